@@ -40,6 +40,10 @@ class MemArena {
 	void ReleaseSpace();
 	void *CreateView(s64 offset, size_t size, void *base = 0);
 	void ReleaseView(s64 offset, void *view, size_t size);
+	// Makes part of a view read-only (or writable again.) Returns false if unsupported,
+	// see SupportsViewProtection.
+	bool ProtectView(void *ptr, size_t size, bool writable);
+	bool SupportsViewProtection() const;
 
 	// This only finds 1 GB in 32-bit
 	u8 *Find4GBBase();
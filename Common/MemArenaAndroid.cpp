@@ -136,6 +136,15 @@ void MemArena::ReleaseView(s64 offset, void* view, size_t size) {
 	munmap(view, size);
 }
 
+bool MemArena::SupportsViewProtection() const {
+	return false;
+}
+
+bool MemArena::ProtectView(void *ptr, size_t size, bool writable) {
+	// Not implemented on this platform yet.
+	return false;
+}
+
 u8* MemArena::Find4GBBase() {
 #if PPSSPP_ARCH(64BIT)
 	// We should probably just go look in /proc/self/maps for some free space.
@@ -84,6 +84,15 @@ void MemArena::ReleaseView(s64 offset, void* view, size_t size) {
 	vm_deallocate(mach_task_self(), addr, size);
 }
 
+bool MemArena::SupportsViewProtection() const {
+	return false;
+}
+
+bool MemArena::ProtectView(void *ptr, size_t size, bool writable) {
+	// Not implemented on this platform yet.
+	return false;
+}
+
 bool MemArena::NeedsProbing() {
 #if PPSSPP_PLATFORM(IOS) && PPSSPP_ARCH(64BIT)
 	return true;
@@ -63,6 +63,15 @@ void MemArena::ReleaseView(s64 offset, void *view, size_t size) {
 		printf("Failed to unmap view...\n");
 }
 
+bool MemArena::SupportsViewProtection() const {
+	return false;
+}
+
+bool MemArena::ProtectView(void *ptr, size_t size, bool writable) {
+	// Not implemented on this platform yet.
+	return false;
+}
+
 u8 *MemArena::Find4GBBase() {
 	memorySrcBase = (uintptr_t)memalign(0x1000, 0x10000000);
 
@@ -135,6 +135,26 @@ void MemArena::ReleaseView(s64 offset, void* view, size_t size) {
 #endif
 }
 
+bool MemArena::SupportsViewProtection() const {
+#ifdef NO_MMAP
+	return false;
+#else
+	return true;
+#endif
+}
+
+bool MemArena::ProtectView(void *ptr, size_t size, bool writable) {
+#ifdef NO_MMAP
+	return false;
+#else
+	if (mprotect(ptr, size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ) != 0) {
+		ERROR_LOG(Log::MemMap, "mprotect on view %p (size %08x) failed: %s", ptr, (int)size, strerror(errno));
+		return false;
+	}
+	return true;
+#endif
+}
+
 u8* MemArena::Find4GBBase() {
 	// Now, create views in high memory where there's plenty of space.
 #if PPSSPP_ARCH(64BIT) && !defined(USE_ASAN) && !defined(NO_MMAP)
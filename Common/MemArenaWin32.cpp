@@ -61,6 +61,15 @@ void MemArena::ReleaseView(s64 offset, void* view, size_t size) {
 #endif
 }
 
+bool MemArena::SupportsViewProtection() const {
+	return false;
+}
+
+bool MemArena::ProtectView(void *ptr, size_t size, bool writable) {
+	// Not implemented on this platform yet.
+	return false;
+}
+
 bool MemArena::NeedsProbing() {
 #if PPSSPP_ARCH(32BIT)
 	return true;
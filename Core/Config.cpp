@@ -407,6 +407,20 @@ static const ConfigSetting cpuSettings[] = {
 	ConfigSetting("HideSlowWarnings", SETTING(g_Config, bHideSlowWarnings), false, CfgFlag::DEFAULT),
 	ConfigSetting("HideStateWarnings", SETTING(g_Config, bHideStateWarnings), false, CfgFlag::DEFAULT),
 	ConfigSetting("JitDisableFlags", SETTING(g_Config, uJitDisableFlags), (uint32_t)0, CfgFlag::PER_GAME),
+	ConfigSetting("IRBlockCache", SETTING(g_Config, bIRBlockCache), false, CfgFlag::PER_GAME),
+	ConfigSetting("JitColdBlockRuns", SETTING(g_Config, iJitColdBlockRuns), 0, CfgFlag::PER_GAME),
+	ConfigSetting("IRSuperblocks", SETTING(g_Config, bIRSuperblocks), false, CfgFlag::PER_GAME),
+	ConfigSetting("IRThreadedDispatch", SETTING(g_Config, bIRThreadedDispatch), false, CfgFlag::PER_GAME),
+	ConfigSetting("JitWriteProtect", SETTING(g_Config, bJitWriteProtect), false, CfgFlag::PER_GAME),
+	ConfigSetting("IRFunctionRegions", SETTING(g_Config, bIRFunctionRegions), false, CfgFlag::PER_GAME),
+	ConfigSetting("FuncScanCache", SETTING(g_Config, bFuncScanCache), false, CfgFlag::PER_GAME),
+	ConfigSetting("IRIdleLoops", SETTING(g_Config, bIRIdleLoops), false, CfgFlag::PER_GAME),
+	ConfigSetting("FuncPatternReplacements", SETTING(g_Config, bFuncPatternReplacements), false, CfgFlag::PER_GAME),
+	ConfigSetting("JitPerfMap", SETTING(g_Config, iJitPerfMap), 0, CfgFlag::PER_GAME),
+	ConfigSetting("IRDirectSyscalls", SETTING(g_Config, bIRDirectSyscalls), false, CfgFlag::PER_GAME),
+	ConfigSetting("IOWorkerThreads", SETTING(g_Config, iIOWorkerThreads), 2, CfgFlag::PER_GAME),
+	ConfigSetting("ISOReadAhead", SETTING(g_Config, bISOReadAhead), true, CfgFlag::PER_GAME),
+	ConfigSetting("PathCaseCache", SETTING(g_Config, bPathCaseCache), true, CfgFlag::PER_GAME),
 	ConfigSetting("CPUSpeed", SETTING(g_Config, iLockedCPUSpeed), 0, CfgFlag::PER_GAME | CfgFlag::REPORT),
 };
 
@@ -221,6 +221,20 @@ struct Config : public ConfigBlock {
 	bool bHideSlowWarnings;
 	bool bHideStateWarnings;
 	uint32_t uJitDisableFlags;
+	bool bIRBlockCache;  // Hidden ini-only setting, persists compiled IR blocks per game.
+	int iJitColdBlockRuns;  // Hidden ini-only setting. Runs in the IR interpreter before a block gets native code, 0 compiles it right away. Saves code space, compiles are still on the emu thread.
+	bool bIRSuperblocks;  // Hidden ini-only setting, lets IR blocks continue through forward branches.
+	bool bIRThreadedDispatch;  // Hidden ini-only setting, uses computed goto dispatch in the IR interpreter.
+	bool bJitWriteProtect;  // Hidden ini-only setting, write protects compiled code pages to skip unneeded invalidations.
+	bool bIRFunctionRegions;  // Hidden ini-only setting, compiles IR blocks up to the end of the enclosing function.
+	bool bFuncScanCache;  // Hidden ini-only setting, caches function scan results per module for later boots.
+	bool bIRIdleLoops;  // Hidden ini-only setting, skips ahead to the next event in IR blocks that only poll memory.
+	bool bFuncPatternReplacements;  // Hidden ini-only setting, also replaces unknown functions that are plain memcpy/memset/strlen byte loops.
+	int iJitPerfMap;  // Hidden ini-only setting. 1 writes /tmp/perf-PID.map for perf, 2 also writes a jitdump for perf inject.
+	bool bIRDirectSyscalls;  // Hidden ini-only setting, lets IR interpreter blocks continue after a few hot, simple syscalls.
+	int iIOWorkerThreads;  // Hidden ini-only setting, number of threads running async file reads and writes (1-8.)
+	bool bISOReadAhead;  // Hidden ini-only setting, reads ahead in the background for files read sequentially from an ISO.
+	bool bPathCaseCache;  // Hidden ini-only setting, remembers the real case of file names on case-sensitive host file systems.
 
 	bool bDisableHTTPS;
 
@@ -15,6 +15,7 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
 #include <atomic>
 #include <climits>
 #include <cstdio>
@@ -25,6 +26,7 @@
 
 #include "Common/Profiler/Profiler.h"
 
+#include "Common/Data/Collections/LinkedList.h"
 #include "Common/Serialize/Serializer.h"
 #include "Common/Serialize/SerializeList.h"
 #include "Core/CoreTiming.h"
@@ -49,8 +51,7 @@ static std::set<int> usedEventTypes;
 static std::set<int> restoredEventTypes;
 static int nextEventTypeRestoreId = -1;
 
-static Event *first;
-static Event *eventPool = 0;
+static EventQueue events;
 
 // Downcount has been moved to currentMIPS, to save a couple of clocks in every ARM JIT block
 // as we can already reach that structure through a register.
@@ -105,28 +106,163 @@ u64 GetGlobalTimeUs() {
 	return lastGlobalTimeUs + usSinceLast;
 }
 
-const Event *GetFirstEvent() {
-	return first;
+void EventQueue::Push(const BaseEvent &ev) {
+	u32 slot;
+	if (!freeSlots_.empty()) {
+		slot = freeSlots_.back();
+		freeSlots_.pop_back();
+	} else {
+		slot = (u32)slots_.size();
+		slots_.push_back(Slot{});
+	}
+	slots_[slot].ev = ev;
+	slots_[slot].order = nextOrder_++;
+
+	heap_.push_back(slot);
+	slots_[slot].heapIndex = (u32)heap_.size() - 1;
+	SiftUp((u32)heap_.size() - 1);
+	IndexFor(ev.type).emplace(ev.userdata, slot);
 }
 
-const std::vector<EventType> &GetEventTypes() {
-	return event_types;
+BaseEvent EventQueue::Pop() {
+	_dbg_assert_(!heap_.empty());
+	u32 slot = heap_[0];
+	BaseEvent ev = slots_[slot].ev;
+	RemoveSlot(slot);
+	return ev;
 }
 
-Event* GetNewEvent()
-{
-	if(!eventPool)
-		return new Event;
+bool EventQueue::Remove(int type, u64 userdata, s64 *lastTime) {
+	UserdataIndex &index = IndexFor(type);
+	auto range = index.equal_range(userdata);
+	u32 last = (u32)-1;
+	std::vector<u32> matches;
+	for (auto it = range.first; it != range.second; ++it) {
+		if (slots_[it->second].ev.type != type)
+			continue;
+		matches.push_back(it->second);
+		if (last == (u32)-1 || Before(last, it->second))
+			last = it->second;
+	}
+	if (matches.empty())
+		return false;
 
-	Event* ev = eventPool;
-	eventPool = ev->next;
-	return ev;
+	*lastTime = slots_[last].ev.time;
+	for (u32 slot : matches)
+		RemoveSlot(slot);
+	return true;
 }
 
-void FreeEvent(Event* ev)
-{
-	ev->next = eventPool;
-	eventPool = ev;
+void EventQueue::RemoveType(int type) {
+	UserdataIndex &index = IndexFor(type);
+	std::vector<u32> matches;
+	for (const auto &it : index) {
+		if (slots_[it.second].ev.type == type)
+			matches.push_back(it.second);
+	}
+	for (u32 slot : matches)
+		RemoveSlot(slot);
+}
+
+bool EventQueue::HasType(int type) const {
+	const UserdataIndex *index = FindIndex(type);
+	if (!index)
+		return false;
+	for (const auto &it : *index) {
+		if (slots_[it.second].ev.type == type)
+			return true;
+	}
+	return false;
+}
+
+void EventQueue::Clear() {
+	heap_.clear();
+	slots_.clear();
+	freeSlots_.clear();
+	byType_.clear();
+}
+
+void EventQueue::GetSorted(std::vector<BaseEvent> &events) const {
+	std::vector<u32> sorted = heap_;
+	std::sort(sorted.begin(), sorted.end(), [this](u32 a, u32 b) {
+		return Before(a, b);
+	});
+	events.reserve(events.size() + sorted.size());
+	for (u32 slot : sorted)
+		events.push_back(slots_[slot].ev);
+}
+
+void EventQueue::SiftUp(u32 pos) {
+	u32 slot = heap_[pos];
+	while (pos > 0) {
+		u32 parent = (pos - 1) / 2;
+		if (!Before(slot, heap_[parent]))
+			break;
+		Place(pos, heap_[parent]);
+		pos = parent;
+	}
+	Place(pos, slot);
+}
+
+void EventQueue::SiftDown(u32 pos) {
+	const u32 size = (u32)heap_.size();
+	u32 slot = heap_[pos];
+	while (true) {
+		u32 child = pos * 2 + 1;
+		if (child >= size)
+			break;
+		if (child + 1 < size && Before(heap_[child + 1], heap_[child]))
+			child++;
+		if (!Before(heap_[child], slot))
+			break;
+		Place(pos, heap_[child]);
+		pos = child;
+	}
+	Place(pos, slot);
+}
+
+void EventQueue::RemoveSlot(u32 slot) {
+	UserdataIndex &index = IndexFor(slots_[slot].ev.type);
+	auto range = index.equal_range(slots_[slot].ev.userdata);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second == slot) {
+			index.erase(it);
+			break;
+		}
+	}
+
+	u32 pos = slots_[slot].heapIndex;
+	u32 lastSlot = heap_.back();
+	heap_.pop_back();
+	if (lastSlot != slot) {
+		// Move the last one into the hole, it might need to go either way.
+		Place(pos, lastSlot);
+		SiftUp(pos);
+		SiftDown(slots_[lastSlot].heapIndex);
+	}
+	freeSlots_.push_back(slot);
+}
+
+EventQueue::UserdataIndex &EventQueue::IndexFor(int type) {
+	size_t i = type >= 0 ? (size_t)type + 1 : 0;
+	if (i >= byType_.size())
+		byType_.resize(i + 1);
+	return byType_[i];
+}
+
+const EventQueue::UserdataIndex *EventQueue::FindIndex(int type) const {
+	size_t i = type >= 0 ? (size_t)type + 1 : 0;
+	return i < byType_.size() ? &byType_[i] : nullptr;
+}
+
+std::vector<BaseEvent> GetPendingEvents() {
+	std::vector<BaseEvent> pending;
+	events.GetSorted(pending);
+	return pending;
+}
+
+const std::vector<EventType> &GetEventTypes() {
+	return event_types;
 }
 
 int RegisterEvent(const char *name, TimedCallback callback) {
@@ -172,7 +308,7 @@ void RestoreRegisterEvent(int &event_type, const char *name, TimedCallback callb
 }
 
 void UnregisterAllEvents() {
-	_dbg_assert_msg_(first == nullptr, "Unregistering events with events pending - this isn't good.");
+	_dbg_assert_msg_(events.Empty(), "Unregistering events with events pending - this isn't good.");
 	event_types.clear();
 	usedEventTypes.clear();
 	restoredEventTypes.clear();
@@ -193,12 +329,6 @@ void Shutdown()
 {
 	ClearPendingEvents();
 	UnregisterAllEvents();
-
-	while (eventPool) {
-		Event *ev = eventPool;
-		eventPool = ev->next;
-		delete ev;
-	}
 }
  
 u64 GetTicks()
@@ -218,30 +348,7 @@ u64 GetIdleTicks()
 
 void ClearPendingEvents()
 {
-	while (first)
-	{
-		Event *e = first->next;
-		FreeEvent(first);
-		first = e;
-	}
-}
-
-void AddEventToQueue(Event* ne)
-{
-	Event* prev = NULL;
-	Event** pNext = &first;
-	for(;;)
-	{
-		Event*& next = *pNext;
-		if(!next || ne->time < next->time)
-		{
-			ne->next = next;
-			next = ne;
-			break;
-		}
-		prev = next;
-		pNext = &prev->next;
-	}
+	events.Clear();
 }
 
 // This must be run ONLY from within the cpu thread
@@ -249,119 +356,37 @@ void AddEventToQueue(Event* ne)
 // than Advance
 void ScheduleEvent(s64 cyclesIntoFuture, int event_type, u64 userdata)
 {
-	Event *ne = GetNewEvent();
-	ne->userdata = userdata;
-	ne->type = event_type;
-	ne->time = GetTicks() + cyclesIntoFuture;
-	AddEventToQueue(ne);
+	events.Push(BaseEvent{ (s64)GetTicks() + cyclesIntoFuture, userdata, event_type });
 }
 
 // Returns cycles left in timer.
 s64 UnscheduleEvent(int event_type, u64 userdata)
 {
-	s64 result = 0;
-	if (!first)
-		return result;
-	while(first)
-	{
-		if (first->type == event_type && first->userdata == userdata)
-		{
-			result = first->time - GetTicks();
-
-			Event *next = first->next;
-			FreeEvent(first);
-			first = next;
-		}
-		else
-		{
-			break;
-		}
-	}
-	if (!first)
-		return result;
-	Event *prev = first;
-	Event *ptr = prev->next;
-	while (ptr)
-	{
-		if (ptr->type == event_type && ptr->userdata == userdata)
-		{
-			result = ptr->time - GetTicks();
-
-			prev->next = ptr->next;
-			FreeEvent(ptr);
-			ptr = prev->next;
-		}
-		else
-		{
-			prev = ptr;
-			ptr = ptr->next;
-		}
-	}
-
-	return result;
+	s64 time;
+	if (!events.Remove(event_type, userdata, &time))
+		return 0;
+	return time - GetTicks();
 }
 
 bool IsScheduled(int event_type) {
-	if (!first)
-		return false;
-	Event *e = first;
-	while (e) {
-		if (e->type == event_type)
-			return true;
-		e = e->next;
-	}
-	return false;
+	return events.HasType(event_type);
 }
 
 void RemoveEvent(int event_type)
 {
-	if (!first)
-		return;
-	while(first)
-	{
-		if (first->type == event_type)
-		{
-			Event *next = first->next;
-			FreeEvent(first);
-			first = next;
-		}
-		else
-		{
-			break;
-		}
-	}
-	if (!first)
-		return;
-	Event *prev = first;
-	Event *ptr = prev->next;
-	while (ptr)
-	{
-		if (ptr->type == event_type)
-		{
-			prev->next = ptr->next;
-			FreeEvent(ptr);
-			ptr = prev->next;
-		}
-		else
-		{
-			prev = ptr;
-			ptr = ptr->next;
-		}
-	}
+	events.RemoveType(event_type);
 }
 
 void ProcessEvents() {
-	while (first) {
-		if (first->time <= (s64)GetTicks()) {
-			// INFO_LOG(Log::CPU, "%s (%lld, %lld) ", first->name ? first->name : "?", (u64)GetTicks(), (u64)first->time);
-			Event *evt = first;
-			first = first->next;
-			if (evt->type >= 0 && evt->type < event_types.size()) {
-				event_types[evt->type].callback(evt->userdata, (int)(GetTicks() - evt->time));
+	while (!events.Empty()) {
+		if (events.Top()->time <= (s64)GetTicks()) {
+			BaseEvent evt = events.Pop();
+			// INFO_LOG(Log::CPU, "%s (%lld, %lld) ", evt.type name, (u64)GetTicks(), (u64)evt.time);
+			if (evt.type >= 0 && evt.type < event_types.size()) {
+				event_types[evt.type].callback(evt.userdata, (int)(GetTicks() - evt.time));
 			} else {
-				_dbg_assert_msg_(false, "Bad event type %d", evt->type);
+				_dbg_assert_msg_(false, "Bad event type %d", evt.type);
 			}
-			FreeEvent(evt);
 		} else {
 			// Caught up to the current time.
 			break;
@@ -391,6 +416,7 @@ void Advance() {
 
 	ProcessEvents();
 
+	const BaseEvent *first = events.Top();
 	if (!first) {
 		// This should never happen in PPSSPP.
 		if (slicelength < 10000) {
@@ -410,10 +436,8 @@ void Advance() {
 }
 
 void LogPendingEvents() {
-	Event *ptr = first;
-	while (ptr) {
-		//INFO_LOG(Log::CPU, "PENDING: Now: %lld Pending: %lld Type: %d", globalTimer, ptr->time, ptr->type);
-		ptr = ptr->next;
+	for (const BaseEvent &ev : GetPendingEvents()) {
+		VERBOSE_LOG(Log::CPU, "PENDING: Now: %lld Pending: %lld Type: %d", (long long)globalTimer, (long long)ev.time, ev.type);
 	}
 }
 
@@ -422,6 +446,7 @@ void Idle(int maxIdle) {
 	if (maxIdle != 0 && cyclesDown > maxIdle)
 		cyclesDown = maxIdle;
 
+	const BaseEvent *first = events.Top();
 	if (first && cyclesDown > 0) {
 		int cyclesExecuted = slicelength - currentMIPS->downcount;
 		int cyclesNextEvent = (int) (first->time - globalTimer);
@@ -443,27 +468,34 @@ void Idle(int maxIdle) {
 }
 
 std::string GetScheduledEventsSummary() {
-	Event *ptr = first;
 	std::string text = "Scheduled events\n";
 	text.reserve(1000);
-	while (ptr) {
-		unsigned int t = ptr->type;
+	for (const BaseEvent &ev : GetPendingEvents()) {
+		unsigned int t = ev.type;
 		if (t >= event_types.size()) {
 			_dbg_assert_msg_(false, "Invalid event type %d", t);
-			ptr = ptr->next;
 			continue;
 		}
 		const char *name = event_types[t].name;
 		if (!name)
 			name = "[unknown]";
 		char temp[512];
-		snprintf(temp, sizeof(temp), "%s : %i %08x%08x\n", name, (int)ptr->time, (u32)(ptr->userdata >> 32), (u32)(ptr->userdata));
+		snprintf(temp, sizeof(temp), "%s : %i %08x%08x\n", name, (int)ev.time, (u32)(ev.userdata >> 32), (u32)(ev.userdata));
 		text += temp;
-		ptr = ptr->next;
 	}
 	return text;
 }
 
+typedef LinkedListItem<BaseEvent> Event;
+
+static Event *NewStateEvent() {
+	return new Event;
+}
+
+static void FreeStateEvent(Event *ev) {
+	delete ev;
+}
+
 void Event_DoState(PointerWrap &p, BaseEvent *ev) {
 	// There may be padding, so do each one individually.
 	Do(p, ev->time);
@@ -500,15 +532,39 @@ void DoState(PointerWrap &p) {
 	usedEventTypes.clear();
 	restoredEventTypes.clear();
 
+	// States store the events as a linked list in order, so convert to and from that.
+	Event *first = nullptr;
+	if (p.mode != PointerWrap::MODE_READ) {
+		Event **tail = &first;
+		for (const BaseEvent &ev : GetPendingEvents()) {
+			Event *item = NewStateEvent();
+			*(BaseEvent *)item = ev;
+			item->next = nullptr;
+			*tail = item;
+			tail = &item->next;
+		}
+	}
+
 	if (s >= 3) {
-		DoLinkedList<BaseEvent, GetNewEvent, FreeEvent, Event_DoState>(p, first, (Event **)nullptr);
+		DoLinkedList<BaseEvent, NewStateEvent, FreeStateEvent, Event_DoState>(p, first, (Event **)nullptr);
 		// This is here because we previously stored a second queue of "threadsafe" events. Gone now. Remove in the next section version upgrade.
 		DoIgnoreUnusedLinkedList(p);
 	} else {
-		DoLinkedList<BaseEvent, GetNewEvent, FreeEvent, Event_DoStateOld>(p, first, (Event **)nullptr);
+		DoLinkedList<BaseEvent, NewStateEvent, FreeStateEvent, Event_DoStateOld>(p, first, (Event **)nullptr);
 		DoIgnoreUnusedLinkedList(p);
 	}
 
+	if (p.mode == PointerWrap::MODE_READ)
+		events.Clear();
+	while (first) {
+		Event *next = first->next;
+		// Pushing in list order keeps events at the same time in the same order.
+		if (p.mode == PointerWrap::MODE_READ)
+			events.Push(*first);
+		FreeStateEvent(first);
+		first = next;
+	}
+
 	Do(p, CPU_HZ);
 	Do(p, slicelength);
 	Do(p, globalTimer);
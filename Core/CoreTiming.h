@@ -18,9 +18,9 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "Common/CommonTypes.h"
-#include "Common/Data/Collections/LinkedList.h"
 
 // This is a system to schedule events into the emulated machine's future. Time is measured
 // in main CPU clock cycles.
@@ -85,7 +85,63 @@ namespace CoreTiming {
 		u64 userdata;
 		int type;
 	};
-	typedef LinkedListItem<BaseEvent> Event;
+
+	// Pending events, in the order they'll run: by time, and then in the order they were scheduled.
+	// This is a binary heap, with an index by type and userdata so removing doesn't need a scan.
+	class EventQueue {
+	public:
+		void Push(const BaseEvent &ev);
+		// The next event to run, or nullptr.
+		const BaseEvent *Top() const {
+			return heap_.empty() ? nullptr : &slots_[heap_[0]].ev;
+		}
+		BaseEvent Pop();
+		// Removes every event with this type and userdata. Returns false if there were none,
+		// otherwise lastTime is the time of the one that would have run last.
+		bool Remove(int type, u64 userdata, s64 *lastTime);
+		void RemoveType(int type);
+		bool HasType(int type) const;
+		void Clear();
+
+		bool Empty() const {
+			return heap_.empty();
+		}
+		size_t Size() const {
+			return heap_.size();
+		}
+		// Appends the events in the order they'll run.
+		void GetSorted(std::vector<BaseEvent> &events) const;
+
+	private:
+		struct Slot {
+			BaseEvent ev;
+			u64 order;
+			u32 heapIndex;
+		};
+		typedef std::unordered_multimap<u64, u32> UserdataIndex;
+
+		bool Before(u32 a, u32 b) const {
+			const Slot &sa = slots_[a];
+			const Slot &sb = slots_[b];
+			return sa.ev.time < sb.ev.time || (sa.ev.time == sb.ev.time && sa.order < sb.order);
+		}
+		void Place(u32 pos, u32 slot) {
+			heap_[pos] = slot;
+			slots_[slot].heapIndex = pos;
+		}
+		void SiftUp(u32 pos);
+		void SiftDown(u32 pos);
+		void RemoveSlot(u32 slot);
+		UserdataIndex &IndexFor(int type);
+		const UserdataIndex *FindIndex(int type) const;
+
+		std::vector<u32> heap_;
+		std::vector<Slot> slots_;
+		std::vector<u32> freeSlots_;
+		// By type + 1, with the bad types (from broken save states) at 0.
+		std::vector<UserdataIndex> byType_;
+		u64 nextOrder_ = 0;
+	};
 
 	void Init();
 	void Shutdown();
@@ -108,7 +164,8 @@ namespace CoreTiming {
 	s64 UnscheduleEvent(int event_type, u64 userdata);
 
 	const std::vector<EventType> &GetEventTypes();
-	const Event *GetFirstEvent();
+	// In the order they'll run.
+	std::vector<BaseEvent> GetPendingEvents();
 	void RemoveEvent(int event_type);
 	bool IsScheduled(int event_type);
 	void Advance();
@@ -17,9 +17,12 @@
 
 #include <algorithm>
 #include <atomic>
+#include <cstddef>
 #include <cstring>
 #include <mutex>
 #include <condition_variable>
+#include <map>
+#include <memory>
 #include <thread>
 
 #include "Common/Log.h"
@@ -31,12 +34,14 @@
 #include "Core/Debugger/Breakpoints.h"
 #include "Core/Debugger/MemBlockInfo.h"
 #include "Core/MIPS/MIPS.h"
+#include "Core/MIPS/JitCommon/JitWriteProtect.h"
 #include "Common/StringUtils.h"
 
+// Tracks the latest info for every address as a set of slabs covering the whole range, without gaps
+// or overlaps. Since they never overlap, a tree sorted by start address is enough to find them.
 class MemSlabMap {
 public:
 	MemSlabMap();
-	~MemSlabMap();
 
 	bool Mark(uint32_t addr, uint32_t size, uint64_t ticks, uint32_t pc, bool allocated, const char *tag);
 	bool Find(MemBlockFlags flags, uint32_t addr, uint32_t size, std::vector<MemBlockInfo> &results);
@@ -52,32 +57,24 @@ class MemSlabMap {
 		uint64_t ticks = 0;
 		uint32_t pc = 0;
 		bool allocated = false;
-		// Intentionally not save stated.
-		bool bulkStorage = false;
 		char tag[128]{};
-		Slab *prev = nullptr;
-		Slab *next = nullptr;
 
 		void DoState(PointerWrap &p);
 	};
+	typedef std::map<uint32_t, Slab> SlabTree;
 
 	static constexpr uint32_t MAX_SIZE = 0x40000000;
-	static constexpr uint32_t SLICES = 65536;
-	static constexpr uint32_t SLICE_SIZE = MAX_SIZE / SLICES;
 
-	Slab *FindSlab(uint32_t addr);
-	void Clear();
+	SlabTree::iterator FindSlab(uint32_t addr);
 	// Returns the new slab after size.
-	Slab *Split(Slab *slab, uint32_t size);
-	void MergeAdjacent(Slab *slab);
-	static inline bool Same(const Slab *a, const Slab *b);
-	void Merge(Slab *a, Slab *b);
-	void FillHeads(Slab *slab);
-
-	Slab *first_ = nullptr;
-	Slab *lastFind_ = nullptr;
-	std::vector<Slab *> heads_;
-	Slab *bulkStorage_ = nullptr;
+	SlabTree::iterator Split(SlabTree::iterator slab, uint32_t size);
+	void MergeAdjacent(SlabTree::iterator slab);
+	static inline bool Same(const Slab &a, const Slab &b);
+	// Merges next into slab, which must be right before it.
+	void MergeNext(SlabTree::iterator slab, SlabTree::iterator next);
+
+	SlabTree slabs_;
+	SlabTree::iterator lastFind_;
 };
 
 struct PendingNotifyMem {
@@ -90,20 +87,34 @@ struct PendingNotifyMem {
 	char tag[128];
 };
 
-// 160 KB.
-static constexpr size_t MAX_PENDING_NOTIFIES = 1024;
-static constexpr size_t MAX_PENDING_NOTIFIES_THREAD = 1000;
+// Each thread that notifies gets its own ring, which only it writes to. Flushing (under
+// pendingReadMutex) is the only reader, so neither side needs a lock.
+struct PendingNotifyRing {
+	// 160 KB.
+	static constexpr uint32_t SIZE = 1024;
+
+	PendingNotifyMem entries[SIZE];
+	// Only the owning thread writes head, and only the flush writes tail.
+	std::atomic<uint32_t> head{};
+	std::atomic<uint32_t> tail{};
+	// Cleared when the thread exits, so a new thread can take over the ring.
+	std::atomic<bool> owned{};
+};
+
+// Once a ring has this many, the flush thread is woken up.
+static constexpr uint32_t MAX_PENDING_NOTIFIES_THREAD = 512;
 static MemSlabMap allocMap;
 static MemSlabMap suballocMap;
 static MemSlabMap writeMap;
 static MemSlabMap textureMap;
-static std::vector<PendingNotifyMem> pendingNotifies;
+// Rings are never freed, only handed to a new thread.
+static std::vector<std::unique_ptr<PendingNotifyRing>> pendingRings;
+static std::mutex pendingRingsMutex;
 static std::atomic<uint32_t> pendingNotifyMinAddr1;
 static std::atomic<uint32_t> pendingNotifyMaxAddr1;
 static std::atomic<uint32_t> pendingNotifyMinAddr2;
 static std::atomic<uint32_t> pendingNotifyMaxAddr2;
-// To prevent deadlocks, acquire Read before Write if you're going to acquire both.
-static std::mutex pendingWriteMutex;
+// Held while flushing or looking at the maps.
 static std::mutex pendingReadMutex;
 static int detailedOverride;
 
@@ -117,37 +128,33 @@ MemSlabMap::MemSlabMap() {
 	Reset();
 }
 
-MemSlabMap::~MemSlabMap() {
-	Clear();
-}
-
 bool MemSlabMap::Mark(uint32_t addr, uint32_t size, uint64_t ticks, uint32_t pc, bool allocated, const char *tag) {
 	uint32_t end = addr + size;
-	Slab *slab = FindSlab(addr);
-	Slab *firstMatch = nullptr;
-	while (slab != nullptr && slab->start < end) {
-		if (slab->start < addr)
-			slab = Split(slab, addr - slab->start);
+	SlabTree::iterator slab = FindSlab(addr);
+	SlabTree::iterator firstMatch = slabs_.end();
+	while (slab != slabs_.end() && slab->second.start < end) {
+		if (slab->second.start < addr)
+			slab = Split(slab, addr - slab->second.start);
 		// Don't replace slab, the return is the after part.
-		if (slab->end > end) {
-			Split(slab, end - slab->start);
+		if (slab->second.end > end) {
+			Split(slab, end - slab->second.start);
 		}
 
-		slab->allocated = allocated;
+		slab->second.allocated = allocated;
 		if (pc != 0) {
-			slab->ticks = ticks;
-			slab->pc = pc;
+			slab->second.ticks = ticks;
+			slab->second.pc = pc;
 		}
 		if (tag)
-			truncate_cpy(slab->tag, tag);
+			truncate_cpy(slab->second.tag, tag);
 
 		// Move on to the next one.
-		if (firstMatch == nullptr)
+		if (firstMatch == slabs_.end())
 			firstMatch = slab;
-		slab = slab->next;
+		++slab;
 	}
 
-	if (firstMatch != nullptr) {
+	if (firstMatch != slabs_.end()) {
 		// This will merge all those blocks to one.
 		MergeAdjacent(firstMatch);
 		return true;
@@ -157,38 +164,37 @@ bool MemSlabMap::Mark(uint32_t addr, uint32_t size, uint64_t ticks, uint32_t pc,
 
 bool MemSlabMap::Find(MemBlockFlags flags, uint32_t addr, uint32_t size, std::vector<MemBlockInfo> &results) {
 	uint32_t end = addr + size;
-	Slab *slab = FindSlab(addr);
+	SlabTree::iterator slab = FindSlab(addr);
 	bool found = false;
-	while (slab != nullptr && slab->start < end) {
-		if (slab->pc != 0 || slab->tag[0] != '\0') {
-			results.push_back({ flags, slab->start, slab->end - slab->start, slab->ticks, slab->pc, slab->tag, slab->allocated });
+	while (slab != slabs_.end() && slab->second.start < end) {
+		const Slab &s = slab->second;
+		if (s.pc != 0 || s.tag[0] != '\0') {
+			results.push_back({ flags, s.start, s.end - s.start, s.ticks, s.pc, s.tag, s.allocated });
 			found = true;
 		}
-		slab = slab->next;
+		++slab;
 	}
 	return found;
 }
 
 const char *MemSlabMap::FastFindWriteTag(MemBlockFlags flags, uint32_t addr, uint32_t size) {
 	uint32_t end = addr + size;
-	Slab *slab = FindSlab(addr);
-	while (slab != nullptr && slab->start < end) {
-		if (slab->pc != 0 || slab->tag[0] != '\0') {
-			return slab->tag;
+	SlabTree::iterator slab = FindSlab(addr);
+	while (slab != slabs_.end() && slab->second.start < end) {
+		if (slab->second.pc != 0 || slab->second.tag[0] != '\0') {
+			return slab->second.tag;
 		}
-		slab = slab->next;
+		++slab;
 	}
 	return nullptr;
 }
 
 void MemSlabMap::Reset() {
-	Clear();
-
-	first_ = new Slab();
-	first_->end = MAX_SIZE;
-	lastFind_ = first_;
+	slabs_.clear();
 
-	heads_.resize(SLICES, first_);
+	Slab first;
+	first.end = MAX_SIZE;
+	lastFind_ = slabs_.emplace(0, first).first;
 }
 
 void MemSlabMap::DoState(PointerWrap &p) {
@@ -198,56 +204,26 @@ void MemSlabMap::DoState(PointerWrap &p) {
 
 	int count = 0;
 	if (p.mode == p.MODE_READ) {
-		// Since heads_ is a static size, let's avoid clearing it.
-		// This helps in case a debugger call happens concurrently.
-		Slab *old = first_;
-		Slab *oldBulk = bulkStorage_;
 		Do(p, count);
 
-		first_ = new Slab();
-		first_->DoState(p);
-		lastFind_ = first_;
-		--count;
-
-		FillHeads(first_);
-
-		bulkStorage_ = new Slab[count];
-
-		Slab *slab = first_;
+		SlabTree slabs;
 		for (int i = 0; i < count; ++i) {
-			slab->next = &bulkStorage_[i];
-			slab->next->bulkStorage = true;
-			slab->next->DoState(p);
-
-			slab->next->prev = slab;
-			slab = slab->next;
-
-			FillHeads(slab);
+			Slab slab;
+			slab.DoState(p);
+			slabs.emplace_hint(slabs.end(), slab.start, slab);
 		}
-
-		// Now that it's entirely disconnected, delete the old slabs.
-		while (old != nullptr) {
-			Slab *next = old->next;
-			if (!old->bulkStorage)
-				delete old;
-			old = next;
+		if (slabs.empty() || slabs.begin()->first != 0) {
+			p.SetError(p.ERROR_FAILURE);
+			return;
 		}
-		delete [] oldBulk;
+		slabs_.swap(slabs);
+		lastFind_ = slabs_.begin();
 	} else {
-		for (Slab *slab = first_; slab != nullptr; slab = slab->next)
-			++count;
+		count = (int)slabs_.size();
 		Do(p, count);
 
-		first_->DoState(p);
-		--count;
-
-		Slab *slab = first_;
-		for (int i = 0; i < count; ++i) {
-			if (slab->next) {
-				slab->next->DoState(p);
-				slab = slab->next;
-			}
-		}
+		for (auto &slab : slabs_)
+			slab.second.DoState(p);
 	}
 }
 
@@ -274,152 +250,157 @@ void MemSlabMap::Slab::DoState(PointerWrap &p) {
 	}
 }
 
-void MemSlabMap::Clear() {
-	Slab *s = first_;
-	while (s != nullptr) {
-		Slab *next = s->next;
-		if (!s->bulkStorage)
-			delete s;
-		s = next;
-	}
-	delete [] bulkStorage_;
-	bulkStorage_ = nullptr;
-	first_ = nullptr;
-	lastFind_ = nullptr;
-	heads_.clear();
-}
-
-MemSlabMap::Slab *MemSlabMap::FindSlab(uint32_t addr) {
-	// Jump ahead using our index.
-	Slab *slab = heads_[addr / SLICE_SIZE];
-	// We often move forward, so check the last find.
-	if (lastFind_->start > slab->start && lastFind_->start <= addr)
-		slab = lastFind_;
-
-	while (slab != nullptr && slab->start <= addr) {
-		if (slab->end > addr) {
-			lastFind_ = slab;
-			return slab;
+MemSlabMap::SlabTree::iterator MemSlabMap::FindSlab(uint32_t addr) {
+	// We often move forward, so check the last find and the one after it first.
+	if (lastFind_->second.start <= addr) {
+		if (lastFind_->second.end > addr)
+			return lastFind_;
+		SlabTree::iterator next = std::next(lastFind_);
+		if (next != slabs_.end() && next->second.end > addr) {
+			lastFind_ = next;
+			return next;
 		}
-		slab = slab->next;
 	}
-	return nullptr;
-}
-
-MemSlabMap::Slab *MemSlabMap::Split(Slab *slab, uint32_t size) {
-	Slab *next = new Slab();
-	next->start = slab->start + size;
-	next->end = slab->end;
-	next->ticks = slab->ticks;
-	next->pc = slab->pc;
-	next->allocated = slab->allocated;
-	truncate_cpy(next->tag, slab->tag);
-	next->prev = slab;
-	next->next = slab->next;
-
-	slab->next = next;
-	if (next->next)
-		next->next->prev = next;
 
-	// If the split is big, we might have to update our index.
-	FillHeads(next);
+	SlabTree::iterator slab = slabs_.upper_bound(addr);
+	if (slab == slabs_.begin())
+		return slabs_.end();
+	--slab;
+	if (slab->second.end <= addr)
+		return slabs_.end();
+	lastFind_ = slab;
+	return slab;
+}
 
-	slab->end = slab->start + size;
-	return next;
+MemSlabMap::SlabTree::iterator MemSlabMap::Split(SlabTree::iterator slab, uint32_t size) {
+	Slab next = slab->second;
+	next.start = slab->second.start + size;
+	slab->second.end = next.start;
+	return slabs_.emplace_hint(std::next(slab), next.start, next);
 }
 
-bool MemSlabMap::Same(const Slab *a, const Slab *b) {
-	if (a->allocated != b->allocated)
+bool MemSlabMap::Same(const Slab &a, const Slab &b) {
+	if (a.allocated != b.allocated)
 		return false;
-	if (a->pc != b->pc)
+	if (a.pc != b.pc)
 		return false;
-	if (strcmp(a->tag, b->tag))
+	if (strcmp(a.tag, b.tag))
 		return false;
 	return true;
 }
 
-void MemSlabMap::MergeAdjacent(Slab *slab) {
-	while (slab->next != nullptr && Same(slab, slab->next)) {
-		Merge(slab, slab->next);
+void MemSlabMap::MergeAdjacent(SlabTree::iterator slab) {
+	SlabTree::iterator next = std::next(slab);
+	while (next != slabs_.end() && Same(slab->second, next->second)) {
+		MergeNext(slab, next);
+		next = std::next(slab);
 	}
-	while (slab->prev != nullptr && Same(slab, slab->prev)) {
-		Merge(slab, slab->prev);
+	while (slab != slabs_.begin()) {
+		SlabTree::iterator prev = std::prev(slab);
+		if (!Same(slab->second, prev->second))
+			break;
+		MergeNext(prev, slab);
+		slab = prev;
 	}
 }
 
-void MemSlabMap::Merge(Slab *a, Slab *b) {
-	if (a->next == b) {
-		_assert_(a->end == b->start);
-		a->end = b->end;
-		a->next = b->next;
+void MemSlabMap::MergeNext(SlabTree::iterator slab, SlabTree::iterator next) {
+	Slab &a = slab->second;
+	const Slab &b = next->second;
+	_assert_(a.end == b.start);
+	a.end = b.end;
+	// Keep the newest info.  The tags and PCs are the same, or we wouldn't merge.
+	if (b.ticks > a.ticks)
+		a.ticks = b.ticks;
+	if (lastFind_ == next)
+		lastFind_ = slab;
+	slabs_.erase(next);
+}
 
-		if (a->next)
-			a->next->prev = a;
-	} else if (a->prev == b) {
-		_assert_(b->end == a->start);
-		a->start = b->start;
-		a->prev = b->prev;
+static size_t FormatMemWriteTagAtNoFlush(char *buf, size_t sz, const char *prefix, uint32_t start, uint32_t size);
 
-		if (a->prev)
-			a->prev->next = a;
-		else if (first_ == b)
-			first_ = a;
-	} else {
-		_assert_(false);
-	}
-	// Take over index entries b had.
-	FillHeads(a);
-	if (b->ticks > a->ticks) {
-		a->ticks = b->ticks;
-		// In case we ignore PC for same.
-		a->pc = b->pc;
-	}
-	if (lastFind_ == b)
-		lastFind_ = a;
-	if (!b->bulkStorage)
-		delete b;
-}
+static inline bool MergeRecentMemInfo(std::vector<PendingNotifyMem *> &batch, const PendingNotifyMem &info) {
+	if (batch.size() < 4)
+		return false;
 
-void MemSlabMap::FillHeads(Slab *slab) {
-	uint32_t slice = slab->start / SLICE_SIZE;
-	uint32_t endSlice = (slab->end - 1) / SLICE_SIZE;
+	for (size_t i = 1; i <= 4; ++i) {
+		auto &prev = *batch[batch.size() - i];
+		if (prev.copySrc != 0)
+			return false;
 
-	// For the first slice, only replace if it's the one we're removing.
-	if (slab->start == slice * SLICE_SIZE) {
-		heads_[slice] = slab;
-	}
+		if (prev.flags != info.flags)
+			continue;
 
-	// Now replace all the rest - we definitely cover the start of them.
-	Slab **next = &heads_[slice + 1];
-	// We want to set slice + 1 through endSlice, inclusive.
-	size_t c = endSlice - slice;
-	for (size_t i = 0; i < c; ++i) {
-		next[i] = slab;
+		if (prev.start >= info.start + info.size || prev.start + prev.size <= info.start)
+			continue;
+
+		// This means there's overlap, but not a match, so we can't combine any.
+		if (prev.start != info.start || prev.size > info.size)
+			return false;
+
+		memcpy(prev.tag, info.tag, sizeof(prev.tag));
+		prev.size = info.size;
+		prev.ticks = info.ticks;
+		prev.pc = info.pc;
+		return true;
 	}
+
+	return false;
 }
 
-size_t FormatMemWriteTagAtNoFlush(char *buf, size_t sz, const char *prefix, uint32_t start, uint32_t size);
+// Must hold pendingReadMutex.
+static void FlushPendingMemInfoLocked() {
+	// Only used here, kept around to avoid reallocating.
+	static std::vector<PendingNotifyMem *> thisBatch;
+	static std::vector<PendingNotifyMem *> merged;
+	static std::vector<std::pair<PendingNotifyRing *, uint32_t>> rings;
+
+	// Reset before taking the entries.  Anything added after that updates the range again.
+	pendingNotifyMinAddr1 = 0xFFFFFFFF;
+	pendingNotifyMaxAddr1 = 0;
+	pendingNotifyMinAddr2 = 0xFFFFFFFF;
+	pendingNotifyMaxAddr2 = 0;
 
-void FlushPendingMemInfo() {
-	// This lock prevents us from another thread reading while we're busy flushing.
-	std::lock_guard<std::mutex> guard(pendingReadMutex);
-	std::vector<PendingNotifyMem> thisBatch;
 	{
-		std::lock_guard<std::mutex> guard(pendingWriteMutex);
-		thisBatch = std::move(pendingNotifies);
-		pendingNotifies.clear();
-		pendingNotifies.reserve(MAX_PENDING_NOTIFIES);
+		std::lock_guard<std::mutex> guard(pendingRingsMutex);
+		rings.clear();
+		for (auto &ring : pendingRings)
+			rings.emplace_back(ring.get(), 0);
+	}
+
+	// The entries are used in place, their slots are only given back to the thread at the end.
+	thisBatch.clear();
+	int ringsWithEntries = 0;
+	for (auto &ring : rings) {
+		uint32_t head = ring.first->head.load(std::memory_order_acquire);
+		uint32_t tail = ring.first->tail.load(std::memory_order_relaxed);
+		ring.second = head;
+		if (head == tail)
+			continue;
+		for (uint32_t i = tail; i != head; ++i)
+			thisBatch.push_back(&ring.first->entries[i % PendingNotifyRing::SIZE]);
+		ringsWithEntries++;
+	}
 
-		pendingNotifyMinAddr1 = 0xFFFFFFFF;
-		pendingNotifyMaxAddr1 = 0;
-		pendingNotifyMinAddr2 = 0xFFFFFFFF;
-		pendingNotifyMaxAddr2 = 0;
+	// Each thread's entries are in order, but they need to be interleaved by time.
+	if (ringsWithEntries > 1) {
+		std::stable_sort(thisBatch.begin(), thisBatch.end(), [](const PendingNotifyMem *a, const PendingNotifyMem *b) {
+			return a->ticks < b->ticks;
+		});
 	}
 
-	for (const auto &info : thisBatch) {
+	// Sometimes we get duplicates, quickly check.
+	merged.clear();
+	for (PendingNotifyMem *info : thisBatch) {
+		if (info->copySrc != 0 || !MergeRecentMemInfo(merged, *info))
+			merged.push_back(info);
+	}
+
+	for (const PendingNotifyMem *entry : merged) {
+		const PendingNotifyMem &info = *entry;
 		if (info.copySrc != 0) {
 			char tagData[128];
-			size_t tagSize = FormatMemWriteTagAtNoFlush(tagData, sizeof(tagData), info.tag, info.copySrc, info.size);
+			FormatMemWriteTagAtNoFlush(tagData, sizeof(tagData), info.tag, info.copySrc, info.size);
 			writeMap.Mark(info.start, info.size, info.ticks, info.pc, true, tagData);
 			continue;
 		}
@@ -444,6 +425,23 @@ void FlushPendingMemInfo() {
 			writeMap.Mark(info.start, info.size, info.ticks, info.pc, true, info.tag);
 		}
 	}
+
+	for (auto &ring : rings)
+		ring.first->tail.store(ring.second, std::memory_order_release);
+}
+
+void FlushPendingMemInfo() {
+	// This lock prevents us from another thread reading while we're busy flushing.
+	std::lock_guard<std::mutex> guard(pendingReadMutex);
+	FlushPendingMemInfoLocked();
+}
+
+// Must hold pendingReadMutex.
+static void FlushPendingMemInfoIfOverlaps(uint32_t start, uint32_t size) {
+	if (pendingNotifyMinAddr1 < start + size && pendingNotifyMaxAddr1 >= start)
+		FlushPendingMemInfoLocked();
+	else if (pendingNotifyMinAddr2 < start + size && pendingNotifyMaxAddr2 >= start)
+		FlushPendingMemInfoLocked();
 }
 
 static inline uint32_t NormalizeAddress(uint32_t addr) {
@@ -452,33 +450,78 @@ static inline uint32_t NormalizeAddress(uint32_t addr) {
 	return addr & 0x3FFFFFFF;
 }
 
-static inline bool MergeRecentMemInfo(const PendingNotifyMem &info, size_t copyLength) {
-	if (pendingNotifies.size() < 4)
-		return false;
+static PendingNotifyRing *GetThreadNotifyRing() {
+	struct RingOwner {
+		~RingOwner() {
+			if (ring)
+				ring->owned = false;
+		}
+		PendingNotifyRing *ring = nullptr;
+	};
+	static thread_local RingOwner owner;
+	if (owner.ring)
+		return owner.ring;
+
+	std::lock_guard<std::mutex> guard(pendingRingsMutex);
+	for (auto &ring : pendingRings) {
+		if (!ring->owned) {
+			owner.ring = ring.get();
+			break;
+		}
+	}
+	if (!owner.ring) {
+		pendingRings.push_back(std::make_unique<PendingNotifyRing>());
+		owner.ring = pendingRings.back().get();
+	}
+	owner.ring->owned = true;
+	return owner.ring;
+}
 
-	for (size_t i = 1; i <= 4; ++i) {
-		auto &prev = pendingNotifies[pendingNotifies.size() - i];
-		if (prev.copySrc != 0)
-			return false;
+static inline void UpdatePendingMin(std::atomic<uint32_t> &minAddr, uint32_t addr) {
+	uint32_t cur = minAddr.load();
+	while (addr < cur && !minAddr.compare_exchange_weak(cur, addr)) {
+		continue;
+	}
+}
 
-		if (prev.flags != info.flags)
-			continue;
+static inline void UpdatePendingMax(std::atomic<uint32_t> &maxAddr, uint32_t addr) {
+	uint32_t cur = maxAddr.load();
+	while (addr > cur && !maxAddr.compare_exchange_weak(cur, addr)) {
+		continue;
+	}
+}
 
-		if (prev.start >= info.start + info.size || prev.start + prev.size <= info.start)
-			continue;
+// Only copies tagLength bytes of the tag and a terminator, the rest is unused.
+static void PushPendingNotify(const PendingNotifyMem &info, size_t tagLength) {
+	PendingNotifyRing *ring = GetThreadNotifyRing();
+	uint32_t head = ring->head.load(std::memory_order_relaxed);
+	uint32_t tail = ring->tail.load(std::memory_order_acquire);
+	if (head - tail >= PendingNotifyRing::SIZE) {
+		// The flush thread is behind, make room ourselves.
+		FlushPendingMemInfo();
+		tail = ring->tail.load(std::memory_order_acquire);
+	}
 
-		// This means there's overlap, but not a match, so we can't combine any.
-		if (prev.start != info.start || prev.size > info.size)
-			return false;
+	PendingNotifyMem &entry = ring->entries[head % PendingNotifyRing::SIZE];
+	memcpy(&entry, &info, offsetof(PendingNotifyMem, tag) + tagLength + 1);
+	ring->head.store(head + 1, std::memory_order_release);
 
-		memcpy(prev.tag, info.tag, copyLength + 1);
-		prev.size = info.size;
-		prev.ticks = info.ticks;
-		prev.pc = info.pc;
-		return true;
+	// Only after adding it, so a flush that resets the range can't miss it.
+	if (info.start < 0x08000000) {
+		UpdatePendingMin(pendingNotifyMinAddr1, info.start);
+		UpdatePendingMax(pendingNotifyMaxAddr1, info.start + info.size);
+	} else {
+		UpdatePendingMin(pendingNotifyMinAddr2, info.start);
+		UpdatePendingMax(pendingNotifyMaxAddr2, info.start + info.size);
 	}
 
-	return false;
+	if (head + 1 - tail >= MAX_PENDING_NOTIFIES_THREAD && !flushThreadPending.load()) {
+		{
+			std::lock_guard<std::mutex> guard(flushLock);
+			flushThreadPending = true;
+		}
+		flushCond.notify_one();
+	}
 }
 
 void NotifyMemInfoPC(MemBlockFlags flags, uint32_t start, uint32_t size, uint32_t pc, const char *tagStr, size_t strLength) {
@@ -488,7 +531,10 @@ void NotifyMemInfoPC(MemBlockFlags flags, uint32_t start, uint32_t size, uint32_
 	// Clear the uncached and kernel bits.
 	start = NormalizeAddress(start);
 
-	bool needFlush = false;
+	// HLE may write with system calls (like file reads), which can't fault on protected pages.
+	if (JitWriteProtect::IsEnabled() && (flags & MemBlockFlags::WRITE))
+		JitWriteProtect::NotifyWrite(start, size);
+
 	// When the setting is off, we skip smaller info to keep things fast.
 	if (MemBlockInfoDetailed(size) && flags != MemBlockFlags::READ) {
 		PendingNotifyMem info{ flags, start, size };
@@ -502,27 +548,7 @@ void NotifyMemInfoPC(MemBlockFlags flags, uint32_t start, uint32_t size, uint32_
 		memcpy(info.tag, tagStr, copyLength);
 		info.tag[copyLength] = 0;
 
-		std::lock_guard<std::mutex> guard(pendingWriteMutex);
-		// Sometimes we get duplicates, quickly check.
-		if (!MergeRecentMemInfo(info, copyLength)) {
-			if (start < 0x08000000) {
-				pendingNotifyMinAddr1 = std::min(pendingNotifyMinAddr1.load(), start);
-				pendingNotifyMaxAddr1 = std::max(pendingNotifyMaxAddr1.load(), start + size);
-			} else {
-				pendingNotifyMinAddr2 = std::min(pendingNotifyMinAddr2.load(), start);
-				pendingNotifyMaxAddr2 = std::max(pendingNotifyMaxAddr2.load(), start + size);
-			}
-			pendingNotifies.push_back(info);
-		}
-		needFlush = pendingNotifies.size() > MAX_PENDING_NOTIFIES_THREAD;
-	}
-
-	if (needFlush) {
-		{
-			std::lock_guard<std::mutex> guard(flushLock);
-			flushThreadPending = true;
-		}
-		flushCond.notify_one();
+		PushPendingNotify(info, copyLength);
 	}
 
 	if (!(flags & MemBlockFlags::SKIP_MEMCHECK)) {
@@ -541,8 +567,9 @@ void NotifyMemInfo(MemBlockFlags flags, uint32_t start, uint32_t size, const cha
 void NotifyMemInfoCopy(uint32_t destPtr, uint32_t srcPtr, uint32_t size, const char *prefix) {
 	if (size == 0)
 		return;
+	if (JitWriteProtect::IsEnabled())
+		JitWriteProtect::NotifyWrite(destPtr, size);
 
-	bool needsFlush = false;
 	if (g_breakpoints.HasMemChecks()) {
 		// This will cause a flush, but it's needed to trigger memchecks with proper data.
 		char tagData[128];
@@ -559,36 +586,17 @@ void NotifyMemInfoCopy(uint32_t destPtr, uint32_t srcPtr, uint32_t size, const c
 		info.pc = currentMIPS->pc;
 
 		// Store the prefix for now.  The correct tag will be calculated on flush.
-		truncate_cpy(info.tag, prefix);
-
-		std::lock_guard<std::mutex> guard(pendingWriteMutex);
-		if (destPtr < 0x08000000) {
-			pendingNotifyMinAddr1 = std::min(pendingNotifyMinAddr1.load(), destPtr);
-			pendingNotifyMaxAddr1 = std::max(pendingNotifyMaxAddr1.load(), destPtr + size);
-		} else {
-			pendingNotifyMinAddr2 = std::min(pendingNotifyMinAddr2.load(), destPtr);
-			pendingNotifyMaxAddr2 = std::max(pendingNotifyMaxAddr2.load(), destPtr + size);
-		}
-		pendingNotifies.push_back(info);
-		needsFlush = pendingNotifies.size() > MAX_PENDING_NOTIFIES_THREAD;
-	}
+		size_t tagLength = truncate_cpy(info.tag, prefix);
 
-	if (needsFlush) {
-		{
-			std::lock_guard<std::mutex> guard(flushLock);
-			flushThreadPending = true;
-		}
-		flushCond.notify_one();
+		PushPendingNotify(info, tagLength);
 	}
 }
 
 std::vector<MemBlockInfo> FindMemInfo(uint32_t start, uint32_t size) {
 	start = NormalizeAddress(start);
 
-	if (pendingNotifyMinAddr1 < start + size && pendingNotifyMaxAddr1 >= start)
-		FlushPendingMemInfo();
-	if (pendingNotifyMinAddr2 < start + size && pendingNotifyMaxAddr2 >= start)
-		FlushPendingMemInfo();
+	std::lock_guard<std::mutex> guard(pendingReadMutex);
+	FlushPendingMemInfoIfOverlaps(start, size);
 
 	std::vector<MemBlockInfo> results;
 	allocMap.Find(MemBlockFlags::ALLOC, start, size, results);
@@ -601,10 +609,8 @@ std::vector<MemBlockInfo> FindMemInfo(uint32_t start, uint32_t size) {
 std::vector<MemBlockInfo> FindMemInfoByFlag(MemBlockFlags flags, uint32_t start, uint32_t size) {
 	start = NormalizeAddress(start);
 
-	if (pendingNotifyMinAddr1 < start + size && pendingNotifyMaxAddr1 >= start)
-		FlushPendingMemInfo();
-	if (pendingNotifyMinAddr2 < start + size && pendingNotifyMaxAddr2 >= start)
-		FlushPendingMemInfo();
+	std::lock_guard<std::mutex> guard(pendingReadMutex);
+	FlushPendingMemInfoIfOverlaps(start, size);
 
 	std::vector<MemBlockInfo> results;
 	if (flags & MemBlockFlags::ALLOC)
@@ -618,16 +624,10 @@ std::vector<MemBlockInfo> FindMemInfoByFlag(MemBlockFlags flags, uint32_t start,
 	return results;
 }
 
-static const char *FindWriteTagByFlag(MemBlockFlags flags, uint32_t start, uint32_t size, bool flush = true) {
+// Must hold pendingReadMutex.
+static const char *FindWriteTagByFlag(MemBlockFlags flags, uint32_t start, uint32_t size) {
 	start = NormalizeAddress(start);
 
-	if (flush) {
-		if (pendingNotifyMinAddr1 < start + size && pendingNotifyMaxAddr1 >= start)
-			FlushPendingMemInfo();
-		if (pendingNotifyMinAddr2 < start + size && pendingNotifyMaxAddr2 >= start)
-			FlushPendingMemInfo();
-	}
-
 	if (flags & MemBlockFlags::ALLOC) {
 		const char *tag = allocMap.FastFindWriteTag(MemBlockFlags::ALLOC, start, size);
 		if (tag)
@@ -652,25 +652,19 @@ static const char *FindWriteTagByFlag(MemBlockFlags flags, uint32_t start, uint3
 }
 
 size_t FormatMemWriteTagAt(char *buf, size_t sz, const char *prefix, uint32_t start, uint32_t size) {
-	const char *tag = FindWriteTagByFlag(MemBlockFlags::WRITE, start, size);
-	if (tag && strcmp(tag, "MemInit") != 0) {
-		return snprintf(buf, sz, "%s%s", prefix, tag);
-	}
-	// Fall back to alloc and texture, especially for VRAM.  We prefer write above.
-	tag = FindWriteTagByFlag(MemBlockFlags::ALLOC | MemBlockFlags::TEXTURE, start, size);
-	if (tag) {
-		return snprintf(buf, sz, "%s%s", prefix, tag);
-	}
-	return snprintf(buf, sz, "%s%08x_size_%08x", prefix, start, size);
+	std::lock_guard<std::mutex> guard(pendingReadMutex);
+	FlushPendingMemInfoIfOverlaps(NormalizeAddress(start), size);
+	return FormatMemWriteTagAtNoFlush(buf, sz, prefix, start, size);
 }
 
-size_t FormatMemWriteTagAtNoFlush(char *buf, size_t sz, const char *prefix, uint32_t start, uint32_t size) {
-	const char *tag = FindWriteTagByFlag(MemBlockFlags::WRITE, start, size, false);
+// Must hold pendingReadMutex.
+static size_t FormatMemWriteTagAtNoFlush(char *buf, size_t sz, const char *prefix, uint32_t start, uint32_t size) {
+	const char *tag = FindWriteTagByFlag(MemBlockFlags::WRITE, start, size);
 	if (tag && strcmp(tag, "MemInit") != 0) {
 		return snprintf(buf, sz, "%s%s", prefix, tag);
 	}
 	// Fall back to alloc and texture, especially for VRAM.  We prefer write above.
-	tag = FindWriteTagByFlag(MemBlockFlags::ALLOC | MemBlockFlags::TEXTURE, start, size, false);
+	tag = FindWriteTagByFlag(MemBlockFlags::ALLOC | MemBlockFlags::TEXTURE, start, size);
 	if (tag) {
 		return snprintf(buf, sz, "%s%s", prefix, tag);
 	}
@@ -693,8 +687,6 @@ static void FlushMemInfoThread() {
 
 void MemBlockInfoInit() {
 	std::lock_guard<std::mutex> guard(pendingReadMutex);
-	std::lock_guard<std::mutex> guardW(pendingWriteMutex);
-	pendingNotifies.reserve(MAX_PENDING_NOTIFIES);
 	pendingNotifyMinAddr1 = 0xFFFFFFFF;
 	pendingNotifyMaxAddr1 = 0;
 	pendingNotifyMinAddr2 = 0xFFFFFFFF;
@@ -708,12 +700,15 @@ void MemBlockInfoInit() {
 void MemBlockInfoShutdown() {
 	{
 		std::lock_guard<std::mutex> guard(pendingReadMutex);
-		std::lock_guard<std::mutex> guardW(pendingWriteMutex);
 		allocMap.Reset();
 		suballocMap.Reset();
 		writeMap.Reset();
 		textureMap.Reset();
-		pendingNotifies.clear();
+
+		// Drop anything still pending.
+		std::lock_guard<std::mutex> guardRings(pendingRingsMutex);
+		for (auto &ring : pendingRings)
+			ring->tail = ring->head.load();
 	}
 
 	if (flushThreadRunning.load()) {
@@ -730,7 +725,8 @@ void MemBlockInfoDoState(PointerWrap &p) {
 	if (!s)
 		return;
 
-	FlushPendingMemInfo();
+	std::lock_guard<std::mutex> guard(pendingReadMutex);
+	FlushPendingMemInfoLocked();
 	allocMap.DoState(p);
 	suballocMap.DoState(p);
 	writeMap.DoState(p);
@@ -35,6 +35,7 @@
 #include "Core/HLE/sceChnnlsv.h"
 #include "Core/ELF/ParamSFO.h"
 #include "Core/HW/MemoryStick.h"
+#include "Core/MIPS/JitCommon/JitWriteProtect.h"
 #include "Core/Util/PPGeDraw.h"
 
 static const std::string ICON0_FILENAME = "ICON0.PNG";
@@ -900,7 +901,11 @@ void SavedataParam::LoadFile(const std::string& dirPath, const std::string& file
 	u8 *buf = fileData->buf;
 	u32 size = Memory::ClampValidSizeAt(fileData->buf.ptr, fileData->bufSize);
 	s64 readSize = -1;
-	if (ReadPSPFile(filePath, &buf, size, &readSize)) {
+	// Might be on the savedata IO thread, and the file system writes to RAM directly.
+	JitWriteProtect::BeginExternalWrite(fileData->buf.ptr, size);
+	const bool success = ReadPSPFile(filePath, &buf, size, &readSize);
+	JitWriteProtect::EndExternalWrite(fileData->buf.ptr, size);
+	if (success) {
 		fileData->size = readSize;
 		const std::string tag = "SavedataLoad/" + filePath;
 		NotifyMemInfo(MemBlockFlags::WRITE, fileData->buf.ptr, fileData->size, tag.c_str(), tag.size());
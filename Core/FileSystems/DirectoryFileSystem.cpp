@@ -34,6 +34,7 @@
 #include "Core/FileSystems/DirectoryFileSystem.h"
 #include "Core/HLE/sceKernel.h"
 #include "Core/HW/MemoryStick.h"
+#include "Core/Config.h"
 #include "Core/CoreTiming.h"
 #include "Core/System.h"
 #include "Core/Replay.h"
@@ -62,7 +63,7 @@
 #include <fcntl.h>
 #endif
 
-DirectoryFileSystem::DirectoryFileSystem(IHandleAllocator *_hAlloc, const Path & _basePath, FileSystemFlags _flags) : basePath(_basePath), flags(_flags) {
+DirectoryFileSystem::DirectoryFileSystem(IHandleAllocator *_hAlloc, const Path & _basePath, FileSystemFlags _flags) : basePath(_basePath), caseCache(_basePath), flags(_flags) {
 	File::CreateFullPath(basePath);
 
 	static const std::string_view mixedCase = "wJpCzSBNnZfxSgoS";
@@ -126,6 +127,191 @@ Path DirectoryFileSystem::GetLocalPath(std::string_view internalPath) const {
 	return basePath / internalPath;
 }
 
+// Lists of huge directories are not worth keeping forever, start over past this many.
+static const size_t MAX_CACHED_DIRS = 1024;
+
+static std::string LowerPath(std::string_view str) {
+	std::string lower(str);
+	for (char &c : lower)
+		c = (char)tolower((unsigned char)c);
+	return lower;
+}
+
+bool PathCaseCache::FixPathCase(std::string &path, FixPathCaseBehavior behavior) {
+#if _WIN32
+	return true;
+#else
+	if (basePath_.Type() == PathType::CONTENT_URI) {
+		return ::FixPathCase(basePath_, path, behavior);
+	}
+
+	size_t len = path.size();
+	if (len == 0)
+		return true;
+	if (path[len - 1] == '/') {
+		len--;
+		if (len == 0)
+			return true;
+	}
+
+	std::lock_guard<std::mutex> guard(lock_);
+	std::string relPath;
+	size_t start = 0;
+	while (start < len) {
+		size_t i = path.find('/', start);
+		if (i == std::string::npos)
+			i = len;
+
+		if (i > start) {
+			std::string_view component(path.data() + start, i - start);
+			const DirEntry *dir = GetDir(relPath);
+			auto it = dir ? dir->names.find(LowerPath(component)) : std::unordered_map<std::string, std::string>::const_iterator();
+			if (!dir || it == dir->names.end()) {
+				// Still counts as success if partial matches allowed or if this
+				// is the last component and only the ones before it are required
+				return (behavior == FPC_PARTIAL_ALLOWED || (behavior == FPC_PATH_MUST_EXIST && i >= len));
+			}
+
+			// Prefer the exact name if several only differ in case.
+			if (it->second != component && std::find(dir->collisions.begin(), dir->collisions.end(), component) == dir->collisions.end()) {
+				// Only the case differs, so the length stays the same.
+				path.replace(start, i - start, it->second);
+			}
+
+			if (!relPath.empty())
+				relPath.push_back('/');
+			relPath.append(path, start, i - start);
+		}
+
+		start = i + 1;
+	}
+
+	return true;
+#endif
+}
+
+const PathCaseCache::DirEntry *PathCaseCache::GetDir(const std::string &relPath) {
+#if _WIN32
+	return nullptr;
+#else
+	Path dirPath = relPath.empty() ? basePath_ : basePath_ / relPath;
+	struct stat st;
+	if (stat(dirPath.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+		dirs_.erase(relPath);
+		return nullptr;
+	}
+
+#if defined(__APPLE__)
+	const s64 mtimeNsec = (s64)st.st_mtimespec.tv_nsec;
+#elif defined(__linux__) || defined(__ANDROID__)
+	const s64 mtimeNsec = (s64)st.st_mtim.tv_nsec;
+#else
+	const s64 mtimeNsec = 0;
+#endif
+
+	auto it = dirs_.find(relPath);
+	if (it != dirs_.end()) {
+		const DirEntry &entry = it->second;
+		if (entry.mtime == (s64)st.st_mtime && entry.mtimeNsec == mtimeNsec && entry.inode == (u64)st.st_ino)
+			return &entry;
+	}
+
+	DIR *dirp = opendir(dirPath.c_str());
+	if (!dirp) {
+		dirs_.erase(relPath);
+		return nullptr;
+	}
+
+	if (it == dirs_.end()) {
+		if (dirs_.size() >= MAX_CACHED_DIRS)
+			dirs_.clear();
+		it = dirs_.emplace(relPath, DirEntry()).first;
+	}
+
+	// If it changes while we list it, the time won't match next time and we'll just list it again.
+	DirEntry &entry = it->second;
+	entry.lowerPath = LowerPath(relPath);
+	entry.mtime = (s64)st.st_mtime;
+	entry.mtimeNsec = mtimeNsec;
+	entry.inode = (u64)st.st_ino;
+	entry.names.clear();
+	entry.collisions.clear();
+
+	struct dirent *result;
+	while ((result = readdir(dirp)) != nullptr) {
+		std::string name = result->d_name;
+		auto inserted = entry.names.emplace(LowerPath(name), name);
+		if (!inserted.second) {
+			std::string &prev = inserted.first->second;
+			if (std::find(entry.collisions.begin(), entry.collisions.end(), prev) == entry.collisions.end())
+				entry.collisions.push_back(prev);
+			entry.collisions.push_back(name);
+			prev = name;
+		}
+	}
+	closedir(dirp);
+
+	listed_++;
+	return &entry;
+#endif
+}
+
+void PathCaseCache::Invalidate(std::string_view path, bool withParents) {
+	// Match the way FixPathCase() builds its keys: no empty components, no slashes at the ends.
+	std::string lower;
+	size_t start = 0;
+	while (start < path.size()) {
+		size_t i = path.find('/', start);
+		if (i == path.npos)
+			i = path.size();
+		if (i > start) {
+			if (!lower.empty())
+				lower.push_back('/');
+			lower.append(path.data() + start, i - start);
+		}
+		start = i + 1;
+	}
+	lower = LowerPath(lower);
+
+	std::lock_guard<std::mutex> guard(lock_);
+	if (lower.empty()) {
+		dirs_.clear();
+		return;
+	}
+
+	size_t slash = lower.find_last_of('/');
+	std::string_view parent = slash == lower.npos ? std::string_view() : std::string_view(lower).substr(0, slash);
+	for (auto it = dirs_.begin(); it != dirs_.end(); ) {
+		const std::string &dir = it->second.lowerPath;
+		bool drop = dir == parent || dir == lower;
+		if (!drop && dir.size() > lower.size())
+			drop = dir[lower.size()] == '/' && startsWith(dir, lower);
+		if (!drop && withParents && dir.size() < lower.size())
+			drop = dir.empty() || (lower[dir.size()] == '/' && startsWith(lower, dir));
+		if (drop)
+			it = dirs_.erase(it);
+		else
+			++it;
+	}
+}
+
+void PathCaseCache::Clear() {
+	std::lock_guard<std::mutex> guard(lock_);
+	dirs_.clear();
+}
+
+bool DirectoryFileHandle::FixCase(const Path &basePath, std::string &fileName, FixPathCaseBehavior behavior) {
+	if (caseCache_ && g_Config.bPathCaseCache)
+		return caseCache_->FixPathCase(fileName, behavior);
+	return FixPathCase(basePath, fileName, behavior);
+}
+
+bool DirectoryFileSystem::FixCase(std::string &path, FixPathCaseBehavior behavior) {
+	if (g_Config.bPathCaseCache)
+		return caseCache.FixPathCase(path, behavior);
+	return FixPathCase(basePath, path, behavior);
+}
+
 bool DirectoryFileHandle::Open(const Path &basePath, std::string &fileName, FileAccess access, u32 &error) {
 	error = 0;
 
@@ -137,7 +323,7 @@ bool DirectoryFileHandle::Open(const Path &basePath, std::string &fileName, File
 	if (fileSystemFlags_ & FileSystemFlags::CASE_SENSITIVE) {
 		if (access & (FILEACCESS_APPEND | FILEACCESS_CREATE | FILEACCESS_WRITE)) {
 			DEBUG_LOG(Log::FileSystem, "Checking case for path %s", fileName.c_str());
-			if (!FixPathCase(basePath, fileName, FPC_PATH_MUST_EXIST)) {
+			if (!FixCase(basePath, fileName, FPC_PATH_MUST_EXIST)) {
 				error = SCE_KERNEL_ERROR_ERRNO_FILE_NOT_FOUND;
 				return false;  // or go on and attempt (for a better error code than just 0?)
 			}
@@ -291,7 +477,7 @@ bool DirectoryFileHandle::Open(const Path &basePath, std::string &fileName, File
 
 	if (fileSystemFlags_ & FileSystemFlags::CASE_SENSITIVE) {
 		if (!success && !(access & FILEACCESS_CREATE)) {
-			if (!FixPathCase(basePath, fileName, FPC_PATH_MUST_EXIST)) {
+			if (!FixCase(basePath, fileName, FPC_PATH_MUST_EXIST)) {
 				error = SCE_KERNEL_ERROR_ERRNO_FILE_NOT_FOUND;
 				return false;
 			}
@@ -351,6 +537,9 @@ bool DirectoryFileHandle::Open(const Path &basePath, std::string &fileName, File
 	if (access & (FILEACCESS_APPEND | FILEACCESS_CREATE | FILEACCESS_WRITE)) {
 		MemoryStick_NotifyWrite();
 	}
+	if (success && caseCache_ && (access & FILEACCESS_CREATE)) {
+		caseCache_->Invalidate(fileName);
+	}
 
 	return success;
 }
@@ -509,6 +698,7 @@ void DirectoryFileHandle::Close() {
 }
 
 void DirectoryFileSystem::CloseAll() {
+	std::lock_guard<std::mutex> guard(entriesLock);
 	for (auto iter = entries.begin(); iter != entries.end(); ++iter) {
 		INFO_LOG(Log::FileSystem, "DirectoryFileSystem::CloseAll(): Force closing %d (%s)", (int)iter->first, iter->second.guestFilename.c_str());
 		iter->second.hFile.Close();
@@ -522,7 +712,7 @@ bool DirectoryFileSystem::MkDir(const std::string &dirname) {
 		// Must fix case BEFORE attempting, because MkDir would create
 		// duplicate (different case) directories
 		std::string fixedCase = dirname;
-		if (!FixPathCase(basePath, fixedCase, FPC_PARTIAL_ALLOWED)) {
+		if (!FixCase(fixedCase, FPC_PARTIAL_ALLOWED)) {
 			result = false;
 		} else {
 			result = File::CreateFullPath(GetLocalPath(fixedCase));
@@ -530,6 +720,7 @@ bool DirectoryFileSystem::MkDir(const std::string &dirname) {
 	} else {
 		result = File::CreateFullPath(GetLocalPath(dirname));
 	}
+	caseCache.Invalidate(dirname, true);
 	MemoryStick_NotifyWrite();
 	return ReplayApplyDisk(ReplayAction::MKDIR, result, CoreTiming::GetGlobalTimeUs()) != 0;
 }
@@ -540,19 +731,21 @@ bool DirectoryFileSystem::RmDir(const std::string &dirname) {
 	if (flags & FileSystemFlags::CASE_SENSITIVE) {
 		// Maybe we're lucky?
 		if (File::DeleteDirRecursively(fullName)) {
+			caseCache.Invalidate(dirname);
 			MemoryStick_NotifyWrite();
 			return (bool)ReplayApplyDisk(ReplayAction::RMDIR, true, CoreTiming::GetGlobalTimeUs());
 		}
 
 		// Nope, fix case and try again.  Should we try again?
 		std::string fullPath = dirname;
-		if (!FixPathCase(basePath, fullPath, FPC_FILE_MUST_EXIST))
+		if (!FixCase(fullPath, FPC_FILE_MUST_EXIST))
 			return (bool)ReplayApplyDisk(ReplayAction::RMDIR, false, CoreTiming::GetGlobalTimeUs());
 
 		fullName = GetLocalPath(fullPath);
 	}
 
 	bool result = File::DeleteDirRecursively(fullName);
+	caseCache.Invalidate(dirname);
 	MemoryStick_NotifyWrite();
 	return ReplayApplyDisk(ReplayAction::RMDIR, result, CoreTiming::GetGlobalTimeUs()) != 0;
 }
@@ -578,7 +771,7 @@ int DirectoryFileSystem::RenameFile(const std::string &from, const std::string &
 
 	if (flags & FileSystemFlags::CASE_SENSITIVE) {
 		// In case TO should overwrite a file with different case.  Check error code?
-		if (!FixPathCase(basePath, fullTo, FPC_PATH_MUST_EXIST))
+		if (!FixCase(fullTo, FPC_PATH_MUST_EXIST))
 			return ReplayApplyDisk(ReplayAction::FILE_RENAME, -1, CoreTiming::GetGlobalTimeUs());
 	}
 
@@ -590,7 +783,7 @@ int DirectoryFileSystem::RenameFile(const std::string &from, const std::string &
 		if (!retValue) {
 			// May have failed due to case sensitivity on FROM, so try again.  Check error code?
 			std::string fullFromPath = from;
-			if (!FixPathCase(basePath, fullFromPath, FPC_FILE_MUST_EXIST))
+			if (!FixCase(fullFromPath, FPC_FILE_MUST_EXIST))
 				return ReplayApplyDisk(ReplayAction::FILE_RENAME, -1, CoreTiming::GetGlobalTimeUs());
 			fullFrom = GetLocalPath(fullFromPath);
 
@@ -600,6 +793,10 @@ int DirectoryFileSystem::RenameFile(const std::string &from, const std::string &
 
 	// TODO: Better error codes.
 	int result = retValue ? 0 : (int)SCE_KERNEL_ERROR_ERRNO_FILE_ALREADY_EXISTS;
+	if (retValue) {
+		caseCache.Invalidate(from);
+		caseCache.Invalidate(fullTo);
+	}
 	MemoryStick_NotifyWrite();
 	return ReplayApplyDisk(ReplayAction::FILE_RENAME, result, CoreTiming::GetGlobalTimeUs());
 }
@@ -613,7 +810,7 @@ bool DirectoryFileSystem::RemoveFile(const std::string &filename) {
 		if (!retValue) {
 			// May have failed due to case sensitivity, so try again.  Try even if it fails?
 			std::string fullNamePath = filename;
-			if (!FixPathCase(basePath, fullNamePath, FPC_FILE_MUST_EXIST))
+			if (!FixCase(fullNamePath, FPC_FILE_MUST_EXIST))
 				return (bool)ReplayApplyDisk(ReplayAction::FILE_REMOVE, false, CoreTiming::GetGlobalTimeUs());
 			localPath = GetLocalPath(fullNamePath);
 
@@ -621,6 +818,8 @@ bool DirectoryFileSystem::RemoveFile(const std::string &filename) {
 		}
 	}
 
+	if (retValue)
+		caseCache.Invalidate(filename);
 	MemoryStick_NotifyWrite();
 	return ReplayApplyDisk(ReplayAction::FILE_REMOVE, retValue, CoreTiming::GetGlobalTimeUs()) != 0;
 }
@@ -628,6 +827,7 @@ bool DirectoryFileSystem::RemoveFile(const std::string &filename) {
 int DirectoryFileSystem::OpenFile(std::string filename, FileAccess access, const char *devicename) {
 	OpenFileEntry entry;
 	entry.hFile.fileSystemFlags_ = flags;
+	entry.hFile.caseCache_ = &caseCache;
 	u32 err = 0;
 	bool success = entry.hFile.Open(basePath, filename, (FileAccess)(access & FILEACCESS_PSP_FLAGS), err);
 	if (err == 0 && !success) {
@@ -661,6 +861,7 @@ int DirectoryFileSystem::OpenFile(std::string filename, FileAccess access, const
 		entry.guestFilename = filename;
 		entry.access = (FileAccess)(access & FILEACCESS_PSP_FLAGS);
 
+		std::lock_guard<std::mutex> guard(entriesLock);
 		entries[newHandle] = entry;
 
 		return newHandle;
@@ -668,6 +869,7 @@ int DirectoryFileSystem::OpenFile(std::string filename, FileAccess access, const
 }
 
 void DirectoryFileSystem::CloseFile(u32 handle) {
+	std::lock_guard<std::mutex> guard(entriesLock);
 	EntryMap::iterator iter = entries.find(handle);
 	if (iter != entries.end()) {
 		hAlloc->FreeHandle(handle);
@@ -680,8 +882,18 @@ void DirectoryFileSystem::CloseFile(u32 handle) {
 }
 
 bool DirectoryFileSystem::OwnsHandle(u32 handle) {
+	return FindEntry(handle) != nullptr;
+}
+
+DirectoryFileSystem::OpenFileEntry *DirectoryFileSystem::FindEntry(u32 handle) {
+	std::lock_guard<std::mutex> guard(entriesLock);
 	EntryMap::iterator iter = entries.find(handle);
-	return (iter != entries.end());
+	return iter != entries.end() ? &iter->second : nullptr;
+}
+
+bool DirectoryFileSystem::SupportsParallelIO() const {
+	// Replays record disk access in order.
+	return !ReplayIsExecuting() && !ReplayIsSaving();
 }
 
 int DirectoryFileSystem::Ioctl(u32 handle, u32 cmd, u32 indataPtr, u32 inlen, u32 outdataPtr, u32 outlen, int &usec) {
@@ -698,14 +910,14 @@ size_t DirectoryFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size) {
 }
 
 size_t DirectoryFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &usec) {
-	EntryMap::iterator iter = entries.find(handle);
-	if (iter != entries.end()) {
+	OpenFileEntry *entry = FindEntry(handle);
+	if (entry) {
 		if (size < 0) {
-			ERROR_LOG(Log::FileSystem, "Invalid read for %lld bytes from disk %s", size, iter->second.guestFilename.c_str());
+			ERROR_LOG(Log::FileSystem, "Invalid read for %lld bytes from disk %s", size, entry->guestFilename.c_str());
 			return 0;
 		}
 
-		size_t bytesRead = iter->second.hFile.Read(pointer,size);
+		size_t bytesRead = entry->hFile.Read(pointer,size);
 		return bytesRead;
 	} else {
 		// This shouldn't happen...
@@ -720,9 +932,9 @@ size_t DirectoryFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size) {
 }
 
 size_t DirectoryFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size, int &usec) {
-	EntryMap::iterator iter = entries.find(handle);
-	if (iter != entries.end()) {
-		size_t bytesWritten = iter->second.hFile.Write(pointer,size);
+	OpenFileEntry *entry = FindEntry(handle);
+	if (entry) {
+		size_t bytesWritten = entry->hFile.Write(pointer,size);
 		return bytesWritten;
 	} else {
 		//This shouldn't happen...
@@ -732,9 +944,9 @@ size_t DirectoryFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size, i
 }
 
 size_t DirectoryFileSystem::SeekFile(u32 handle, s32 position, FileMove type) {
-	EntryMap::iterator iter = entries.find(handle);
-	if (iter != entries.end()) {
-		return iter->second.hFile.Seek(position,type);
+	OpenFileEntry *entry = FindEntry(handle);
+	if (entry) {
+		return entry->hFile.Seek(position,type);
 	} else {
 		//This shouldn't happen...
 		ERROR_LOG(Log::FileSystem,"Cannot seek in file that hasn't been opened: %08x", handle);
@@ -750,7 +962,7 @@ PSPFileInfo DirectoryFileSystem::GetFileInfo(std::string filename) {
 	Path fullName = GetLocalPath(filename);
 	if (!File::GetFileInfo(fullName, &info)) {
 		if (flags & FileSystemFlags::CASE_SENSITIVE) {
-			if (!FixPathCase(basePath, filename, FPC_FILE_MUST_EXIST))
+			if (!FixCase(filename, FPC_FILE_MUST_EXIST))
 				return ReplayApplyDiskFileInfo(x, CoreTiming::GetGlobalTimeUs());
 			fullName = GetLocalPath(filename);
 
@@ -885,7 +1097,7 @@ std::vector<PSPFileInfo> DirectoryFileSystem::GetDirListing(std::string_view pat
 		if (!success) {
 			// TODO: Case sensitivity should be checked on a file system basis, right?
 			std::string fixedPath(path);
-			if (FixPathCase(basePath, fixedPath, FPC_FILE_MUST_EXIST)) {
+			if (FixCase(fixedPath, FPC_FILE_MUST_EXIST)) {
 				// May have failed due to case sensitivity, try again
 				localPath = GetLocalPath(fixedPath);
 				success = File::GetFilesInDir(localPath, &files, nullptr, flags);
@@ -972,7 +1184,7 @@ u64 DirectoryFileSystem::FreeDiskSpace(const std::string &path) {
 
 	if (flags & FileSystemFlags::CASE_SENSITIVE) {
 		std::string fixedCase = path;
-		if (FixPathCase(basePath, fixedCase, FPC_FILE_MUST_EXIST)) {
+		if (FixCase(fixedCase, FPC_FILE_MUST_EXIST)) {
 			// May have failed due to case sensitivity, try again.
 			if (free_disk_space(GetLocalPath(fixedCase), result)) {
 				return ReplayApplyDisk64(ReplayAction::FREESPACE, result, CoreTiming::GetGlobalTimeUs());
@@ -1003,9 +1215,11 @@ void DirectoryFileSystem::DoState(PointerWrap &p) {
 
 	if (p.mode == p.MODE_READ) {
 		CloseAll();
+		std::lock_guard<std::mutex> guard(entriesLock);
 		u32 key;
 		OpenFileEntry entry;
 		entry.hFile.fileSystemFlags_ = flags;
+		entry.hFile.caseCache_ = &caseCache;
 		for (u32 i = 0; i < num; i++) {
 			Do(p, key);
 			Do(p, entry.guestFilename);
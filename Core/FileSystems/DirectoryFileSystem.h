@@ -20,6 +20,10 @@
 // TODO: Remove the Windows-specific code, FILE is fine there too.
 
 #include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "Common/File/Path.h"
 #include "Core/FileSystems/FileSystem.h"
@@ -28,6 +32,44 @@
 typedef void * HANDLE;
 #endif
 
+// Remembers the real names in the directories FixPathCase() looked through, so looking up
+// many files on a case-sensitive host file system doesn't list the same directories over and over.
+// A directory is listed again when its modification time changes, or after Invalidate().
+class PathCaseCache {
+public:
+	explicit PathCaseCache(const Path &basePath) : basePath_(basePath) {}
+
+	// Same as FixPathCase(basePath, path, behavior).
+	bool FixPathCase(std::string &path, FixPathCaseBehavior behavior);
+	// Call after creating, removing or renaming path (a file or a directory.)
+	// withParents also forgets all directories above it, for when several levels were created.
+	void Invalidate(std::string_view path, bool withParents = false);
+	void Clear();
+
+	int ListedCount() const { return listed_; }
+
+private:
+	struct DirEntry {
+		std::string lowerPath;
+		s64 mtime;
+		s64 mtimeNsec;
+		u64 inode;
+		// Lowercased name -> real name. If several names only differ in case, the last one listed.
+		std::unordered_map<std::string, std::string> names;
+		// All the real names that share a lowercased name with another.
+		std::vector<std::string> collisions;
+	};
+
+	// Returns nullptr if relPath isn't a directory. lock_ must be held.
+	const DirEntry *GetDir(const std::string &relPath);
+
+	Path basePath_;
+	std::mutex lock_;
+	// Key is the real path relative to basePath_, without slashes at either end.
+	std::unordered_map<std::string, DirEntry> dirs_;
+	int listed_ = 0;
+};
+
 struct DirectoryFileHandle {
 	enum Flags {
 		NORMAL,
@@ -45,6 +87,8 @@ struct DirectoryFileHandle {
 	bool replay_ = true;
 	bool inGameDir_ = false;
 	FileSystemFlags fileSystemFlags_ = (FileSystemFlags)0;
+	// Owned by the DirectoryFileSystem, if any.
+	PathCaseCache *caseCache_ = nullptr;
 
 	DirectoryFileHandle() {}
 
@@ -53,6 +97,7 @@ struct DirectoryFileHandle {
 
 	Path GetLocalPath(const Path &basePath, std::string_view localPath) const;
 	bool Open(const Path &basePath, std::string &fileName, FileAccess access, u32 &err);
+	bool FixCase(const Path &basePath, std::string &fileName, FixPathCaseBehavior behavior);
 	size_t Read(u8* pointer, s64 size);
 	size_t Write(const u8* pointer, s64 size);
 	size_t Seek(s32 position, FileMove type);
@@ -90,6 +135,7 @@ class DirectoryFileSystem : public IFileSystem {
 
 	bool ComputeRecursiveDirSizeIfFast(const std::string &path, int64_t *size) override;
 	void Describe(char *buf, size_t size) const override { snprintf(buf, size, "Dir: %s", basePath.c_str()); }
+	bool SupportsParallelIO() const override;
 
 private:
 	struct OpenFileEntry {
@@ -99,8 +145,15 @@ class DirectoryFileSystem : public IFileSystem {
 	};
 
 	typedef std::map<u32, OpenFileEntry> EntryMap;
+	// Only the map itself is guarded, an entry belongs to whoever uses its handle.
+	// Map nodes don't move, so reads and writes happen outside the lock.
+	OpenFileEntry *FindEntry(u32 handle);
+	bool FixCase(std::string &path, FixPathCaseBehavior behavior);
+
 	EntryMap entries;
+	std::mutex entriesLock;
 	Path basePath;
+	PathCaseCache caseCache;
 	IHandleAllocator *hAlloc;
 	FileSystemFlags flags;
 
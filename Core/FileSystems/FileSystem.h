@@ -159,6 +159,9 @@ class IFileSystem {
 	virtual bool     ComputeRecursiveDirSizeIfFast(const std::string &path, int64_t *size) = 0;
 	virtual void     Describe(char *buf, size_t size) const = 0;
 	virtual std::shared_ptr<BlockDevice> GetBlockDevice() { return std::shared_ptr<BlockDevice>(); }
+	// If true, ReadFile/WriteFile/SeekFile on different handles may run on several threads at once,
+	// so MetaFileSystem doesn't need to hold its lock during them.
+	virtual bool     SupportsParallelIO() const { return false; }
 };
 
 
@@ -194,3 +197,19 @@ class EmptyFileSystem : public IFileSystem {
 };
 
 
+
+// Totals for the sequential read-ahead on ISO files (the ISOReadAhead setting), shown in the debugger.
+// Kept here since ISOFileSystem.h drags in kirk, implemented in ISOFileSystem.cpp.
+struct ISOReadAheadStats {
+	u64 reads;  // File reads while read-ahead was enabled.
+	u64 hits;  // Reads served entirely from a read-ahead buffer.
+	u64 hitBytes;
+	u64 prefetches;
+	u64 prefetchedBytes;
+	// Host time spent inside ReadFile, to compare the two.
+	double hitSeconds;
+	double missSeconds;
+};
+
+ISOReadAheadStats GetISOReadAheadStats();
+void ResetISOReadAheadStats();
@@ -16,13 +16,18 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <algorithm>
+#include <condition_variable>
 #include <cstring>
 #include <cstdio>
+#include <vector>
 
 #include "Common/CommonTypes.h"
 #include "Common/Serialize/Serializer.h"
 #include "Common/Serialize/SerializeFuncs.h"
 #include "Common/StringUtils.h"
+#include "Common/Thread/ThreadManager.h"
+#include "Common/TimeUtil.h"
+#include "Core/Config.h"
 #include "Core/FileSystems/ISOFileSystem.h"
 #include "Core/HLE/sceKernel.h"
 #include "Core/MemMap.h"
@@ -30,6 +35,99 @@
 
 const int sectorSize = 2048;
 
+// Reads in a row that start where the previous one ended, before reading ahead.
+static const int READ_AHEAD_MIN_SEQUENTIAL = 2;
+// Read ahead about four reads' worth, within these limits.
+static const u32 READ_AHEAD_MIN_SECTORS = 16;
+static const u32 READ_AHEAD_MAX_SECTORS = 64;
+
+struct ISOReadAheadBuffer {
+	std::mutex lock;
+	std::condition_variable done;
+	std::vector<u8> data;
+	u32 startSector = 0;
+	u32 sectors = 0;
+	// While a task is queued to read pendingSectors from pendingStart.
+	bool pending = false;
+	// Once it's running, it has to be waited for. Before that, it can be cancelled by clearing pending.
+	bool started = false;
+	u32 pendingStart = 0;
+	u32 pendingSectors = 0;
+	// Tells a cancelled task apart from a newer one.
+	u32 generation = 0;
+	// Where on the ISO a sequential read would start next.
+	u64 nextPosition = 0;
+	int sequentialReads = 0;
+};
+
+static std::mutex g_readAheadStatsLock;
+static ISOReadAheadStats g_readAheadStats{};
+
+ISOReadAheadStats GetISOReadAheadStats() {
+	std::lock_guard<std::mutex> guard(g_readAheadStatsLock);
+	return g_readAheadStats;
+}
+
+void ResetISOReadAheadStats() {
+	std::lock_guard<std::mutex> guard(g_readAheadStatsLock);
+	g_readAheadStats = ISOReadAheadStats{};
+}
+
+class ISOReadAheadTask : public Task {
+public:
+	ISOReadAheadTask(std::shared_ptr<BlockDevice> blockDevice, std::mutex *blockLock, std::shared_ptr<ISOReadAheadBuffer> buffer, u32 generation)
+		: blockDevice_(std::move(blockDevice)), blockLock_(blockLock), buffer_(std::move(buffer)), generation_(generation) {}
+
+	TaskType Type() const override { return TaskType::IO_BLOCKING; }
+	// The game is likely to want it soon.
+	TaskPriority Priority() const override { return TaskPriority::HIGH; }
+
+	void Run() override {
+		std::unique_lock<std::mutex> guard(buffer_->lock);
+		// If cancelled or taken over, the filesystem (and blockLock_) may be gone already.
+		if (!buffer_->pending || buffer_->started || buffer_->generation != generation_)
+			return;
+		buffer_->started = true;
+		const u32 start = buffer_->pendingStart;
+		const u32 count = buffer_->pendingSectors;
+		guard.unlock();
+
+		std::vector<u8> data;
+		bool success = ReadSectors(blockDevice_.get(), *blockLock_, start, count, data);
+
+		guard.lock();
+		if (success) {
+			buffer_->data.swap(data);
+			buffer_->startSector = start;
+			buffer_->sectors = count;
+		}
+		buffer_->pending = false;
+		buffer_->started = false;
+		buffer_->done.notify_all();
+	}
+
+	static bool ReadSectors(BlockDevice *blockDevice, std::mutex &blockLock, u32 start, u32 count, std::vector<u8> &data) {
+		data.resize((size_t)count * sectorSize);
+		std::lock_guard<std::mutex> guard(blockLock);
+		return blockDevice->ReadBlocks(start, (int)count, data.data());
+	}
+
+private:
+	std::shared_ptr<BlockDevice> blockDevice_;
+	std::mutex *blockLock_;
+	std::shared_ptr<ISOReadAheadBuffer> buffer_;
+	u32 generation_;
+};
+
+// Waits for a running task, but just cancels a queued one. All IO threads might be busy waiting, too.
+static void FinishReadAhead(ISOReadAheadBuffer &buffer, std::unique_lock<std::mutex> &guard) {
+	if (buffer.pending && !buffer.started) {
+		buffer.pending = false;
+		return;
+	}
+	buffer.done.wait(guard, [&buffer] { return !buffer.pending; });
+}
+
 bool parseLBN(const std::string &filename, u32 *sectorStart, u32 *readSize) {
 	// The format of this is: "/sce_lbn" "0x"? HEX* ANY* "_size" "0x"? HEX* ANY*
 	// That means that "/sce_lbn/_size1/" is perfectly valid.
@@ -186,6 +284,7 @@ ISOFileSystem::ISOFileSystem(IHandleAllocator *_hAlloc, std::shared_ptr<BlockDev
 }
 
 ISOFileSystem::~ISOFileSystem() {
+	WaitForReadAheads();
 	delete treeroot;
 }
 
@@ -200,12 +299,14 @@ std::string ISOFileSystem::TreeEntry::BuildPath() {
 void ISOFileSystem::ReadDirectory(TreeEntry *root) const {
 	for (u32 secnum = root->startsector, endsector = root->startsector + (root->dirsize + 2047) / 2048; secnum < endsector; ++secnum) {
 		u8 theSector[2048];
+		std::unique_lock<std::mutex> blockGuard(blockLock_);
 		if (!blockDevice->ReadBlock(secnum, theSector)) {
 			blockDevice->NotifyReadError();
 			ERROR_LOG(Log::FileSystem, "Error reading block for directory '%s' in sector %d - skipping", root->name.c_str(), secnum);
 			root->valid = true;  // Prevents re-reading
 			return;
 		}
+		blockGuard.unlock();
 		lastReadBlock_ = secnum;  // Hm, this could affect timing... but lazy loading is probably more realistic.
 
 		for (int offset = 0; offset < 2048; ) {
@@ -392,6 +493,11 @@ void ISOFileSystem::CloseFile(u32 handle) {
 	EntryMap::iterator iter = entries.find(handle);
 	if (iter != entries.end()) {
 		//CloseHandle((*iter).second.hFile);
+		if (iter->second.readAhead) {
+			// Tasks use blockLock_, so they have to be done before this filesystem can go away.
+			std::unique_lock<std::mutex> guard(iter->second.readAhead->lock);
+			FinishReadAhead(*iter->second.readAhead, guard);
+		}
 		hAlloc->FreeHandle(handle);
 		entries.erase(iter);
 	} else {
@@ -428,7 +534,10 @@ int ISOFileSystem::Ioctl(u32 handle, u32 cmd, u32 indataPtr, u32 inlen, u32 outd
 		}
 
 		INFO_LOG(Log::sceIo, "sceIoIoctl: reading ISO9660 volume descriptor read");
-		blockDevice->ReadBlock(16, Memory::GetPointerWriteUnchecked(outdataPtr));
+		{
+			std::lock_guard<std::mutex> guard(blockLock_);
+			blockDevice->ReadBlock(16, Memory::GetPointerWriteUnchecked(outdataPtr));
+		}
 		return 0;
 
 	// Get ISO9660 path table (from open ISO9660 file.)
@@ -438,6 +547,7 @@ int ISOFileSystem::Ioctl(u32 handle, u32 cmd, u32 indataPtr, u32 inlen, u32 outd
 			return SCE_KERNEL_ERROR_ERRNO_FUNCTION_NOT_SUPPORTED;
 		}
 
+		std::lock_guard<std::mutex> guard(blockLock_);
 		VolDescriptor desc;
 		blockDevice->ReadBlock(16, (u8 *)&desc);
 		if (outlen < (u32)desc.pathTableLength) {
@@ -498,7 +608,10 @@ size_t ISOFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &usec) {
 		
 		if (e.isBlockSectorMode) {
 			// Whole sectors! Shortcut to this simple code.
-			blockDevice->ReadBlocks(e.seekPos, (int)size, pointer);
+			{
+				std::lock_guard<std::mutex> guard(blockLock_);
+				blockDevice->ReadBlocks(e.seekPos, (int)size, pointer);
+			}
 			if (abs((int)lastReadBlock_ - (int)e.seekPos) > 100) {
 				// This is an estimate, sometimes it takes 1+ seconds, but it definitely takes time.
 				usec = 100000;
@@ -538,39 +651,66 @@ size_t ISOFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &usec) {
 			size = newSize;
 		}
 
-		// Okay, we have size and position, let's rock.
-		const int firstBlockOffset = positionOnIso & 2047;
-		const int firstBlockSize = firstBlockOffset == 0 ? 0 : (int)std::min(size, 2048LL - firstBlockOffset);
-		const int lastBlockSize = (size - firstBlockSize) & 2047;
-		const s64 middleSize = size - firstBlockSize - lastBlockSize;
-		_dbg_assert_((middleSize & 2047) == 0);
-
+		const bool readAhead = g_Config.bISOReadAhead;
+		const double startTime = readAhead ? time_now_d() : 0.0;
 		u32 secNum = (u32)(positionOnIso / 2048);
-		u8 theSector[2048];
+		size_t totalBytes;
+		bool hit = false;
+		if (readAhead && ReadFromReadAhead(e, positionOnIso, size, pointer, hit)) {
+			totalBytes = (size_t)size;
+			// Same as reading the sectors below, for timing.
+			secNum = (u32)((positionOnIso + size + 2047) / 2048);
+		} else {
+			// Okay, we have size and position, let's rock.
+			const int firstBlockOffset = positionOnIso & 2047;
+			const int firstBlockSize = firstBlockOffset == 0 ? 0 : (int)std::min(size, 2048LL - firstBlockOffset);
+			const int lastBlockSize = (size - firstBlockSize) & 2047;
+			const s64 middleSize = size - firstBlockSize - lastBlockSize;
+			_dbg_assert_((middleSize & 2047) == 0);
 
-		if ((middleSize & 2047) != 0) {
-			ERROR_LOG(Log::FileSystem, "Remaining size should be aligned");
-		}
+			u8 theSector[2048];
 
-		const u8 *const start = pointer;
-		if (firstBlockSize > 0) {
-			blockDevice->ReadBlock(secNum++, theSector);
-			memcpy(pointer, theSector + firstBlockOffset, firstBlockSize);
-			pointer += firstBlockSize;
-		}
-		if (middleSize > 0) {
-			const u32 middleSectors = (u32)(middleSize / 2048);
-			blockDevice->ReadBlocks(secNum, middleSectors, pointer);
-			secNum += middleSectors;
-			pointer += middleSize;
+			if ((middleSize & 2047) != 0) {
+				ERROR_LOG(Log::FileSystem, "Remaining size should be aligned");
+			}
+
+			std::lock_guard<std::mutex> guard(blockLock_);
+			const u8 *const start = pointer;
+			if (firstBlockSize > 0) {
+				blockDevice->ReadBlock(secNum++, theSector);
+				memcpy(pointer, theSector + firstBlockOffset, firstBlockSize);
+				pointer += firstBlockSize;
+			}
+			if (middleSize > 0) {
+				const u32 middleSectors = (u32)(middleSize / 2048);
+				blockDevice->ReadBlocks(secNum, middleSectors, pointer);
+				secNum += middleSectors;
+				pointer += middleSize;
+			}
+			if (lastBlockSize > 0) {
+				blockDevice->ReadBlock(secNum++, theSector);
+				memcpy(pointer, theSector, lastBlockSize);
+				pointer += lastBlockSize;
+			}
+
+			totalBytes = pointer - start;
 		}
-		if (lastBlockSize > 0) {
-			blockDevice->ReadBlock(secNum++, theSector);
-			memcpy(pointer, theSector, lastBlockSize);
-			pointer += lastBlockSize;
+
+		if (readAhead) {
+			UpdateReadAhead(e, positionOnIso, totalBytes, positionOnIso - e.seekPos + fileSize);
+
+			const double elapsed = time_now_d() - startTime;
+			std::lock_guard<std::mutex> guard(g_readAheadStatsLock);
+			g_readAheadStats.reads++;
+			if (hit) {
+				g_readAheadStats.hits++;
+				g_readAheadStats.hitBytes += totalBytes;
+				g_readAheadStats.hitSeconds += elapsed;
+			} else {
+				g_readAheadStats.missSeconds += elapsed;
+			}
 		}
 
-		size_t totalBytes = pointer - start;
 		if (abs((int)lastReadBlock_ - (int)secNum) > 100) {
 			// This is an estimate, sometimes it takes 1+ seconds, but it definitely takes time.
 			usec = 100000;
@@ -585,6 +725,88 @@ size_t ISOFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &usec) {
 	}
 }
 
+bool ISOFileSystem::ReadFromReadAhead(OpenFileEntry &e, u64 positionOnIso, s64 size, u8 *pointer, bool &hit) {
+	hit = false;
+	if (!e.readAhead || size <= 0)
+		return false;
+
+	ISOReadAheadBuffer &buffer = *e.readAhead;
+	const u64 end = positionOnIso + size;
+	std::unique_lock<std::mutex> guard(buffer.lock);
+	bool readNow = false;
+	if (buffer.pending && positionOnIso >= buffer.pendingStart * 2048ULL && end <= (buffer.pendingStart + buffer.pendingSectors) * 2048ULL) {
+		if (buffer.started) {
+			// If it's on the way, waiting beats reading the same sectors again.
+			buffer.done.wait(guard, [&buffer] { return !buffer.pending; });
+		} else {
+			// Still queued, so just do it now. The next few reads will hit.
+			buffer.started = true;
+			std::vector<u8> data;
+			if (ISOReadAheadTask::ReadSectors(blockDevice.get(), blockLock_, buffer.pendingStart, buffer.pendingSectors, data)) {
+				buffer.data.swap(data);
+				buffer.startSector = buffer.pendingStart;
+				buffer.sectors = buffer.pendingSectors;
+			}
+			buffer.pending = false;
+			buffer.started = false;
+			readNow = true;
+		}
+	}
+
+	const u64 bufferStart = buffer.startSector * 2048ULL;
+	if (positionOnIso < bufferStart || end > bufferStart + buffer.sectors * 2048ULL)
+		return false;
+	memcpy(pointer, buffer.data.data() + (positionOnIso - bufferStart), (size_t)size);
+	hit = !readNow;
+	return true;
+}
+
+void ISOFileSystem::UpdateReadAhead(OpenFileEntry &e, u64 positionOnIso, size_t bytes, u64 endOnIso) {
+	if (bytes == 0)
+		return;
+	if (!e.readAhead)
+		e.readAhead = std::make_shared<ISOReadAheadBuffer>();
+
+	ISOReadAheadBuffer &buffer = *e.readAhead;
+	std::unique_lock<std::mutex> guard(buffer.lock);
+	buffer.sequentialReads = positionOnIso == buffer.nextPosition ? buffer.sequentialReads + 1 : 0;
+	buffer.nextPosition = positionOnIso + bytes;
+	if (buffer.sequentialReads < READ_AHEAD_MIN_SEQUENTIAL || buffer.pending || !g_threadManager.IsInitialized())
+		return;
+
+	// Nothing to do if the next read of the same size is already buffered.
+	const u64 bufferStart = buffer.startSector * 2048ULL;
+	const u64 nextEnd = std::min(buffer.nextPosition + bytes, endOnIso);
+	if (buffer.nextPosition >= nextEnd || (buffer.nextPosition >= bufferStart && nextEnd <= bufferStart + buffer.sectors * 2048ULL))
+		return;
+
+	const u32 firstSector = (u32)(buffer.nextPosition / 2048);
+	const u32 endSector = (u32)((endOnIso + 2047) / 2048);
+	const u32 wanted = std::clamp((u32)((bytes * 4 + 2047) / 2048), READ_AHEAD_MIN_SECTORS, READ_AHEAD_MAX_SECTORS);
+	const u32 count = std::min(wanted, endSector - firstSector);
+	buffer.pending = true;
+	buffer.pendingStart = firstSector;
+	buffer.pendingSectors = count;
+	const u32 generation = ++buffer.generation;
+	guard.unlock();
+
+	{
+		std::lock_guard<std::mutex> statsGuard(g_readAheadStatsLock);
+		g_readAheadStats.prefetches++;
+		g_readAheadStats.prefetchedBytes += count * 2048ULL;
+	}
+	g_threadManager.EnqueueTask(new ISOReadAheadTask(blockDevice, &blockLock_, e.readAhead, generation));
+}
+
+void ISOFileSystem::WaitForReadAheads() {
+	for (auto &it : entries) {
+		if (!it.second.readAhead)
+			continue;
+		std::unique_lock<std::mutex> guard(it.second.readAhead->lock);
+		FinishReadAhead(*it.second.readAhead, guard);
+	}
+}
+
 size_t ISOFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size) {
 	ERROR_LOG(Log::FileSystem, "Hey, what are you doing? You can't write to an ISO!");
 	return 0;
@@ -752,6 +974,7 @@ void ISOFileSystem::DoState(PointerWrap &p) {
 	Do(p, n);
 
 	if (p.mode == p.MODE_READ) {
+		WaitForReadAheads();
 		entries.clear();
 		for (int i = 0; i < n; ++i) {
 			u32 fd = 0;
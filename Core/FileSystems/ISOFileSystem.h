@@ -19,6 +19,7 @@
 
 #include <map>
 #include <memory>
+#include <mutex>
 
 #include "FileSystem.h"
 
@@ -26,6 +27,8 @@
 
 bool parseLBN(const std::string &filename, u32 *sectorStart, u32 *readSize);
 
+struct ISOReadAheadBuffer;
+
 class ISOFileSystem : public IFileSystem {
 public:
 	ISOFileSystem(IHandleAllocator *_hAlloc, std::shared_ptr<BlockDevice> _blockDevice);
@@ -89,6 +92,8 @@ class ISOFileSystem : public IFileSystem {
 		bool isBlockSectorMode;  // "umd:" mode: all sizes and offsets are in 2048 byte chunks
 		u32 sectorStart;
 		u32 openSize;
+		// Created once the file is read, a background task fills it after a few sequential reads.
+		std::shared_ptr<ISOReadAheadBuffer> readAhead;
 	};
 
 	typedef std::map<u32, OpenFileEntry> EntryMap;
@@ -96,12 +101,17 @@ class ISOFileSystem : public IFileSystem {
 	IHandleAllocator *hAlloc = nullptr;
 	TreeEntry *treeroot = nullptr;
 	std::shared_ptr<BlockDevice> blockDevice;
+	// Block devices aren't thread safe, and read-ahead tasks use it too.
+	mutable std::mutex blockLock_;
 	mutable u32 lastReadBlock_ = 0;
 
 	TreeEntry entireISO{};
 	std::string errorString_;
 
 	void ReadDirectory(TreeEntry *root) const;
+	bool ReadFromReadAhead(OpenFileEntry &e, u64 positionOnIso, s64 size, u8 *pointer, bool &hit);
+	void UpdateReadAhead(OpenFileEntry &e, u64 positionOnIso, size_t bytes, u64 endOnIso);
+	void WaitForReadAheads();
 	const TreeEntry *GetFromPath(std::string_view path, bool catchError = true);
 	std::string EntryFullPath(const TreeEntry *e);
 };
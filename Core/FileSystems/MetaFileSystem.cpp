@@ -175,6 +175,15 @@ IFileSystem *MetaFileSystem::GetHandleOwner(u32 handle) const
 	return nullptr;
 }
 
+std::shared_ptr<IFileSystem> MetaFileSystem::GetHandleOwnerShared(u32 handle) const {
+	std::lock_guard<std::recursive_mutex> guard(lock);
+	for (const MountPoint &mount : fileSystems) {
+		if (mount.system->OwnsHandle(handle))
+			return mount.system;
+	}
+	return nullptr;
+}
+
 int MetaFileSystem::MapFilePath(std::string_view _inpath, std::string *outpath, MountPoint **system) {
 	int error = SCE_KERNEL_ERROR_ERRNO_FILE_NOT_FOUND;
 	std::lock_guard<std::recursive_mutex> guard(lock);
@@ -528,52 +537,57 @@ void MetaFileSystem::CloseFile(u32 handle)
 
 size_t MetaFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
-	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->ReadFile(handle, pointer, size);
-	else
+	std::unique_lock<std::recursive_mutex> guard(lock);
+	std::shared_ptr<IFileSystem> sys = GetHandleOwnerShared(handle);
+	if (!sys)
 		return 0;
+	if (sys->SupportsParallelIO())
+		guard.unlock();
+	return sys->ReadFile(handle, pointer, size);
 }
 
 size_t MetaFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
-	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->WriteFile(handle, pointer, size);
-	else
+	std::unique_lock<std::recursive_mutex> guard(lock);
+	std::shared_ptr<IFileSystem> sys = GetHandleOwnerShared(handle);
+	if (!sys)
 		return 0;
+	if (sys->SupportsParallelIO())
+		guard.unlock();
+	return sys->WriteFile(handle, pointer, size);
 }
 
 size_t MetaFileSystem::ReadFile(u32 handle, u8 *pointer, s64 size, int &usec)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
-	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->ReadFile(handle, pointer, size, usec);
-	else
+	std::unique_lock<std::recursive_mutex> guard(lock);
+	std::shared_ptr<IFileSystem> sys = GetHandleOwnerShared(handle);
+	if (!sys)
 		return 0;
+	if (sys->SupportsParallelIO())
+		guard.unlock();
+	return sys->ReadFile(handle, pointer, size, usec);
 }
 
 size_t MetaFileSystem::WriteFile(u32 handle, const u8 *pointer, s64 size, int &usec)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
-	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->WriteFile(handle, pointer, size, usec);
-	else
+	std::unique_lock<std::recursive_mutex> guard(lock);
+	std::shared_ptr<IFileSystem> sys = GetHandleOwnerShared(handle);
+	if (!sys)
 		return 0;
+	if (sys->SupportsParallelIO())
+		guard.unlock();
+	return sys->WriteFile(handle, pointer, size, usec);
 }
 
 size_t MetaFileSystem::SeekFile(u32 handle, s32 position, FileMove type)
 {
-	std::lock_guard<std::recursive_mutex> guard(lock);
-	IFileSystem *sys = GetHandleOwner(handle);
-	if (sys)
-		return sys->SeekFile(handle, position, type);
-	else
+	std::unique_lock<std::recursive_mutex> guard(lock);
+	std::shared_ptr<IFileSystem> sys = GetHandleOwnerShared(handle);
+	if (!sys)
 		return 0;
+	if (sys->SupportsParallelIO())
+		guard.unlock();
+	return sys->SeekFile(handle, position, type);
 }
 
 int MetaFileSystem::ReadEntireFile(const std::string &filename, std::vector<u8> &data, bool quiet) {
@@ -46,6 +46,9 @@ class MetaFileSystem : public IHandleAllocator, public IFileSystem {
 	std::string startingDirectory;
 	mutable std::recursive_mutex lock;  // must be recursive. TODO: fix that
 
+	// Keeps the system alive even if it's unmounted, for calls made without the lock.
+	std::shared_ptr<IFileSystem> GetHandleOwnerShared(u32 handle) const;
+
 	// Assumes the lock is held
 	void Reset() {
 		// This used to be 6, probably an attempt to replicate PSP handles.
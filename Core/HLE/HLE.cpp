@@ -85,6 +85,8 @@ static int splitSyscallEatCycles = 0;
 // Stats
 static double hleSteppingTime = 0.0;
 static double hleFlipTime = 0.0;
+static u64 directSyscallCalls = 0;
+static u64 directSyscallSlowCalls = 0;
 
 struct HLEMipsCallInfo {
 	u32 func;
@@ -266,6 +268,8 @@ void HLEInit() {
 	g_stackSize = 0;
 	delayedResultEvent = CoreTiming::RegisterEvent("HLEDelayedResult", hleDelayResultFinish);
 	idleOp = GetSyscallOp("FakeSysCalls", NID_IDLE);
+	directSyscallCalls = 0;
+	directSyscallSlowCalls = 0;
 }
 
 void HLEDoState(PointerWrap &p) {
@@ -938,6 +942,73 @@ void *GetQuickSyscallFunc(MIPSOpcode op) {
 	return (void *)&CallSyscallWithoutFlags;
 }
 
+// Frequently called functions that usually just return a value, so the IR can keep going after them.
+// If one switches threads or similar, CallSyscallDirect() exits the block like a regular syscall.
+static const char *const directSyscallNames[] = {
+	"sceKernelGetSystemTimeLow",
+	"sceKernelGetSystemTimeWide",
+	"sceKernelGetSystemTime",
+	"sceKernelCpuSuspendIntr",
+	"sceKernelCpuResumeIntr",
+	"sceKernelIsCpuIntrEnable",
+	"sceRtcGetCurrentTick",
+	"sceCtrlReadBufferPositive",
+	"sceCtrlPeekBufferPositive",
+	"sceDisplayGetVcount",
+	"sceGeListUpdateStallAddr",
+};
+
+const HLEFunction *GetDirectSyscallFunc(MIPSOpcode op) {
+	if (coreCollectDebugStats || op == idleOp)
+		return nullptr;
+
+	const HLEFunction *info = GetSyscallFuncPointer(op);
+	if (!info || !info->func || !info->name)
+		return nullptr;
+	// The other flags need the checks in CallSyscallWithFlags().
+	if ((info->flags & ~HLE_KERNEL_SYSCALL) != 0)
+		return nullptr;
+
+	for (const char *name : directSyscallNames) {
+		if (!strcmp(info->name, name))
+			return info;
+	}
+	return nullptr;
+}
+
+u32 CallSyscallDirect(const HLEFunction *info) {
+	g_stack[0] = info;
+	g_stackSize = 1;
+	g_syscallPC = currentMIPS->pc;
+	directSyscallCalls++;
+
+	SceUID threadID = __KernelGetCurThread();
+	info->func();
+
+	// This wants CoreTiming to run as soon as possible, not at the end of the block.
+	bool forceCheck = (hleAfterSyscall & HLE_AFTER_CORETIMING_FORCE_CHECK) != 0;
+	if (hleAfterSyscall == HLE_AFTER_NOTHING)
+		SetDeadbeefRegs();
+	else
+		hleFinishSyscall(info);
+	g_stackSize = 0;
+
+	// Most of these ask for a reschedule, which usually keeps the same thread running right where it was.
+	if (!forceCheck && coreState == CORE_RUNNING_CPU && currentMIPS->pc == g_syscallPC && __KernelGetCurThread() == threadID)
+		return 0;
+
+	// Switched threads, ran an interrupt, the GE or similar.
+	directSyscallSlowCalls++;
+	if (coreState != CORE_RUNNING_CPU)
+		CoreTiming::ForceCheck();
+	return currentMIPS->pc;
+}
+
+void hleGetDirectSyscallStats(u64 &calls, u64 &slowCalls) {
+	calls = directSyscallCalls;
+	slowCalls = directSyscallSlowCalls;
+}
+
 void hleSetFlipTime(double t) {
 	hleFlipTime = t;
 }
@@ -185,6 +185,11 @@ void HLEReturnFromMipsCall();
 const HLEFunction *GetSyscallFuncPointer(MIPSOpcode op);
 // For jit, takes arg: const HLEFunction *
 void *GetQuickSyscallFunc(MIPSOpcode op);
+// For the IR, when the block can continue after the syscall. Only a few hot, simple functions qualify.
+const HLEFunction *GetDirectSyscallFunc(MIPSOpcode op);
+// Returns 0 to continue, or the PC to exit to when the syscall switched threads, ran an interrupt or similar.
+u32 CallSyscallDirect(const HLEFunction *info);
+void hleGetDirectSyscallStats(u64 &calls, u64 &slowCalls);
 
 void hleDoLogInternal(Log t, LogLevel level, u64 res, const char *file, int line, const char *reportTag, const char *reason, const char *formatted_reason);
 
@@ -21,6 +21,7 @@
 #include <map>
 #include <unordered_map>
 
+#include "Common/BitSet.h"
 #include "Common/CommonTypes.h"
 #include "Common/Log.h"
 #include "Common/Swap.h"
@@ -28,6 +29,7 @@
 #include "Core/Debugger/Breakpoints.h"
 #include "Core/Debugger/MemBlockInfo.h"
 #include "Core/Debugger/SymbolMap.h"
+#include "Core/ELF/ParamSFO.h"
 #include "Core/MemMap.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
 #include "Core/MIPS/MIPSCodeUtils.h"
@@ -49,6 +51,37 @@ enum class GPUReplacementSkip {
 
 static int skipGPUReplacements = 0;
 
+// Replacements that count what they did, for the report at shutdown.
+enum class TrackedReplacement {
+	MEMCPY_BYTELOOP,
+	MEMSET_BYTELOOP,
+	STRLEN_BYTELOOP,
+	COUNT,
+};
+
+static const char *const trackedReplacementNames[] = {
+	"memcpy_byteloop",
+	"memset_byteloop",
+	"strlen_byteloop",
+};
+
+struct ReplacementCallStats {
+	u64 calls;
+	u64 bytes;
+	// What we told the CPU the original would have taken, all done natively instead.
+	u64 cycles;
+};
+
+static ReplacementCallStats trackedStats[(int)TrackedReplacement::COUNT];
+
+static int TrackReplacementCall(TrackedReplacement which, u32 bytes, int cycles) {
+	ReplacementCallStats &stats = trackedStats[(int)which];
+	stats.calls++;
+	stats.bytes += bytes;
+	stats.cycles += cycles;
+	return cycles;
+}
+
 // I think these have to be pretty accurate as these are libc replacements,
 // but we can probably get away with approximating the VFPU vsin/vcos and vrot
 // pretty roughly.
@@ -428,6 +461,37 @@ static uint32_t SafeStringLen(const uint32_t ptr, uint32_t maxLen = 0x07FFFFFF)
 	return (uint32_t)(end - p);
 }
 
+// Returns the index of the first byte that differs or is a terminator, or len.
+static u32 FirstStringDifference(const u8 *a, const u8 *b, u32 len) {
+	u32 i = 0;
+#if PPSSPP_ARCH(SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	for (; i + 16 <= len; i += 16) {
+		const __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+		const __m128i eq = _mm_cmpeq_epi8(va, _mm_loadu_si128((const __m128i *)(b + i)));
+		const u32 stop = (u32)_mm_movemask_epi8(_mm_andnot_si128(eq, _mm_set1_epi8(-1))) | (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(va, zero));
+		if (stop != 0)
+			return i + LeastSignificantSetBit(stop);
+	}
+#elif PPSSPP_ARCH(ARM_NEON)
+	for (; i + 16 <= len; i += 16) {
+		const uint8x16_t va = vld1q_u8(a + i);
+		// Same bytes that aren't zero are the only ones to keep going on.
+		const uint8x16_t go = vandq_u8(vceqq_u8(va, vld1q_u8(b + i)), vtstq_u8(va, va));
+		const uint64_t stop = ~vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(go), 4)), 0);
+		if (stop != 0) {
+			const u32 low = (u32)stop;
+			return i + (low != 0 ? LeastSignificantSetBit(low) : 32 + LeastSignificantSetBit((u32)(stop >> 32))) / 4;
+		}
+	}
+#endif
+	for (; i < len; ++i) {
+		if (a[i] != b[i] || a[i] == 0)
+			break;
+	}
+	return i;
+}
+
 static int Replace_strlen() {
 	u32 srcPtr = PARAM(0);
 	u32 len = SafeStringLen(srcPtr);
@@ -462,31 +526,99 @@ static int Replace_strncpy() {
 	return 10;  // approximation
 }
 
+// Compares up to maxLen bytes of two strings in PSP memory. Like the MIPS versions,
+// returns the difference of the first bytes that differ.
+static int CompareStrings(u32 aPtr, u32 bPtr, u32 maxLen, u32 *compared) {
+	const u32 len = std::min(maxLen, std::min(Memory::ClampValidSizeAt(aPtr, maxLen), Memory::ClampValidSizeAt(bPtr, maxLen)));
+	const u8 *a = Memory::GetPointerRange(aPtr, len);
+	const u8 *b = Memory::GetPointerRange(bPtr, len);
+	*compared = 0;
+	if (!a || !b || len == 0)
+		return 0;
+	const u32 i = FirstStringDifference(a, b, len);
+	*compared = i;
+	return i == len ? 0 : (int)a[i] - (int)b[i];
+}
+
 static int Replace_strcmp() {
-	u32 aLen = SafeStringLen(PARAM(0));
-	const char *a = (const char *)Memory::GetPointerRange(PARAM(0), aLen);
-	u32 bLen = SafeStringLen(PARAM(1));
-	const char *b = (const char *)Memory::GetPointerRange(PARAM(1), bLen);
-	if (a && b && aLen != 0 && bLen != 0) {
-		RETURN(strcmp(a, b));
-	} else {
-		RETURN(0);
-	}
-	return 10;  // approximation
+	u32 compared;
+	RETURN(CompareStrings(PARAM(0), PARAM(1), 0x07FFFFFF, &compared));
+	return 10 + compared / 4;  // approximation
 }
 
 static int Replace_strncmp() {
 	u32 bytes = PARAM(2);
-	u32 aLen = SafeStringLen(PARAM(0), bytes);
-	const char *a = (const char *)Memory::GetPointerRange(PARAM(0), aLen == 0 ? bytes : aLen);
-	u32 bLen = SafeStringLen(PARAM(1), bytes);
-	const char *b = (const char *)Memory::GetPointerRange(PARAM(1), bLen == 0 ? bytes : bLen);
-	if (a && b && bytes != 0) {
-		RETURN(strncmp(a, b, bytes));
-	} else {
-		RETURN(0);
+	u32 compared;
+	RETURN(CompareStrings(PARAM(0), PARAM(1), bytes, &compared));
+	return 10 + compared / 4;  // approximation
+}
+
+// The *_byteloop ones replace functions matched by MIPSAnalyst::MatchByteLoop(), so must
+// behave exactly like a forward byte loop. Their cycle counts are about what the loops take.
+static int Replace_memcpy_byteloop() {
+	u32 destPtr = PARAM(0);
+	u32 srcPtr = PARAM(1);
+	u32 bytes = PARAM(2);
+	RETURN(destPtr);
+	if (bytes == 0)
+		return 5;
+
+	bool skip = false;
+	currentMIPS->InvalidateICache(srcPtr, bytes);
+	if ((skipGPUReplacements & (int)GPUReplacementSkip::MEMCPY) == 0) {
+		if (Memory::IsVRAMAddress(destPtr) || Memory::IsVRAMAddress(srcPtr)) {
+			skip = gpu->PerformMemoryCopy(destPtr, srcPtr, bytes);
+		}
 	}
-	return 10 + bytes / 4;  // approximation
+	if (!skip) {
+		u8 *dst = Memory::GetPointerWriteRange(destPtr, bytes);
+		const u8 *src = Memory::GetPointerRange(srcPtr, bytes);
+		if (dst && src) {
+			if (destPtr > srcPtr && destPtr - srcPtr < bytes) {
+				// Copying forward over the source repeats the start, memmove wouldn't.
+				for (u32 i = 0; i < bytes; i++) {
+					dst[i] = src[i];
+				}
+			} else {
+				memmove(dst, src, bytes);
+			}
+		}
+	}
+
+	if (MemBlockInfoDetailed(bytes)) {
+		NotifyMemInfoCopy(destPtr, srcPtr, bytes, "ReplaceMemcpy/");
+	}
+	return TrackReplacementCall(TrackedReplacement::MEMCPY_BYTELOOP, bytes, 5 + bytes * 5);
+}
+
+static int Replace_memset_byteloop() {
+	u32 destPtr = PARAM(0);
+	u8 value = PARAM(1);
+	u32 bytes = PARAM(2);
+	RETURN(destPtr);
+	if (bytes == 0)
+		return 5;
+
+	bool skip = false;
+	if (Memory::IsVRAMAddress(destPtr) && (skipGPUReplacements & (int)GPUReplacementSkip::MEMSET) == 0) {
+		skip = gpu->PerformMemorySet(destPtr, value, bytes);
+	}
+	if (!skip) {
+		u8 *dst = Memory::GetPointerWriteRange(destPtr, bytes);
+		if (dst) {
+			memset(dst, value, bytes);
+		}
+	}
+
+	NotifyMemInfo(MemBlockFlags::WRITE, destPtr, bytes, "ReplaceMemset");
+	return TrackReplacementCall(TrackedReplacement::MEMSET_BYTELOOP, bytes, 5 + bytes * 4);
+}
+
+static int Replace_strlen_byteloop() {
+	u32 srcPtr = PARAM(0);
+	u32 len = SafeStringLen(srcPtr);
+	RETURN(len);
+	return TrackReplacementCall(TrackedReplacement::STRLEN_BYTELOOP, len, 5 + len * 4);
 }
 
 static int Replace_fabsf() {
@@ -1611,6 +1743,9 @@ static const ReplacementTableEntry entries[] = {
 	{ "strncpy", &Replace_strncpy, 0, REPFLAG_DISABLED },
 	{ "strcmp", &Replace_strcmp, 0, REPFLAG_DISABLED },
 	{ "strncmp", &Replace_strncmp, 0, REPFLAG_DISABLED },
+	{ "memcpy_byteloop", &Replace_memcpy_byteloop, 0, 0 },
+	{ "memset_byteloop", &Replace_memset_byteloop, 0, 0 },
+	{ "strlen_byteloop", &Replace_strlen_byteloop, 0, 0 },
 	{ "fabsf", &Replace_fabsf, JITFUNC(Replace_fabsf), REPFLAG_DISABLED },
 	{ "dl_write_matrix", &Replace_dl_write_matrix, 0, REPFLAG_DISABLED }, // &MIPSComp::Jit::Replace_dl_write_matrix, REPFLAG_DISABLED },
 	{ "dl_write_matrix_2", &Replace_dl_write_matrix, 0, REPFLAG_DISABLED },
@@ -1714,6 +1849,30 @@ static const ReplacementTableEntry entries[] = {
 static std::map<u32, u32> replacedInstructions;
 static std::unordered_map<std::string, std::vector<int> > replacementNameLookup;
 
+struct ReplacedFunction {
+	int index;
+	bool byShape;
+};
+// Everything replaced since Replacement_Init, for the report. Kept when restored.
+static std::map<u32, ReplacedFunction> replacedFunctions;
+
+static void LogReplacementReport() {
+	if (replacedFunctions.empty())
+		return;
+
+	int byShape = 0;
+	for (const auto &[addr, replaced] : replacedFunctions)
+		byShape += replaced.byShape ? 1 : 0;
+	INFO_LOG(Log::HLE, "Function replacements for %s: %d functions, %d of them by shape", g_paramSFO.GetDiscID().c_str(), (int)replacedFunctions.size(), byShape);
+	for (const auto &[addr, replaced] : replacedFunctions)
+		INFO_LOG(Log::HLE, "  %08x %s%s", addr, entries[replaced.index].name, replaced.byShape ? " (by shape)" : "");
+	for (int i = 0; i < (int)TrackedReplacement::COUNT; ++i) {
+		const ReplacementCallStats &stats = trackedStats[i];
+		if (stats.calls != 0)
+			INFO_LOG(Log::HLE, "  %s: %llu calls, %llu bytes, ~%llu cycles run natively", trackedReplacementNames[i], (unsigned long long)stats.calls, (unsigned long long)stats.bytes, (unsigned long long)stats.cycles);
+	}
+}
+
 void Replacement_Init() {
 	for (int i = 0; i < (int)ARRAY_SIZE(entries); i++) {
 		const auto entry = &entries[i];
@@ -1723,11 +1882,15 @@ void Replacement_Init() {
 	}
 
 	skipGPUReplacements = 0;
+	replacedFunctions.clear();
+	memset(trackedStats, 0, sizeof(trackedStats));
 }
 
 void Replacement_Shutdown() {
+	LogReplacementReport();
 	replacedInstructions.clear();
 	replacementNameLookup.clear();
+	replacedFunctions.clear();
 }
 
 int GetNumReplacementFuncs() {
@@ -1802,6 +1965,22 @@ void WriteReplaceInstructions(u32 address, u64 hash, int size) {
 
 		if (didReplace) {
 			INFO_LOG(Log::HLE, "Replaced %s at %08x with hash %016llx", entries[index].name, address, hash);
+			replacedFunctions[address] = { index, false };
+		}
+	}
+}
+
+void WriteReplaceInstructionsByName(u32 address, const char *name) {
+	auto iter = replacementNameLookup.find(name);
+	if (iter == replacementNameLookup.end())
+		return;
+	for (int index : iter->second) {
+		// Only whole function replacements, hooks are tied to specific code.
+		if ((entries[index].flags & (REPFLAG_HOOKENTER | REPFLAG_HOOKEXIT)) != 0)
+			continue;
+		if (WriteReplaceInstruction(address, index)) {
+			INFO_LOG(Log::HLE, "Replaced %s at %08x by its shape", entries[index].name, address);
+			replacedFunctions[address] = { index, true };
 		}
 	}
 }
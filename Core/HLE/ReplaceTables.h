@@ -73,6 +73,8 @@ std::vector<int> GetReplacementFuncIndexes(u64 hash, int funcSize);
 const ReplacementTableEntry *GetReplacementFunc(size_t index);
 
 void WriteReplaceInstructions(u32 address, u64 hash, int size);
+// For functions recognized by shape rather than hash, see MIPSAnalyst::MatchByteLoop().
+void WriteReplaceInstructionsByName(u32 address, const char *name);
 void RestoreReplacedInstruction(u32 address);
 void RestoreReplacedInstructions(u32 startAddr, u32 endAddr);
 bool GetReplacedOpAt(u32 address, u32 *op);
@@ -15,13 +15,11 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
-#include <algorithm> // std::remove
+#include <algorithm> // std::remove, std::clamp
 #include <cstdlib>
 #include <set>
-#include <thread>
 #include <memory>
 
-#include "Common/Thread/ThreadUtil.h"
 #include "Common/Profiler/Profiler.h"
 #include "Common/TimeUtil.h"
 
@@ -140,8 +138,6 @@ static MemStickState lastMemStickState;
 static MemStickFatState lastMemStickFatState;
 
 static AsyncIOManager ioManager;
-static bool ioManagerThreadEnabled = false;
-static std::thread ioManagerThread;
 
 // TODO: Is it better to just put all on the thread?
 // Let's try. (was 256)
@@ -580,24 +576,6 @@ static void __IoAsyncEndCallback(SceUID threadID, SceUID prevCallbackId) {
 	}
 }
 
-static void __IoManagerThread() {
-	SetCurrentThreadName("IO");
-	INFO_LOG(Log::sceIo, "Entering __IoManagerThread");
-	AndroidJNIThreadContext jniContext;
-	while (ioManagerThreadEnabled) {
-		ioManager.RunEventsUntil(CoreTiming::GetTicks() + msToCycles(1000));
-	}
-	INFO_LOG(Log::sceIo, "Leaving __IoManagerThread");
-}
-
-static void __IoWakeManager(CoreLifecycle stage) {
-	// Ping the thread so that it knows to check coreState.
-	if (stage == CoreLifecycle::STOPPING) {
-		ioManagerThreadEnabled = false;
-		ioManager.FinishEventLoop();
-	}
-}
-
 void __IoVblank() {
 	// We update memstick status here just to avoid possible thread safety issues.
 	// It doesn't actually need to be on a vblank.
@@ -689,10 +667,7 @@ void __IoInit() {
 
 	memset(fds, 0, sizeof(fds));
 
-	ioManagerThreadEnabled = true;
-	ioManager.SetThreadEnabled(true);
-	Core_ListenLifecycle(&__IoWakeManager);
-	ioManagerThread = std::thread(&__IoManagerThread);
+	ioManager.StartWorkers(std::clamp(g_Config.iIOWorkerThreads, 1, 8));
 
 	__KernelRegisterWaitTypeFuncs(WAITTYPE_ASYNCIO, __IoAsyncBeginCallback, __IoAsyncEndCallback);
 
@@ -770,13 +745,8 @@ void __IoDoState(PointerWrap &p) {
 }
 
 void __IoShutdown() {
-	ioManagerThreadEnabled = false;
-	ioManager.SyncThread();
-	ioManager.FinishEventLoop();
-	if (ioManagerThread.joinable()) {
-		ioManagerThread.join();
-		ioManager.Shutdown();
-	}
+	ioManager.StopWorkers();
+	ioManager.Shutdown();
 
 	for (int i = 0; i < PSP_COUNT_FDS; ++i) {
 		asyncParams[i].op = IoAsyncOp::NONE;
@@ -1086,12 +1056,12 @@ static bool __IoRead(int &result, int id, u32 data_addr, int size, int &us) {
 				return true;
 			}
 
-			bool useThread = __KernelIsDispatchEnabled() && ioManagerThreadEnabled && size > IO_THREAD_MIN_DATA_SIZE;
+			bool useThread = __KernelIsDispatchEnabled() && ioManager.ThreadEnabled() && size > IO_THREAD_MIN_DATA_SIZE;
 			if (useThread) {
 				// If there's a pending operation on this file, wait for it to finish and don't overwrite it.
 				useThread = !ioManager.HasOperation(f->handle);
 				if (!useThread) {
-					ioManager.SyncThread();
+					ioManager.SyncHandle(f->handle);
 				}
 			}
 			if (useThread) {
@@ -1236,12 +1206,12 @@ static bool __IoWrite(int &result, int id, u32 data_addr, int size, int &us) {
 			return true;
 		}
 
-		bool useThread = __KernelIsDispatchEnabled() && ioManagerThreadEnabled && size > IO_THREAD_MIN_DATA_SIZE;
+		bool useThread = __KernelIsDispatchEnabled() && ioManager.ThreadEnabled() && size > IO_THREAD_MIN_DATA_SIZE;
 		if (useThread) {
 			// If there's a pending operation on this file, wait for it to finish and don't overwrite it.
 			useThread = !ioManager.HasOperation(f->handle);
 			if (!useThread) {
-				ioManager.SyncThread();
+				ioManager.SyncHandle(f->handle);
 			}
 		}
 		if (useThread) {
@@ -1392,9 +1362,7 @@ static s64 __IoLseekDest(FileNode *f, s64 offset, int whence, FileMove &seek) {
 	seek = FILEMOVE_BEGIN;
 
 	// Let's make sure this isn't incorrect mid-operation.
-	if (ioManager.HasOperation(f->handle)) {
-		ioManager.SyncThread();
-	}
+	ioManager.SyncHandle(f->handle);
 
 	s64 newPos = 0;
 	switch (whence) {
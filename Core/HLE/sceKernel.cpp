@@ -495,65 +495,117 @@ void KernelObject::GetLongInfo(char *ptr, int size) const {
 }
 
 KernelObjectPool::KernelObjectPool() {
-	memset(occupied, 0, sizeof(bool)*maxCount);
-	nextID = initialNextID;
+	memset(pool, 0, sizeof(pool));
+	memset(generation, 0, sizeof(generation));
+	count = 0;
+	ResetFreeSlots(initialNextID);
 }
 
-SceUID KernelObjectPool::Create(KernelObject *obj, int rangeBottom, int rangeTop) {
-	if (rangeTop > maxCount)
-		rangeTop = maxCount;
-	if (nextID >= rangeBottom && nextID < rangeTop)
-		rangeBottom = nextID++;
-
-	for (int i = rangeBottom; i < rangeTop; i++) {
-		if (!occupied[i]) {
-			occupied[i] = true;
-			pool[i] = obj;
-			pool[i]->uid = i + handleOffset;
-			return i + handleOffset;
-		}
+void KernelObjectPool::ResetFreeSlots(int firstIndex) {
+	// Hand out slots in order from firstIndex and then wrap around. Freed slots go to the back,
+	// so unlike the old sequential IDs, reuse after wrapping is oldest freed first, not lowest first.
+	freeHead = 0;
+	freeCount = 0;
+	for (int n = 0; n < maxCount - initialNextID; n++) {
+		int i = initialNextID + (firstIndex - initialNextID + n) % (maxCount - initialNextID);
+		if (!pool[i])
+			freeSlots[freeCount++] = (u16)i;
 	}
+}
+
+int KernelObjectPool::FindTypeSlots(int type) const {
+	for (size_t i = 0; i < typeSlots.size(); i++) {
+		if (typeSlots[i].type == type)
+			return (int)i;
+	}
+	return -1;
+}
+
+void KernelObjectPool::Occupy(int index, KernelObject *obj) {
+	pool[index] = obj;
+	obj->uid = MakeUID(index);
+	count++;
+
+	const int type = obj->GetIDType();
+	int typeIndex = FindTypeSlots(type);
+	if (typeIndex < 0) {
+		typeIndex = (int)typeSlots.size();
+		typeSlots.push_back(TypeSlots{ type, {} });
+	}
+	typeSlots[typeIndex].bits[index / 64] |= 1ULL << (index % 64);
+}
+
+void KernelObjectPool::Free(int index) {
+	KernelObject *obj = pool[index];
+	int typeIndex = FindTypeSlots(obj->GetIDType());
+	_dbg_assert_(typeIndex >= 0);
+	typeSlots[typeIndex].bits[index / 64] &= ~(1ULL << (index % 64));
+
+	pool[index] = nullptr;
+	generation[index] = (generation[index] + 1) & generationMask;
+	freeSlots[(freeHead + freeCount) % maxCount] = (u16)index;
+	freeCount++;
+	count--;
+
+	delete obj;
+}
+
+SceUID KernelObjectPool::Create(KernelObject *obj) {
+	if (freeCount == 0) {
+		ERROR_LOG_REPORT(Log::sceKernel, "Unable to allocate kernel object, too many objects slots in use.");
+		return 0;
+	}
+
+	int index = freeSlots[freeHead];
+	freeHead = (freeHead + 1) % maxCount;
+	freeCount--;
+	Occupy(index, obj);
+	return obj->uid;
+}
 
-	ERROR_LOG_REPORT(Log::sceKernel, "Unable to allocate kernel object, too many objects slots in use.");
-	return 0;
+int KernelObjectPool::ListIDType(int type, SceUID_le *uids, int count) const {
+	int typeIndex = FindTypeSlots(type);
+	if (typeIndex < 0)
+		return 0;
+
+	int total = 0;
+	for (int w = 0; w < slotWords; w++) {
+		u64 word = typeSlots[typeIndex].bits[w];
+		while (word != 0) {
+			int bit = LeastSignificantSetBit(word);
+			word &= word - 1;
+			if (total < count)
+				*uids++ = pool[w * 64 + bit]->GetUID();
+			++total;
+		}
+	}
+	return total;
 }
 
 void KernelObjectPool::Clear() {
 	for (int i = 0; i < maxCount; i++) {
 		// brutally clear everything, no validation
-		if (occupied[i])
-			delete pool[i];
+		delete pool[i];
 		pool[i] = nullptr;
-		occupied[i] = false;
 	}
-	nextID = initialNextID;
+	memset(generation, 0, sizeof(generation));
+	count = 0;
+	typeSlots.clear();
+	ResetFreeSlots(initialNextID);
 }
 
 void KernelObjectPool::List() {
 	for (int i = 0; i < maxCount; i++) {
-		if (occupied[i]) {
+		if (pool[i]) {
 			char buffer[256];
-			if (pool[i]) {
-				pool[i]->GetQuickInfo(buffer, sizeof(buffer));
-				DEBUG_LOG(Log::sceKernel, "KO %i: %s \"%s\": %s", i + handleOffset, pool[i]->GetTypeName(), pool[i]->GetName(), buffer);
-			} else {
-				ERROR_LOG(Log::sceKernel, "KO %i: bad object", i + handleOffset);
-			}
+			pool[i]->GetQuickInfo(buffer, sizeof(buffer));
+			DEBUG_LOG(Log::sceKernel, "KO %i: %s \"%s\": %s", pool[i]->GetUID(), pool[i]->GetTypeName(), pool[i]->GetName(), buffer);
 		}
 	}
 }
 
-int KernelObjectPool::GetCount() const {
-	int count = 0;
-	for (int i = 0; i < maxCount; i++) {
-		if (occupied[i])
-			count++;
-	}
-	return count;
-}
-
 void KernelObjectPool::DoState(PointerWrap &p) {
-	auto s = p.Section("KernelObjectPool", 1);
+	auto s = p.Section("KernelObjectPool", 1, 2);
 	if (!s)
 		return;
 
@@ -571,8 +623,43 @@ void KernelObjectPool::DoState(PointerWrap &p) {
 		kernelObjects.Clear();
 	}
 
-	Do(p, nextID);
+	// Older states had a sequential next ID instead of generations and a free list.
+	int nextID = initialNextID;
+	if (s >= 2)
+		DoArray(p, generation, maxCount);
+	else
+		Do(p, nextID);
+
+	bool occupied[maxCount];
+	for (int i = 0; i < maxCount; ++i)
+		occupied[i] = pool[i] != nullptr;
 	DoArray(p, occupied, maxCount);
+
+	if (s >= 2) {
+		Do(p, freeCount);
+		if (freeCount < 0 || freeCount > maxCount) {
+			p.SetError(p.ERROR_FAILURE);
+			ERROR_LOG(Log::sceKernel, "Unable to load state: bad kernel object free list.");
+			return;
+		}
+		for (int n = 0; n < freeCount; ++n) {
+			u16 index = 0;
+			if (p.mode != p.MODE_READ)
+				index = freeSlots[(freeHead + n) % maxCount];
+			Do(p, index);
+			if (index < initialNextID || index >= maxCount) {
+				p.SetError(p.ERROR_FAILURE);
+				ERROR_LOG(Log::sceKernel, "Unable to load state: bad kernel object free list.");
+				return;
+			}
+			// Compacting in place is only safe on load, saving must leave the live ring alone.
+			if (p.mode == p.MODE_READ)
+				freeSlots[n] = index;
+		}
+		if (p.mode == p.MODE_READ)
+			freeHead = 0;
+	}
+
 	for (int i = 0; i < maxCount; ++i) {
 		if (!occupied[i])
 			continue;
@@ -580,13 +667,13 @@ void KernelObjectPool::DoState(PointerWrap &p) {
 		int type;
 		if (p.mode == p.MODE_READ) {
 			Do(p, type);
-			pool[i] = CreateByIDType(type);
+			KernelObject *obj = CreateByIDType(type);
 
 			// Already logged an error.
-			if (pool[i] == nullptr)
+			if (obj == nullptr)
 				return;
 
-			pool[i]->uid = i + handleOffset;
+			Occupy(i, obj);
 		} else {
 			type = pool[i]->GetIDType();
 			Do(p, type);
@@ -595,6 +682,9 @@ void KernelObjectPool::DoState(PointerWrap &p) {
 		if (p.error >= p.ERROR_FAILURE)
 			break;
 	}
+
+	if (p.mode == p.MODE_READ && s < 2)
+		ResetFreeSlots(nextID >= initialNextID && nextID < maxCount ? nextID : initialNextID);
 }
 
 KernelObject *KernelObjectPool::CreateByIDType(int type) {
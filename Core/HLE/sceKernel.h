@@ -19,7 +19,9 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
+#include "Common/BitSet.h"
 #include "Common/CommonTypes.h"
 #include "Common/Log.h"
 #include "Common/Swap.h"
@@ -140,14 +142,17 @@ class KernelObject {
 	}
 };
 
-// TODO: Delete the "occupied" array, rely on non-zero pool entries?
+// Handles are the slot index plus handleOffset, with a generation in the upper bits that changes
+// each time the slot is freed, so stale handles stop working instead of finding a newer object.
+// The first generation is 0, so the first handle for each slot is the same as it always was.
+// Free slots are reused oldest first, and each type keeps a bitmap of its slots for iteration.
 class KernelObjectPool {
 public:
 	KernelObjectPool();
 	~KernelObjectPool() {}
 
-	// Allocates a UID within the range and inserts the object into the map.
-	SceUID Create(KernelObject *obj, int rangeBottom = initialNextID, int rangeTop = 0x7fffffff);
+	// Allocates a UID and inserts the object into the pool.
+	SceUID Create(KernelObject *obj);
 
 	void DoState(PointerWrap &p);
 	static KernelObject *CreateByIDType(int type);
@@ -155,44 +160,34 @@ class KernelObjectPool {
 	template <class T>
 	u32 Destroy(SceUID handle) {
 		u32 error;
-		if (Get<T>(handle, error)) {
-			int index = handle - handleOffset;
-			occupied[index] = false;
-			delete pool[index];
-			pool[index] = nullptr;
-		}
+		if (Get<T>(handle, error))
+			Free(IndexOf(handle));
 		return error;
 	};
 
 	bool IsValid(SceUID handle) const {
-		int index = handle - handleOffset;
-		if (index < 0 || index >= maxCount)
-			return false;
-		else
-			return occupied[index];
+		return IndexOf(handle) >= 0;
 	}
 
 	template<class T>
 	bool Is(SceUID handle) const {
-		int index = handle - handleOffset;
-		if (index < 0 || index >= maxCount)
-			return false;
-		else
-			return occupied[index] && pool[handle - handleOffset]->GetIDType() == T::GetStaticIDType();
+		int index = IndexOf(handle);
+		return index >= 0 && pool[index]->GetIDType() == T::GetStaticIDType();
 	}
 
 	template <class T>
 	T* Get(SceUID handle, u32 &outError) {
-		if (handle < handleOffset || handle >= handleOffset+maxCount || !occupied[handle-handleOffset]) {
+		int index = IndexOf(handle);
+		if (index < 0) {
 			outError = T::GetMissingErrorCode();
 			return nullptr;
 		} else {
 			// Previously we had a dynamic_cast here, but since RTTI was disabled traditionally,
 			// it just acted as a static cast and everything worked. This means that we will never
 			// see the Wrong type object error below, but we'll just have to live with that danger.
-			T *t = static_cast<T *>(pool[handle - handleOffset]);
-			if (t == nullptr || t->GetIDType() != T::GetStaticIDType()) {
-				WARN_LOG(Log::sceKernel, "Kernel: Wrong object type for %d (%08x), was %s, should have been %s", handle, handle, t ? t->GetTypeName() : "null", T::GetStaticTypeName());
+			T *t = static_cast<T *>(pool[index]);
+			if (t->GetIDType() != T::GetStaticIDType()) {
+				WARN_LOG(Log::sceKernel, "Kernel: Wrong object type for %d (%08x), was %s, should have been %s", handle, handle, t->GetTypeName(), T::GetStaticTypeName());
 				outError = T::GetMissingErrorCode();
 				return nullptr;
 			}
@@ -204,64 +199,98 @@ class KernelObjectPool {
 	// ONLY use this when you KNOW the handle is valid.
 	template <class T>
 	T *GetFast(SceUID handle) {
-		const SceUID realHandle = handle - handleOffset;
-		_dbg_assert_(realHandle >= 0 && realHandle < maxCount && occupied[realHandle]);
-		return static_cast<T *>(pool[realHandle]);
+		const int index = (handle & indexMask) - handleOffset;
+		_dbg_assert_(index >= 0 && index < maxCount && pool[index] && pool[index]->uid == (u32)handle);
+		return static_cast<T *>(pool[index]);
 	}
 
+	// Calls func for each object of type T, in handle slot order, until it returns false.
+	// func may create or destroy objects.
 	template <typename T, typename F>
 	void Iterate(F func) {
-		int type = T::GetStaticIDType();
-		for (int i = 0; i < maxCount; i++) {
-			if (!occupied[i])
-				continue;
-			T *t = static_cast<T *>(pool[i]);
-			if (t->GetIDType() == type) {
-				if (!func(i + handleOffset, t))
-					break;
+		int typeIndex = FindTypeSlots(T::GetStaticIDType());
+		if (typeIndex < 0)
+			return;
+		for (int w = 0; w < slotWords; w++) {
+			u64 word = typeSlots[typeIndex].bits[w];
+			while (word != 0) {
+				int bit = LeastSignificantSetBit(word);
+				int index = w * 64 + bit;
+				if (!func((SceUID)pool[index]->uid, static_cast<T *>(pool[index])))
+					return;
+				// Look again, func might have changed things.
+				word = bit == 63 ? 0 : typeSlots[typeIndex].bits[w] & (~0ULL << (bit + 1));
 			}
 		}
 	}
 
-	int ListIDType(int type, SceUID_le *uids, int count) const {
-		int total = 0;
-		for (int i = 0; i < maxCount; i++) {
-			if (!occupied[i]) {
-				continue;
-			}
-			if (pool[i]->GetIDType() == type) {
-				if (total < count) {
-					*uids++ = pool[i]->GetUID();
-				}
-				++total;
-			}
-		}
-		return total;
+	int ListIDType(int type, SceUID_le *uids, int count) const;
+
+	// The object in a slot (0 to maxCount - 1), or nullptr. For debugger views that list everything.
+	KernelObject *GetBySlot(int index) const {
+		return pool[index];
 	}
 
 	bool GetIDType(SceUID handle, int *type) const {
-		if (handle < handleOffset || handle >= handleOffset+maxCount || !occupied[handle-handleOffset]) {
+		int index = IndexOf(handle);
+		if (index < 0) {
 			ERROR_LOG(Log::sceKernel, "Kernel: Bad object handle %i (%08x)", handle, handle);
 			return false;
 		}
-		KernelObject *t = pool[handle - handleOffset];
-		*type = t->GetIDType();
+		*type = pool[index]->GetIDType();
 		return true;
 	}
 
 	void List();
 	void Clear();
-	int GetCount() const;
+	int GetCount() const {
+		return count;
+	}
 
 	enum {
 		maxCount = 4096,
 		handleOffset = 0x100,
-		initialNextID = 0x10
+		initialNextID = 0x10,
+		// Slot index + handleOffset fits in the low bits, the generation goes above them.
+		indexMask = 0xFFFF,
+		generationShift = 16,
+		// Keeps handles positive.
+		generationMask = 0x7FFF,
 	};
+
 private:
+	enum {
+		slotWords = maxCount / 64,
+	};
+
+	struct TypeSlots {
+		int type;
+		u64 bits[slotWords];
+	};
+
+	// The slot for a live handle with the current generation, or -1.
+	int IndexOf(SceUID handle) const {
+		int index = (handle & indexMask) - handleOffset;
+		if (index < 0 || index >= maxCount || !pool[index] || pool[index]->uid != (u32)handle)
+			return -1;
+		return index;
+	}
+	SceUID MakeUID(int index) const {
+		return (SceUID)(((u32)generation[index] << generationShift) | (u32)(index + handleOffset));
+	}
+	void Occupy(int index, KernelObject *obj);
+	void Free(int index);
+	void ResetFreeSlots(int firstIndex);
+	int FindTypeSlots(int type) const;
+
 	KernelObject *pool[maxCount];
-	bool occupied[maxCount];
-	int nextID;
+	u16 generation[maxCount];
+	// Ring of free slots, oldest first. Slots below initialNextID are never used.
+	u16 freeSlots[maxCount];
+	int freeHead;
+	int freeCount;
+	int count;
+	std::vector<TypeSlots> typeSlots;
 };
 
 extern KernelObjectPool kernelObjects;
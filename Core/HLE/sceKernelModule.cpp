@@ -26,6 +26,7 @@
 #include "Common/Serialize/SerializeSet.h"
 #include "Common/File/FileUtil.h"
 #include "Common/StringUtils.h"
+#include "Common/TimeUtil.h"
 #include "Common/System/Request.h"
 #include "Common/System/System.h"
 #include "Common/System/OSD.h"
@@ -1339,8 +1340,11 @@ static PSPModule *__KernelLoadELFFromPtr(const u8 *ptr, size_t elfSize, u32 load
 
 	if (!module->isFake) {
 		bool scan = true;
+		Instant scanStart = Instant::Now();
 		// If the ELF has debug symbols, don't add entries to the symbol table.
 		bool insertSymbols = scan && !reader.LoadSymbols();
+		// Start and inclusive end of each range to scan, in order.
+		std::vector<std::pair<u32, u32>> scanRanges;
 		std::vector<SectionID> codeSections = reader.GetCodeSections();
 		for (SectionID id : codeSections) {
 			const u32 start = reader.GetSectionAddr(id);
@@ -1362,7 +1366,7 @@ static PSPModule *__KernelLoadELFFromPtr(const u8 *ptr, size_t elfSize, u32 load
 				module->textEnd = end;
 
 			if (scan) {
-				insertSymbols = MIPSAnalyst::ScanForFunctions(start, end, insertSymbols);
+				scanRanges.emplace_back(start, end);
 			}
 		}
 
@@ -1374,23 +1378,43 @@ static PSPModule *__KernelLoadELFFromPtr(const u8 *ptr, size_t elfSize, u32 load
 			if (Memory::IsValid4AlignedRange(scanStart, scanEnd - scanStart)) {
 				// Skip the exports and imports sections, they're not code.
 				if (scanEnd >= std::min(modinfo->libent, modinfo->libstub)) {
-					insertSymbols = MIPSAnalyst::ScanForFunctions(scanStart, std::min(modinfo->libent, modinfo->libstub), insertSymbols);
+					scanRanges.emplace_back(scanStart, std::min(modinfo->libent, modinfo->libstub));
 					scanStart = std::min(modinfo->libentend, modinfo->libstubend);
 				}
 				if (scanEnd >= std::max(modinfo->libent, modinfo->libstub)) {
-					insertSymbols = MIPSAnalyst::ScanForFunctions(scanStart, std::max(modinfo->libent, modinfo->libstub), insertSymbols);
+					scanRanges.emplace_back(scanStart, std::max(modinfo->libent, modinfo->libstub));
 					scanStart = std::max(modinfo->libentend, modinfo->libstubend);
 				}
-				insertSymbols = MIPSAnalyst::ScanForFunctions(scanStart, scanEnd, insertSymbols);
+				scanRanges.emplace_back(scanStart, scanEnd);
 			} else {
 				ERROR_LOG(Log::Loader, "Bad text scan range %08x-%08x", scanStart, scanEnd);
 			}
 		}
 
 		if (scan) {
-			// TODO: Limit this to the newly loaded range! This is expensive, well, at least in debug builds
-			// and the cause of stutter during Wipeout Pure initialization.
-			MIPSAnalyst::FinalizeScan(insertSymbols);
+			u64 cacheKey = 0;
+			bool cached = false;
+			if (g_Config.bFuncScanCache) {
+				cacheKey = MIPSAnalyst::ScanCacheKey(scanRanges, insertSymbols);
+				cached = MIPSAnalyst::ApplyCachedScan(cacheKey);
+			}
+
+			double scanMs = 0.0;
+			Instant finalizeStart = Instant::Now();
+			if (!cached) {
+				for (const auto &range : scanRanges) {
+					insertSymbols = MIPSAnalyst::ScanForFunctions(range.first, range.second, insertSymbols);
+				}
+				scanMs = scanStart.ElapsedMs();
+				finalizeStart = Instant::Now();
+				// TODO: Limit this to the newly loaded range! This is expensive, well, at least in debug builds
+				// and the cause of stutter during Wipeout Pure initialization.
+				MIPSAnalyst::FinalizeScan(insertSymbols);
+				if (g_Config.bFuncScanCache)
+					MIPSAnalyst::StoreCachedScan(cacheKey, scanRanges, insertSymbols);
+			}
+			INFO_LOG(Log::Loader, "Module %s: function scan took %0.2f ms, hashing and replacements %0.2f ms%s (%08x-%08x)",
+				module->nm.name, scanMs, finalizeStart.ElapsedMs(), cached ? " (cached)" : "", module->textStart, module->textEnd);
 		}
 	}
 
@@ -17,6 +17,7 @@
 #include "Core/HLE/sceNp2.h"
 #include "Core/HLE/NetInetConstants.h"
 #include "Core/MIPS/MIPS.h"
+#include "Core/MIPS/JitCommon/JitWriteProtect.h"
 #include "Core/Config.h"
 #include "Core/System.h"
 #include "Core/ELF/ParamSFO.h"
@@ -419,6 +420,8 @@ static int sceNetInetRecv(int socket, u32 bufPtr, u32 bufLen, u32 flags) {
 
 	int flgs = flags & ~PSP_NET_INET_MSG_DONTWAIT; // removing non-POSIX flag, which is an alternative way to use non-blocking mode
 	flgs = convertMSGFlagsPSP2Host(flgs);
+	// The kernel writes to RAM directly, that can't fault like our own writes do.
+	JitWriteProtect::NotifyWrite(bufPtr, bufLen);
 	int retval = recv(inetSock->sock, (char*)Memory::GetPointer(bufPtr), bufLen, flgs | MSG_NOSIGNAL);
 	if (retval < 0) {
 		if (UpdateErrnoFromHost(__KernelGetCurThread(), socket_errno, __FUNCTION__) == ERROR_INET_EAGAIN) {
@@ -608,6 +611,8 @@ static int sceNetInetGetsockopt(int socket, int level, int optname, u32 optvalPt
 			memcpy(optval, &val, std::min(static_cast<socklen_t>(sizeof(val)), std::min(static_cast<socklen_t>(sizeof(*optval)), *optlen)));
 		}
 	} else {
+		JitWriteProtect::NotifyWrite(optvalPtr, optlen ? *optlen : 0);
+		JitWriteProtect::NotifyWrite(optlenPtr, sizeof(socklen_t));
 		retval = getsockopt(inetSock->sock, convertSockoptLevelPSP2Host(level), convertSockoptNamePSP2Host(optname, level), (char*)optval, optlen);
 	}
 	if (retval < 0) {
@@ -757,6 +762,7 @@ static int sceNetInetAccept(int socket, u32 addrPtr, u32 addrLenPtr) {
 	if (srclen)
 		*srclen = std::min((*srclen) > 0 ? *srclen : 0, static_cast<socklen_t>(sizeof(saddr)));
 
+	JitWriteProtect::NotifyWrite(addrLenPtr, sizeof(socklen_t));
 	int newHostSocket = accept(inetSock->sock, (struct sockaddr*)&saddr.addr, srclen);
 	if (newHostSocket < 0) {
 		if (UpdateErrnoFromHost(__KernelGetCurThread(), socket_errno, __FUNCTION__) == ERROR_INET_EAGAIN) {
@@ -852,6 +858,8 @@ static int sceNetInetRecvfrom(int socket, u32 bufferPtr, int len, int flags, u32
 		*srclen = std::min((*srclen) > 0 ? *srclen : 0, static_cast<socklen_t>(sizeof(saddr)));
 	int flgs = flags & ~PSP_NET_INET_MSG_DONTWAIT; // removing non-POSIX flag, which is an alternative way to use non-blocking mode
 	flgs = convertMSGFlagsPSP2Host(flgs);
+	JitWriteProtect::NotifyWrite(bufferPtr, std::max(0, len));
+	JitWriteProtect::NotifyWrite(fromlenPtr, sizeof(socklen_t));
 	int retval = recvfrom(inetSock->sock, (char*)Memory::GetPointer(bufferPtr), len, flgs | MSG_NOSIGNAL, (struct sockaddr*)&saddr.addr, srclen);
 	if (retval < 0) {
 		if (UpdateErrnoFromHost(__KernelGetCurThread(), socket_errno, __FUNCTION__) == ERROR_INET_EAGAIN) {
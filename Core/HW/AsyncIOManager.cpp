@@ -16,106 +16,169 @@
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
 #include <condition_variable>
+#include <cstdio>
+#include <map>
 #include <mutex>
+#include <set>
 
 #include "Common/Serialize/Serializer.h"
 #include "Common/Serialize/SerializeFuncs.h"
 #include "Common/Serialize/SerializeMap.h"
 #include "Common/Serialize/SerializeSet.h"
+#include "Common/Thread/ThreadUtil.h"
 #include "Core/MIPS/MIPS.h"
+#include "Core/MIPS/JitCommon/JitWriteProtect.h"
 #include "Core/Reporting.h"
 #include "Core/HW/AsyncIOManager.h"
 #include "Core/FileSystems/MetaFileSystem.h"
 
-bool AsyncIOManager::HasOperation(u32 handle) {
-	std::lock_guard<std::mutex> guard(resultsLock_);
-	if (resultsPending_.find(handle) != resultsPending_.end()) {
-		return true;
+void AsyncIOManager::StartWorkers(int count) {
+	StopWorkers();
+	for (int i = 0; i < count; ++i) {
+		workers_.push_back(std::make_unique<Worker>());
+		Worker *worker = workers_.back().get();
+		worker->thread = std::thread(&AsyncIOManager::WorkerThread, this, worker, i);
+	}
+}
+
+void AsyncIOManager::StopWorkers() {
+	for (auto &worker : workers_) {
+		std::lock_guard<std::mutex> guard(worker->lock);
+		worker->stopping = true;
+		worker->wake.notify_one();
+	}
+	for (auto &worker : workers_) {
+		worker->thread.join();
+	}
+	workers_.clear();
+}
+
+void AsyncIOManager::WorkerThread(Worker *worker, int index) {
+	char name[16];
+	snprintf(name, sizeof(name), "IO%d", index);
+	SetCurrentThreadName(name);
+	AndroidJNIThreadContext jniContext;
+
+	std::unique_lock<std::mutex> guard(worker->lock);
+	while (true) {
+		worker->wake.wait(guard, [worker] {
+			return worker->stopping || !worker->queue.empty();
+		});
+		// When stopping, still run everything that was queued.
+		if (worker->queue.empty())
+			break;
+
+		AsyncIOEvent ev = worker->queue.front();
+		worker->queue.pop_front();
+		guard.unlock();
+		ProcessEvent(ev);
+		guard.lock();
 	}
-	if (results_.find(handle) != results_.end()) {
-		return true;
+}
+
+AsyncIOManager::ResultEntry *AsyncIOManager::FindResult(u32 handle) {
+	for (ResultEntry &entry : results_) {
+		if (entry.handle == handle)
+			return &entry;
 	}
-	return false;
+	return nullptr;
+}
+
+AsyncIOManager::ResultEntry *AsyncIOManager::WaitFinished(std::unique_lock<std::mutex> &guard, u32 handle) {
+	resultsWait_.wait(guard, [this, handle] {
+		const ResultEntry *entry = FindResult(handle);
+		return !entry || entry->running == 0;
+	});
+	return FindResult(handle);
+}
+
+bool AsyncIOManager::HasOperation(u32 handle) {
+	std::lock_guard<std::mutex> guard(resultsLock_);
+	return FindResult(handle) != nullptr;
 }
 
 void AsyncIOManager::ScheduleOperation(const AsyncIOEvent &ev) {
 	{
 		std::lock_guard<std::mutex> guard(resultsLock_);
-		if (!resultsPending_.insert(ev.handle).second) {
+		ResultEntry *entry = FindResult(ev.handle);
+		if (entry) {
 			ERROR_LOG_REPORT(Log::sceIo, "Scheduling operation for file %d while one is pending (type %d)", ev.handle, ev.type);
+		} else {
+			results_.push_back(ResultEntry{ ev.handle, 0, false, AsyncIOResult() });
+			entry = &results_.back();
 		}
+		entry->running++;
+		running_++;
+	}
+
+	// The read may still be running when blocks in the buffer get compiled, keep it writable.
+	if (ev.type == IO_EVENT_READ && ev.invalidateAddr)
+		JitWriteProtect::BeginExternalWrite(ev.invalidateAddr, (u32)ev.bytes);
+
+	if (workers_.empty()) {
+		ProcessEvent(ev);
+		return;
 	}
-	ScheduleEvent(ev);
+
+	Worker *worker = workers_[ev.handle % workers_.size()].get();
+	std::lock_guard<std::mutex> guard(worker->lock);
+	worker->queue.push_back(ev);
+	worker->wake.notify_one();
 }
 
 void AsyncIOManager::Shutdown() {
 	std::lock_guard<std::mutex> guard(resultsLock_);
-	resultsPending_.clear();
 	results_.clear();
+	running_ = 0;
 }
 
 bool AsyncIOManager::HasResult(u32 handle) {
 	std::lock_guard<std::mutex> guard(resultsLock_);
-	return results_.find(handle) != results_.end();
+	const ResultEntry *entry = FindResult(handle);
+	return entry && entry->hasResult;
 }
 
-bool AsyncIOManager::PopResult(u32 handle, AsyncIOResult &result) {
-	// This is called under lock from WaitResult, no need to lock again.
-	if (results_.find(handle) != results_.end()) {
-		result = results_[handle];
-		results_.erase(handle);
-		resultsPending_.erase(handle);
-
-		if (result.invalidateAddr && result.result > 0) {
-			currentMIPS->InvalidateICache(result.invalidateAddr, (int)result.result);
-		}
-		return true;
-	} else {
+bool AsyncIOManager::WaitResult(u32 handle, AsyncIOResult &result) {
+	std::unique_lock<std::mutex> guard(resultsLock_);
+	ResultEntry *entry = WaitFinished(guard, handle);
+	if (!entry)
 		return false;
-	}
-}
 
-bool AsyncIOManager::ReadResult(u32 handle, AsyncIOResult &result) {
-	// This is called under lock from WaitResult, no need to lock again.
-	if (results_.find(handle) != results_.end()) {
-		result = results_[handle];
-		return true;
-	} else {
-		return false;
-	}
-}
+	bool hasResult = entry->hasResult;
+	if (hasResult)
+		result = entry->result;
+	// Nothing will ever finish one without a result, so drop it either way.
+	*entry = results_.back();
+	results_.pop_back();
+	guard.unlock();
 
-bool AsyncIOManager::WaitResult(u32 handle, AsyncIOResult &result) {
-	std::unique_lock<std::mutex> guard(resultsLock_);
-	ScheduleEvent(IO_EVENT_SYNC);
-	while (HasEvents() && ThreadEnabled() && resultsPending_.find(handle) != resultsPending_.end()) {
-		if (PopResult(handle, result)) {
-			return true;
-		}
-		resultsWait_.wait_for(guard, std::chrono::milliseconds(16));
+	if (hasResult && result.invalidateAddr && result.result > 0) {
+		currentMIPS->InvalidateICache(result.invalidateAddr, (int)result.result);
 	}
-	return PopResult(handle, result);
+	return hasResult;
 }
 
 u64 AsyncIOManager::ResultFinishTicks(u32 handle) {
-	AsyncIOResult result;
+	std::unique_lock<std::mutex> guard(resultsLock_);
+	const ResultEntry *entry = WaitFinished(guard, handle);
+	if (entry && entry->hasResult)
+		return entry->result.finishTicks;
+	return 0;
+}
 
+void AsyncIOManager::SyncHandle(u32 handle) {
 	std::unique_lock<std::mutex> guard(resultsLock_);
-	ScheduleEvent(IO_EVENT_SYNC);
-	while (HasEvents() && ThreadEnabled() && resultsPending_.find(handle) != resultsPending_.end()) {
-		if (ReadResult(handle, result)) {
-			return result.finishTicks;
-		}
-		resultsWait_.wait_for(guard, std::chrono::milliseconds(16));
-	}
-	if (ReadResult(handle, result)) {
-		return result.finishTicks;
-	}
+	WaitFinished(guard, handle);
+}
 
-	return 0;
+void AsyncIOManager::SyncThread() {
+	std::unique_lock<std::mutex> guard(resultsLock_);
+	resultsWait_.wait(guard, [this] {
+		return running_ == 0;
+	});
 }
 
-void AsyncIOManager::ProcessEvent(AsyncIOEvent ev) {
+void AsyncIOManager::ProcessEvent(const AsyncIOEvent &ev) {
 	switch (ev.type) {
 	case IO_EVENT_READ:
 		Read(ev.handle, ev.buf, ev.bytes, ev.invalidateAddr);
@@ -127,12 +190,15 @@ void AsyncIOManager::ProcessEvent(AsyncIOEvent ev) {
 
 	default:
 		ERROR_LOG_REPORT(Log::sceIo, "Unsupported IO event type");
+		EventResult(ev.handle, AsyncIOResult());
 	}
 }
 
 void AsyncIOManager::Read(u32 handle, u8 *buf, size_t bytes, u32 invalidateAddr) {
 	int usec = 0;
 	s64 result = pspFileSystem.ReadFile(handle, buf, bytes, usec);
+	if (invalidateAddr)
+		JitWriteProtect::EndExternalWrite(invalidateAddr, (u32)bytes);
 	EventResult(handle, AsyncIOResult(result, usec, invalidateAddr));
 }
 
@@ -144,11 +210,19 @@ void AsyncIOManager::Write(u32 handle, const u8 *buf, size_t bytes) {
 
 void AsyncIOManager::EventResult(u32 handle, const AsyncIOResult &result) {
 	std::lock_guard<std::mutex> guard(resultsLock_);
-	if (results_.find(handle) != results_.end()) {
+	ResultEntry *entry = FindResult(handle);
+	if (!entry) {
+		// Shutdown() dropped it.
+		return;
+	}
+	if (entry->hasResult) {
 		ERROR_LOG_REPORT(Log::sceIo, "Overwriting previous result for file action on handle %d", handle);
 	}
-	results_[handle] = result;
-	resultsWait_.notify_one();
+	entry->result = result;
+	entry->hasResult = true;
+	entry->running--;
+	running_--;
+	resultsWait_.notify_all();
 }
 
 void AsyncIOManager::DoState(PointerWrap &p) {
@@ -158,14 +232,34 @@ void AsyncIOManager::DoState(PointerWrap &p) {
 
 	SyncThread();
 	std::lock_guard<std::mutex> guard(resultsLock_);
-	Do(p, resultsPending_);
+	// Still saved in the layout of the old pending set and results map.
+	std::set<u32> pending;
+	std::map<u32, AsyncIOResult> results;
+	for (const ResultEntry &entry : results_) {
+		pending.insert(entry.handle);
+		if (entry.hasResult)
+			results[entry.handle] = entry.result;
+	}
+
+	Do(p, pending);
 	if (s >= 2) {
-		Do(p, results_);
+		Do(p, results);
 	} else {
 		std::map<u32, size_t> oldResults;
 		Do(p, oldResults);
 		for (auto it = oldResults.begin(), end = oldResults.end(); it != end; ++it) {
-			results_[it->first] = AsyncIOResult(it->second);
+			results[it->first] = AsyncIOResult(it->second);
+		}
+	}
+
+	if (p.mode == p.MODE_READ) {
+		results_.clear();
+		for (u32 handle : pending) {
+			if (results.find(handle) == results.end())
+				results_.push_back(ResultEntry{ handle, 0, false, AsyncIOResult() });
+		}
+		for (const auto &it : results) {
+			results_.push_back(ResultEntry{ it.first, 0, true, it.second });
 		}
 	}
 }
@@ -17,12 +17,15 @@
 
 #pragma once
 
-#include <mutex>
 #include <condition_variable>
 #include <deque>
-#include <map>
-#include <set>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
+#include "Common/Serialize/Serializer.h"
+#include "Common/Serialize/SerializeFuncs.h"
 #include "Core/Core.h"
 
 #include "Core/System.h"
@@ -30,8 +33,6 @@
 
 enum AsyncIOEventType {
 	IO_EVENT_INVALID,
-	IO_EVENT_SYNC,
-	IO_EVENT_FINISH,
 	IO_EVENT_READ,
 	IO_EVENT_WRITE,
 };
@@ -77,10 +78,25 @@ struct AsyncIOResult {
 	u32 invalidateAddr;
 };
 
+// Runs file reads and writes on a few worker threads, so streams on different files don't wait for each other.
+// Operations on a handle always go to the same worker, so they finish in the order they were scheduled.
+// Results wait in a small table until sceIo picks them up from a CoreTiming event, after their finishTicks.
 class AsyncIOManager {
 public:
+	~AsyncIOManager() {
+		StopWorkers();
+	}
+
 	void DoState(PointerWrap &p);
 
+	// Without workers, operations run on the calling thread when scheduled.
+	void StartWorkers(int count);
+	// Finishes everything that's queued first.
+	void StopWorkers();
+	bool ThreadEnabled() const {
+		return !workers_.empty();
+	}
+
 	bool HasOperation(u32 handle);
 	void ScheduleOperation(const AsyncIOEvent &ev);
 	void Shutdown();
@@ -89,190 +105,45 @@ class AsyncIOManager {
 	bool WaitResult(u32 handle, AsyncIOResult &result);
 	u64 ResultFinishTicks(u32 handle);
 
-	void SetThreadEnabled(bool threadEnabled) {
-		threadEnabled_ = threadEnabled;
-	}
-
-	bool ThreadEnabled() {
-		return threadEnabled_;
-	}
-
-	void ScheduleEvent(AsyncIOEvent ev) {
-		if (threadEnabled_) {
-			std::lock_guard<std::recursive_mutex> guard(eventsLock_);
-			events_.push_back(ev);
-			eventsWait_.notify_one();
-		} else {
-			events_.push_back(ev);
-		}
-
-		if (!threadEnabled_) {
-			RunEventsUntil(0);
-		}
-	}
-
-	bool HasEvents() {
-		if (threadEnabled_) {
-			std::lock_guard<std::recursive_mutex> guard(eventsLock_);
-			return !events_.empty();
-		} else {
-			return !events_.empty();
-		}
-	}
-
-	void NotifyDrain() {
-		if (threadEnabled_) {
-			std::lock_guard<std::recursive_mutex> guard(eventsLock_);
-			eventsDrain_.notify_one();
-		}
-	}
-
-	AsyncIOEvent GetNextEvent() {
-		if (threadEnabled_) {
-			std::lock_guard<std::recursive_mutex> guard(eventsLock_);
-			if (events_.empty()) {
-				NotifyDrain();
-				return IO_EVENT_INVALID;
-			}
-
-			AsyncIOEvent ev = events_.front();
-			events_.pop_front();
-			return ev;
-		} else {
-			if (events_.empty()) {
-				return IO_EVENT_INVALID;
-			}
-			AsyncIOEvent ev = events_.front();
-			events_.pop_front();
-			return ev;
-		}
-	}
-
-	// This is the threadfunc, really. Although it can also run on the main thread if threadEnabled_ is set.
-	// TODO: Remove threadEnabled_, always be on a thread.
-	void RunEventsUntil(u64 globalticks) {
-		if (!threadEnabled_) {
-			do {
-				for (AsyncIOEvent ev = GetNextEvent(); AsyncIOEventType(ev) != IO_EVENT_INVALID; ev = GetNextEvent()) {
-					ProcessEventIfApplicable(ev, globalticks);
-				}
-			} while (CoreTiming::GetTicks() < globalticks);
-			return;
-		}
-
-		std::unique_lock<std::recursive_mutex> guard(eventsLock_);
-		eventsRunning_ = true;
-		eventsHaveRun_ = true;
-		do {
-			while (events_.empty()) {
-				eventsWait_.wait(guard);
-			}
-			// Quit the loop if the queue is drained and coreState has tripped, or threading is disabled.
-			if (events_.empty()) {
-				break;
-			}
-
-			for (AsyncIOEvent ev = GetNextEvent(); AsyncIOEventType(ev) != IO_EVENT_INVALID; ev = GetNextEvent()) {
-				guard.unlock();
-				ProcessEventIfApplicable(ev, globalticks);
-				guard.lock();
-			}
-		} while (CoreTiming::GetTicks() < globalticks);
-
-		// This will force the waiter to check coreState, even if we didn't actually drain.
-		NotifyDrain();
-		eventsRunning_ = false;
-	}
-
-	void SyncBeginFrame() {
-		if (threadEnabled_) {
-			std::lock_guard<std::recursive_mutex> guard(eventsLock_);
-			eventsHaveRun_ = false;
-		} else {
-			eventsHaveRun_ = false;
-		}
-	}
-
-	inline bool ShouldSyncThread(bool force) {
-		if (!HasEvents())
-			return false;
-		if (coreState != CORE_RUNNING_CPU && !force)
-			return false;
-
-		// Don't run if it's not running, but wait for startup.
-		if (!eventsRunning_) {
-			if (eventsHaveRun_ || coreState == CORE_RUNTIME_ERROR || coreState == CORE_POWERDOWN) {
-				return false;
-			}
-		}
-
-		return true;
-	}
-
-	// Force ignores coreState.
-	void SyncThread(bool force = false) {
-		if (!threadEnabled_) {
-			return;
-		}
-
-		std::unique_lock<std::recursive_mutex> guard(eventsLock_);
-		// While processing the last event, HasEvents() will be false even while not done.
-		// So we schedule a nothing event and wait for that to finish.
-		ScheduleEvent(IO_EVENT_SYNC);
-		while (ShouldSyncThread(force)) {
-			eventsDrain_.wait(guard);
-		}
-	}
-
-	void FinishEventLoop() {
-		if (!threadEnabled_) {
-			return;
-		}
-
-		std::lock_guard<std::recursive_mutex> guard(eventsLock_);
-		// Don't schedule a finish if it's not even running.
-		if (eventsRunning_) {
-			ScheduleEvent(IO_EVENT_FINISH);
-		}
-	}
-
-protected:
-	void ProcessEvent(AsyncIOEvent ref);
-	
-	inline void ProcessEventIfApplicable(AsyncIOEvent &ev, u64 &globalticks) {
-		switch (AsyncIOEventType(ev)) {
-		case IO_EVENT_FINISH:
-			// Stop waiting.
-			globalticks = 0;
-			break;
-
-		case IO_EVENT_SYNC:
-			// Nothing special to do, this event it just to wait on, see SyncThread.
-			break;
-
-		default:
-			ProcessEvent(ev);
-		}
-	}
+	// Waits until the operations on handle are done, leaving the result to be picked up.
+	void SyncHandle(u32 handle);
+	// Waits until all operations are done.
+	void SyncThread();
 
 private:
-	bool PopResult(u32 handle, AsyncIOResult &result);
-	bool ReadResult(u32 handle, AsyncIOResult &result);
+	struct Worker {
+		std::thread thread;
+		std::mutex lock;
+		std::condition_variable wake;
+		std::deque<AsyncIOEvent> queue;
+		bool stopping = false;
+	};
+
+	// One per handle from scheduling the operation until its result is taken.
+	struct ResultEntry {
+		u32 handle;
+		// Scheduled but not done.  Results restored from a save state were never scheduled here.
+		int running;
+		bool hasResult;
+		AsyncIOResult result;
+	};
+
+	void WorkerThread(Worker *worker, int index);
+	void ProcessEvent(const AsyncIOEvent &ev);
 	void Read(u32 handle, u8 *buf, size_t bytes, u32 invalidateAddr);
 	void Write(u32 handle, const u8 *buf, size_t bytes);
 
 	void EventResult(u32 handle, const AsyncIOResult &result);
 
-	bool threadEnabled_ = false;
-	bool eventsRunning_ = false;
-	bool eventsHaveRun_ = false;
-	std::deque<AsyncIOEvent> events_;
-	std::recursive_mutex eventsLock_;  // TODO: Should really make this non-recursive - condition_variable_any is dangerous
-	std::condition_variable_any eventsWait_;
-	std::condition_variable_any eventsDrain_;
+	// These assume resultsLock_ is held.
+	ResultEntry *FindResult(u32 handle);
+	ResultEntry *WaitFinished(std::unique_lock<std::mutex> &guard, u32 handle);
+
+	std::vector<std::unique_ptr<Worker>> workers_;
 
 	std::mutex resultsLock_;
 	std::condition_variable resultsWait_;
-	std::set<u32> resultsPending_;
-	std::map<u32, AsyncIOResult> results_;
+	// Only as many as there are open files with operations, a search is cheaper than a map.
+	std::vector<ResultEntry> results_;
+	int running_ = 0;
 };
@@ -27,6 +27,7 @@
 #include "Common/ArmEmitter.h"
 #include "Core/MIPS/ARM/ArmJit.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
+#include "Core/MIPS/JitCommon/JitPerfMap.h"
 
 using namespace ArmGen;
 
@@ -268,6 +269,12 @@ void ArmJit::GenerateFixedCode() {
 	// Let's spare the pre-generated code from unprotect-reprotect.
 	AlignCodePage();
 	EndWrite();
+
+	if (JitPerfMap::IsEnabled()) {
+		JitPerfMap::RegisterFixedCode(start, GetCodePtr(), [this](const u8 *ptr, std::string &name) {
+			return DescribeCodePtr(ptr, name);
+		});
+	}
 }
 
 }  // namespace MIPSComp
@@ -29,6 +29,7 @@
 #include "Core/CoreTiming.h"
 #include "Core/MIPS/ARM64/Arm64Jit.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
+#include "Core/MIPS/JitCommon/JitPerfMap.h"
 
 using namespace Arm64Gen;
 
@@ -324,6 +325,12 @@ void Arm64Jit::GenerateFixedCode(const JitOptions &jo) {
 	// Don't forget to zap the instruction cache! This must stay at the end of this function.
 	FlushIcache();
 	EndWrite();
+
+	if (JitPerfMap::IsEnabled()) {
+		JitPerfMap::RegisterFixedCode(start, GetCodePtr(), [this](const u8 *ptr, std::string &name) {
+			return DescribeCodePtr(ptr, name);
+		});
+	}
 }
 
 }  // namespace MIPSComp
@@ -54,6 +54,79 @@ using namespace MIPSAnalyst;
 namespace MIPSComp
 {
 
+// Superblocks are capped so a long chain of branches doesn't make huge blocks.
+static const int MAX_SUPERBLOCK_INSTRUCTIONS = 256;
+static const u32 MAX_SUPERBLOCK_BYTES = 0x1000;
+// Function regions are bounded by the function, this just limits huge ones.
+static const int MAX_FUNCTION_REGION_INSTRUCTIONS = 1024;
+
+IRFrontend::SuperblockPath IRFrontend::ChooseSuperblockPath(const BranchInfo &branchInfo, u32 targetAddr, bool alwaysTaken) {
+	const bool inFunction = functionEnd_ != 0;
+	if ((!opts.superblocks && !inFunction) || branchInfo.delaySlotIsBranch)
+		return SuperblockPath::NONE;
+	if (js.numInstructions >= (inFunction ? MAX_FUNCTION_REGION_INSTRUCTIONS : MAX_SUPERBLOCK_INSTRUCTIONS))
+		return SuperblockPath::NONE;
+
+	// Only continue forward, so the block still covers one contiguous range of MIPS code.
+	// Anything skipped over is included in that range, which only makes invalidation more conservative.
+	u32 notTakenAddr = GetCompilerPC() + 8;
+	bool canTake, canFallThrough;
+	if (inFunction) {
+		// Stay inside the function. Calls still end the block, the callee gets its own.
+		canTake = !branchInfo.andLink && targetAddr >= notTakenAddr && targetAddr < functionEnd_;
+		canFallThrough = notTakenAddr < functionEnd_;
+	} else {
+		canTake = targetAddr >= notTakenAddr && targetAddr - js.blockStart < MAX_SUPERBLOCK_BYTES;
+		canFallThrough = notTakenAddr - js.blockStart < MAX_SUPERBLOCK_BYTES;
+	}
+	// A likely branch skips the delay slot when not taken, and we can't put it in the side exit.
+	if (branchInfo.likely)
+		canFallThrough = false;
+	// Like beq zero, zero. Following the fall through would only add a side exit that always fires.
+	if (alwaysTaken)
+		return canTake ? SuperblockPath::TAKEN : SuperblockPath::NONE;
+	if (!canTake && !canFallThrough)
+		return SuperblockPath::NONE;
+
+	// Use block execution counts if we have them, to follow the hot side.
+	if (blockExecutionCount_) {
+		int64_t takenCount = blockExecutionCount_(targetAddr);
+		int64_t notTakenCount = blockExecutionCount_(notTakenAddr);
+		if (takenCount >= 0 || notTakenCount >= 0) {
+			if (takenCount > notTakenCount)
+				return canTake ? SuperblockPath::TAKEN : SuperblockPath::NONE;
+			return canFallThrough ? SuperblockPath::NOT_TAKEN : SuperblockPath::NONE;
+		}
+	}
+
+	// Otherwise, assume forward branches aren't taken, except likely ones.
+	if (branchInfo.likely)
+		return canTake ? SuperblockPath::TAKEN : SuperblockPath::NONE;
+	return canFallThrough ? SuperblockPath::NOT_TAKEN : SuperblockPath::NONE;
+}
+
+bool IRFrontend::CanContinueInFunction(u32 targetAddr) {
+	// For unconditional jumps, which only continue with function regions.
+	if (functionEnd_ == 0 || js.numInstructions >= MAX_FUNCTION_REGION_INSTRUCTIONS)
+		return false;
+	const MIPSInfo delaySlotInfo = MIPSGetInfo(GetOffsetInstruction(1));
+	if ((delaySlotInfo & (IS_JUMP | IS_CONDBRANCH)) != 0)
+		return false;
+	return targetAddr >= GetCompilerPC() + 8 && targetAddr < functionEnd_;
+}
+
+void IRFrontend::ContinueSuperblockAt(u32 targetAddr) {
+	// DoJit advances past the branch itself.
+	js.compilerPC = targetAddr - 4;
+}
+
+bool IRFrontend::IsIdleLoop(u32 targetAddr) {
+	// Only when branching back to the start of this block, so the whole loop is in it.
+	if (!opts.idleLoops || targetAddr != js.blockStart)
+		return false;
+	return MIPSAnalyst::IsIdlePollingLoop(targetAddr, GetCompilerPC());
+}
+
 void IRFrontend::BranchRSRTComp(MIPSOpcode op, IRComparison cc, bool likely) {
 	if (js.inDelaySlot) {
 		ERROR_LOG_REPORT(Log::JIT, "Branch in RSRTComp delay slot at %08x in block starting at %08x", GetCompilerPC(), js.blockStart);
@@ -99,8 +172,18 @@ void IRFrontend::BranchRSRTComp(MIPSOpcode op, IRComparison cc, bool likely) {
 	ir.Write(IROp::Downcount, 0, ir.AddConstant(dcAmount));
 	js.downcountAmount = 0;
 
+	// cc is the not taken condition, so beq with the same register twice is always taken.
+	const bool alwaysTaken = cc == IRComparison::NotEqual && rs == rt;
+	SuperblockPath path = ChooseSuperblockPath(branchInfo, targetAddr, alwaysTaken);
 	FlushAll();
-	ir.Write(ComparisonToExit(cc), ir.AddConstant(ResolveNotTakenTarget(branchInfo)), lhs, rhs);
+	if (path == SuperblockPath::NOT_TAKEN) {
+		// Side exit when taken, and keep going after the delay slot.
+		ir.Write(ComparisonToExit(Invert(cc)), ir.AddConstant(targetAddr), lhs, rhs);
+		js.compilerPC += 4;
+		return;
+	}
+	if (path != SuperblockPath::TAKEN || !alwaysTaken)
+		ir.Write(ComparisonToExit(cc), ir.AddConstant(ResolveNotTakenTarget(branchInfo)), lhs, rhs);
 	// This makes the block "impure" :(
 	if (likely && !branchInfo.delaySlotIsBranch)
 		CompileDelaySlot();
@@ -114,6 +197,13 @@ void IRFrontend::BranchRSRTComp(MIPSOpcode op, IRComparison cc, bool likely) {
 	}
 
 	FlushAll();
+	if (path == SuperblockPath::TAKEN) {
+		ContinueSuperblockAt(targetAddr);
+		return;
+	}
+	// Looping again won't change anything until the next event, so skip right to it.
+	if (IsIdleLoop(targetAddr))
+		ir.Write(IROp::IdleLoop, 0, ir.AddConstant(targetAddr));
 	ir.Write(IROp::ExitToConst, ir.AddConstant(targetAddr));
 
 	// Account for the delay slot.
@@ -150,8 +240,18 @@ void IRFrontend::BranchRSZeroComp(MIPSOpcode op, IRComparison cc, bool andLink,
 	ir.Write(IROp::Downcount, 0, ir.AddConstant(dcAmount));
 	js.downcountAmount = 0;
 
+	// Like bgez/blez zero, which are always taken.
+	const bool alwaysTaken = rs == MIPS_REG_ZERO && (cc == IRComparison::Less || cc == IRComparison::Greater);
+	SuperblockPath path = ChooseSuperblockPath(branchInfo, targetAddr, alwaysTaken);
 	FlushAll();
-	ir.Write(ComparisonToExit(cc), ir.AddConstant(ResolveNotTakenTarget(branchInfo)), lhs);
+	if (path == SuperblockPath::NOT_TAKEN) {
+		// Side exit when taken, and keep going after the delay slot.
+		ir.Write(ComparisonToExit(Invert(cc)), ir.AddConstant(targetAddr), lhs);
+		js.compilerPC += 4;
+		return;
+	}
+	if (path != SuperblockPath::TAKEN || !alwaysTaken)
+		ir.Write(ComparisonToExit(cc), ir.AddConstant(ResolveNotTakenTarget(branchInfo)), lhs);
 	if (likely && !branchInfo.delaySlotIsBranch)
 		CompileDelaySlot();
 	if (branchInfo.delaySlotIsBranch) {
@@ -165,6 +265,13 @@ void IRFrontend::BranchRSZeroComp(MIPSOpcode op, IRComparison cc, bool andLink,
 
 	// Taken
 	FlushAll();
+	if (path == SuperblockPath::TAKEN) {
+		ContinueSuperblockAt(targetAddr);
+		return;
+	}
+	// Looping again won't change anything until the next event, so skip right to it.
+	if (IsIdleLoop(targetAddr))
+		ir.Write(IROp::IdleLoop, 0, ir.AddConstant(targetAddr));
 	ir.Write(IROp::ExitToConst, ir.AddConstant(targetAddr));
 
 	// Account for the delay slot.
@@ -228,7 +335,14 @@ void IRFrontend::BranchFPFlag(MIPSOpcode op, IRComparison cc, bool likely) {
 	ir.Write(IROp::Downcount, 0, ir.AddConstant(dcAmount));
 	js.downcountAmount = 0;
 
+	SuperblockPath path = ChooseSuperblockPath(branchInfo, targetAddr);
 	FlushAll();
+	if (path == SuperblockPath::NOT_TAKEN) {
+		// Side exit when taken, and keep going after the delay slot.
+		ir.Write(ComparisonToExit(Invert(cc)), ir.AddConstant(targetAddr), IRTEMP_LHS, 0);
+		js.compilerPC += 4;
+		return;
+	}
 	// Not taken
 	ir.Write(ComparisonToExit(cc), ir.AddConstant(ResolveNotTakenTarget(branchInfo)), IRTEMP_LHS, 0);
 	// Taken
@@ -244,6 +358,10 @@ void IRFrontend::BranchFPFlag(MIPSOpcode op, IRComparison cc, bool likely) {
 	}
 
 	FlushAll();
+	if (path == SuperblockPath::TAKEN) {
+		ContinueSuperblockAt(targetAddr);
+		return;
+	}
 	ir.Write(IROp::ExitToConst, ir.AddConstant(targetAddr));
 
 	// Account for the delay slot.
@@ -290,7 +408,14 @@ void IRFrontend::BranchVFPUFlag(MIPSOpcode op, IRComparison cc, bool likely) {
 	int imm3 = (op >> 18) & 7;
 
 	ir.Write(IROp::AndConst, IRTEMP_LHS, IRTEMP_LHS, ir.AddConstant(1 << imm3));
+	SuperblockPath path = ChooseSuperblockPath(branchInfo, targetAddr);
 	FlushAll();
+	if (path == SuperblockPath::NOT_TAKEN) {
+		// Side exit when taken, and keep going after the delay slot.
+		ir.Write(ComparisonToExit(Invert(cc)), ir.AddConstant(targetAddr), IRTEMP_LHS, 0);
+		js.compilerPC += 4;
+		return;
+	}
 	ir.Write(ComparisonToExit(cc), ir.AddConstant(ResolveNotTakenTarget(branchInfo)), IRTEMP_LHS, 0);
 
 	if (likely && !branchInfo.delaySlotIsBranch)
@@ -306,6 +431,10 @@ void IRFrontend::BranchVFPUFlag(MIPSOpcode op, IRComparison cc, bool likely) {
 
 	// Taken
 	FlushAll();
+	if (path == SuperblockPath::TAKEN) {
+		ContinueSuperblockAt(targetAddr);
+		return;
+	}
 	ir.Write(IROp::ExitToConst, ir.AddConstant(targetAddr));
 
 	// Account for the delay slot.
@@ -359,6 +488,11 @@ void IRFrontend::Comp_Jump(MIPSOpcode op) {
 	js.downcountAmount = 0;
 
 	FlushAll();
+	if ((op >> 26) == 2 && CanContinueInFunction(targetAddr)) {
+		// Delay slot was already compiled above.
+		ContinueSuperblockAt(targetAddr);
+		return;
+	}
 	ir.Write(IROp::ExitToConst, ir.AddConstant(targetAddr));
 
 	// Account for the delay slot.
@@ -444,6 +578,12 @@ void IRFrontend::Comp_Syscall(MIPSOpcode op) {
 	FlushAll();
 
 	RestoreRoundingMode();
+	if (opts.directSyscalls && !js.inDelaySlot && GetDirectSyscallFunc(op)) {
+		// The block goes on after it, unless the syscall rescheduled or similar.
+		ir.Write(IROp::SyscallDirect, 0, ir.AddConstant(op.encoding));
+		ApplyRoundingMode();
+		return;
+	}
 	ir.Write(IROp::Syscall, 0, ir.AddConstant(op.encoding));
 	ApplyRoundingMode();
 	ir.Write(IROp::ExitToPC);
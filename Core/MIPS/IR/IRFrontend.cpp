@@ -255,6 +255,15 @@ void IRFrontend::DoJit(u32 em_address, std::vector<IRInst> &instructions, u32 &m
 	ir.Clear();
 	ir.Reserve(64); // Estimate a reasonable number of IR instructions per block
 
+	// Function boundaries come from MIPSAnalyst's scan (or the module's symbols), via the symbol map.
+	functionEnd_ = 0;
+	if (opts.functionRegions) {
+		u32 funcStart = g_symbolMap->GetFunctionStart(em_address);
+		u32 funcSize = funcStart != SymbolMap::INVALID_ADDRESS ? g_symbolMap->GetFunctionSize(funcStart) : SymbolMap::INVALID_ADDRESS;
+		if (funcSize != SymbolMap::INVALID_ADDRESS)
+			functionEnd_ = funcStart + funcSize;
+	}
+
 	js.numInstructions = 0;
 	while (js.compiling) {
 		// Jit breakpoints are quite fast, so let's do them in release too.
@@ -277,24 +286,7 @@ void IRFrontend::DoJit(u32 em_address, std::vector<IRInst> &instructions, u32 &m
 	IRWriter simplified;
 	IRWriter *code = &ir;
 	if (!js.hadBreakpoints) {
-		std::vector<IRPassFunc> passes{
-			&ApplyMemoryValidation,
-			&RemoveLoadStoreLeftRight,
-			&OptimizeFPMoves,
-			&PropagateConstants,
-			&PurgeTemps,
-			&ReduceVec4Flush,
-			&OptimizeLoadsAfterStores,
-			// &ReorderLoadStore,
-			// &MergeLoadStore,
-			// &ThreeOpToTwoOp,
-		};
-
-		if (opts.optimizeForInterpreter) {
-			// Add special passes here.
-			passes.push_back(&OptimizeForInterpreter);
-		}
-		if (IRApplyPasses(passes.data(), passes.size(), ir, simplified, opts))
+		if (IRApplyPasses(passes_.data(), passes_.size(), ir, simplified, opts, passStats_.data()))
 			logBlocks = 1;
 		code = &simplified;
 		//if (ir.GetInstructions().size() >= 24)
@@ -349,6 +341,56 @@ void IRFrontend::DoJit(u32 em_address, std::vector<IRInst> &instructions, u32 &m
 		dontLogBlocks--;
 }
 
+void IRFrontend::SetOptions(const IROptions &o) {
+	opts = o;
+
+	passes_.clear();
+	passStats_.clear();
+	auto addPass = [&](IRPassFunc pass, const char *name) {
+		passes_.push_back(pass);
+		passStats_.push_back(IRPassStats{ name });
+	};
+
+	addPass(&ApplyMemoryValidation, "ApplyMemoryValidation");
+	addPass(&RemoveLoadStoreLeftRight, "RemoveLoadStoreLeftRight");
+	addPass(&OptimizeFPMoves, "OptimizeFPMoves");
+	addPass(&PropagateConstants, "PropagateConstants");
+	addPass(&PurgeTemps, "PurgeTemps");
+	if (opts.vectorizeFloats)
+		addPass(&VectorizeFloatOps, "VectorizeFloatOps");
+	addPass(&ReduceVec4Flush, "ReduceVec4Flush");
+	addPass(&OptimizeLoadsAfterStores, "OptimizeLoadsAfterStores");
+	if (opts.reorderLoadStore)
+		addPass(&ReorderLoadStore, "ReorderLoadStore");
+	if (opts.mergeLoadStore)
+		addPass(&MergeLoadStore, "MergeLoadStore");
+	if (opts.threeOpToTwoOp)
+		addPass(&ThreeOpToTwoOp, "ThreeOpToTwoOp");
+
+	if (opts.optimizeForInterpreter) {
+		// Add special passes here.
+		addPass(&OptimizeForInterpreter, "OptimizeForInterpreter");
+	}
+}
+
+void IRFrontend::LogAndResetPassStats() {
+	for (IRPassStats &stats : passStats_) {
+		if (stats.runs == 0)
+			continue;
+		int64_t removed = stats.instructionsIn - stats.instructionsOut;
+		INFO_LOG(Log::JIT, "IR pass %s: %lld blocks, %0.3f ms, %lld -> %lld instructions (%0.1f%% removed)", stats.name,
+			(long long)stats.runs, stats.nanos / 1000000.0, (long long)stats.instructionsIn, (long long)stats.instructionsOut,
+			stats.instructionsIn > 0 ? removed * 100.0 / stats.instructionsIn : 0.0);
+		stats.runs = 0;
+		stats.nanos = 0;
+		stats.instructionsIn = 0;
+		stats.instructionsOut = 0;
+	}
+	int64_t vectorized = IRTakeVectorizedGroupCount();
+	if (vectorized != 0)
+		INFO_LOG(Log::JIT, "IR pass VectorizeFloatOps: fused %lld scalar ops into %lld Vec4 ops", (long long)vectorized * 4, (long long)vectorized);
+}
+
 void IRFrontend::Comp_RunBlock(MIPSOpcode op) {
 	// This shouldn't be necessary, the dispatcher should catch us before we get here.
 	ERROR_LOG(Log::JIT, "Comp_RunBlock should never be reached!");
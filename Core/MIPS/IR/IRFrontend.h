@@ -1,10 +1,13 @@
 #pragma once
 
+#include <functional>
+
 #include "Common/CommonTypes.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
 #include "Core/MIPS/JitCommon/JitState.h"
 #include "Core/MIPS/MIPSVFPUUtils.h"
 #include "Core/MIPS/IR/IRInst.h"
+#include "Core/MIPS/IR/IRPassSimplify.h"
 
 namespace MIPSComp {
 
@@ -95,8 +98,21 @@ class IRFrontend : public MIPSFrontendInterface {
 		js.EatPrefix();
 	}
 
-	void SetOptions(const IROptions &o) {
-		opts = o;
+	void SetOptions(const IROptions &o);
+
+	const std::vector<IRPassStats> &GetPassStats() const {
+		return passStats_;
+	}
+	void LogAndResetPassStats();
+
+	// For superblocks: returns how often the block at an address ran, or -1 if unknown.
+	void SetBlockExecutionCountFunc(std::function<int64_t(u32)> func) {
+		blockExecutionCount_ = func;
+	}
+
+	// Frontend state that affects the generated IR (used to validate persisted blocks.)
+	u32 GetStateFlags() const {
+		return (js.startDefaultPrefix ? 1 : 0) | (js.hasSetRounding ? 2 : 0);
 	}
 
 private:
@@ -116,6 +132,16 @@ class IRFrontend : public MIPSFrontendInterface {
 	void CheckMemoryBreakpoint(int rs, int offset);
 
 	// Utility compilation functions
+	enum class SuperblockPath {
+		NONE,
+		TAKEN,
+		NOT_TAKEN,
+	};
+	SuperblockPath ChooseSuperblockPath(const BranchInfo &branchInfo, u32 targetAddr, bool alwaysTaken = false);
+	bool CanContinueInFunction(u32 targetAddr);
+	void ContinueSuperblockAt(u32 targetAddr);
+	bool IsIdleLoop(u32 targetAddr);
+
 	void BranchFPFlag(MIPSOpcode op, IRComparison cc, bool likely);
 	void BranchVFPUFlag(MIPSOpcode op, IRComparison cc, bool likely);
 	void BranchRSZeroComp(MIPSOpcode op, IRComparison cc, bool andLink, bool likely);
@@ -138,6 +164,12 @@ class IRFrontend : public MIPSFrontendInterface {
 	JitState js;
 	IRWriter ir;
 	IROptions opts{};
+	std::function<int64_t(u32)> blockExecutionCount_;
+	// With function regions, the end of the function the current block is in (or 0.)
+	u32 functionEnd_ = 0;
+	// Built from opts, passStats_ has an entry per pass.
+	std::vector<IRPassFunc> passes_;
+	std::vector<IRPassStats> passStats_;
 
 	int dontLogBlocks = 0;
 	int logBlocks = 0;
@@ -176,12 +176,14 @@ static const IRMeta irMeta[] = {
 	{ IROp::ExitToConstIfLtZ, "ExitIfLtZ", "CG", IRFLAG_EXIT },
 	{ IROp::ExitToReg, "ExitToReg", "_G", IRFLAG_EXIT },
 	{ IROp::Syscall, "Syscall", "_C", IRFLAG_EXIT },
+	{ IROp::SyscallDirect, "SyscallDirect", "_C", IRFLAG_BARRIER },
 	{ IROp::Break, "Break", "", IRFLAG_EXIT },
 	{ IROp::SetPC, "SetPC", "_G" },
 	{ IROp::SetPCConst, "SetPC", "_C" },
 	{ IROp::CallReplacement, "CallRepl", "Gr", IRFLAG_BARRIER },
 	{ IROp::Breakpoint, "Breakpoint", "_C", IRFLAG_BARRIER },
 	{ IROp::MemoryCheck, "MemoryCheck", "IGC", IRFLAG_BARRIER },
+	{ IROp::IdleLoop, "IdleLoop", "_C", IRFLAG_BARRIER },
 
 	{ IROp::ValidateAddress8, "ValidAddr8", "_GC", IRFLAG_BARRIER },
 	{ IROp::ValidateAddress16, "ValidAddr16", "_GC", IRFLAG_BARRIER },
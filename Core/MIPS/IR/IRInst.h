@@ -223,6 +223,8 @@ enum class IROp : uint8_t {
 	ExitToPC,  // Used after a syscall to give us a way to do things before returning.
 
 	Syscall,
+	// Calls a simple HLE function directly, without ending the block. Exits only if it reschedules or similar.
+	SyscallDirect,
 	SetPC,  // hack to make syscall returns work
 	SetPCConst,  // hack to make replacement know PC
 	CallReplacement,
@@ -232,6 +234,9 @@ enum class IROp : uint8_t {
 	Breakpoint,
 	MemoryCheck,
 
+	// Fast-forwards to the next scheduled event, from an idle polling loop.
+	IdleLoop,
+
 	ValidateAddress8,
 	ValidateAddress16,
 	ValidateAddress32,
@@ -419,6 +424,20 @@ struct IROptions {
 	bool preferVec4;
 	bool preferVec4Dot;
 	bool optimizeForInterpreter;
+	// Continue blocks through conditional branches, with side exits.
+	bool superblocks;
+	// Compile the rest of the enclosing function (from the symbol map) into each block,
+	// following forward branches and jumps inside it.
+	bool functionRegions;
+	// Skip to the next CoreTiming event from loops that only poll memory.
+	bool idleLoops;
+	// Keep going after syscalls to GetDirectSyscallFunc() functions. IR interpreter only.
+	bool directSyscalls;
+	// Optional IR passes.
+	bool reorderLoadStore;
+	bool mergeLoadStore;
+	bool threeOpToTwoOp;
+	bool vectorizeFloats;
 };
 
 const IRMeta *GetIRMeta(IROp op);
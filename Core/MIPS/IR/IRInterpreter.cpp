@@ -1,5 +1,7 @@
 #include <algorithm>
 #include <cmath>
+#include <mutex>
+#include <unordered_map>
 
 #include "ppsspp_config.h"
 
@@ -110,6 +112,31 @@ u32 IRRunMemCheck(u32 pc, u32 addr) {
 	return coreState != CORE_RUNNING_CPU ? 1 : 0;
 }
 
+// Cycles skipped by each idle loop, by loop address. Read by the debug UI, so locked.
+static std::mutex idleLoopLock;
+static std::unordered_map<u32, u64> idleLoopSkippedCycles;
+
+void IRRunIdleLoop(u32 pc) {
+	int downcount = currentMIPS->downcount;
+	CoreTiming::Idle();
+	int skipped = downcount - currentMIPS->downcount;
+	if (skipped > 0) {
+		std::lock_guard<std::mutex> guard(idleLoopLock);
+		idleLoopSkippedCycles[pc] += skipped;
+	}
+}
+
+u64 IRGetIdleLoopSkippedCycles(u32 pc) {
+	std::lock_guard<std::mutex> guard(idleLoopLock);
+	auto it = idleLoopSkippedCycles.find(pc);
+	return it != idleLoopSkippedCycles.end() ? it->second : 0;
+}
+
+void IRResetIdleLoopStats() {
+	std::lock_guard<std::mutex> guard(idleLoopLock);
+	idleLoopSkippedCycles.clear();
+}
+
 void IRApplyRounding(MIPSState *mips) {
 	u32 fcr1Bits = mips->fcr31 & 0x01000003;
 	// If these are 0, we just leave things as they are.
@@ -161,125 +188,331 @@ void IRRestoreRounding() {
 #endif
 }
 
-u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
+// With computed goto, each handler can jump directly to the next instruction's handler.
+// This gives the CPU's branch predictor one indirect jump per op instead of one shared one.
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(__EMSCRIPTEN__)
+#define IR_THREADED_DISPATCH
+#endif
+
+#ifdef IR_THREADED_DISPATCH
+#define IR_CASE(op) case IROp::op: handler_##op:
+static const void *irHandlers[256];
+#else
+#define IR_CASE(op) case IROp::op:
+#endif
+
+// In debug builds, always go through the loop tail to get the r[0] check.
+#if defined(IR_THREADED_DISPATCH) && !defined(_DEBUG)
+#define IR_NEXT() if constexpr (threaded) { ++inst; goto **++handler; } break
+#else
+#define IR_NEXT() break
+#endif
+
+#ifdef IR_THREADED_DISPATCH
+// The labels are only referenced by the threaded instantiation.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-label"
+#endif
+
+// When threaded, handler points to the handler address for each inst (see IRTranslateToHandlers.)
+template <bool threaded>
+static u32 IRInterpretImpl(MIPSState *mips, const IRInst *inst, const void *const *handler) {
+#ifdef IR_THREADED_DISPATCH
+	if constexpr (threaded) {
+		if (!inst) {
+			// Called once to collect the handler addresses, see IRTranslateToHandlers.
+			for (auto &h : irHandlers)
+				h = &&handler_Bad;
+#define IR_SET_HANDLER(op) irHandlers[(int)IROp::op] = &&handler_##op
+		IR_SET_HANDLER(SetConst);
+		IR_SET_HANDLER(SetConstF);
+		IR_SET_HANDLER(Add);
+		IR_SET_HANDLER(Sub);
+		IR_SET_HANDLER(And);
+		IR_SET_HANDLER(Or);
+		IR_SET_HANDLER(Xor);
+		IR_SET_HANDLER(Mov);
+		IR_SET_HANDLER(AddConst);
+		IR_SET_HANDLER(OptAddConst);
+		IR_SET_HANDLER(SubConst);
+		IR_SET_HANDLER(AndConst);
+		IR_SET_HANDLER(OptAndConst);
+		IR_SET_HANDLER(OrConst);
+		IR_SET_HANDLER(OptOrConst);
+		IR_SET_HANDLER(XorConst);
+		IR_SET_HANDLER(Neg);
+		IR_SET_HANDLER(Not);
+		IR_SET_HANDLER(Ext8to32);
+		IR_SET_HANDLER(Ext16to32);
+		IR_SET_HANDLER(ReverseBits);
+		IR_SET_HANDLER(Load8);
+		IR_SET_HANDLER(Load8Ext);
+		IR_SET_HANDLER(Load16);
+		IR_SET_HANDLER(Load16Ext);
+		IR_SET_HANDLER(Load32);
+		IR_SET_HANDLER(Load32Left);
+		IR_SET_HANDLER(Load32Right);
+		IR_SET_HANDLER(Load32Linked);
+		IR_SET_HANDLER(LoadFloat);
+		IR_SET_HANDLER(Store8);
+		IR_SET_HANDLER(Store16);
+		IR_SET_HANDLER(Store32);
+		IR_SET_HANDLER(Store32Left);
+		IR_SET_HANDLER(Store32Right);
+		IR_SET_HANDLER(Store32Conditional);
+		IR_SET_HANDLER(StoreFloat);
+		IR_SET_HANDLER(LoadVec4);
+		IR_SET_HANDLER(StoreVec4);
+		IR_SET_HANDLER(Vec4Init);
+		IR_SET_HANDLER(Vec4Shuffle);
+		IR_SET_HANDLER(Vec4Blend);
+		IR_SET_HANDLER(Vec4Mov);
+		IR_SET_HANDLER(Vec4Add);
+		IR_SET_HANDLER(Vec4Sub);
+		IR_SET_HANDLER(Vec4Mul);
+		IR_SET_HANDLER(Vec4Div);
+		IR_SET_HANDLER(Vec4Scale);
+		IR_SET_HANDLER(Vec4Neg);
+		IR_SET_HANDLER(Vec4Abs);
+		IR_SET_HANDLER(Vec2Unpack16To31);
+		IR_SET_HANDLER(Vec2Unpack16To32);
+		IR_SET_HANDLER(Vec4Unpack8To32);
+		IR_SET_HANDLER(Vec2Pack32To16);
+		IR_SET_HANDLER(Vec2Pack31To16);
+		IR_SET_HANDLER(Vec4Pack32To8);
+		IR_SET_HANDLER(Vec4Pack31To8);
+		IR_SET_HANDLER(Vec2ClampToZero);
+		IR_SET_HANDLER(Vec4ClampToZero);
+		IR_SET_HANDLER(Vec4DuplicateUpperBitsAndShift1);
+		IR_SET_HANDLER(FCmpVfpuBit);
+		IR_SET_HANDLER(FCmpVfpuAggregate);
+		IR_SET_HANDLER(FCmovVfpuCC);
+		IR_SET_HANDLER(Vec4Dot);
+		IR_SET_HANDLER(FSin);
+		IR_SET_HANDLER(FCos);
+		IR_SET_HANDLER(FRSqrt);
+		IR_SET_HANDLER(FRecip);
+		IR_SET_HANDLER(FAsin);
+		IR_SET_HANDLER(ShlImm);
+		IR_SET_HANDLER(ShrImm);
+		IR_SET_HANDLER(SarImm);
+		IR_SET_HANDLER(RorImm);
+		IR_SET_HANDLER(Shl);
+		IR_SET_HANDLER(Shr);
+		IR_SET_HANDLER(Sar);
+		IR_SET_HANDLER(Ror);
+		IR_SET_HANDLER(Clz);
+		IR_SET_HANDLER(Slt);
+		IR_SET_HANDLER(SltU);
+		IR_SET_HANDLER(SltConst);
+		IR_SET_HANDLER(SltUConst);
+		IR_SET_HANDLER(MovZ);
+		IR_SET_HANDLER(MovNZ);
+		IR_SET_HANDLER(Max);
+		IR_SET_HANDLER(Min);
+		IR_SET_HANDLER(MtLo);
+		IR_SET_HANDLER(MtHi);
+		IR_SET_HANDLER(MfLo);
+		IR_SET_HANDLER(MfHi);
+		IR_SET_HANDLER(Mult);
+		IR_SET_HANDLER(MultU);
+		IR_SET_HANDLER(Madd);
+		IR_SET_HANDLER(MaddU);
+		IR_SET_HANDLER(Msub);
+		IR_SET_HANDLER(MsubU);
+		IR_SET_HANDLER(Div);
+		IR_SET_HANDLER(DivU);
+		IR_SET_HANDLER(BSwap16);
+		IR_SET_HANDLER(BSwap32);
+		IR_SET_HANDLER(FAdd);
+		IR_SET_HANDLER(FSub);
+		IR_SET_HANDLER(FMul);
+		IR_SET_HANDLER(FDiv);
+		IR_SET_HANDLER(FMin);
+		IR_SET_HANDLER(FMax);
+		IR_SET_HANDLER(FMov);
+		IR_SET_HANDLER(FAbs);
+		IR_SET_HANDLER(FSqrt);
+		IR_SET_HANDLER(FNeg);
+		IR_SET_HANDLER(FSat0_1);
+		IR_SET_HANDLER(FSatMinus1_1);
+		IR_SET_HANDLER(FSign);
+		IR_SET_HANDLER(FpCondFromReg);
+		IR_SET_HANDLER(FpCondToReg);
+		IR_SET_HANDLER(FpCtrlFromReg);
+		IR_SET_HANDLER(FpCtrlToReg);
+		IR_SET_HANDLER(VfpuCtrlToReg);
+		IR_SET_HANDLER(FRound);
+		IR_SET_HANDLER(FTrunc);
+		IR_SET_HANDLER(FCeil);
+		IR_SET_HANDLER(FFloor);
+		IR_SET_HANDLER(FCmp);
+		IR_SET_HANDLER(FCvtSW);
+		IR_SET_HANDLER(FCvtWS);
+		IR_SET_HANDLER(FCvtScaledSW);
+		IR_SET_HANDLER(FCvtScaledWS);
+		IR_SET_HANDLER(FMovFromGPR);
+		IR_SET_HANDLER(OptFCvtSWFromGPR);
+		IR_SET_HANDLER(FMovToGPR);
+		IR_SET_HANDLER(OptFMovToGPRShr8);
+		IR_SET_HANDLER(ExitToConst);
+		IR_SET_HANDLER(ExitToReg);
+		IR_SET_HANDLER(ExitToConstIfEq);
+		IR_SET_HANDLER(ExitToConstIfNeq);
+		IR_SET_HANDLER(ExitToConstIfGtZ);
+		IR_SET_HANDLER(ExitToConstIfGeZ);
+		IR_SET_HANDLER(ExitToConstIfLtZ);
+		IR_SET_HANDLER(ExitToConstIfLeZ);
+		IR_SET_HANDLER(Downcount);
+		IR_SET_HANDLER(SetPC);
+		IR_SET_HANDLER(SetPCConst);
+		IR_SET_HANDLER(Syscall);
+		IR_SET_HANDLER(SyscallDirect);
+		IR_SET_HANDLER(ExitToPC);
+		IR_SET_HANDLER(Interpret);
+		IR_SET_HANDLER(CallReplacement);
+		IR_SET_HANDLER(SetCtrlVFPU);
+		IR_SET_HANDLER(SetCtrlVFPUReg);
+		IR_SET_HANDLER(SetCtrlVFPUFReg);
+		IR_SET_HANDLER(ApplyRoundingMode);
+		IR_SET_HANDLER(RestoreRoundingMode);
+		IR_SET_HANDLER(UpdateRoundingMode);
+		IR_SET_HANDLER(Break);
+		IR_SET_HANDLER(Breakpoint);
+		IR_SET_HANDLER(MemoryCheck);
+		IR_SET_HANDLER(IdleLoop);
+		IR_SET_HANDLER(ValidateAddress8);
+		IR_SET_HANDLER(ValidateAddress16);
+		IR_SET_HANDLER(ValidateAddress32);
+		IR_SET_HANDLER(ValidateAddress128);
+		IR_SET_HANDLER(LogIRBlock);
+		IR_SET_HANDLER(Nop);
+		IR_SET_HANDLER(Bad);
+#undef IR_SET_HANDLER
+			return 0;
+		}
+		goto **handler;
+	}
+#endif
+
 	while (true) {
 		switch (inst->op) {
-		case IROp::SetConst:
+		IR_CASE(SetConst)
 			mips->r[inst->dest] = inst->constant;
-			break;
-		case IROp::SetConstF:
+			IR_NEXT();
+		IR_CASE(SetConstF)
 			memcpy(&mips->f[inst->dest], &inst->constant, 4);
-			break;
-		case IROp::Add:
+			IR_NEXT();
+		IR_CASE(Add)
 			mips->r[inst->dest] = mips->r[inst->src1] + mips->r[inst->src2];
-			break;
-		case IROp::Sub:
+			IR_NEXT();
+		IR_CASE(Sub)
 			mips->r[inst->dest] = mips->r[inst->src1] - mips->r[inst->src2];
-			break;
-		case IROp::And:
+			IR_NEXT();
+		IR_CASE(And)
 			mips->r[inst->dest] = mips->r[inst->src1] & mips->r[inst->src2];
-			break;
-		case IROp::Or:
+			IR_NEXT();
+		IR_CASE(Or)
 			mips->r[inst->dest] = mips->r[inst->src1] | mips->r[inst->src2];
-			break;
-		case IROp::Xor:
+			IR_NEXT();
+		IR_CASE(Xor)
 			mips->r[inst->dest] = mips->r[inst->src1] ^ mips->r[inst->src2];
-			break;
-		case IROp::Mov:
+			IR_NEXT();
+		IR_CASE(Mov)
 			mips->r[inst->dest] = mips->r[inst->src1];
-			break;
-		case IROp::AddConst:
+			IR_NEXT();
+		IR_CASE(AddConst)
 			mips->r[inst->dest] = mips->r[inst->src1] + inst->constant;
-			break;
-		case IROp::OptAddConst:  // For this one, it's worth having a "unary" variant of the above that only needs to read one register param.
+			IR_NEXT();
+		IR_CASE(OptAddConst)  // For this one, it's worth having a "unary" variant of the above that only needs to read one register param.
 			mips->r[inst->dest] += inst->constant;
-			break;
-		case IROp::SubConst:
+			IR_NEXT();
+		IR_CASE(SubConst)
 			mips->r[inst->dest] = mips->r[inst->src1] - inst->constant;
-			break;
-		case IROp::AndConst:
+			IR_NEXT();
+		IR_CASE(AndConst)
 			mips->r[inst->dest] = mips->r[inst->src1] & inst->constant;
-			break;
-		case IROp::OptAndConst:  // For this one, it's worth having a "unary" variant of the above that only needs to read one register param.
+			IR_NEXT();
+		IR_CASE(OptAndConst)  // For this one, it's worth having a "unary" variant of the above that only needs to read one register param.
 			mips->r[inst->dest] &= inst->constant;
-			break;
-		case IROp::OrConst:
+			IR_NEXT();
+		IR_CASE(OrConst)
 			mips->r[inst->dest] = mips->r[inst->src1] | inst->constant;
-			break;
-		case IROp::OptOrConst:
+			IR_NEXT();
+		IR_CASE(OptOrConst)
 			mips->r[inst->dest] |= inst->constant;
-			break;
-		case IROp::XorConst:
+			IR_NEXT();
+		IR_CASE(XorConst)
 			mips->r[inst->dest] = mips->r[inst->src1] ^ inst->constant;
-			break;
-		case IROp::Neg:
+			IR_NEXT();
+		IR_CASE(Neg)
 			mips->r[inst->dest] = (u32)(-(s32)mips->r[inst->src1]);
-			break;
-		case IROp::Not:
+			IR_NEXT();
+		IR_CASE(Not)
 			mips->r[inst->dest] = ~mips->r[inst->src1];
-			break;
-		case IROp::Ext8to32:
+			IR_NEXT();
+		IR_CASE(Ext8to32)
 			mips->r[inst->dest] = SignExtend8ToU32(mips->r[inst->src1]);
-			break;
-		case IROp::Ext16to32:
+			IR_NEXT();
+		IR_CASE(Ext16to32)
 			mips->r[inst->dest] = SignExtend16ToU32(mips->r[inst->src1]);
-			break;
-		case IROp::ReverseBits:
+			IR_NEXT();
+		IR_CASE(ReverseBits)
 			mips->r[inst->dest] = ReverseBits32(mips->r[inst->src1]);
-			break;
+			IR_NEXT();
 
-		case IROp::Load8:
+		IR_CASE(Load8)
 			mips->r[inst->dest] = Memory::ReadUnchecked_U8(mips->r[inst->src1] + inst->constant);
-			break;
-		case IROp::Load8Ext:
+			IR_NEXT();
+		IR_CASE(Load8Ext)
 			mips->r[inst->dest] = SignExtend8ToU32(Memory::ReadUnchecked_U8(mips->r[inst->src1] + inst->constant));
-			break;
-		case IROp::Load16:
+			IR_NEXT();
+		IR_CASE(Load16)
 			mips->r[inst->dest] = Memory::ReadUnchecked_U16(mips->r[inst->src1] + inst->constant);
-			break;
-		case IROp::Load16Ext:
+			IR_NEXT();
+		IR_CASE(Load16Ext)
 			mips->r[inst->dest] = SignExtend16ToU32(Memory::ReadUnchecked_U16(mips->r[inst->src1] + inst->constant));
-			break;
-		case IROp::Load32:
+			IR_NEXT();
+		IR_CASE(Load32)
 			mips->r[inst->dest] = Memory::ReadUnchecked_U32(mips->r[inst->src1] + inst->constant);
-			break;
-		case IROp::Load32Left:
+			IR_NEXT();
+		IR_CASE(Load32Left)
 		{
 			u32 addr = mips->r[inst->src1] + inst->constant;
 			u32 shift = (addr & 3) * 8;
 			u32 mem = Memory::ReadUnchecked_U32(addr & 0xfffffffc);
 			u32 destMask = 0x00ffffff >> shift;
 			mips->r[inst->dest] = (mips->r[inst->dest] & destMask) | (mem << (24 - shift));
-			break;
+			IR_NEXT();
 		}
-		case IROp::Load32Right:
+		IR_CASE(Load32Right)
 		{
 			u32 addr = mips->r[inst->src1] + inst->constant;
 			u32 shift = (addr & 3) * 8;
 			u32 mem = Memory::ReadUnchecked_U32(addr & 0xfffffffc);
 			u32 destMask = 0xffffff00 << (24 - shift);
 			mips->r[inst->dest] = (mips->r[inst->dest] & destMask) | (mem >> shift);
-			break;
+			IR_NEXT();
 		}
-		case IROp::Load32Linked:
+		IR_CASE(Load32Linked)
 			if (inst->dest != MIPS_REG_ZERO)
 				mips->r[inst->dest] = Memory::ReadUnchecked_U32(mips->r[inst->src1] + inst->constant);
 			mips->llBit = 1;
-			break;
-		case IROp::LoadFloat:
+			IR_NEXT();
+		IR_CASE(LoadFloat)
 			mips->f[inst->dest] = Memory::ReadUnchecked_Float(mips->r[inst->src1] + inst->constant);
-			break;
+			IR_NEXT();
 
-		case IROp::Store8:
+		IR_CASE(Store8)
 			Memory::WriteUnchecked_U8(mips->r[inst->src3], mips->r[inst->src1] + inst->constant);
-			break;
-		case IROp::Store16:
+			IR_NEXT();
+		IR_CASE(Store16)
 			Memory::WriteUnchecked_U16(mips->r[inst->src3], mips->r[inst->src1] + inst->constant);
-			break;
-		case IROp::Store32:
+			IR_NEXT();
+		IR_CASE(Store32)
 			Memory::WriteUnchecked_U32(mips->r[inst->src3], mips->r[inst->src1] + inst->constant);
-			break;
-		case IROp::Store32Left:
+			IR_NEXT();
+		IR_CASE(Store32Left)
 		{
 			u32 addr = mips->r[inst->src1] + inst->constant;
 			u32 shift = (addr & 3) * 8;
@@ -287,9 +520,9 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			u32 memMask = 0xffffff00 << shift;
 			u32 result = (mips->r[inst->src3] >> (24 - shift)) | (mem & memMask);
 			Memory::WriteUnchecked_U32(result, addr & 0xfffffffc);
-			break;
+			IR_NEXT();
 		}
-		case IROp::Store32Right:
+		IR_CASE(Store32Right)
 		{
 			u32 addr = mips->r[inst->src1] + inst->constant;
 			u32 shift = (addr & 3) * 8;
@@ -297,9 +530,9 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			u32 memMask = 0x00ffffff >> (24 - shift);
 			u32 result = (mips->r[inst->src3] << shift) | (mem & memMask);
 			Memory::WriteUnchecked_U32(result, addr & 0xfffffffc);
-			break;
+			IR_NEXT();
 		}
-		case IROp::Store32Conditional:
+		IR_CASE(Store32Conditional)
 			if (mips->llBit) {
 				Memory::WriteUnchecked_U32(mips->r[inst->src3], mips->r[inst->src1] + inst->constant);
 				if (inst->dest != MIPS_REG_ZERO) {
@@ -308,32 +541,32 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			} else if (inst->dest != MIPS_REG_ZERO) {
 				mips->r[inst->dest] = 0;
 			}
-			break;
-		case IROp::StoreFloat:
+			IR_NEXT();
+		IR_CASE(StoreFloat)
 			Memory::WriteUnchecked_Float(mips->f[inst->src3], mips->r[inst->src1] + inst->constant);
-			break;
+			IR_NEXT();
 
-		case IROp::LoadVec4:
+		IR_CASE(LoadVec4)
 		{
 			u32 base = mips->r[inst->src1] + inst->constant;
 			// This compiles to a nice SSE load/store on x86, and hopefully similar on ARM.
 			memcpy(&mips->f[inst->dest], Memory::GetPointerUnchecked(base), 4 * 4);
-			break;
+			IR_NEXT();
 		}
-		case IROp::StoreVec4:
+		IR_CASE(StoreVec4)
 		{
 			u32 base = mips->r[inst->src1] + inst->constant;
 			memcpy((float *)Memory::GetPointerUnchecked(base), &mips->f[inst->dest], 4 * 4);
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec4Init:
+		IR_CASE(Vec4Init)
 		{
 			memcpy(&mips->f[inst->dest], vec4InitValues[inst->src1], 4 * sizeof(float));
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec4Shuffle:
+		IR_CASE(Vec4Shuffle)
 		{
 			// Can't use the SSE shuffle here because it takes an immediate. pshufb with a table would work though,
 			// or a big switch - there are only 256 shuffles possible (4^4)
@@ -343,10 +576,10 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			const u32 dest = inst->dest;
 			for (u32 i = 0; i < 4; i++)
 				mips->f[dest + i] = temp[i];
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec4Blend:
+		IR_CASE(Vec4Blend)
 		{
 			const u32 dest = inst->dest;
 			const u32 src1 = inst->src1;
@@ -359,10 +592,10 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 				temp[i] = ((constant >> i) & 1) ? mips->f[src2 + i] : mips->f[src1 + i];
 			for (u32 i = 0; i < 4; i++)
 				mips->f[dest + i] = temp[i];
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec4Mov:
+		IR_CASE(Vec4Mov)
 		{
 #if PPSSPP_ARCH(SSE2)
 			_mm_store_ps(&mips->f[inst->dest], _mm_load_ps(&mips->f[inst->src1]));
@@ -371,10 +604,10 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 #else
 			memcpy(&mips->f[inst->dest], &mips->f[inst->src1], 4 * sizeof(float));
 #endif
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec4Add:
+		IR_CASE(Vec4Add)
 		{
 #if PPSSPP_ARCH(SSE2)
 			_mm_store_ps(&mips->f[inst->dest], _mm_add_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps(&mips->f[inst->src2])));
@@ -384,10 +617,10 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			for (int i = 0; i < 4; i++)
 				mips->f[inst->dest + i] = mips->f[inst->src1 + i] + mips->f[inst->src2 + i];
 #endif
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec4Sub:
+		IR_CASE(Vec4Sub)
 		{
 #if PPSSPP_ARCH(SSE2)
 			_mm_store_ps(&mips->f[inst->dest], _mm_sub_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps(&mips->f[inst->src2])));
@@ -397,10 +630,10 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			for (int i = 0; i < 4; i++)
 				mips->f[inst->dest + i] = mips->f[inst->src1 + i] - mips->f[inst->src2 + i];
 #endif
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec4Mul:
+		IR_CASE(Vec4Mul)
 		{
 #if PPSSPP_ARCH(SSE2)
 			_mm_store_ps(&mips->f[inst->dest], _mm_mul_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps(&mips->f[inst->src2])));
@@ -410,10 +643,10 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			for (int i = 0; i < 4; i++)
 				mips->f[inst->dest + i] = mips->f[inst->src1 + i] * mips->f[inst->src2 + i];
 #endif
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec4Div:
+		IR_CASE(Vec4Div)
 		{
 #if PPSSPP_ARCH(SSE2)
 			_mm_store_ps(&mips->f[inst->dest], _mm_div_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps(&mips->f[inst->src2])));
@@ -423,10 +656,10 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			for (int i = 0; i < 4; i++)
 				mips->f[inst->dest + i] = mips->f[inst->src1 + i] / mips->f[inst->src2 + i];
 #endif
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec4Scale:
+		IR_CASE(Vec4Scale)
 		{
 #if PPSSPP_ARCH(SSE2)
 			_mm_store_ps(&mips->f[inst->dest], _mm_mul_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_set1_ps(mips->f[inst->src2])));
@@ -437,10 +670,10 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			for (int i = 0; i < 4; i++)
 				mips->f[inst->dest + i] = mips->f[inst->src1 + i] * factor;
 #endif
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec4Neg:
+		IR_CASE(Vec4Neg)
 		{
 #if PPSSPP_ARCH(SSE2)
 			_mm_store_ps(&mips->f[inst->dest], _mm_xor_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps((const float *)signBits)));
@@ -450,10 +683,10 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			for (int i = 0; i < 4; i++)
 				mips->f[inst->dest + i] = -mips->f[inst->src1 + i];
 #endif
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec4Abs:
+		IR_CASE(Vec4Abs)
 		{
 #if PPSSPP_ARCH(SSE2)
 			_mm_store_ps(&mips->f[inst->dest], _mm_and_ps(_mm_load_ps(&mips->f[inst->src1]), _mm_load_ps((const float *)noSignMask)));
@@ -463,10 +696,10 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			for (int i = 0; i < 4; i++)
 				mips->f[inst->dest + i] = fabsf(mips->f[inst->src1 + i]);
 #endif
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec2Unpack16To31:
+		IR_CASE(Vec2Unpack16To31)
 		{
 			const u32 dest = inst->dest;
 			const u32 src1 = inst->src1;
@@ -474,10 +707,10 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			const u32 temp1 = (mips->fi[src1] & 0xFFFF0000) >> 1;
 			mips->fi[dest] = temp0;
 			mips->fi[dest + 1] = temp1;
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec2Unpack16To32:
+		IR_CASE(Vec2Unpack16To32)
 		{
 			const u32 dest = inst->dest;
 			const u32 src1 = inst->src1;
@@ -485,10 +718,10 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			const u32 temp1 = (mips->fi[src1] & 0xFFFF0000);
 			mips->fi[dest] = temp0;
 			mips->fi[dest + 1] = temp1;
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec4Unpack8To32:
+		IR_CASE(Vec4Unpack8To32)
 		{
 			// Used in Gran Turismo
 #if PPSSPP_ARCH(SSE2)
@@ -507,25 +740,25 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			mips->fi[inst->dest + 2] = (mips->fi[inst->src1] << 8) & 0xFF000000;
 			mips->fi[inst->dest + 3] = (mips->fi[inst->src1]) & 0xFF000000;
 #endif
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec2Pack32To16:
+		IR_CASE(Vec2Pack32To16)
 		{
 			u32 val = mips->fi[inst->src1] >> 16;
 			mips->fi[inst->dest] = val | (mips->fi[(u32)inst->src1 + 1] & 0xFFFF0000);
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec2Pack31To16:
+		IR_CASE(Vec2Pack31To16)
 		{
 			// Used in Tekken 6
 			u32 val = (mips->fi[inst->src1] >> 15) & 0xFFFF;
 			mips->fi[inst->dest] = val | ((mips->fi[(u32)inst->src1 + 1] << 1) & 0xFFFF0000);
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec4Pack32To8:
+		IR_CASE(Vec4Pack32To8)
 		{
 #if PPSSPP_ARCH(SSE2)
 			__m128i src = _mm_loadu_si128((__m128i *)&mips->fi[inst->src1]);
@@ -558,10 +791,10 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			val |= (mips->fi[(u32)inst->src1 + 3]) & 0xFF000000;
 			mips->fi[inst->dest] = val;
 #endif
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec4Pack31To8:
+		IR_CASE(Vec4Pack31To8)
 		{
 			// Used in Tekken 6, Gran Turismo
 
@@ -588,19 +821,19 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			val |= (mips->fi[(u32)inst->src1 + 3] << 1) & 0xFF000000;
 			mips->fi[(u32)inst->dest] = val;
 #endif
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec2ClampToZero:
+		IR_CASE(Vec2ClampToZero)
 		{
 			const u32 temp0 = mips->fi[(u32)inst->src1];
 			const u32 temp1 = mips->fi[(u32)inst->src1 + 1];
 			mips->fi[(u32)inst->dest] = (int)temp0 >= 0 ? temp0 : 0;
 			mips->fi[(u32)inst->dest + 1] = (int)temp1 >= 0 ? temp1 : 0;
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec4ClampToZero:
+		IR_CASE(Vec4ClampToZero)
 		{
 #if PPSSPP_ARCH(SSE2)
 			// Trickery: Expand the sign bit, and use andnot to zero negative values.
@@ -622,10 +855,10 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 				mips->fi[dest + i] = (int)val >= 0 ? val : 0;
 			}
 #endif
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Vec4DuplicateUpperBitsAndShift1:  // For vuc2i, the weird one.
+		IR_CASE(Vec4DuplicateUpperBitsAndShift1)  // For vuc2i, the weird one.
 		{
 			const int src1 = inst->src1;
 			const int dest = inst->dest;
@@ -639,10 +872,10 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			for (int i = 0; i < 4; i++) {
 				mips->fi[dest + i] = temp[i];
 			}
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::FCmpVfpuBit:
+		IR_CASE(FCmpVfpuBit)
 		{
 			const int op = inst->dest & 0xF;
 			const int bit = inst->dest >> 4;
@@ -672,26 +905,26 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			} else {
 				mips->vfpuCtrl[VFPU_CTRL_CC] &= ~(1 << bit);
 			}
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::FCmpVfpuAggregate:
+		IR_CASE(FCmpVfpuAggregate)
 		{
 			const u32 mask = inst->dest;
 			const u32 cc = mips->vfpuCtrl[VFPU_CTRL_CC];
 			int anyBit = (cc & mask) ? 0x10 : 0x00;
 			int allBit = (cc & mask) == mask ? 0x20 : 0x00;
 			mips->vfpuCtrl[VFPU_CTRL_CC] = (cc & ~0x30) | anyBit | allBit;
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::FCmovVfpuCC:
+		IR_CASE(FCmovVfpuCC)
 			if (((mips->vfpuCtrl[VFPU_CTRL_CC] >> (inst->src2 & 0xf)) & 1) == ((u32)inst->src2 >> 7)) {
 				mips->f[inst->dest] = mips->f[inst->src1];
 			}
-			break;
+			IR_NEXT();
 
-		case IROp::Vec4Dot:
+		IR_CASE(Vec4Dot)
 		{
 			// Not quickly implementable on all platforms, unfortunately.
 			// Though, this is still pretty fast compared to one split into multiple IR instructions.
@@ -699,156 +932,156 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			const float *a = &mips->f[(u32)inst->src1];
 			const float *b = &mips->f[(u32)inst->src2];
 			mips->f[inst->dest] = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::FSin:
+		IR_CASE(FSin)
 			mips->f[inst->dest] = vfpu_sin(mips->f[inst->src1]);
-			break;
-		case IROp::FCos:
+			IR_NEXT();
+		IR_CASE(FCos)
 			mips->f[inst->dest] = vfpu_cos(mips->f[inst->src1]);
-			break;
-		case IROp::FRSqrt:
+			IR_NEXT();
+		IR_CASE(FRSqrt)
 			mips->f[inst->dest] = 1.0f / sqrtf(mips->f[inst->src1]);
-			break;
-		case IROp::FRecip:
+			IR_NEXT();
+		IR_CASE(FRecip)
 			mips->f[inst->dest] = 1.0f / mips->f[inst->src1];
-			break;
-		case IROp::FAsin:
+			IR_NEXT();
+		IR_CASE(FAsin)
 			mips->f[inst->dest] = vfpu_asin(mips->f[inst->src1]);
-			break;
+			IR_NEXT();
 
-		case IROp::ShlImm:
+		IR_CASE(ShlImm)
 			mips->r[inst->dest] = mips->r[inst->src1] << (int)inst->src2;
-			break;
-		case IROp::ShrImm:
+			IR_NEXT();
+		IR_CASE(ShrImm)
 			mips->r[inst->dest] = mips->r[inst->src1] >> (int)inst->src2;
-			break;
-		case IROp::SarImm:
+			IR_NEXT();
+		IR_CASE(SarImm)
 			mips->r[inst->dest] = (s32)mips->r[inst->src1] >> (int)inst->src2;
-			break;
-		case IROp::RorImm:
+			IR_NEXT();
+		IR_CASE(RorImm)
 		{
 			u32 x = mips->r[inst->src1];
 			int sa = inst->src2;
 			mips->r[inst->dest] = (x >> sa) | (x << (32 - sa));
 		}
-		break;
+		IR_NEXT();
 
-		case IROp::Shl:
+		IR_CASE(Shl)
 			mips->r[inst->dest] = mips->r[inst->src1] << (mips->r[inst->src2] & 31);
-			break;
-		case IROp::Shr:
+			IR_NEXT();
+		IR_CASE(Shr)
 			mips->r[inst->dest] = mips->r[inst->src1] >> (mips->r[inst->src2] & 31);
-			break;
-		case IROp::Sar:
+			IR_NEXT();
+		IR_CASE(Sar)
 			mips->r[inst->dest] = (s32)mips->r[inst->src1] >> (mips->r[inst->src2] & 31);
-			break;
-		case IROp::Ror:
+			IR_NEXT();
+		IR_CASE(Ror)
 		{
 			u32 x = mips->r[inst->src1];
 			int sa = mips->r[inst->src2] & 31;
 			mips->r[inst->dest] = (x >> sa) | (x << (32 - sa));
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Clz:
+		IR_CASE(Clz)
 		{
 			mips->r[inst->dest] = clz32(mips->r[inst->src1]);
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Slt:
+		IR_CASE(Slt)
 			mips->r[inst->dest] = (s32)mips->r[inst->src1] < (s32)mips->r[inst->src2];
-			break;
+			IR_NEXT();
 
-		case IROp::SltU:
+		IR_CASE(SltU)
 			mips->r[inst->dest] = mips->r[inst->src1] < mips->r[inst->src2];
-			break;
+			IR_NEXT();
 
-		case IROp::SltConst:
+		IR_CASE(SltConst)
 			mips->r[inst->dest] = (s32)mips->r[inst->src1] < (s32)inst->constant;
-			break;
+			IR_NEXT();
 
-		case IROp::SltUConst:
+		IR_CASE(SltUConst)
 			mips->r[inst->dest] = mips->r[inst->src1] < inst->constant;
-			break;
+			IR_NEXT();
 
-		case IROp::MovZ:
+		IR_CASE(MovZ)
 			if (mips->r[inst->src1] == 0)
 				mips->r[inst->dest] = mips->r[inst->src2];
-			break;
-		case IROp::MovNZ:
+			IR_NEXT();
+		IR_CASE(MovNZ)
 			if (mips->r[inst->src1] != 0)
 				mips->r[inst->dest] = mips->r[inst->src2];
-			break;
+			IR_NEXT();
 
-		case IROp::Max:
+		IR_CASE(Max)
 			mips->r[inst->dest] = (s32)mips->r[inst->src1] > (s32)mips->r[inst->src2] ? mips->r[inst->src1] : mips->r[inst->src2];
-			break;
-		case IROp::Min:
+			IR_NEXT();
+		IR_CASE(Min)
 			mips->r[inst->dest] = (s32)mips->r[inst->src1] < (s32)mips->r[inst->src2] ? mips->r[inst->src1] : mips->r[inst->src2];
-			break;
+			IR_NEXT();
 
-		case IROp::MtLo:
+		IR_CASE(MtLo)
 			mips->lo = mips->r[inst->src1];
-			break;
-		case IROp::MtHi:
+			IR_NEXT();
+		IR_CASE(MtHi)
 			mips->hi = mips->r[inst->src1];
-			break;
-		case IROp::MfLo:
+			IR_NEXT();
+		IR_CASE(MfLo)
 			mips->r[inst->dest] = mips->lo;
-			break;
-		case IROp::MfHi:
+			IR_NEXT();
+		IR_CASE(MfHi)
 			mips->r[inst->dest] = mips->hi;
-			break;
+			IR_NEXT();
 
-		case IROp::Mult:
+		IR_CASE(Mult)
 		{
 			s64 result = (s64)(s32)mips->r[inst->src1] * (s64)(s32)mips->r[inst->src2];
 			memcpy(&mips->lo, &result, 8);  // note: lo is followed by hi, so this is ok (little-endian).
-			break;
+			IR_NEXT();
 		}
-		case IROp::MultU:
+		IR_CASE(MultU)
 		{
 			u64 result = (u64)mips->r[inst->src1] * (u64)mips->r[inst->src2];
 			memcpy(&mips->lo, &result, 8);
-			break;
+			IR_NEXT();
 		}
-		case IROp::Madd:
+		IR_CASE(Madd)
 		{
 			s64 result;
 			memcpy(&result, &mips->lo, 8);
 			result += (s64)(s32)mips->r[inst->src1] * (s64)(s32)mips->r[inst->src2];
 			memcpy(&mips->lo, &result, 8);
-			break;
+			IR_NEXT();
 		}
-		case IROp::MaddU:
+		IR_CASE(MaddU)
 		{
 			s64 result;
 			memcpy(&result, &mips->lo, 8);
 			result += (u64)mips->r[inst->src1] * (u64)mips->r[inst->src2];
 			memcpy(&mips->lo, &result, 8);
-			break;
+			IR_NEXT();
 		}
-		case IROp::Msub:
+		IR_CASE(Msub)
 		{
 			s64 result;
 			memcpy(&result, &mips->lo, 8);
 			result -= (s64)(s32)mips->r[inst->src1] * (s64)(s32)mips->r[inst->src2];
 			memcpy(&mips->lo, &result, 8);
-			break;
+			IR_NEXT();
 		}
-		case IROp::MsubU:
+		IR_CASE(MsubU)
 		{
 			s64 result;
 			memcpy(&result, &mips->lo, 8);
 			result -= (u64)mips->r[inst->src1] * (u64)mips->r[inst->src2];
 			memcpy(&mips->lo, &result, 8);
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::Div:
+		IR_CASE(Div)
 		{
 			s32 numerator = (s32)mips->r[inst->src1];
 			s32 denominator = (s32)mips->r[inst->src2];
@@ -862,9 +1095,9 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 				mips->lo = numerator < 0 ? 1 : -1;
 				mips->hi = numerator;
 			}
-			break;
+			IR_NEXT();
 		}
-		case IROp::DivU:
+		IR_CASE(DivU)
 		{
 			u32 numerator = mips->r[inst->src1];
 			u32 denominator = mips->r[inst->src2];
@@ -875,29 +1108,29 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 				mips->lo = numerator <= 0xFFFF ? 0xFFFF : -1;
 				mips->hi = numerator;
 			}
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::BSwap16:
+		IR_CASE(BSwap16)
 		{
 			u32 x = mips->r[inst->src1];
 			// Don't think we can beat this with intrinsics.
 			mips->r[inst->dest] = ((x & 0xFF00FF00) >> 8) | ((x & 0x00FF00FF) << 8);
-			break;
+			IR_NEXT();
 		}
-		case IROp::BSwap32:
+		IR_CASE(BSwap32)
 		{
 			mips->r[inst->dest] = swap32(mips->r[inst->src1]);
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::FAdd:
+		IR_CASE(FAdd)
 			mips->f[inst->dest] = mips->f[inst->src1] + mips->f[inst->src2];
-			break;
-		case IROp::FSub:
+			IR_NEXT();
+		IR_CASE(FSub)
 			mips->f[inst->dest] = mips->f[inst->src1] - mips->f[inst->src2];
-			break;
-		case IROp::FMul:
+			IR_NEXT();
+		IR_CASE(FMul)
 #if 1
 		{
 			float a = mips->f[inst->src1];
@@ -908,7 +1141,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 				mips->f[inst->dest] = a * b;
 			}
 		}
-			break;
+			IR_NEXT();
 #else
 			// Not sure if faster since it needs to load the operands twice? But the code is simpler.
 			{
@@ -923,10 +1156,10 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 				break;
 			}
 #endif
-		case IROp::FDiv:
+		IR_CASE(FDiv)
 			mips->f[inst->dest] = mips->f[inst->src1] / mips->f[inst->src2];
-			break;
-		case IROp::FMin:
+			IR_NEXT();
+		IR_CASE(FMin)
 			if (my_isnan(mips->f[inst->src1]) || my_isnan(mips->f[inst->src2])) {
 				// See interpreter for this logic: this is for vmin, we're comparing mantissa+exp.
 				if (mips->fs[inst->src1] < 0 && mips->fs[inst->src2] < 0) {
@@ -937,8 +1170,8 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			} else {
 				mips->f[inst->dest] = std::min(mips->f[inst->src1], mips->f[inst->src2]);
 			}
-			break;
-		case IROp::FMax:
+			IR_NEXT();
+		IR_CASE(FMax)
 			if (my_isnan(mips->f[inst->src1]) || my_isnan(mips->f[inst->src2])) {
 				// See interpreter for this logic: this is for vmax, we're comparing mantissa+exp.
 				if (mips->fs[inst->src1] < 0 && mips->fs[inst->src2] < 0) {
@@ -949,29 +1182,29 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			} else {
 				mips->f[inst->dest] = std::max(mips->f[inst->src1], mips->f[inst->src2]);
 			}
-			break;
+			IR_NEXT();
 
-		case IROp::FMov:
+		IR_CASE(FMov)
 			mips->f[inst->dest] = mips->f[inst->src1];
-			break;
-		case IROp::FAbs:
+			IR_NEXT();
+		IR_CASE(FAbs)
 			mips->f[inst->dest] = fabsf(mips->f[inst->src1]);
-			break;
-		case IROp::FSqrt:
+			IR_NEXT();
+		IR_CASE(FSqrt)
 			mips->f[inst->dest] = sqrtf(mips->f[inst->src1]);
-			break;
-		case IROp::FNeg:
+			IR_NEXT();
+		IR_CASE(FNeg)
 			mips->f[inst->dest] = -mips->f[inst->src1];
-			break;
-		case IROp::FSat0_1:
+			IR_NEXT();
+		IR_CASE(FSat0_1)
 			// We have to do this carefully to handle NAN and -0.0f.
 			mips->f[inst->dest] = vfpu_clamp(mips->f[inst->src1], 0.0f, 1.0f);
-			break;
-		case IROp::FSatMinus1_1:
+			IR_NEXT();
+		IR_CASE(FSatMinus1_1)
 			mips->f[inst->dest] = vfpu_clamp(mips->f[inst->src1], -1.0f, 1.0f);
-			break;
+			IR_NEXT();
 
-		case IROp::FSign:
+		IR_CASE(FSign)
 		{
 			// Bitwise trickery
 			u32 val;
@@ -982,30 +1215,30 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 				mips->f[inst->dest] = 1.0f;
 			else
 				mips->f[inst->dest] = -1.0f;
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::FpCondFromReg:
+		IR_CASE(FpCondFromReg)
 			mips->fpcond = mips->r[inst->dest];
-			break;
-		case IROp::FpCondToReg:
+			IR_NEXT();
+		IR_CASE(FpCondToReg)
 			mips->r[inst->dest] = mips->fpcond;
-			break;
-		case IROp::FpCtrlFromReg:
+			IR_NEXT();
+		IR_CASE(FpCtrlFromReg)
 			mips->fcr31 = mips->r[inst->src1] & 0x0181FFFF;
 			// Extract the new fpcond value.
 			// TODO: Is it really helping us to keep it separate?
 			mips->fpcond = (mips->fcr31 >> 23) & 1;
-			break;
-		case IROp::FpCtrlToReg:
+			IR_NEXT();
+		IR_CASE(FpCtrlToReg)
 			// Update the fpcond bit first.
 			mips->fcr31 = (mips->fcr31 & ~(1 << 23)) | ((mips->fpcond & 1) << 23);
 			mips->r[inst->dest] = mips->fcr31;
-			break;
-		case IROp::VfpuCtrlToReg:
+			IR_NEXT();
+		IR_CASE(VfpuCtrlToReg)
 			mips->r[inst->dest] = mips->vfpuCtrl[inst->src1];
-			break;
-		case IROp::FRound:
+			IR_NEXT();
+		IR_CASE(FRound)
 		{
 			float value = mips->f[inst->src1];
 			if (my_isnanorinf(value)) {
@@ -1014,9 +1247,9 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			} else {
 				mips->fs[inst->dest] = (int)round_ieee_754(value);
 			}
-			break;
+			IR_NEXT();
 		}
-		case IROp::FTrunc:
+		IR_CASE(FTrunc)
 		{
 			float value = mips->f[inst->src1];
 			if (my_isnanorinf(value)) {
@@ -1036,7 +1269,7 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 				break;
 			}
 		}
-		case IROp::FCeil:
+		IR_CASE(FCeil)
 		{
 			float value = mips->f[inst->src1];
 			if (my_isnanorinf(value)) {
@@ -1045,9 +1278,9 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			} else {
 				mips->fs[inst->dest] = (int)ceilf(value);
 			}
-			break;
+			IR_NEXT();
 		}
-		case IROp::FFloor:
+		IR_CASE(FFloor)
 		{
 			float value = mips->f[inst->src1];
 			if (my_isnanorinf(value)) {
@@ -1056,9 +1289,9 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			} else {
 				mips->fs[inst->dest] = (int)floorf(value);
 			}
-			break;
+			IR_NEXT();
 		}
-		case IROp::FCmp:
+		IR_CASE(FCmp)
 			switch (inst->dest) {
 			case IRFpCompareMode::False:
 				mips->fpcond = 0;
@@ -1089,12 +1322,12 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 				mips->fpcond = !(mips->f[inst->src1] >= mips->f[inst->src2]);
 				break;
 			}
-			break;
+			IR_NEXT();
 
-		case IROp::FCvtSW:
+		IR_CASE(FCvtSW)
 			mips->f[inst->dest] = (float)mips->fs[inst->src1];
-			break;
-		case IROp::FCvtWS:
+			IR_NEXT();
+		IR_CASE(FCvtWS)
 		{
 			float src = mips->f[inst->src1];
 			if (my_isnanorinf(src)) {
@@ -1110,10 +1343,10 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			}
 			break; //cvt.w.s
 		}
-		case IROp::FCvtScaledSW:
+		IR_CASE(FCvtScaledSW)
 			mips->f[inst->dest] = (float)mips->fs[inst->src1] * (1.0f / (1UL << (inst->src2 & 0x1F)));
-			break;
-		case IROp::FCvtScaledWS:
+			IR_NEXT();
+		IR_CASE(FCvtScaledWS)
 		{
 			float src = mips->f[inst->src1];
 			if (my_isnan(src)) {
@@ -1137,175 +1370,188 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 				case IRRoundMode::FLOOR_3: mips->fs[inst->dest] = (int)floor(sv); break;
 				}
 			}
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::FMovFromGPR:
+		IR_CASE(FMovFromGPR)
 			memcpy(&mips->f[inst->dest], &mips->r[inst->src1], 4);
-			break;
-		case IROp::OptFCvtSWFromGPR:
+			IR_NEXT();
+		IR_CASE(OptFCvtSWFromGPR)
 			mips->f[inst->dest] = (float)(int)mips->r[inst->src1];
-			break;
-		case IROp::FMovToGPR:
+			IR_NEXT();
+		IR_CASE(FMovToGPR)
 			memcpy(&mips->r[inst->dest], &mips->f[inst->src1], 4);
-			break;
-		case IROp::OptFMovToGPRShr8:
+			IR_NEXT();
+		IR_CASE(OptFMovToGPRShr8)
 		{
 			u32 temp;
 			memcpy(&temp, &mips->f[inst->src1], 4);
 			mips->r[inst->dest] = temp >> 8;
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::ExitToConst:
+		IR_CASE(ExitToConst)
 			return inst->constant;
 
-		case IROp::ExitToReg:
+		IR_CASE(ExitToReg)
 			return mips->r[inst->src1];
 
-		case IROp::ExitToConstIfEq:
+		IR_CASE(ExitToConstIfEq)
 			if (mips->r[inst->src1] == mips->r[inst->src2])
 				return inst->constant;
-			break;
-		case IROp::ExitToConstIfNeq:
+			IR_NEXT();
+		IR_CASE(ExitToConstIfNeq)
 			if (mips->r[inst->src1] != mips->r[inst->src2])
 				return inst->constant;
-			break;
-		case IROp::ExitToConstIfGtZ:
+			IR_NEXT();
+		IR_CASE(ExitToConstIfGtZ)
 			if ((s32)mips->r[inst->src1] > 0)
 				return inst->constant;
-			break;
-		case IROp::ExitToConstIfGeZ:
+			IR_NEXT();
+		IR_CASE(ExitToConstIfGeZ)
 			if ((s32)mips->r[inst->src1] >= 0)
 				return inst->constant;
-			break;
-		case IROp::ExitToConstIfLtZ:
+			IR_NEXT();
+		IR_CASE(ExitToConstIfLtZ)
 			if ((s32)mips->r[inst->src1] < 0)
 				return inst->constant;
-			break;
-		case IROp::ExitToConstIfLeZ:
+			IR_NEXT();
+		IR_CASE(ExitToConstIfLeZ)
 			if ((s32)mips->r[inst->src1] <= 0)
 				return inst->constant;
-			break;
+			IR_NEXT();
 
-		case IROp::Downcount:
+		IR_CASE(Downcount)
 			mips->downcount -= (int)inst->constant;
-			break;
+			IR_NEXT();
 
-		case IROp::SetPC:
+		IR_CASE(SetPC)
 			mips->pc = mips->r[inst->src1];
-			break;
+			IR_NEXT();
 
-		case IROp::SetPCConst:
+		IR_CASE(SetPCConst)
 			mips->pc = inst->constant;
-			break;
+			IR_NEXT();
 
-		case IROp::Syscall:
+		IR_CASE(Syscall)
 			// IROp::SetPC was (hopefully) executed before.
 		{
 			MIPSOpcode op(inst->constant);
 			CallSyscall(op);
 			if (coreState != CORE_RUNNING_CPU)
 				CoreTiming::ForceCheck();
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::ExitToPC:
+		IR_CASE(SyscallDirect)
+		{
+			MIPSOpcode op(inst->constant);
+			u32 exitPC = CallSyscallDirect(GetSyscallFuncPointer(op));
+			if (exitPC != 0)
+				return exitPC;
+			IR_NEXT();
+		}
+
+		IR_CASE(ExitToPC)
 			return mips->pc;
 
-		case IROp::Interpret:  // SLOW fallback. Can be made faster. Ideally should be removed but may be useful for debugging.
+		IR_CASE(Interpret)  // SLOW fallback. Can be made faster. Ideally should be removed but may be useful for debugging.
 		{
 			MIPSOpcode op(inst->constant);
 			MIPSInterpret(op);
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::CallReplacement:
+		IR_CASE(CallReplacement)
 		{
 			int funcIndex = inst->constant;
 			const ReplacementTableEntry *f = GetReplacementFunc(funcIndex);
 			int cycles = f->replaceFunc();
 			mips->r[inst->dest] = cycles < 0 ? -1 : 0;
 			mips->downcount -= cycles < 0 ? -cycles : cycles;
-			break;
+			IR_NEXT();
 		}
 
-		case IROp::SetCtrlVFPU:
+		IR_CASE(SetCtrlVFPU)
 			mips->vfpuCtrl[inst->dest] = inst->constant;
-			break;
+			IR_NEXT();
 
-		case IROp::SetCtrlVFPUReg:
+		IR_CASE(SetCtrlVFPUReg)
 			mips->vfpuCtrl[inst->dest] = mips->r[inst->src1];
-			break;
+			IR_NEXT();
 
-		case IROp::SetCtrlVFPUFReg:
+		IR_CASE(SetCtrlVFPUFReg)
 			memcpy(&mips->vfpuCtrl[inst->dest], &mips->f[inst->src1], 4);
-			break;
+			IR_NEXT();
 
-		case IROp::ApplyRoundingMode:
+		IR_CASE(ApplyRoundingMode)
 			IRApplyRounding(mips);
-			break;
-		case IROp::RestoreRoundingMode:
+			IR_NEXT();
+		IR_CASE(RestoreRoundingMode)
 			IRRestoreRounding();
-			break;
-		case IROp::UpdateRoundingMode:
+			IR_NEXT();
+		IR_CASE(UpdateRoundingMode)
 			// TODO: Implement
-			break;
+			IR_NEXT();
 
-		case IROp::Break:
+		IR_CASE(Break)
 			Core_BreakException(mips->pc);
 			return mips->pc + 4;
 
-		case IROp::Breakpoint:
+		IR_CASE(Breakpoint)
 			if (IRRunBreakpoint(inst->constant)) {
 				CoreTiming::ForceCheck();
 				return mips->pc;
 			}
-			break;
+			IR_NEXT();
 
-		case IROp::MemoryCheck:
+		IR_CASE(MemoryCheck)
 			if (IRRunMemCheck(mips->pc + inst->dest, mips->r[inst->src1] + inst->constant)) {
 				CoreTiming::ForceCheck();
 				return mips->pc;
 			}
-			break;
+			IR_NEXT();
 
-		case IROp::ValidateAddress8:
+		IR_CASE(IdleLoop)
+			IRRunIdleLoop(inst->constant);
+			IR_NEXT();
+
+		IR_CASE(ValidateAddress8)
 			if (RunValidateAddress<1>(mips->pc, mips->r[inst->src1] + inst->constant, inst->src2)) {
 				CoreTiming::ForceCheck();
 				return mips->pc;
 			}
-			break;
-		case IROp::ValidateAddress16:
+			IR_NEXT();
+		IR_CASE(ValidateAddress16)
 			if (RunValidateAddress<2>(mips->pc, mips->r[inst->src1] + inst->constant, inst->src2)) {
 				CoreTiming::ForceCheck();
 				return mips->pc;
 			}
-			break;
-		case IROp::ValidateAddress32:
+			IR_NEXT();
+		IR_CASE(ValidateAddress32)
 			if (RunValidateAddress<4>(mips->pc, mips->r[inst->src1] + inst->constant, inst->src2)) {
 				CoreTiming::ForceCheck();
 				return mips->pc;
 			}
-			break;
-		case IROp::ValidateAddress128:
+			IR_NEXT();
+		IR_CASE(ValidateAddress128)
 			if (RunValidateAddress<16>(mips->pc, mips->r[inst->src1] + inst->constant, inst->src2)) {
 				CoreTiming::ForceCheck();
 				return mips->pc;
 			}
-			break;
-		case IROp::LogIRBlock:
+			IR_NEXT();
+		IR_CASE(LogIRBlock)
 			if (mipsTracer.tracing_enabled) {
-				mipsTracer.executed_blocks.push_back(inst->constant);
+				mipsTracer.log_block(inst->constant);
 			}
-			break;
+			IR_NEXT();
 
-		case IROp::Nop: // TODO: This shouldn't crash, but for now we should not emit nops, so...
-		case IROp::Bad:
+		IR_CASE(Nop) // TODO: This shouldn't crash, but for now we should not emit nops, so...
+		IR_CASE(Bad)
 		default:
 			// Unimplemented IR op. Bad. We define it as unreachable so the compiler can optimize better (remove the range check).
 			UNREACHABLE();
-			break;
+			IR_NEXT();
 		}
 
 #ifdef _DEBUG
@@ -1313,8 +1559,48 @@ u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
 			Crash();
 #endif
 		inst++;
+#ifdef IR_THREADED_DISPATCH
+		if constexpr (threaded) {
+			// Also reached by ops that break out early, so keep the handler stream in sync here.
+			++handler;
+			goto **handler;
+		}
+#endif
 	}
 
 	// We should not reach here anymore.
 	return 0;
 }
+
+#ifdef IR_THREADED_DISPATCH
+#pragma GCC diagnostic pop
+#endif
+
+u32 IRInterpret(MIPSState *mips, const IRInst *inst) {
+	return IRInterpretImpl<false>(mips, inst, nullptr);
+}
+
+bool IRThreadedDispatchAvailable() {
+#ifdef IR_THREADED_DISPATCH
+	return true;
+#else
+	return false;
+#endif
+}
+
+void IRTranslateToHandlers(const IRInst *inst, size_t count, const void **handlers) {
+#ifdef IR_THREADED_DISPATCH
+	static const bool initialized = (IRInterpretImpl<true>(nullptr, nullptr, nullptr), true);
+	(void)initialized;
+	for (size_t i = 0; i < count; ++i)
+		handlers[i] = irHandlers[(int)inst[i].op];
+#endif
+}
+
+u32 IRInterpretThreaded(MIPSState *mips, const IRInst *inst, const void *const *handlers) {
+#ifdef IR_THREADED_DISPATCH
+	return IRInterpretImpl<true>(mips, inst, handlers);
+#else
+	return IRInterpretImpl<false>(mips, inst, nullptr);
+#endif
+}
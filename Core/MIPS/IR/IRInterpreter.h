@@ -9,8 +9,18 @@ struct IRInst;
 
 u32 IRRunBreakpoint(u32 pc);
 u32 IRRunMemCheck(u32 pc, u32 addr);
+// Skips ahead to the next CoreTiming event, from the idle polling loop at pc.
+void IRRunIdleLoop(u32 pc);
+u64 IRGetIdleLoopSkippedCycles(u32 pc);
+void IRResetIdleLoopStats();
 u32 IRInterpret(MIPSState *ms, const IRInst *inst);
 
+// Alternative dispatch using computed goto, where supported by the compiler.
+// The IR is first translated to a parallel stream of handler addresses, one per instruction.
+bool IRThreadedDispatchAvailable();
+void IRTranslateToHandlers(const IRInst *inst, size_t count, const void **handlers);
+u32 IRInterpretThreaded(MIPSState *ms, const IRInst *inst, const void *const *handlers);
+
 void IRApplyRounding();
 void IRRestoreRounding();
 
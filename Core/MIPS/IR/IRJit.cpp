@@ -22,6 +22,7 @@
 #include "ext/xxhash.h"
 #include "Common/Profiler/Profiler.h"
 
+#include "Common/File/FileUtil.h"
 #include "Common/Log.h"
 #include "Common/Serialize/Serializer.h"
 #include "Common/StringUtils.h"
@@ -29,6 +30,10 @@
 #include "Core/Config.h"
 #include "Core/Core.h"
 #include "Core/CoreTiming.h"
+#include "Core/System.h"
+#include "Core/Debugger/Breakpoints.h"
+#include "Core/Debugger/SymbolMap.h"
+#include "Core/ELF/ParamSFO.h"
 #include "Core/HLE/sceKernelMemory.h"
 #include "Core/MemMap.h"
 #include "Core/MIPS/MIPS.h"
@@ -40,6 +45,7 @@
 #include "Core/MIPS/IR/IRJit.h"
 #include "Core/MIPS/IR/IRNativeCommon.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
+#include "Core/MIPS/JitCommon/JitWriteProtect.h"
 #include "Core/Reporting.h"
 #include "Common/TimeUtil.h"
 #include "Core/MIPS/MIPSTracer.h"
@@ -47,6 +53,15 @@
 
 namespace MIPSComp {
 
+static u64 IRDiskCacheFingerprint(const IROptions &opts) {
+	// Anything that changes the IR we generate for the same MIPS code must go in here.
+	// The IR opcode numbering is covered by the version string.
+	std::string key = StringFromFormat("%s|%08x|%d%d%d%d%d%d%d%d%d%d%d%d%d", PPSSPP_GIT_VERSION, opts.disableFlags,
+		opts.unalignedLoadStore, opts.unalignedLoadStoreVec4, opts.preferVec4, opts.preferVec4Dot, opts.optimizeForInterpreter, opts.superblocks,
+		opts.reorderLoadStore, opts.mergeLoadStore, opts.threeOpToTwoOp, opts.functionRegions, opts.vectorizeFloats, opts.idleLoops, opts.directSyscalls);
+	return XXH3_64bits(key.data(), key.size());
+}
+
 IRJit::IRJit(MIPSState *mipsState, bool actualJit) : frontend_(mipsState->HasDefaultPrefix()), mips_(mipsState), blocks_(actualJit) {
 	// u32 size = 128 * 1024;
 	InitIR();
@@ -74,10 +89,47 @@ IRJit::IRJit(MIPSState *mipsState, bool actualJit) : frontend_(mipsState->HasDef
 	opts.preferVec4 = true;
 #endif
 	opts.optimizeForInterpreter = jo.optimizeForInterpreter;
+	// The native jits only use the interpreter for cold blocks, if at all.
+	threadedDispatch_ = !actualJit && g_Config.bIRThreadedDispatch && IRThreadedDispatchAvailable();
+	blocks_.EnableThreadedDispatch(threadedDispatch_);
+	opts.superblocks = g_Config.bIRSuperblocks;
+	opts.functionRegions = g_Config.bIRFunctionRegions;
+	functionRegions_ = opts.functionRegions;
+	opts.idleLoops = g_Config.bIRIdleLoops;
+	// The native jits get through the block exit and dispatch about as fast as the direct call, so only the interpreter gains.
+	opts.directSyscalls = g_Config.bIRDirectSyscalls && !actualJit;
+	// Groups loads/stores by base and offset, then combines adjacent ones.
+	opts.reorderLoadStore = (opts.disableFlags & (uint32_t)JitDisable::LSU) == 0;
+	opts.mergeLoadStore = (opts.disableFlags & (uint32_t)JitDisable::LSU) == 0;
+	// None of the backends currently benefit from this.
+	opts.threeOpToTwoOp = false;
+	// Only worth it where Vec4 ops are native.
+	opts.vectorizeFloats = opts.preferVec4 && (opts.disableFlags & (uint32_t)JitDisable::SIMD) == 0;
 	frontend_.SetOptions(opts);
+#ifdef IR_PROFILING
+	if (opts.superblocks) {
+		// Let superblock formation follow the hot path, based on how often existing blocks ran.
+		frontend_.SetBlockExecutionCountFunc([this](u32 addr) -> int64_t {
+			int blockNum = blocks_.GetBlockNumberFromStartAddress(addr);
+			if (blockNum < 0)
+				return -1;
+			return blocks_.GetBlock(blockNum)->profileStats_.executions;
+		});
+	}
+#endif
+
+	std::string discID = g_paramSFO.GetDiscID();
+	if (g_Config.bIRBlockCache && !discID.empty()) {
+		File::CreateFullPath(GetSysDirectory(DIRECTORY_APP_CACHE));
+		Path cachePath = GetSysDirectory(DIRECTORY_APP_CACHE) / (discID + (actualJit ? ".irjitcache" : ".ircache"));
+		blocks_.EnableDiskCache(cachePath, IRDiskCacheFingerprint(opts));
+	}
 }
 
 IRJit::~IRJit() {
+	if (blocks_.DiskCacheEnabled()) {
+		blocks_.SaveDiskCache(frontend_.GetStateFlags());
+	}
 }
 
 void IRJit::DoState(PointerWrap &p) {
@@ -89,6 +141,8 @@ void IRJit::UpdateFCR31() {
 
 void IRJit::ClearCache() {
 	INFO_LOG(Log::JIT, "IRJit: Clearing the block cache!");
+	frontend_.LogAndResetPassStats();
+	IRResetIdleLoopStats();
 	blocks_.Clear();
 }
 
@@ -136,7 +190,13 @@ void IRJit::Compile(u32 em_address) {
 bool IRJit::CompileBlock(u32 em_address, std::vector<IRInst> &instructions, u32 &mipsBytes) {
 	_dbg_assert_(compilerEnabled_);
 
-	frontend_.DoJit(em_address, instructions, mipsBytes);
+	bool fromDiskCache = false;
+	if (blocks_.DiskCacheEnabled() && !mipsTracer.tracing_enabled) {
+		fromDiskCache = blocks_.TakeDiskCacheBlock(em_address, frontend_.GetStateFlags(), instructions, mipsBytes);
+	}
+	if (!fromDiskCache) {
+		frontend_.DoJit(em_address, instructions, mipsBytes);
+	}
 	_dbg_assert_(!instructions.empty());
 
 	int block_num = blocks_.AllocateBlock(em_address, mipsBytes, instructions);
@@ -147,9 +207,11 @@ bool IRJit::CompileBlock(u32 em_address, std::vector<IRInst> &instructions, u32
 	}
 
 	IRBlock *b = blocks_.GetBlock(block_num);
-	if (mipsTracer.tracing_enabled) {
+	if (functionRegions_)
+		b->SetFunctionEntry(g_symbolMap->GetFunctionStart(em_address) == em_address);
+	if (mipsTracer.tracing_enabled || blocks_.DiskCacheEnabled()) {
 		// Hash, then only update page stats, don't link yet.
-		// TODO: Should we always hash?  Then we can reuse blocks.
+		// The disk cache needs the hash to validate the block on the next boot.
 		b->UpdateHash();
 	}
 
@@ -166,6 +228,14 @@ bool IRJit::CompileBlock(u32 em_address, std::vector<IRInst> &instructions, u32
 	return true;
 }
 
+inline u32 IRJit::InterpretInstructions(MIPSState *mips, const IRInst *instPtr) {
+	if (threadedDispatch_) {
+		const void *const *handlers = blocks_.GetHandlerArenaPtr() + (instPtr - blocks_.GetArenaPtr());
+		return IRInterpretThreaded(mips, instPtr, handlers);
+	}
+	return IRInterpret(mips, instPtr);
+}
+
 void IRJit::RunLoopUntil(u64 globalticks) {
 	PROFILE_THIS_SCOPE("jit");
 
@@ -196,15 +266,20 @@ void IRJit::RunLoopUntil(u64 globalticks) {
 					mips->downcount -= instPtr->constant;
 					instPtr++;
 				}
+				numDispatches_++;
+				if (functionRegions_) {
+					// Costs a lookup per dispatch, but this mode is mostly for measuring anyway.
+					numFunctionEntryDispatches_ += blocks_.GetBlockUnchecked(blocks_.GetBlockNumFromIRArenaOffset(offset))->IsFunctionEntry() ? 1 : 0;
+				}
 #ifdef IR_PROFILING
 				IRBlock *block = blocks_.GetBlock(blocks_.GetBlockNumFromIRArenaOffset(offset));
 				Instant start = Instant::Now();
-				mips->pc = IRInterpret(mips, instPtr);
+				mips->pc = InterpretInstructions(mips, instPtr);
 				int64_t elapsedNanos = start.ElapsedNanos();
 				block->profileStats_.executions += 1;
 				block->profileStats_.totalNanos += elapsedNanos;
 #else
-				mips->pc = IRInterpret(mips, instPtr);
+				mips->pc = InterpretInstructions(mips, instPtr);
 #endif
 				// Note: this will "jump to zero" on a badly constructed block missing exits.
 				if (!Memory::IsValid4AlignedAddress(mips->pc)) {
@@ -252,9 +327,12 @@ void IRBlockCache::Clear() {
 		blocks_[i].Destroy(cookie);
 	}
 	blocks_.clear();
-	byPage_.clear();
+	pageIndex_.Clear();
+	JitWriteProtect::Reset();
 	arena_.clear();
 	arena_.shrink_to_fit();
+	handlerArena_.clear();
+	handlerArena_.shrink_to_fit();
 }
 
 IRBlockCache::IRBlockCache(bool compileToNative) : compileToNative_(compileToNative) {}
@@ -271,6 +349,10 @@ int IRBlockCache::AllocateBlock(int emAddr, u32 origSize, const std::vector<IRIn
 	for (int i = 0; i < insts.size(); i++) {
 		arena_.push_back(insts[i]);
 	}
+	if (threadedDispatch_) {
+		handlerArena_.resize(arena_.size());
+		IRTranslateToHandlers(insts.data(), insts.size(), handlerArena_.data() + offset);
+	}
 	int newBlockIndex = (int)blocks_.size();
 	blocks_.push_back(IRBlock(emAddr, origSize, offset, (u32)insts.size()));
 	return newBlockIndex;
@@ -311,24 +393,9 @@ int IRBlockCache::GetBlockNumFromIRArenaOffset(int offset) const {
 }
 
 std::vector<int> IRBlockCache::FindInvalidatedBlockNumbers(u32 address, u32 lengthInBytes) {
-	u32 startPage = AddressToPage(address);
-	u32 endPage = AddressToPage(address + lengthInBytes);
-
 	std::vector<int> found;
-	for (u32 page = startPage; page <= endPage; ++page) {
-		const auto iter = byPage_.find(page);
-		if (iter == byPage_.end())
-			continue;
-
-		const std::vector<int> &blocksInPage = iter->second;
-		for (int i : blocksInPage) {
-			if (blocks_[i].OverlapsRange(address, lengthInBytes)) {
-				// We now try to remove these during invalidation.
-				found.push_back(i);
-			}
-		}
-	}
-
+	// We now try to remove these during invalidation.
+	pageIndex_.FindOverlapping(address, lengthInBytes, found);
 	return found;
 }
 
@@ -341,33 +408,21 @@ void IRBlockCache::FinalizeBlock(int blockIndex) {
 	u32 startAddr, size;
 	block.GetRange(&startAddr, &size);
 
-	u32 startPage = AddressToPage(startAddr);
-	u32 endPage = AddressToPage(startAddr + size);
-
-	for (u32 page = startPage; page <= endPage; ++page) {
-		byPage_[page].push_back(blockIndex);
-	}
+	pageIndex_.Add(blockIndex, startAddr, size);
+	JitWriteProtect::OnBlockFinalized(startAddr, size);
 }
 
 // Call after Destroy-ing it.
 void IRBlockCache::RemoveBlockFromPageLookup(int blockIndex) {
-	// We need to remove the block from the byPage lookup.
+	// We need to remove the block from the page index.
 	IRBlock &block = blocks_[blockIndex];
 
 	u32 startAddr, size;
 	block.GetRange(&startAddr, &size);
 
-	u32 startPage = AddressToPage(startAddr);
-	u32 endPage = AddressToPage(startAddr + size);
-
-	for (u32 page = startPage; page <= endPage; ++page) {
-		auto iter = std::find(byPage_[page].begin(), byPage_[page].end(), blockIndex);
-		if (iter != byPage_[page].end()) {
-			byPage_[page].erase(iter);
-		} else if (block.IsValid()) {
-			// If it was previously invalidated, we don't care, hence the above check.
-			WARN_LOG(Log::JIT, "RemoveBlock: Block at %08x was not found where expected in byPage table.", startAddr);
-		}
+	if (!pageIndex_.Remove(blockIndex, startAddr, size) && block.IsValid()) {
+		// If it was previously invalidated, we don't care, hence the above check.
+		WARN_LOG(Log::JIT, "RemoveBlock: Block at %08x was not found where expected in page index.", startAddr);
 	}
 
 	// Additionally, we'd like to zap the block in the IR arena.
@@ -380,27 +435,14 @@ void IRBlockCache::RemoveBlockFromPageLookup(int blockIndex) {
 	*/
 }
 
-u32 IRBlockCache::AddressToPage(u32 addr) const {
-	// Use relatively small pages since basic blocks are typically small.
-	return (addr & 0x3FFFFFFF) >> 10;
-}
-
 int IRBlockCache::FindPreloadBlock(u32 em_address) {
-	u32 page = AddressToPage(em_address);
-	auto iter = byPage_.find(page);
-	if (iter == byPage_.end())
-		return -1;
-
-	const std::vector<int> &blocksInPage = iter->second;
-	for (int i : blocksInPage) {
-		if (blocks_[i].GetOriginalStart() == em_address) {
-			if (blocks_[i].HashMatches()) {
-				return i;
-			}
+	int found = -1;
+	pageIndex_.ForEachInPage(em_address, [&](int i) {
+		if (found == -1 && blocks_[i].GetOriginalStart() == em_address && blocks_[i].HashMatches()) {
+			found = i;
 		}
-	}
-
-	return -1;
+	});
+	return found;
 }
 
 int IRBlockCache::FindByCookie(int cookie) {
@@ -509,25 +551,197 @@ void IRBlockCache::ComputeStats(BlockCacheStats &bcStats) const {
 	bcStats.minBloat = minBloat;
 	bcStats.maxBloat = maxBloat;
 	bcStats.avgBloat = totalBloat / (double)blocks_.size();
+	bcStats.diskCacheHits = diskCacheStats_.hits;
+	bcStats.diskCacheMisses = diskCacheStats_.misses;
+	bcStats.diskCacheInvalidated = diskCacheStats_.invalidated;
+	bcStats.lookupMemoryBytes = GetLookupMemoryUsage();
+	ComputeIdleLoopStats(bcStats);
 }
 
-int IRBlockCache::GetBlockNumberFromStartAddress(u32 em_address) const {
-	u32 page = AddressToPage(em_address);
+void IRBlockCache::ComputeIdleLoopStats(BlockCacheStats &bcStats) const {
+	for (const auto &b : blocks_) {
+		u64 idleCycles = IRGetIdleLoopSkippedCycles(b.GetOriginalStart());
+		if (idleCycles == 0)
+			continue;
+		bcStats.idleLoopBlocks++;
+		bcStats.idleSkippedCycles += idleCycles;
+		if (idleCycles > bcStats.maxIdleSkippedCycles) {
+			bcStats.maxIdleSkippedCycles = idleCycles;
+			bcStats.maxIdleSkippedBlock = b.GetOriginalStart();
+		}
+	}
+}
 
-	const auto iter = byPage_.find(page);
-	if (iter == byPage_.end())
-		return -1;
+#define IR_DISK_CACHE_MAGIC 0x43425249  // "IRBC"
+#define IR_DISK_CACHE_VERSION 1
+
+struct IRDiskCacheHeader {
+	u32 magic;
+	u32 version;
+	u64 fingerprint;
+	u32 stateFlags;
+	u32 numBlocks;
+	u32 numIRInstructions;
+	u32 reserved;
+};
+
+struct IRDiskCacheBlockHeader {
+	u32 origAddr;
+	u32 origSize;
+	u64 hash;
+	u32 arenaOffset;
+	u32 numIRInstructions;
+};
 
-	const std::vector<int> &blocksInPage = iter->second;
+static_assert(sizeof(IRInst) == 8, "IRInst is written directly to the disk cache");
+
+void IRBlockCache::EnableDiskCache(const Path &filename, u64 fingerprint) {
+	diskCachePath_ = filename;
+	diskCacheFingerprint_ = fingerprint;
+	diskCache_.clear();
+	diskCacheArena_.clear();
+	diskCacheStats_ = {};
+
+	FILE *f = File::OpenCFile(filename, "rb");
+	if (!f)
+		return;
+
+	IRDiskCacheHeader header{};
+	bool success = fread(&header, sizeof(header), 1, f) == 1;
+	if (!success || header.magic != IR_DISK_CACHE_MAGIC || header.version != IR_DISK_CACHE_VERSION) {
+		WARN_LOG(Log::JIT, "IR block cache: bad header or version in %s, ignoring", filename.c_str());
+		fclose(f);
+		return;
+	}
+	if (header.fingerprint != fingerprint) {
+		// Different build or IR options, nothing in there is usable.
+		INFO_LOG(Log::JIT, "IR block cache: fingerprint mismatch, ignoring %s", filename.c_str());
+		fclose(f);
+		return;
+	}
+
+	std::vector<IRDiskCacheBlockHeader> entries(header.numBlocks);
+	diskCacheArena_.resize(header.numIRInstructions);
+	success = header.numBlocks == 0 || fread(&entries[0], sizeof(IRDiskCacheBlockHeader), header.numBlocks, f) == header.numBlocks;
+	success = success && (header.numIRInstructions == 0 || fread(&diskCacheArena_[0], sizeof(IRInst), header.numIRInstructions, f) == header.numIRInstructions);
+	fclose(f);
+
+	if (!success) {
+		ERROR_LOG(Log::JIT, "IR block cache truncated: %s", filename.c_str());
+		diskCacheArena_.clear();
+		return;
+	}
+
+	for (const IRDiskCacheBlockHeader &entry : entries) {
+		if (entry.numIRInstructions == 0 || entry.arenaOffset + (u64)entry.numIRInstructions > diskCacheArena_.size() || (entry.origSize & 3) != 0) {
+			ERROR_LOG(Log::JIT, "IR block cache: bad block at %08x, ignoring the cache", entry.origAddr);
+			diskCache_.clear();
+			diskCacheArena_.clear();
+			return;
+		}
+		diskCache_[entry.origAddr] = IRDiskCacheEntry{ entry.hash, entry.origSize, entry.arenaOffset, entry.numIRInstructions };
+	}
+	diskCacheStateFlags_ = header.stateFlags;
+	diskCacheStats_.loaded = (int)diskCache_.size();
+	NOTICE_LOG(Log::JIT, "IR block cache: loaded %d blocks (%d IR instructions) from %s", diskCacheStats_.loaded, (int)diskCacheArena_.size(), filename.c_str());
+}
+
+bool IRBlockCache::TakeDiskCacheBlock(u32 em_address, u32 stateFlags, std::vector<IRInst> &instructions, u32 &mipsBytes) {
+	auto iter = diskCache_.find(em_address);
+	if (iter == diskCache_.end()) {
+		diskCacheStats_.misses++;
+		return false;
+	}
+
+	const IRDiskCacheEntry entry = iter->second;
+	if (g_breakpoints.HasMemChecks() || g_breakpoints.RangeContainsBreakPoint(em_address, entry.origSize)) {
+		// The frontend needs to compile in the checks. Keep the entry for later.
+		diskCacheStats_.misses++;
+		return false;
+	}
+
+	// Either way, we won't look at this one again - the block we end up with will be saved instead.
+	diskCache_.erase(iter);
+	if (stateFlags != diskCacheStateFlags_ || !Memory::IsValidRange(em_address, entry.origSize) || IRBlock::CalculateHash(em_address, entry.origSize) != entry.hash) {
+		diskCacheStats_.invalidated++;
+		return false;
+	}
+
+	const IRInst *start = diskCacheArena_.data() + entry.arenaOffset;
+	instructions.assign(start, start + entry.numIRInstructions);
+	mipsBytes = entry.origSize;
+	diskCacheStats_.hits++;
+	return true;
+}
+
+void IRBlockCache::SaveDiskCache(u32 stateFlags) {
+	IRDiskCacheHeader header{};
+	header.magic = IR_DISK_CACHE_MAGIC;
+	header.version = IR_DISK_CACHE_VERSION;
+	header.fingerprint = diskCacheFingerprint_;
+	header.stateFlags = stateFlags;
+
+	std::vector<IRDiskCacheBlockHeader> entries;
+	std::vector<IRInst> arena;
+	auto addBlock = [&](u32 addr, u32 size, u64 hash, const IRInst *inst, u32 count) {
+		for (u32 i = 0; i < count; ++i) {
+			// Blocks with compiled-in breakpoints or memchecks are not reusable.
+			if (inst[i].op == IROp::Breakpoint || inst[i].op == IROp::MemoryCheck)
+				return;
+		}
+		entries.push_back(IRDiskCacheBlockHeader{ addr, size, hash, (u32)arena.size(), count });
+		arena.insert(arena.end(), inst, inst + count);
+	};
+
+	for (const IRBlock &b : blocks_) {
+		if (!b.IsValid() || b.GetHash() == 0)
+			continue;
+		u32 addr, size;
+		b.GetRange(&addr, &size);
+		addBlock(addr, size, b.GetHash(), GetBlockInstructionPtr(b), (u32)b.GetNumIRInstructions());
+	}
+	// Keep what we loaded but never reached this run, if it's still compatible.
+	if (stateFlags == diskCacheStateFlags_) {
+		for (const auto &iter : diskCache_) {
+			const IRDiskCacheEntry &entry = iter.second;
+			addBlock(iter.first, entry.origSize, entry.hash, diskCacheArena_.data() + entry.arenaOffset, entry.numIRInstructions);
+		}
+	}
+
+	header.numBlocks = (u32)entries.size();
+	header.numIRInstructions = (u32)arena.size();
+
+	FILE *f = File::OpenCFile(diskCachePath_, "wb");
+	if (!f)
+		return;
+	bool writeFailed = fwrite(&header, sizeof(header), 1, f) != 1;
+	writeFailed = writeFailed || (!entries.empty() && fwrite(&entries[0], sizeof(IRDiskCacheBlockHeader), entries.size(), f) != entries.size());
+	writeFailed = writeFailed || (!arena.empty() && fwrite(&arena[0], sizeof(IRInst), arena.size(), f) != arena.size());
+	fclose(f);
+
+	if (writeFailed) {
+		ERROR_LOG(Log::JIT, "Failed to write IR block cache, disk full?");
+		File::Delete(diskCachePath_);
+	} else {
+		NOTICE_LOG(Log::JIT, "IR block cache: saved %d blocks. This run: %d hits, %d misses, %d invalidated (of %d loaded)",
+			(int)entries.size(), diskCacheStats_.hits, diskCacheStats_.misses, diskCacheStats_.invalidated, diskCacheStats_.loaded);
+	}
+}
+
+int IRBlockCache::GetBlockNumberFromStartAddress(u32 em_address) const {
 	int best = -1;
-	for (int i : blocksInPage) {
-		if (blocks_[i].GetOriginalStart() == em_address) {
+	bool bestValid = false;
+	pageIndex_.ForEachInPage(em_address, [&](int i) {
+		// Prefer a valid block, otherwise the newest (highest numbered) invalid one.
+		if (bestValid || blocks_[i].GetOriginalStart() != em_address)
+			return;
+		if (blocks_[i].IsValid()) {
+			best = i;
+			bestValid = true;
+		} else if (i > best) {
 			best = i;
-			if (blocks_[i].IsValid()) {
-				return i;
-			}
 		}
-	}
+	});
 	return best;
 }
 
@@ -572,19 +786,19 @@ void IRBlock::Destroy(int cookie) {
 	}
 }
 
-u64 IRBlock::CalculateHash() const {
-	if (origAddr_) {
+u64 IRBlock::CalculateHash(u32 addr, u32 size) {
+	if (addr) {
 		// This is unfortunate. In case there are emuhacks, we have to make a copy.
 		// If we could hash while reading we could avoid this.
 		std::vector<u32> buffer;
-		buffer.resize(origSize_ / 4);
+		buffer.resize(size / 4);
 		size_t pos = 0;
-		for (u32 off = 0; off < origSize_; off += 4) {
+		for (u32 off = 0; off < size; off += 4) {
 			// Let's actually hash the replacement, if any.
-			MIPSOpcode instr = Memory::ReadUnchecked_Instruction(origAddr_ + off, false);
+			MIPSOpcode instr = Memory::ReadUnchecked_Instruction(addr + off, false);
 			buffer[pos++] = instr.encoding;
 		}
-		return XXH3_64bits(&buffer[0], origSize_);
+		return XXH3_64bits(&buffer[0], size);
 	}
 	return 0;
 }
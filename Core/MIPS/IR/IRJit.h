@@ -22,6 +22,7 @@
 
 #include "Common/CommonTypes.h"
 #include "Common/CPUDetect.h"
+#include "Common/File/Path.h"
 #include "Core/MIPS/JitCommon/JitBlockCache.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
 #include "Core/MIPS/IR/IRRegCache.h"
@@ -60,6 +61,7 @@ class IRBlock {
 		origFirstOpcode_ = b.origFirstOpcode_;
 		nativeOffset_ = b.nativeOffset_;
 		numIRInstructions_ = b.numIRInstructions_;
+		isFunctionEntry_ = b.isFunctionEntry_;
 		b.arenaOffset_ = 0xFFFFFFFF;
 	}
 
@@ -95,6 +97,14 @@ class IRBlock {
 	u64 GetHash() const {
 		return hash_;
 	}
+	// Starts at the entry point of a known function, only tracked with function regions.
+	void SetFunctionEntry(bool entry) {
+		isFunctionEntry_ = entry;
+	}
+	bool IsFunctionEntry() const {
+		return isFunctionEntry_;
+	}
+	static u64 CalculateHash(u32 addr, u32 size);
 
 	void Finalize(int number);
 	void Destroy(int number);
@@ -104,7 +114,9 @@ class IRBlock {
 #endif
 
 private:
-	u64 CalculateHash() const;
+	u64 CalculateHash() const {
+		return CalculateHash(origAddr_, origSize_);
+	}
 
 	// Offset into the block cache's Arena
 	u32 arenaOffset_ = 0;
@@ -115,6 +127,22 @@ class IRBlock {
 	u32 origSize_ = 0;
 	MIPSOpcode origFirstOpcode_ = MIPSOpcode(0x68FFFFFF);
 	u32 numIRInstructions_ = 0;
+	bool isFunctionEntry_ = false;
+};
+
+// A block from the on-disk cache, waiting to be adopted if the MIPS code still matches.
+struct IRDiskCacheEntry {
+	u64 hash;
+	u32 origSize;
+	u32 arenaOffset;
+	u32 numIRInstructions;
+};
+
+struct IRDiskCacheStats {
+	int loaded;
+	int hits;
+	int misses;
+	int invalidated;
 };
 
 class IRBlockCache : public JitBlockCacheDebugInterface {
@@ -147,6 +175,13 @@ class IRBlockCache : public JitBlockCacheDebugInterface {
 	const IRInst *GetArenaPtr() const {
 		return arena_.data();
 	}
+	// Parallel to the arena when threaded dispatch is enabled, see IRTranslateToHandlers.
+	void EnableThreadedDispatch(bool enable) {
+		threadedDispatch_ = enable;
+	}
+	const void *const *GetHandlerArenaPtr() const {
+		return handlerArena_.data();
+	}
 	bool IsValidBlock(int blockNum) const override {
 		return blockNum >= 0 && blockNum < (int)blocks_.size() && blocks_[blockNum].IsValid();
 	}
@@ -169,6 +204,14 @@ class IRBlockCache : public JitBlockCacheDebugInterface {
 	std::vector<u32> SaveAndClearEmuHackOps();
 	void RestoreSavedEmuHackOps(const std::vector<u32> &saved);
 
+	// Persistent cache of post-optimization IR. The fingerprint identifies the build and
+	// IR options, the state flags the frontend state the blocks were compiled under.
+	void EnableDiskCache(const Path &filename, u64 fingerprint);
+	bool DiskCacheEnabled() const { return !diskCachePath_.empty(); }
+	bool TakeDiskCacheBlock(u32 em_address, u32 stateFlags, std::vector<IRInst> &instructions, u32 &mipsBytes);
+	void SaveDiskCache(u32 stateFlags);
+	const IRDiskCacheStats &GetDiskCacheStats() const { return diskCacheStats_; }
+
 	JitBlockDebugInfo GetBlockDebugInfo(int blockNum) const override;
 	JitBlockMeta GetBlockMeta(int blockNum) const override {
 		JitBlockMeta meta{};
@@ -186,7 +229,12 @@ class IRBlockCache : public JitBlockCacheDebugInterface {
 #endif
 	}
 	void ComputeStats(BlockCacheStats &bcStats) const override;
+	// Fills in the idle loop fields, shared with the native jits' stats.
+	void ComputeIdleLoopStats(BlockCacheStats &bcStats) const;
 	int GetBlockNumberFromStartAddress(u32 em_address) const override;
+	size_t GetLookupMemoryUsage() const {
+		return pageIndex_.MemoryUsage();
+	}
 
 	bool SupportsProfiling() const override {
 #ifdef IR_PROFILING
@@ -197,11 +245,21 @@ class IRBlockCache : public JitBlockCacheDebugInterface {
 	}
 
 private:
-	u32 AddressToPage(u32 addr) const;
 	bool compileToNative_;
 	std::vector<IRBlock> blocks_;
 	std::vector<IRInst> arena_;
-	std::unordered_map<u32, std::vector<int>> byPage_;
+	bool threadedDispatch_ = false;
+	std::vector<const void *> handlerArena_;
+	// Block ranges by page, for invalidation and start address lookups.
+	JitBlockPageIndex pageIndex_{ 0x3FFFFFFF };
+
+	Path diskCachePath_;
+	u64 diskCacheFingerprint_ = 0;
+	u32 diskCacheStateFlags_ = 0;
+	// Blocks loaded from disk that have not been looked up yet, by start address.
+	std::unordered_map<u32, IRDiskCacheEntry> diskCache_;
+	std::vector<IRInst> diskCacheArena_;
+	IRDiskCacheStats diskCacheStats_{};
 };
 
 class IRJit : public JitInterface {
@@ -243,10 +301,16 @@ class IRJit : public JitInterface {
 	// This gets overridden by the native-backed IR jits.
 	const u8 *GetCodeBase() const override { return nullptr; }
 
+	// Number of blocks entered by the IR interpreter dispatcher.
+	u64 GetNumDispatches() const { return numDispatches_; }
+	// Of those, how many started at a function entry. Only counted with function regions.
+	u64 GetNumFunctionEntryDispatches() const { return numFunctionEntryDispatches_; }
+
 protected:
 	bool CompileBlock(u32 em_address, std::vector<IRInst> &instructions, u32 &mipsBytes);
 	virtual bool CompileNativeBlock(IRBlockCache *irBlockCache, int block_num) { return true; }
 	virtual void FinalizeNativeBlock(IRBlockCache *irBlockCache, int block_num) {}
+	u32 InterpretInstructions(MIPSState *mips, const IRInst *instPtr);
 
 	bool compileToNative_;
 
@@ -258,6 +322,10 @@ class IRJit : public JitInterface {
 	MIPSState *mips_;
 
 	bool compilerEnabled_ = true;
+	bool threadedDispatch_ = false;
+	bool functionRegions_ = false;
+	u64 numDispatches_ = 0;
+	u64 numFunctionEntryDispatches_ = 0;
 
 	// where to write branch-likely trampolines. not used atm
 	// u32 blTrampolines_;
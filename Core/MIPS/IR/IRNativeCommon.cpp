@@ -15,16 +15,21 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
 #include <atomic>
 #include <climits>
 #include <thread>
 #include "Common/Profiler/Profiler.h"
 #include "Common/StringUtils.h"
 #include "Common/TimeUtil.h"
+#include "Core/Config.h"
 #include "Core/Core.h"
+#include "Core/Debugger/Breakpoints.h"
 #include "Core/Debugger/SymbolMap.h"
 #include "Core/MemMap.h"
 #include "Core/MIPS/MIPSTables.h"
+#include "Core/MIPS/JitCommon/JitPerfMap.h"
+#include "Core/MIPS/MIPSTracer.h"
 #include "Core/MIPS/IR/IRNativeCommon.h"
 
 using namespace MIPSComp;
@@ -450,6 +455,11 @@ void IRNativeBackend::CompileIRInst(IRInst inst) {
 		CompIR_Breakpoint(inst);
 		break;
 
+	case IROp::IdleLoop:
+		// Rare and already slow, so no need for native code.
+		CompIR_Generic(inst);
+		break;
+
 	case IROp::ValidateAddress8:
 	case IROp::ValidateAddress16:
 	case IROp::ValidateAddress32:
@@ -482,12 +492,20 @@ void IRNativeBackend::CompileIRInst(IRInst inst) {
 }
 
 IRNativeJit::IRNativeJit(MIPSState *mipsState)
-	: IRJit(mipsState, true), debugInterface_(blocks_) {}
+	: IRJit(mipsState, true), debugInterface_(blocks_) {
+	coldBlockRuns_ = std::max(g_Config.iJitColdBlockRuns, 0);
+}
 
 void IRNativeJit::Init(IRNativeBackend &backend) {
 	backend_ = &backend;
 	debugInterface_.Init(backend_);
 	backend_->GenerateFixedCode(mips_);
+	if (JitPerfMap::IsEnabled()) {
+		const IRNativeBackend *backend = backend_;
+		JitPerfMap::RegisterFixedCode(backend->CodeBlock().GetBasePtr(), backend->CodeBlock().GetCodePtr(), [backend](const u8 *ptr, std::string &name) {
+			return backend->DescribeCodePtr(ptr, name);
+		});
+	}
 
 	// Wanted this to be a reference, but vtbls get in the way.  Shouldn't change.
 	hooks_ = backend.GetNativeHooks();
@@ -508,7 +526,79 @@ void IRNativeJit::Init(IRNativeBackend &backend) {
 }
 
 bool IRNativeJit::CompileNativeBlock(IRBlockCache *irblockCache, int block_num) {
-	return backend_->CompileBlock(irblockCache, block_num);
+	if (block_num >= (int)coldRunCounts_.size())
+		coldRunCounts_.resize(block_num + 1, -1);
+	coldRunCounts_[block_num] = -1;
+
+	const u8 *start = backend_->CodeBlock().GetCodePtr();
+	// Breakpoints and tracing are simpler to keep native only.
+	if (coldBlockRuns_ > 0 && !mipsTracer.tracing_enabled && !g_breakpoints.HasMemChecks()) {
+		if (backend_->CompileInterpreterStub(irblockCache, block_num, &InterpretColdBlock)) {
+			coldRunCounts_[block_num] = 0;
+			RegisterPerfMapBlock(irblockCache, block_num, start, "stub_");
+			return true;
+		}
+	}
+	if (!backend_->CompileBlock(irblockCache, block_num))
+		return false;
+	RegisterPerfMapBlock(irblockCache, block_num, start, "");
+	return true;
+}
+
+void IRNativeJit::RegisterPerfMapBlock(IRBlockCache *irBlockCache, int block_num, const u8 *start, const char *prefix) {
+	if (!JitPerfMap::IsEnabled())
+		return;
+	const u8 *end = backend_->CodeBlock().GetCodePtr();
+	if (end > start)
+		JitPerfMap::RegisterBlock(start, end - start, irBlockCache->GetBlock(block_num)->GetOriginalStart(), prefix);
+}
+
+// Called from the interpreter stub of a block that doesn't have native code yet.
+uint32_t IRNativeJit::InterpretColdBlock(int block_num) {
+	IRNativeJit *jit = static_cast<IRNativeJit *>(MIPSComp::jit);
+	IRBlock *block = jit->blocks_.GetBlockUnchecked(block_num);
+	u32 startPC = block->GetOriginalStart();
+
+	// Includes the Downcount.
+	u32 pc = IRInterpret(jit->mips_, jit->blocks_.GetBlockInstructionPtr(*block));
+	if (!Memory::IsValid4AlignedAddress(pc)) {
+		// The dispatcher will see the core state change.
+		Core_ExecException(pc, startPC, ExecExceptionType::JUMP);
+		return pc;
+	}
+
+	// The block may have invalidated itself while running.
+	if (block->IsValid() && jit->coldRunCounts_[block_num] >= 0 && ++jit->coldRunCounts_[block_num] >= jit->coldBlockRuns_) {
+		jit->CompileHotBlock(block_num);
+	}
+	return pc;
+}
+
+// Synchronous, the emu thread waits for the native compile just like without cold blocks.
+// What this saves is native code (and codegen time) for blocks that only run a few times.
+void IRNativeJit::CompileHotBlock(int block_num) {
+	IRBlock *block = blocks_.GetBlockUnchecked(block_num);
+	int stubCookie = block->GetNativeOffset();
+
+	// We return into the stub after this, but InvalidateBlock only overwrites its padded start.
+	// This also sends anything linked to the stub back through the dispatcher.
+	backend_->InvalidateBlock(&blocks_, block_num);
+	block->RestoreOriginalFirstOp(stubCookie);
+	coldRunCounts_[block_num] = -1;
+
+	const u8 *start = backend_->CodeBlock().GetCodePtr();
+	if (!backend_->CompileBlock(&blocks_, block_num)) {
+		// Out of space. The dispatcher will try to compile it again, and clear the cache.
+		blocks_.RemoveBlockFromPageLookup(block_num);
+		block->Destroy(stubCookie);
+		return;
+	}
+	RegisterPerfMapBlock(&blocks_, block_num, start, "");
+
+	// The IR stays the same, so only the cookie and links need updating.
+	block->Finalize(block->GetNativeOffset());
+	backend_->FinalizeBlock(&blocks_, block_num, jo);
+	numHotBlocks_++;
 }
 
 void IRNativeJit::FinalizeNativeBlock(IRBlockCache *irblockCache, int block_num) {
@@ -525,8 +615,13 @@ void IRNativeJit::RunLoopUntil(u64 globalticks) {
 }
 
 void IRNativeJit::ClearCache() {
+	if (coldBlockRuns_ > 0) {
+		INFO_LOG(Log::JIT, "IRNativeJit: %d of %d blocks got native code (after %d interpreted runs)", numHotBlocks_, blocks_.GetNumBlocks(), coldBlockRuns_);
+	}
 	IRJit::ClearCache();
 	backend_->ClearAllBlocks();
+	coldRunCounts_.clear();
+	numHotBlocks_ = 0;
 }
 
 bool IRNativeJit::DescribeCodePtr(const u8 *ptr, std::string &name) {
@@ -805,6 +900,13 @@ void IRNativeBlockCacheDebugInterface::ComputeStats(BlockCacheStats &bcStats) co
 	bcStats.minBloat = (float)minBloat;
 	bcStats.maxBloat = (float)maxBloat;
 	bcStats.avgBloat = (float)(totalBloat / (double)numBlocks);
+
+	const IRDiskCacheStats &diskStats = irBlocks_.GetDiskCacheStats();
+	bcStats.diskCacheHits = diskStats.hits;
+	bcStats.diskCacheMisses = diskStats.misses;
+	bcStats.diskCacheInvalidated = diskStats.invalidated;
+	bcStats.lookupMemoryBytes = irBlocks_.GetLookupMemoryUsage();
+	irBlocks_.ComputeIdleLoopStats(bcStats);
 }
 
 } // namespace MIPSComp
@@ -25,6 +25,8 @@
 namespace MIPSComp {
 
 typedef void (*IRNativeFuncNoArg)();
+// Runs a cold block in the IR interpreter, returns the next PC.
+typedef uint32_t (*IRNativeInterpretBlockFunc)(int block_num);
 
 enum class IRProfilerStatus : int32_t {
 	NOT_RUNNING,
@@ -73,6 +75,9 @@ class IRNativeBackend {
 
 	virtual void GenerateFixedCode(MIPSState *mipsState) = 0;
 	virtual bool CompileBlock(IRBlockCache *irBlockCache, int block_num) = 0;
+	// For cold blocks: emits a small stub calling func instead of compiling the IR.
+	// Returns false if the backend doesn't support this (or is out of space.)
+	virtual bool CompileInterpreterStub(IRBlockCache *irBlockCache, int block_num, IRNativeInterpretBlockFunc func) { return false; }
 	virtual void ClearAllBlocks() = 0;
 	virtual void InvalidateBlock(IRBlockCache *irBlockCache, int block_num) = 0;
 	void FinalizeBlock(IRBlockCache *irBlockCache, int block_num, const JitOptions &jo);
@@ -207,6 +212,18 @@ class IRNativeJit : public IRJit {
 	IRNativeBackend *backend_ = nullptr;
 	IRNativeHooks hooks_;
 	IRNativeBlockCacheDebugInterface debugInterface_;
+
+private:
+	static uint32_t InterpretColdBlock(int block_num);
+	void CompileHotBlock(int block_num);
+	// Names the code emitted since start in the perf map, if enabled.
+	void RegisterPerfMapBlock(IRBlockCache *irBlockCache, int block_num, const u8 *start, const char *prefix);
+
+	// Blocks first run in the IR interpreter, and get native code (right here, on the emu thread) after this many runs.
+	int coldBlockRuns_ = 0;
+	// Interpreted runs per block, or -1 once it has native code.
+	std::vector<int> coldRunCounts_;
+	int numHotBlocks_ = 0;
 };
 
 } // namespace MIPSComp
@@ -1,10 +1,13 @@
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <utility>
 
 #include "Common/BitSet.h"
 #include "Common/Data/Convert/SmallDataConvert.h"
 #include "Common/Log.h"
+#include "Common/StringUtils.h"
+#include "Common/TimeUtil.h"
 #include "Core/Config.h"
 #include "Core/MIPS/MIPSVFPUUtils.h"
 #include "Core/MIPS/IR/IRAnalysis.h"
@@ -86,11 +89,24 @@ IROp ShiftToShiftImm(IROp op) {
 	}
 }
 
-bool IRApplyPasses(const IRPassFunc *passes, size_t c, const IRWriter &in, IRWriter &out, const IROptions &opts) {
+static bool IRApplyPass(IRPassFunc pass, const IRWriter &in, IRWriter &out, const IROptions &opts, IRPassStats *stats) {
+	if (!stats)
+		return pass(in, out, opts);
+
+	Instant start = Instant::Now();
+	bool logBlocks = pass(in, out, opts);
+	stats->nanos += start.ElapsedNanos();
+	stats->runs++;
+	stats->instructionsIn += in.GetInstructions().size();
+	stats->instructionsOut += out.GetInstructions().size();
+	return logBlocks;
+}
+
+bool IRApplyPasses(const IRPassFunc *passes, size_t c, const IRWriter &in, IRWriter &out, const IROptions &opts, IRPassStats *stats) {
 	out.Reserve(in.GetInstructions().size());
 
 	if (c == 1) {
-		return passes[0](in, out, opts);
+		return IRApplyPass(passes[0], in, out, opts, stats);
 	}
 
 	bool logBlocks = false;
@@ -100,7 +116,7 @@ bool IRApplyPasses(const IRPassFunc *passes, size_t c, const IRWriter &in, IRWri
 	IRWriter *nextOut = &temp[1];
 	temp[1].Reserve(nextIn->GetInstructions().size());
 	for (size_t i = 0; i < c - 1; ++i) {
-		if (passes[i](*nextIn, *nextOut, opts)) {
+		if (IRApplyPass(passes[i], *nextIn, *nextOut, opts, stats ? &stats[i] : nullptr)) {
 			logBlocks = true;
 		}
 
@@ -112,13 +128,72 @@ bool IRApplyPasses(const IRPassFunc *passes, size_t c, const IRWriter &in, IRWri
 	}
 
 	out.Reserve(nextIn->GetInstructions().size());
-	if (passes[c - 1](*nextIn, out, opts)) {
+	if (IRApplyPass(passes[c - 1], *nextIn, out, opts, stats ? &stats[c - 1] : nullptr)) {
 		logBlocks = true;
 	}
 
 	return logBlocks;
 }
 
+static bool IRIsTempGPR(int reg) {
+	return reg >= IRTEMP_0 && reg <= IRTEMP_LR_SHIFT;
+}
+
+// Returns a bitmask of temps read before they're written in the block.
+static u64 IRTempsReadBeforeWrite(const IRWriter &code) {
+	u64 written = 0;
+	u64 readFirst = 0;
+	for (const IRInst &inst : code.GetInstructions()) {
+		const IRMeta *m = GetIRMeta(inst.op);
+		auto checkRead = [&](char type, int reg) {
+			if (type == 'G' && IRIsTempGPR(reg) && (written & (1ULL << (reg - IRTEMP_0))) == 0)
+				readFirst |= 1ULL << (reg - IRTEMP_0);
+		};
+		checkRead(m->types[1], inst.src1);
+		checkRead(m->types[2], inst.src2);
+		if ((m->flags & (IRFLAG_SRC3 | IRFLAG_SRC3DST)) != 0)
+			checkRead(m->types[0], inst.src3);
+		if ((m->flags & IRFLAG_SRC3) == 0 && m->types[0] == 'G' && IRIsTempGPR(inst.dest))
+			written |= 1ULL << (inst.dest - IRTEMP_0);
+	}
+	return readFirst;
+}
+
+bool IRVerifyPassResult(const IRWriter &before, const IRWriter &after, std::string *error) {
+	auto collectFixed = [](const IRWriter &code) {
+		std::vector<IRInst> fixed;
+		for (const IRInst &inst : code.GetInstructions()) {
+			if ((GetIRMeta(inst.op)->flags & (IRFLAG_EXIT | IRFLAG_BARRIER)) != 0)
+				fixed.push_back(inst);
+		}
+		return fixed;
+	};
+
+	std::vector<IRInst> fixedBefore = collectFixed(before);
+	std::vector<IRInst> fixedAfter = collectFixed(after);
+	if (fixedBefore.size() != fixedAfter.size()) {
+		*error = StringFromFormat("%d exits/barriers became %d", (int)fixedBefore.size(), (int)fixedAfter.size());
+		return false;
+	}
+	for (size_t i = 0; i < fixedBefore.size(); ++i) {
+		if (memcmp(&fixedBefore[i], &fixedAfter[i], sizeof(IRInst)) != 0) {
+			char buf[256];
+			DisassembleIR(buf, sizeof(buf), fixedBefore[i]);
+			*error = StringFromFormat("exit/barrier #%d changed or moved: %s", (int)i, buf);
+			return false;
+		}
+	}
+
+	u64 newReads = IRTempsReadBeforeWrite(after) & ~IRTempsReadBeforeWrite(before);
+	for (int i = 0; i < 64; ++i) {
+		if (newReads & (1ULL << i)) {
+			*error = StringFromFormat("temp %d read before written", IRTEMP_0 + i);
+			return false;
+		}
+	}
+	return true;
+}
+
 bool OptimizeFPMoves(const IRWriter &in, IRWriter &out, const IROptions &opts) {
 	CONDITIONAL_DISABLE;
 
@@ -927,6 +1002,7 @@ bool PropagateConstants(const IRWriter &in, IRWriter &out, const IROptions &opts
 		case IROp::CallReplacement:
 		case IROp::Break:
 		case IROp::Syscall:
+		case IROp::SyscallDirect:
 		case IROp::Interpret:
 		case IROp::ExitToConstIfFpFalse:
 		case IROp::ExitToConstIfFpTrue:
@@ -1350,6 +1426,63 @@ bool ReduceLoads(const IRWriter &in, IRWriter &out, const IROptions &opts) {
 	return logBlocks;
 }
 
+struct IRMemoryOpInfo {
+	int size;
+	bool isWrite;
+	bool isWordLR;
+};
+
+static IRMemoryOpInfo IROpMemoryAccessSize(IROp op) {
+	// Assumes all take src1 + constant.
+	switch (op) {
+	case IROp::Load8:
+	case IROp::Load8Ext:
+	case IROp::Store8:
+		return { 1, op == IROp::Store8 };
+
+	case IROp::Load16:
+	case IROp::Load16Ext:
+	case IROp::Store16:
+		return { 2, op == IROp::Store16 };
+
+	case IROp::Load32:
+	case IROp::Load32Linked:
+	case IROp::LoadFloat:
+	case IROp::Store32:
+	case IROp::Store32Conditional:
+	case IROp::StoreFloat:
+		return { 4, op == IROp::Store32 || op == IROp::Store32Conditional || op == IROp::StoreFloat };
+
+	case IROp::LoadVec4:
+	case IROp::StoreVec4:
+		return { 16, op == IROp::StoreVec4 };
+
+	case IROp::Load32Left:
+	case IROp::Load32Right:
+	case IROp::Store32Left:
+	case IROp::Store32Right:
+		// This explicitly does not require alignment, so validate as an 8-bit operation.
+		return { 1, op == IROp::Store32Left || op == IROp::Store32Right, true };
+
+	default:
+		return { 0 };
+	}
+}
+
+// Checks if ops[j] writes any bytes also written by ops[start..j-1], which all share a base.
+static bool StoreOverlapsAny(const std::vector<IRInst> &ops, size_t start, size_t j) {
+	int size = IROpMemoryAccessSize(ops[j].op).size;
+	// Left/right stores touch up to 4 bytes, even if validated as 1.
+	if (IROpMemoryAccessSize(ops[j].op).isWordLR)
+		size = 4;
+	for (size_t k = start; k < j; ++k) {
+		s32 diff = (s32)(ops[j].constant - ops[k].constant);
+		if (diff > -size && diff < size)
+			return true;
+	}
+	return false;
+}
+
 static std::vector<IRInst> ReorderLoadStoreOps(std::vector<IRInst> &ops) {
 	if (ops.size() < 2) {
 		return ops;
@@ -1409,6 +1542,10 @@ static std::vector<IRInst> ReorderLoadStoreOps(std::vector<IRInst> &ops) {
 				// Can't reorder, this reg was modified.
 				break;
 			}
+			if (!modifiesReg && StoreOverlapsAny(ops, start, j)) {
+				// Sorting could change which store wins.
+				break;
+			}
 			if (modifiesReg) {
 				// Modifies itself, can't reorder this.
 				if (!usesFloatReg && ops[j].dest == ops[j].src1) {
@@ -1425,7 +1562,7 @@ static std::vector<IRInst> ReorderLoadStoreOps(std::vector<IRInst> &ops) {
 		size_t end = j;
 		if (start + 1 < end) {
 			std::stable_sort(ops.begin() + start, ops.begin() + end, [&](const IRInst &a, const IRInst &b) {
-				return a.constant < b.constant;
+				return (s32)a.constant < (s32)b.constant;
 			});
 		}
 	}
@@ -1710,7 +1847,7 @@ bool MergeLoadStore(const IRWriter &in, IRWriter &out, const IROptions &opts) {
 			break;
 
 		case IROp::Load32:
-			if (prev.src1 == inst.src1 && prev.src2 == inst.src2) {
+			if (prev.src1 == inst.src1 && prev.constant == inst.constant) {
 				// A store and then an immediate load.  This is sadly common in minis.
 				if (prev.op == IROp::Store32 && prev.src3 == inst.dest) {
 					// Even the same reg, a volatile variable?  Skip it.
@@ -1734,7 +1871,7 @@ bool MergeLoadStore(const IRWriter &in, IRWriter &out, const IROptions &opts) {
 			break;
 
 		case IROp::LoadFloat:
-			if (prev.src1 == inst.src1 && prev.src2 == inst.src2) {
+			if (prev.src1 == inst.src1 && prev.constant == inst.constant) {
 				// A store and then an immediate load, of a float.
 				if (prev.op == IROp::StoreFloat && prev.src3 == inst.dest) {
 					// Volatile float, I suppose?
@@ -1765,49 +1902,6 @@ bool MergeLoadStore(const IRWriter &in, IRWriter &out, const IROptions &opts) {
 	return logBlocks;
 }
 
-struct IRMemoryOpInfo {
-	int size;
-	bool isWrite;
-	bool isWordLR;
-};
-
-static IRMemoryOpInfo IROpMemoryAccessSize(IROp op) {
-	// Assumes all take src1 + constant.
-	switch (op) {
-	case IROp::Load8:
-	case IROp::Load8Ext:
-	case IROp::Store8:
-		return { 1, op == IROp::Store8 };
-
-	case IROp::Load16:
-	case IROp::Load16Ext:
-	case IROp::Store16:
-		return { 2, op == IROp::Store16 };
-
-	case IROp::Load32:
-	case IROp::Load32Linked:
-	case IROp::LoadFloat:
-	case IROp::Store32:
-	case IROp::Store32Conditional:
-	case IROp::StoreFloat:
-		return { 4, op == IROp::Store32 || op == IROp::Store32Conditional || op == IROp::StoreFloat };
-
-	case IROp::LoadVec4:
-	case IROp::StoreVec4:
-		return { 16, op == IROp::StoreVec4 };
-
-	case IROp::Load32Left:
-	case IROp::Load32Right:
-	case IROp::Store32Left:
-	case IROp::Store32Right:
-		// This explicitly does not require alignment, so validate as an 8-bit operation.
-		return { 1, op == IROp::Store32Left || op == IROp::Store32Right, true };
-
-	default:
-		return { 0 };
-	}
-}
-
 bool ApplyMemoryValidation(const IRWriter &in, IRWriter &out, const IROptions &opts) {
 	CONDITIONAL_DISABLE;
 	if (g_Config.bFastMemory)
@@ -1897,6 +1991,100 @@ bool ApplyMemoryValidation(const IRWriter &in, IRWriter &out, const IROptions &o
 	return logBlocks;
 }
 
+// Fused groups since the last call to IRTakeVectorizedGroupCount().
+static std::atomic<int64_t> vectorizedGroups;
+
+int64_t IRTakeVectorizedGroupCount() {
+	return vectorizedGroups.exchange(0);
+}
+
+static IROp VectorizedFloatOp(IROp op) {
+	switch (op) {
+	case IROp::FAdd: return IROp::Vec4Add;
+	case IROp::FSub: return IROp::Vec4Sub;
+	case IROp::FMul: return IROp::Vec4Mul;
+	case IROp::FDiv: return IROp::Vec4Div;
+	case IROp::FMov: return IROp::Vec4Mov;
+	case IROp::FNeg: return IROp::Vec4Neg;
+	case IROp::FAbs: return IROp::Vec4Abs;
+	default: return IROp::Nop;
+	}
+}
+
+// Checks if four scalar ops can run as one Vec4 op, and if so writes it to result.
+static bool VectorizeFloatGroup(const IRInst *group, IRInst *result) {
+	const IROp vecOp = VectorizedFloatOp(group[0].op);
+	if (vecOp == IROp::Nop)
+		return false;
+	const bool hasSrc2 = GetIRMeta(group[0].op)->types[2] == 'F';
+
+	const IRReg destBase = group[0].dest & ~3;
+	const IRReg src1Base = group[0].src1 & ~3;
+	const IRReg src2Base = group[0].src2 & ~3;
+	// Scalar src2 for all lanes, only for multiply (Vec4Scale.)
+	bool scalarSrc2 = hasSrc2 && group[0].op == IROp::FMul;
+	bool vectorSrc2 = hasSrc2;
+	u8 lanes = 0;
+	for (int k = 0; k < 4; ++k) {
+		const IRInst &inst = group[k];
+		const int lane = inst.dest & 3;
+		if (inst.op != group[0].op || (inst.dest & ~3) != destBase || (lanes & (1 << lane)) != 0)
+			return false;
+		if (inst.src1 != src1Base + lane)
+			return false;
+		if (hasSrc2) {
+			vectorSrc2 = vectorSrc2 && inst.src2 == src2Base + lane;
+			scalarSrc2 = scalarSrc2 && inst.src2 == group[0].src2;
+		}
+		lanes |= 1 << lane;
+	}
+	if (hasSrc2 && !vectorSrc2 && !scalarSrc2)
+		return false;
+
+	if (group[0].op == IROp::FMul) {
+		// FMul on the FPU returns a positive NaN for inf * 0, Vec4Mul doesn't. The VFPU already
+		// uses Vec4Mul for unprefixed vmul/vscl, so only fuse VFPU (and VFPU temp) registers.
+		if (destBase < 32 || src1Base < 32 || group[0].src2 < 32)
+			return false;
+	}
+
+	if (scalarSrc2 && !vectorSrc2) {
+		// The Vec4 op reads all inputs before writing, unlike the scalar ops. Since every lane
+		// reads the same lane of its sources, only a scale factor inside dest could see a
+		// different value. The backends also don't like it overlapping the source.
+		if ((group[0].src2 & ~3) == destBase || (group[0].src2 & ~3) == src1Base)
+			return false;
+		*result = IRInst{ IROp::Vec4Scale, { destBase }, src1Base, group[0].src2, 0 };
+	} else {
+		*result = IRInst{ vecOp, { destBase }, src1Base, hasSrc2 ? src2Base : (IRReg)0, 0 };
+	}
+	return true;
+}
+
+// Packs four adjacent scalar float ops, one per lane of the same registers, into a Vec4 op.
+// This is mostly VFPU code that had to be compiled lane by lane (prefixes, overlap) and
+// FPU code doing vector math by hand.
+bool VectorizeFloatOps(const IRWriter &in, IRWriter &out, const IROptions &opts) {
+	CONDITIONAL_DISABLE;
+	bool logBlocks = false;
+	const std::vector<IRInst> &insts = in.GetInstructions();
+	const size_t n = insts.size();
+	int groups = 0;
+	for (size_t i = 0; i < n; ++i) {
+		IRInst fused;
+		if (i + 4 <= n && VectorizeFloatGroup(&insts[i], &fused)) {
+			out.Write(fused);
+			groups++;
+			i += 3;
+			continue;
+		}
+		out.Write(insts[i]);
+	}
+	if (groups != 0)
+		vectorizedGroups += groups;
+	return logBlocks;
+}
+
 bool ReduceVec4Flush(const IRWriter &in, IRWriter &out, const IROptions &opts) {
 	CONDITIONAL_DISABLE;
 	// Only do this when using a SIMD backend.
@@ -1,9 +1,27 @@
 #pragma once
 
+#include <cstdint>
+#include <string>
+
 #include "Core/MIPS/IR/IRInst.h"
 
 typedef bool (*IRPassFunc)(const IRWriter &in, IRWriter &out, const IROptions &opts);
-bool IRApplyPasses(const IRPassFunc *passes, size_t c, const IRWriter &in, IRWriter &out, const IROptions &opts);
+
+// Accumulated over all blocks a pass has run on.
+struct IRPassStats {
+	const char *name;
+	int64_t runs;
+	int64_t nanos;
+	int64_t instructionsIn;
+	int64_t instructionsOut;
+};
+
+// If stats is not null, it must have c entries, which are added to.
+bool IRApplyPasses(const IRPassFunc *passes, size_t c, const IRWriter &in, IRWriter &out, const IROptions &opts, IRPassStats *stats = nullptr);
+
+// Sanity checks the result of a pass that doesn't fold exits: exits and barriers must stay
+// identical and in order, and no temp may be read before written unless it already was.
+bool IRVerifyPassResult(const IRWriter &before, const IRWriter &after, std::string *error);
 
 // Block optimizer passes of varying usefulness.
 bool RemoveLoadStoreLeftRight(const IRWriter &in, IRWriter &out, const IROptions &opts);
@@ -15,7 +33,11 @@ bool OptimizeFPMoves(const IRWriter &in, IRWriter &out, const IROptions &opts);
 bool ReorderLoadStore(const IRWriter &in, IRWriter &out, const IROptions &opts);
 bool MergeLoadStore(const IRWriter &in, IRWriter &out, const IROptions &opts);
 bool ApplyMemoryValidation(const IRWriter &in, IRWriter &out, const IROptions &opts);
+bool VectorizeFloatOps(const IRWriter &in, IRWriter &out, const IROptions &opts);
 bool ReduceVec4Flush(const IRWriter &in, IRWriter &out, const IROptions &opts);
 
+// Number of scalar op groups VectorizeFloatOps fused since the last call, resets the count.
+int64_t IRTakeVectorizedGroupCount();
+
 bool OptimizeLoadsAfterStores(const IRWriter &in, IRWriter &out, const IROptions &opts);
 bool OptimizeForInterpreter(const IRWriter &in, IRWriter &out, const IROptions &opts);
@@ -39,6 +39,8 @@
 
 #include "Core/MIPS/JitCommon/JitBlockCache.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
+#include "Core/MIPS/JitCommon/JitPerfMap.h"
+#include "Core/MIPS/JitCommon/JitWriteProtect.h"
 
 constexpr u32 INVALID_EXIT = 0xFFFFFFFF;
 constexpr u32 SENTINEL_VAL = 0xc0ffeefe;
@@ -95,11 +97,12 @@ void JitBlockCache::Shutdown() {
 // This clears the JIT cache. It's called from JitCache.cpp when the JIT cache
 // is full and when saving and loading states.
 void JitBlockCache::Clear() {
-	// Note: We intentionally clear the block_map_ first to avoid O(N^2) behavior in RemoveBlockMap
-	block_map_.clear();
+	// Note: We intentionally clear the block index first to avoid searching it in RemoveBlockMap
+	blockIndex_.Clear();
 	for (int i = 0; i < num_blocks_; i++) {
 		DestroyBlock(i, DestroyType::CLEAR);
 	}
+	JitWriteProtect::Reset();
 	links_to_.clear();
 	num_blocks_ = 0;
 
@@ -136,32 +139,18 @@ int JitBlockCache::AllocateBlock(u32 startAddress) {
 
 void JitBlockCache::AddBlockMap(int block_num) {
 	const JitBlock &b = blocks_[block_num];
-	// Convert the logical address to a physical address for the block map
-	u32 pAddr = b.originalAddress & 0x1FFFFFFF;
-	block_map_[std::make_pair(pAddr + 4 * b.originalSize, pAddr)] = block_num;
+	// The index masks the logical address down to a physical address itself.
+	blockIndex_.Add(block_num, b.originalAddress, 4 * b.originalSize);
 }
 
 void JitBlockCache::RemoveBlockMap(int block_num) {
 	const JitBlock &b = blocks_[block_num];
-	if (b.invalid) {
+	if (b.invalid || blockIndex_.NumEntries() == 0) {
 		return;
 	}
 
-	const u32 pAddr = b.originalAddress & 0x1FFFFFFF;
-	auto it = block_map_.find(std::make_pair(pAddr + 4 * b.originalSize, pAddr));
-	if (it != block_map_.end() && it->second == (u32)block_num) {
-		block_map_.erase(it);
-	} else {
-		// It wasn't in there, or it has the wrong key.  Let's search...
-		// TODO: This is O(n), so O(n^2) when called for every block.
-		for (auto it = block_map_.begin(); it != block_map_.end(); ++it) {
-			if (it->second == (u32)block_num) {
-				_dbg_assert_(false);
-				block_map_.erase(it);
-				break;
-			}
-		}
-	}
+	// Might not be there, if the block was never finalized.
+	blockIndex_.Remove(block_num, b.originalAddress, 4 * b.originalSize);
 }
 
 static void ExpandRange(std::pair<u32, u32> &range, u32 newStart, u32 newEnd) {
@@ -180,6 +169,9 @@ void JitBlockCache::FinalizeBlock(int block_num, bool block_link) {
 	b.compiledHash = HashJitBlock(b);
 
 	AddBlockMap(block_num);
+	JitWriteProtect::OnBlockFinalized(b.originalAddress, 4 * b.originalSize);
+	if (JitPerfMap::IsEnabled())
+		JitPerfMap::RegisterBlock(b.checkedEntry, b.normalEntry + b.codeSize - b.checkedEntry, b.originalAddress);
 
 	if (block_link) {
 		for (int i = 0; i < MAX_JIT_BLOCK_EXITS; i++) {
@@ -462,25 +454,12 @@ void JitBlockCache::InvalidateICache(u32 address, const u32 length) {
 		return;
 	}
 
-	// Blocks may start and end in overlapping ways, and destroying one invalidates iterators.
-	// So after destroying one, we start over.
-	do {
-	restart:
-		auto next = block_map_.lower_bound(std::make_pair(pAddr, 0));
-		auto last = block_map_.upper_bound(std::make_pair(pEnd + MAX_BLOCK_INSTRUCTIONS, 0));
-		// Note that if next is end(), last will be end() too (equal.)
-		for (; next != last; ++next) {
-			const u32 blockStart = next->first.second;
-			const u32 blockEnd = next->first.first;
-			if (blockStart < pEnd && blockEnd > pAddr) {
-				DestroyBlock(next->second, DestroyType::INVALIDATE);
-				// Our iterator is now invalid.  Break and search again.
-				// Most of the time there shouldn't be a bunch of matching blocks.
-				goto restart;
-			}
-		}
-		// We got here - it wasn't in the map at all (or anymore.)
-	} while (false);
+	// Collect first, since destroying a block removes it from the index.
+	invalidateScratch_.clear();
+	blockIndex_.FindOverlapping(pAddr, length, invalidateScratch_);
+	for (int block_num : invalidateScratch_) {
+		DestroyBlock(block_num, DestroyType::INVALIDATE);
+	}
 }
 
 void JitBlockCache::InvalidateChangedBlocks() {
@@ -551,6 +530,7 @@ void JitBlockCache::ComputeStats(BlockCacheStats &bcStats) const {
 	bcStats.minBloat = (float)minBloat;
 	bcStats.maxBloat = (float)maxBloat;
 	bcStats.avgBloat = (float)(totalBloat / (double)num_blocks_);
+	bcStats.lookupMemoryBytes = blockIndex_.MemoryUsage();
 }
 
 JitBlockDebugInfo JitBlockCache::GetBlockDebugInfo(int blockNum) const {
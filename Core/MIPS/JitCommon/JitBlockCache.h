@@ -27,6 +27,7 @@
 #include "Common/CommonTypes.h"
 #include "Common/CodeBlock.h"
 #include "Core/MIPS/MIPS.h"
+#include "Core/MIPS/JitCommon/JitBlockPageIndex.h"
 
 // Can probably reduce to 2 now that block continuation is gone.
 const int MAX_JIT_BLOCK_EXITS = 4;
@@ -40,6 +41,17 @@ struct BlockCacheStats {
 	u32 minBloatBlock;
 	float maxBloat;
 	u32 maxBloatBlock;
+	// Only used by the IR block cache, when the disk cache is enabled.
+	int diskCacheHits;
+	int diskCacheMisses;
+	int diskCacheInvalidated;
+	// Memory used by the address -> block lookup structures.
+	size_t lookupMemoryBytes;
+	// Only used by the IR block cache, with idle loop skipping enabled.
+	int idleLoopBlocks;
+	u64 idleSkippedCycles;
+	u64 maxIdleSkippedCycles;
+	u32 maxIdleSkippedBlock;
 };
 
 enum class DestroyType {
@@ -195,7 +207,10 @@ class JitBlockCache : public JitBlockCacheDebugInterface {
 	CodeBlockCommon *codeBlock_;
 	JitBlock *blocks_ = nullptr;
 	std::unordered_multimap<u32, int> links_to_;
-	std::map<std::pair<u32,u32>, u32> block_map_; // (end_addr, start_addr) -> number
+	// Physical address ranges of valid blocks -> number.
+	JitBlockPageIndex blockIndex_{ 0x1FFFFFFF };
+	// Reused by InvalidateICache to avoid allocating.
+	std::vector<int> invalidateScratch_;
 
 	enum {
 		JITBLOCK_RANGE_SCRATCH = 0,
@@ -0,0 +1,155 @@
+// Copyright (c) 2024- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <cstring>
+
+#include "Common/Log.h"
+#include "Core/MIPS/JitCommon/JitBlockPageIndex.h"
+
+JitBlockPageIndex::JitBlockPageIndex(u32 addressMask) : mask_(addressMask) {
+	// The mask must cover a whole number of leaves.
+	_dbg_assert_(((addressMask + 1) & ((1 << (PAGE_SHIFT + LEAF_SHIFT)) - 1)) == 0);
+	leaves_.resize(((u64)addressMask + 1) >> (PAGE_SHIFT + LEAF_SHIFT));
+}
+
+JitBlockPageIndex::Bucket *JitBlockPageIndex::GetOrCreateLeaf(u32 page) {
+	std::unique_ptr<Bucket[]> &leaf = leaves_[page >> LEAF_SHIFT];
+	if (!leaf) {
+		leaf.reset(new Bucket[LEAF_SIZE]);
+		// All -1 is an empty bucket.
+		memset(leaf.get(), 0xFF, sizeof(Bucket) * LEAF_SIZE);
+		numLeaves_++;
+	}
+	return leaf.get();
+}
+
+void JitBlockPageIndex::AddToBucket(Bucket &bucket, int blockNum) {
+	for (int i = 0; i < INLINE_BLOCKS; ++i) {
+		if (bucket.blocks[i] == -1) {
+			bucket.blocks[i] = blockNum;
+			return;
+		}
+	}
+	if (bucket.overflow == -1) {
+		if (!freeOverflow_.empty()) {
+			bucket.overflow = freeOverflow_.back();
+			freeOverflow_.pop_back();
+		} else {
+			bucket.overflow = (int)overflow_.size();
+			overflow_.emplace_back();
+		}
+	}
+	overflow_[bucket.overflow].push_back(blockNum);
+}
+
+bool JitBlockPageIndex::RemoveFromBucket(Bucket &bucket, int blockNum) {
+	// Order doesn't matter, so fill the hole with the last entry.
+	int *slot = nullptr;
+	int lastInline = -1;
+	for (int i = 0; i < INLINE_BLOCKS && bucket.blocks[i] != -1; ++i) {
+		if (bucket.blocks[i] == blockNum)
+			slot = &bucket.blocks[i];
+		lastInline = i;
+	}
+
+	if (bucket.overflow != -1) {
+		std::vector<int> &list = overflow_[bucket.overflow];
+		if (!slot) {
+			auto it = std::find(list.begin(), list.end(), blockNum);
+			if (it == list.end())
+				return false;
+			slot = &*it;
+		}
+		*slot = list.back();
+		list.pop_back();
+		if (list.empty()) {
+			freeOverflow_.push_back(bucket.overflow);
+			bucket.overflow = -1;
+		}
+		return true;
+	}
+
+	if (!slot)
+		return false;
+	*slot = bucket.blocks[lastInline];
+	bucket.blocks[lastInline] = -1;
+	return true;
+}
+
+void JitBlockPageIndex::Add(int blockNum, u32 start, u32 size) {
+	const u32 mStart = start & mask_;
+	const u32 startPage = mStart >> PAGE_SHIFT;
+	// Zero sized blocks still go in their first page, so start address lookups find them.
+	const u32 endPage = (mStart + (size == 0 ? 0 : size - 1)) >> PAGE_SHIFT;
+
+	if (blockNum >= (int)ranges_.size())
+		ranges_.resize(std::max((size_t)blockNum + 1, ranges_.size() * 2));
+	ranges_[blockNum] = Range{ mStart, mStart + size };
+
+	for (u32 page = startPage; page <= endPage; ++page) {
+		Bucket *leaf = GetOrCreateLeaf(page);
+		AddToBucket(leaf[page & (LEAF_SIZE - 1)], blockNum);
+		numEntries_++;
+	}
+}
+
+bool JitBlockPageIndex::Remove(int blockNum, u32 start, u32 size) {
+	const u32 mStart = start & mask_;
+	const u32 startPage = mStart >> PAGE_SHIFT;
+	const u32 endPage = (mStart + (size == 0 ? 0 : size - 1)) >> PAGE_SHIFT;
+
+	bool foundAll = true;
+	for (u32 page = startPage; page <= endPage; ++page) {
+		Bucket *leaf = leaves_[page >> LEAF_SHIFT].get();
+		if (leaf && RemoveFromBucket(leaf[page & (LEAF_SIZE - 1)], blockNum)) {
+			numEntries_--;
+		} else {
+			foundAll = false;
+		}
+	}
+	return foundAll;
+}
+
+void JitBlockPageIndex::Clear() {
+	// Keep the leaves and overflow lists around, the cache will likely fill up again soon.
+	for (auto &leaf : leaves_) {
+		if (leaf)
+			memset(leaf.get(), 0xFF, sizeof(Bucket) * LEAF_SIZE);
+	}
+	freeOverflow_.clear();
+	for (int i = (int)overflow_.size() - 1; i >= 0; --i) {
+		overflow_[i].clear();
+		freeOverflow_.push_back(i);
+	}
+	numEntries_ = 0;
+}
+
+size_t JitBlockPageIndex::MemoryUsage() const {
+	size_t bytes = leaves_.capacity() * sizeof(leaves_[0]);
+	bytes += numLeaves_ * sizeof(Bucket) * LEAF_SIZE;
+	bytes += ranges_.capacity() * sizeof(Range);
+	bytes += overflow_.capacity() * sizeof(overflow_[0]) + freeOverflow_.capacity() * sizeof(int);
+	for (const auto &list : overflow_)
+		bytes += list.capacity() * sizeof(int);
+	return bytes;
+}
+
+void JitBlockPageIndex::FindOverlapping(u32 start, u32 size, std::vector<int> &found) const {
+	ForEachOverlapping(start, size, [&](int blockNum) {
+		found.push_back(blockNum);
+	});
+}
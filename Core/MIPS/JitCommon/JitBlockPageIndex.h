@@ -0,0 +1,150 @@
+// Copyright (c) 2024- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "Common/CommonTypes.h"
+
+// Maps the guest address ranges of compiled blocks to block numbers, for invalidation and
+// start address lookups. Used by both JitBlockCache and IRBlockCache.
+//
+// Addresses are masked (to fold mirrors together) and bucketed by small pages. A block is
+// listed in every page it touches, so an invalidation only looks at the blocks in the
+// pages it covers. The page table is directly indexed by page number, split into lazily
+// allocated leaves so unused parts of the address space cost nothing. Each page keeps a
+// few block numbers inline, and only busy pages spill into an overflow list. Block ranges
+// are kept in a flat array by block number, so checking overlap doesn't touch the blocks.
+// Overflow lists are recycled, so once warmed up nothing allocates.
+class JitBlockPageIndex {
+public:
+	explicit JitBlockPageIndex(u32 addressMask);
+
+	void Add(int blockNum, u32 start, u32 size);
+	// Returns false if the block wasn't in the index (at least not in all its pages.)
+	bool Remove(int blockNum, u32 start, u32 size);
+	void Clear();
+
+	// Calls func(blockNum) exactly once for each block overlapping [start, start + size).
+	// The index must not be modified from inside func.
+	template <typename F>
+	void ForEachOverlapping(u32 start, u32 size, F func) const;
+	// Appends to found instead, can be used if blocks need to be destroyed.
+	void FindOverlapping(u32 start, u32 size, std::vector<int> &found) const;
+
+	// Calls func(blockNum) for each block that touches the page containing addr, in no
+	// particular order. Useful for start address lookups, the caller checks the exact address.
+	template <typename F>
+	void ForEachInPage(u32 addr, F func) const;
+
+	int NumEntries() const { return numEntries_; }
+	// Bytes allocated by the page table, range array and overflow lists.
+	size_t MemoryUsage() const;
+
+	enum {
+		PAGE_SHIFT = 10,
+		// Each leaf of the page table covers 1024 pages (1MB of address space.)
+		LEAF_SHIFT = 10,
+		LEAF_SIZE = 1 << LEAF_SHIFT,
+		// Most pages only hold a handful of blocks.
+		INLINE_BLOCKS = 3,
+	};
+
+private:
+	struct Bucket {
+		// Filled from the front, -1 terminates.
+		int blocks[INLINE_BLOCKS];
+		// Index into overflow_, or -1. Only used when the inline slots are full.
+		int overflow;
+	};
+	struct Range {
+		u32 start;
+		u32 end;
+	};
+
+	Bucket *GetOrCreateLeaf(u32 page);
+	const Bucket *GetBucket(u32 page) const {
+		const Bucket *leaf = leaves_[page >> LEAF_SHIFT].get();
+		return leaf ? &leaf[page & (LEAF_SIZE - 1)] : nullptr;
+	}
+	void AddToBucket(Bucket &bucket, int blockNum);
+	bool RemoveFromBucket(Bucket &bucket, int blockNum);
+	template <typename F>
+	void ForEachInBucket(const Bucket &bucket, F func) const;
+
+	u32 mask_;
+	std::vector<std::unique_ptr<Bucket[]>> leaves_;
+	int numLeaves_ = 0;
+	std::vector<Range> ranges_;
+	std::vector<std::vector<int>> overflow_;
+	std::vector<int> freeOverflow_;
+	int numEntries_ = 0;
+};
+
+template <typename F>
+void JitBlockPageIndex::ForEachInBucket(const Bucket &bucket, F func) const {
+	for (int i = 0; i < INLINE_BLOCKS; ++i) {
+		if (bucket.blocks[i] == -1)
+			return;
+		func(bucket.blocks[i]);
+	}
+	if (bucket.overflow != -1) {
+		for (int blockNum : overflow_[bucket.overflow])
+			func(blockNum);
+	}
+}
+
+template <typename F>
+void JitBlockPageIndex::ForEachOverlapping(u32 start, u32 size, F func) const {
+	if (size == 0)
+		return;
+	const u32 qStart = start & mask_;
+	// Clamp the end to the masked address space, the caller may pass a huge size.
+	const u64 qEnd64 = std::min((u64)qStart + size, (u64)mask_ + 1);
+	const u32 qEnd = (u32)qEnd64;
+	const u32 startPage = qStart >> PAGE_SHIFT;
+	const u32 endPage = (u32)((qEnd64 - 1) >> PAGE_SHIFT);
+
+	for (u32 page = startPage; page <= endPage; ++page) {
+		const Bucket *bucket = GetBucket(page);
+		if (!bucket) {
+			// Skip the rest of this leaf.
+			page |= LEAF_SIZE - 1;
+			continue;
+		}
+		ForEachInBucket(*bucket, [&](int blockNum) {
+			const Range &range = ranges_[blockNum];
+			if (range.start >= qEnd || range.end <= qStart)
+				return;
+			// A block is in every page it touches. Only report it from the page where
+			// its overlap with the query starts, so it's reported once.
+			const u32 overlapStart = range.start > qStart ? range.start : qStart;
+			if ((overlapStart >> PAGE_SHIFT) == page)
+				func(blockNum);
+		});
+	}
+}
+
+template <typename F>
+void JitBlockPageIndex::ForEachInPage(u32 addr, F func) const {
+	const Bucket *bucket = GetBucket((addr & mask_) >> PAGE_SHIFT);
+	if (bucket)
+		ForEachInBucket(*bucket, func);
+}
@@ -0,0 +1,327 @@
+// Copyright (c) 2024- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include "ppsspp_config.h"
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if PPSSPP_PLATFORM(LINUX)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "Common/Log.h"
+#include "Common/StringUtils.h"
+#include "Common/Thread/ThreadUtil.h"
+#include "Core/Config.h"
+#include "Core/Debugger/SymbolMap.h"
+#include "Core/MIPS/JitCommon/JitPerfMap.h"
+
+namespace JitPerfMap {
+
+bool g_enabled = false;
+
+#if PPSSPP_PLATFORM(LINUX)
+
+// See tools/perf/Documentation/jitdump-specification.txt in the kernel sources.
+struct JitDumpHeader {
+	u32 magic;
+	u32 version;
+	u32 totalSize;
+	u32 elfMach;
+	u32 pad1;
+	u32 pid;
+	u64 timestamp;
+	u64 flags;
+};
+
+enum : u32 {
+	JITDUMP_MAGIC = 0x4A695444,
+	JITDUMP_VERSION = 1,
+	JIT_CODE_LOAD = 0,
+};
+
+// Followed by the name with a terminator, and then the code.
+struct JitDumpCodeLoad {
+	u32 id;
+	u32 totalSize;
+	u64 timestamp;
+	u32 pid;
+	u32 tid;
+	u64 vma;
+	u64 codeAddr;
+	u64 codeSize;
+	u64 codeIndex;
+};
+
+static_assert(sizeof(JitDumpHeader) == 40, "Unexpected jitdump header size");
+static_assert(sizeof(JitDumpCodeLoad) == 56, "Unexpected jitdump record size");
+
+// The writer is woken up once this much is queued, or on shutdown.
+static const size_t FLUSH_THRESHOLD = 64 * 1024;
+
+static std::mutex g_lock;
+static std::condition_variable g_wake;
+static std::thread g_writer;
+static bool g_stopping;
+// Protected by g_lock, swapped out by the writer.
+static std::vector<char> g_pendingMap;
+static std::vector<u8> g_pendingDump;
+static u64 g_codeIndex;
+
+// Only touched by Init/Shutdown and the writer.
+static FILE *g_mapFile;
+static FILE *g_dumpFile;
+static void *g_dumpMarker;
+static size_t g_dumpMarkerSize;
+
+static u64 Timestamp() {
+	// perf record needs -k 1 (CLOCK_MONOTONIC) to match these up.
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+}
+
+static u32 ElfMachine() {
+#if PPSSPP_ARCH(AMD64)
+	return 62;  // EM_X86_64
+#elif PPSSPP_ARCH(X86)
+	return 3;  // EM_386
+#elif PPSSPP_ARCH(ARM64)
+	return 183;  // EM_AARCH64
+#elif PPSSPP_ARCH(ARM)
+	return 40;  // EM_ARM
+#elif PPSSPP_ARCH(RISCV64)
+	return 243;  // EM_RISCV
+#elif PPSSPP_ARCH(LOONGARCH64)
+	return 258;  // EM_LOONGARCH
+#else
+	return 0;
+#endif
+}
+
+static void WriterThread() {
+	SetCurrentThreadName("JitPerfMap");
+
+	std::vector<char> mapData;
+	std::vector<u8> dumpData;
+	std::unique_lock<std::mutex> guard(g_lock);
+	while (true) {
+		g_wake.wait(guard, [] {
+			return g_stopping || g_pendingMap.size() + g_pendingDump.size() >= FLUSH_THRESHOLD;
+		});
+		bool stopping = g_stopping;
+		mapData.swap(g_pendingMap);
+		dumpData.swap(g_pendingDump);
+		guard.unlock();
+
+		if (!mapData.empty()) {
+			fwrite(mapData.data(), 1, mapData.size(), g_mapFile);
+			fflush(g_mapFile);
+		}
+		if (!dumpData.empty() && g_dumpFile) {
+			fwrite(dumpData.data(), 1, dumpData.size(), g_dumpFile);
+			fflush(g_dumpFile);
+		}
+		mapData.clear();
+		dumpData.clear();
+
+		guard.lock();
+		if (stopping && g_pendingMap.empty() && g_pendingDump.empty())
+			break;
+	}
+}
+
+static bool OpenJitDump(int pid) {
+	char filename[64];
+	snprintf(filename, sizeof(filename), "/tmp/jit-%d.dump", pid);
+	g_dumpFile = fopen(filename, "wb+");
+	if (!g_dumpFile) {
+		WARN_LOG(Log::JIT, "JitPerfMap: Could not create %s", filename);
+		return false;
+	}
+
+	// perf inject finds the file through this mapping, which perf record sees as an executable mmap.
+	g_dumpMarkerSize = (size_t)sysconf(_SC_PAGESIZE);
+	g_dumpMarker = mmap(nullptr, g_dumpMarkerSize, PROT_READ | PROT_EXEC, MAP_PRIVATE, fileno(g_dumpFile), 0);
+	if (g_dumpMarker == MAP_FAILED) {
+		WARN_LOG(Log::JIT, "JitPerfMap: Could not map %s, perf won't find it", filename);
+		g_dumpMarker = nullptr;
+	}
+
+	JitDumpHeader header{};
+	header.magic = JITDUMP_MAGIC;
+	header.version = JITDUMP_VERSION;
+	header.totalSize = sizeof(header);
+	header.elfMach = ElfMachine();
+	header.pid = (u32)pid;
+	header.timestamp = Timestamp();
+	fwrite(&header, sizeof(header), 1, g_dumpFile);
+	fflush(g_dumpFile);
+	return true;
+}
+
+void Init() {
+	if (g_enabled || g_Config.iJitPerfMap <= 0)
+		return;
+
+	const int pid = (int)getpid();
+	char filename[64];
+	snprintf(filename, sizeof(filename), "/tmp/perf-%d.map", pid);
+	// Appending keeps the entries from earlier games in the same process around.
+	g_mapFile = fopen(filename, "a");
+	if (!g_mapFile) {
+		WARN_LOG(Log::JIT, "JitPerfMap: Could not open %s", filename);
+		return;
+	}
+	if (g_Config.iJitPerfMap >= 2)
+		OpenJitDump(pid);
+
+	g_stopping = false;
+	g_codeIndex = 0;
+	g_enabled = true;
+	g_writer = std::thread(&WriterThread);
+	INFO_LOG(Log::JIT, "JitPerfMap: Writing %s%s", filename, g_dumpFile ? " and a jitdump" : "");
+}
+
+void Shutdown() {
+	if (!g_enabled)
+		return;
+
+	{
+		std::lock_guard<std::mutex> guard(g_lock);
+		g_enabled = false;
+		g_stopping = true;
+	}
+	g_wake.notify_one();
+	g_writer.join();
+
+	fclose(g_mapFile);
+	g_mapFile = nullptr;
+	if (g_dumpMarker)
+		munmap(g_dumpMarker, g_dumpMarkerSize);
+	g_dumpMarker = nullptr;
+	if (g_dumpFile)
+		fclose(g_dumpFile);
+	g_dumpFile = nullptr;
+}
+
+void RegisterCode(const void *code, size_t size, const std::string &name) {
+	if (!g_enabled || size == 0)
+		return;
+
+	std::string cleanName = ReplaceAll(name, " ", "_");
+	char line[64];
+	int lineLen = snprintf(line, sizeof(line), "%llx %llx ", (unsigned long long)(uintptr_t)code, (unsigned long long)size);
+
+	const bool dump = g_dumpFile != nullptr;
+	const u64 timestamp = dump ? Timestamp() : 0;
+	const u32 tid = dump ? (u32)syscall(SYS_gettid) : 0;
+
+	std::unique_lock<std::mutex> guard(g_lock);
+	g_pendingMap.insert(g_pendingMap.end(), line, line + lineLen);
+	g_pendingMap.insert(g_pendingMap.end(), cleanName.begin(), cleanName.end());
+	g_pendingMap.push_back('\n');
+
+	if (dump) {
+		JitDumpCodeLoad record{};
+		record.id = JIT_CODE_LOAD;
+		record.totalSize = (u32)(sizeof(record) + cleanName.size() + 1 + size);
+		record.timestamp = timestamp;
+		record.pid = (u32)getpid();
+		record.tid = tid;
+		record.vma = (u64)(uintptr_t)code;
+		record.codeAddr = (u64)(uintptr_t)code;
+		record.codeSize = size;
+		record.codeIndex = g_codeIndex++;
+
+		// Copy the code now, since the space gets reused.
+		const u8 *recordBytes = (const u8 *)&record;
+		const u8 *codeBytes = (const u8 *)code;
+		g_pendingDump.insert(g_pendingDump.end(), recordBytes, recordBytes + sizeof(record));
+		g_pendingDump.insert(g_pendingDump.end(), cleanName.c_str(), cleanName.c_str() + cleanName.size() + 1);
+		g_pendingDump.insert(g_pendingDump.end(), codeBytes, codeBytes + size);
+	}
+
+	bool wake = g_pendingMap.size() + g_pendingDump.size() >= FLUSH_THRESHOLD;
+	guard.unlock();
+	if (wake)
+		g_wake.notify_one();
+}
+
+#else
+
+void Init() {
+	if (g_Config.iJitPerfMap > 0)
+		WARN_LOG(Log::JIT, "JitPerfMap: Only supported on Linux");
+}
+
+void Shutdown() {
+}
+
+void RegisterCode(const void *code, size_t size, const std::string &name) {
+}
+
+#endif
+
+void RegisterBlock(const void *code, size_t size, u32 mipsAddress, const char *prefix) {
+	if (!g_enabled)
+		return;
+
+	const std::string label = g_symbolMap ? g_symbolMap->GetDescription(mipsAddress) : "";
+	if (!label.empty())
+		RegisterCode(code, size, StringFromFormat("%s%08x_%s", prefix, mipsAddress, label.c_str()));
+	else
+		RegisterCode(code, size, StringFromFormat("%s%08x", prefix, mipsAddress));
+}
+
+void RegisterFixedCode(const u8 *start, const u8 *end, const std::function<bool(const u8 *, std::string &)> &describe) {
+	if (!g_enabled)
+		return;
+
+	const u8 *rangeStart = start;
+	std::string rangeName;
+	std::string lastName;
+	for (const u8 *p = start; p < end; ++p) {
+		std::string name;
+		if (!describe(p, name))
+			name.clear();
+		if (p != start && name == lastName)
+			continue;
+
+		// Entry points only match exactly, so the range continues under the entry's name.
+		if (p - rangeStart > 1) {
+			RegisterCode(rangeStart, p - rangeStart, rangeName.empty() ? "fixedCode" : rangeName);
+			rangeStart = p;
+			rangeName = name;
+		} else if (p == start) {
+			rangeName = name;
+		}
+		lastName = name;
+	}
+	if (end > rangeStart)
+		RegisterCode(rangeStart, end - rangeStart, rangeName.empty() ? "fixedCode" : rangeName);
+}
+
+}  // namespace JitPerfMap
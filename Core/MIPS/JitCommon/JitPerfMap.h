@@ -0,0 +1,54 @@
+// Copyright (c) 2024- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+
+#include "Common/CommonTypes.h"
+
+// Optional symbols for generated code, for Linux perf (the JitPerfMap ini setting.)
+//
+// 1 writes /tmp/perf-PID.map, which perf report reads by itself. Since code space gets
+// reused after the cache is cleared, old entries can point at the wrong block.
+// 2 also writes /tmp/jit-PID.dump with a copy of each block's code, which keeps reused
+// code apart and allows annotating. Record with perf record -k 1, then run
+// perf inject --jit -i perf.data -o perf.jit.data before perf report.
+//
+// Lines and records are queued and written from a background thread.
+namespace JitPerfMap {
+
+extern bool g_enabled;
+inline bool IsEnabled() {
+	return g_enabled;
+}
+
+// Called by MIPSState::Init and MIPSState::Shutdown.
+void Init();
+void Shutdown();
+
+// Names a range of generated code. Spaces are replaced, perf cuts names off at them.
+void RegisterCode(const void *code, size_t size, const std::string &name);
+// Names a compiled block by its MIPS address and the symbol around it, like the disassembly does.
+void RegisterBlock(const void *code, size_t size, u32 mipsAddress, const char *prefix = "");
+// Splits the fixed code in [start, end) into ranges starting at each pointer that
+// describe() has a name for, and names them (usually a jit's DescribeCodePtr.)
+void RegisterFixedCode(const u8 *start, const u8 *end, const std::function<bool(const u8 *, std::string &)> &describe);
+
+}  // namespace JitPerfMap
@@ -0,0 +1,395 @@
+// Copyright (c) 2024- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Common/Log.h"
+#include "Common/MachineContext.h"
+#include "Common/MemoryUtil.h"
+#include "Core/Config.h"
+#include "Core/MemMap.h"
+#include "Core/MIPS/JitCommon/JitWriteProtect.h"
+
+namespace JitWriteProtect {
+
+bool g_enabled = false;
+
+enum : u8 {
+	// Read-only, has blocks that are up to date.
+	PAGE_PROTECTED = 1,
+	// Written since some of its blocks were compiled. Not protected.
+	PAGE_WRITTEN = 2,
+	// Claimed by whoever is making a protected page writable. Faults on it just retry.
+	PAGE_UNPROTECTING = 3,
+	// Zero means the page has no blocks, and isn't protected.
+};
+
+// Physical address of RAM. We only track RAM, scratchpad and VRAM code is rare.
+static const u32 RAM_START = 0x08000000;
+
+// The fault handler can't take locks, it runs in a signal handler on any thread. It only
+// moves pages from PAGE_PROTECTED to PAGE_WRITTEN (through PAGE_UNPROTECTING), everything
+// else changes page state while holding g_lock. The sizes are set up in Init.
+static std::unique_ptr<std::atomic<u8>[]> g_pageState;
+static u32 g_numPages;
+static u32 g_pageShift;
+static u32 g_ramEnd;
+static std::atomic<u64> g_faults;
+
+// Protects everything below.
+static std::mutex g_lock;
+// Per page count of external writes in progress, see BeginExternalWrite.
+static std::vector<u16> g_pendingWrites;
+static Stats g_stats;
+// Page ranges collected by Invalidate, kept to avoid allocating.
+static std::vector<std::pair<u32, u32>> g_invalidateRanges;
+
+static bool HasFaultHandler() {
+#ifdef MACHINE_CONTEXT_SUPPORTED
+	return true;
+#else
+	// InstallExceptionHandler() is only a stub, nothing would make pages writable again.
+	return false;
+#endif
+}
+
+void Init() {
+	std::lock_guard<std::mutex> guard(g_lock);
+	g_enabled = false;
+	g_pageState.reset();
+	g_numPages = 0;
+	g_pendingWrites.clear();
+	g_stats = {};
+	g_faults = 0;
+	if (!g_Config.bJitWriteProtect)
+		return;
+	if (!HasFaultHandler()) {
+		WARN_LOG(Log::JIT, "JitWriteProtect: No fault handler on this platform, disabled");
+		return;
+	}
+	if (!Memory::CanProtectRAM()) {
+		WARN_LOG(Log::JIT, "JitWriteProtect: Write protection of views not supported on this platform, disabled");
+		return;
+	}
+
+	const u32 pageSize = (u32)GetMemoryProtectPageSize();
+	if (pageSize == 0 || (pageSize & (pageSize - 1)) != 0 || (RAM_START & (pageSize - 1)) != 0) {
+		WARN_LOG(Log::JIT, "JitWriteProtect: Unexpected page size %d, disabled", pageSize);
+		return;
+	}
+	g_pageShift = 0;
+	while ((1U << g_pageShift) < pageSize)
+		g_pageShift++;
+	g_ramEnd = RAM_START + Memory::g_MemorySize;
+	g_numPages = Memory::g_MemorySize >> g_pageShift;
+	g_pageState.reset(new std::atomic<u8>[g_numPages]);
+	for (u32 page = 0; page < g_numPages; ++page)
+		g_pageState[page].store(0);
+	g_pendingWrites.resize(g_numPages);
+	g_enabled = true;
+	INFO_LOG(Log::JIT, "JitWriteProtect: Tracking writes to %d pages of %d bytes", (int)g_numPages, pageSize);
+}
+
+// Must hold g_lock. Calls func(page, count) for runs of pages where pred(page) is true.
+template <typename P, typename F>
+static void ForEachPageRun(u32 firstPage, u32 lastPage, P pred, F func) {
+	u32 runStart = firstPage;
+	u32 runLength = 0;
+	for (u32 page = firstPage; page <= lastPage; ++page) {
+		if (pred(page)) {
+			if (runLength == 0)
+				runStart = page;
+			runLength++;
+		} else if (runLength != 0) {
+			func(runStart, runLength);
+			runLength = 0;
+		}
+	}
+	if (runLength != 0)
+		func(runStart, runLength);
+}
+
+static bool ProtectPages(u32 page, u32 count, bool writable) {
+	return Memory::ProtectRAM(RAM_START + (page << g_pageShift), count << g_pageShift, writable);
+}
+
+// Converts a range to host pages, returns false if it's not in RAM.
+static bool RangeToPages(u32 address, u32 size, u32 *firstPage, u32 *lastPage) {
+	if (size == 0 || (address & 0x20000000) != 0)
+		return false;
+	const u32 start = std::max(address & 0x1FFFFFFF, RAM_START);
+	const u32 end = (u32)std::min((u64)(address & 0x1FFFFFFF) + size, (u64)g_ramEnd);
+	if (start >= end)
+		return false;
+	*firstPage = (start - RAM_START) >> g_pageShift;
+	*lastPage = (end - 1 - RAM_START) >> g_pageShift;
+	return true;
+}
+
+static bool ClaimProtectedPage(u32 page) {
+	u8 expected = PAGE_PROTECTED;
+	return g_pageState[page].compare_exchange_strong(expected, PAGE_UNPROTECTING);
+}
+
+// Must hold g_lock. Makes protected pages writable, and marks them as written.
+static void UnprotectPagesLocked(u32 firstPage, u32 lastPage) {
+	ForEachPageRun(firstPage, lastPage, &ClaimProtectedPage, [](u32 page, u32 count) {
+		ProtectPages(page, count, true);
+		for (u32 p = page; p < page + count; ++p)
+			g_pageState[p].store(PAGE_WRITTEN);
+	});
+}
+
+static u32 CountProtectedPagesLocked() {
+	u32 count = 0;
+	for (u32 page = 0; page < g_numPages; ++page) {
+		if (g_pageState[page].load() == PAGE_PROTECTED)
+			count++;
+	}
+	return count;
+}
+
+static void ResetLocked() {
+	if (g_numPages == 0)
+		return;
+	UnprotectPagesLocked(0, g_numPages - 1);
+	// A fault handler might still be finishing a page, it'll just stay written.
+	// Pages with external writes in progress stay written too, so they're not protected again.
+	for (u32 page = 0; page < g_numPages; ++page) {
+		if (g_pageState[page].load() == PAGE_WRITTEN && g_pendingWrites[page] == 0)
+			g_pageState[page].store(0);
+	}
+}
+
+void Reset() {
+	if (!g_enabled)
+		return;
+	std::lock_guard<std::mutex> guard(g_lock);
+	ResetLocked();
+}
+
+void Shutdown() {
+	if (!g_enabled)
+		return;
+	LogAndResetStats();
+	std::lock_guard<std::mutex> guard(g_lock);
+	ResetLocked();
+	g_enabled = false;
+	g_pageState.reset();
+	g_numPages = 0;
+	g_pendingWrites.clear();
+}
+
+void OnBlockFinalized(u32 address, u32 size) {
+	if (!g_enabled)
+		return;
+	std::lock_guard<std::mutex> guard(g_lock);
+	u32 firstPage, lastPage;
+	if (!RangeToPages(address, size, &firstPage, &lastPage))
+		return;
+	// Pages that were written stay unprotected, they may already have stale blocks.
+	ForEachPageRun(firstPage, lastPage, [](u32 page) {
+		return g_pageState[page].load() == 0;
+	}, [](u32 page, u32 count) {
+		// Set the state first, so a fault as soon as it's read-only finds it.
+		for (u32 p = page; p < page + count; ++p)
+			g_pageState[p].store(PAGE_PROTECTED);
+		if (!ProtectPages(page, count, false)) {
+			// Some of the mirrors may have been protected anyway.
+			UnprotectPagesLocked(page, page + count - 1);
+		}
+	});
+}
+
+void NotifyWrite(u32 address, u32 size) {
+	if (!g_enabled)
+		return;
+	std::lock_guard<std::mutex> guard(g_lock);
+	u32 firstPage, lastPage;
+	if (RangeToPages(address, size, &firstPage, &lastPage))
+		UnprotectPagesLocked(firstPage, lastPage);
+}
+
+void NotifyHostWrite(const void *ptr, size_t size) {
+	if (!g_enabled || size == 0)
+		return;
+	const uintptr_t baseAddress = (uintptr_t)Memory::base;
+	const uintptr_t hostAddress = (uintptr_t)ptr;
+	if (hostAddress < baseAddress || hostAddress >= baseAddress + 0x100000000ULL)
+		return;
+	const u64 address = hostAddress - baseAddress;
+	NotifyWrite((u32)address, (u32)std::min((u64)size, 0x100000000ULL - address));
+}
+
+void BeginExternalWrite(u32 address, u32 size) {
+	if (!g_enabled)
+		return;
+	std::lock_guard<std::mutex> guard(g_lock);
+	u32 firstPage, lastPage;
+	if (!RangeToPages(address, size, &firstPage, &lastPage))
+		return;
+	UnprotectPagesLocked(firstPage, lastPage);
+	for (u32 page = firstPage; page <= lastPage; ++page) {
+		// Also pages without blocks, so they aren't skipped when the write is invalidated.
+		if (g_pageState[page].load() == 0)
+			g_pageState[page].store(PAGE_WRITTEN);
+		g_pendingWrites[page]++;
+	}
+}
+
+void EndExternalWrite(u32 address, u32 size) {
+	if (!g_enabled)
+		return;
+	std::lock_guard<std::mutex> guard(g_lock);
+	u32 firstPage, lastPage;
+	if (!RangeToPages(address, size, &firstPage, &lastPage))
+		return;
+	// The pages stay written until the range is invalidated.
+	for (u32 page = firstPage; page <= lastPage; ++page) {
+		_dbg_assert_(g_pendingWrites[page] != 0);
+		if (g_pendingWrites[page] != 0)
+			g_pendingWrites[page]--;
+	}
+}
+
+bool HandleFault(uintptr_t hostAddress) {
+	// Runs in a signal handler, so no locks or allocation here.
+	if (!g_enabled)
+		return false;
+	const uintptr_t baseAddress = (uintptr_t)Memory::base;
+	if (hostAddress < baseAddress || hostAddress >= baseAddress + 0x100000000ULL)
+		return false;
+
+	u32 page, lastPage;
+	if (!RangeToPages((u32)(hostAddress - baseAddress), 1, &page, &lastPage))
+		return false;
+	if (ClaimProtectedPage(page)) {
+		ProtectPages(page, 1, true);
+		g_pageState[page].store(PAGE_WRITTEN);
+		g_faults++;
+		return true;
+	}
+	switch (g_pageState[page].load()) {
+	case PAGE_UNPROTECTING:
+		// Someone else is making it writable, just retry until they're done.
+	case PAGE_WRITTEN:
+		return true;
+	default:
+		// Not one of ours, let the regular handler deal with it.
+		return false;
+	}
+}
+
+void WriteOpcode(u32 address, u32 value) {
+	std::lock_guard<std::mutex> guard(g_lock);
+	u32 page, lastPage;
+	if (g_enabled && RangeToPages(address, 4, &page, &lastPage) && ClaimProtectedPage(page)) {
+		// Other writers to the page wait in the fault handler until it's protected again.
+		ProtectPages(page, 1, true);
+		Memory::WriteUnchecked_U32(value, address);
+		ProtectPages(page, 1, false);
+		g_pageState[page].store(PAGE_PROTECTED);
+	} else {
+		Memory::WriteUnchecked_U32(value, address);
+	}
+}
+
+void Invalidate(u32 address, u32 length, const std::function<void(u32, u32)> &invalidate) {
+	if (!g_enabled || length == 0 || (address & 0x20000000) != 0) {
+		invalidate(address, length);
+		return;
+	}
+
+	const u64 end = (u64)address + length;
+	// RAM as seen from the mirror the request starts in. Nothing outside it is tracked.
+	const u32 mirror = address & ~0x1FFFFFFF;
+	const u64 ramStart = mirror + RAM_START;
+	const u64 ramEnd = mirror + g_ramEnd;
+	const u64 start = std::max((u64)address, ramStart);
+	const u64 stop = std::min(end, ramEnd);
+
+	{
+		std::lock_guard<std::mutex> guard(g_lock);
+		g_stats.requests++;
+		g_stats.requestedBytes += length;
+
+		g_invalidateRanges.clear();
+		if (address < ramStart)
+			g_invalidateRanges.emplace_back(address, (u32)(std::min(end, ramStart) - address));
+		if (start < stop) {
+			const u32 firstPage = (u32)(start - ramStart) >> g_pageShift;
+			const u32 lastPage = (u32)(stop - 1 - ramStart) >> g_pageShift;
+			ForEachPageRun(firstPage, lastPage, [](u32 page) {
+				const u8 state = g_pageState[page].load();
+				return state == PAGE_WRITTEN || state == PAGE_UNPROTECTING;
+			}, [&](u32 page, u32 count) {
+				const u64 runStart = std::max(ramStart + (page << g_pageShift), start);
+				const u64 runEnd = std::min(ramStart + ((u64)(page + count) << g_pageShift), stop);
+				g_invalidateRanges.emplace_back((u32)runStart, (u32)(runEnd - runStart));
+				// Pages covered completely won't have any blocks left afterward.
+				// Unless something is still writing to them, then they have to wait for the next one.
+				for (u32 p = page; p < page + count; ++p) {
+					const u64 pageStart = ramStart + ((u64)p << g_pageShift);
+					if (pageStart >= start && pageStart + (1ULL << g_pageShift) <= stop && g_pendingWrites[p] == 0 && g_pageState[p].load() == PAGE_WRITTEN)
+						g_pageState[p].store(0);
+				}
+			});
+		}
+		if (end > ramEnd) {
+			const u64 afterStart = std::max((u64)address, ramEnd);
+			g_invalidateRanges.emplace_back((u32)afterStart, (u32)(end - afterStart));
+		}
+
+		u64 invalidated = 0;
+		for (const auto &range : g_invalidateRanges)
+			invalidated += range.second;
+		g_stats.invalidatedBytes += invalidated;
+		if (invalidated == 0)
+			g_stats.skippedRequests++;
+	}
+
+	// Can't hold the lock here, destroying blocks writes back their original opcodes.
+	// The caller holds the jit lock, so nobody else touches the ranges meanwhile.
+	for (const auto &range : g_invalidateRanges)
+		invalidate(range.first, range.second);
+}
+
+Stats GetStats() {
+	std::lock_guard<std::mutex> guard(g_lock);
+	Stats stats = g_stats;
+	stats.faults = g_faults.load();
+	stats.protectedPages = (int)CountProtectedPagesLocked();
+	return stats;
+}
+
+void LogAndResetStats() {
+	std::lock_guard<std::mutex> guard(g_lock);
+	const u64 faults = g_faults.exchange(0);
+	if (g_stats.requests != 0 || faults != 0) {
+		NOTICE_LOG(Log::JIT, "JitWriteProtect: %llu invalidations (%llu skipped entirely), %llu of %llu bytes invalidated, %llu write faults, %d pages protected",
+			(unsigned long long)g_stats.requests, (unsigned long long)g_stats.skippedRequests,
+			(unsigned long long)g_stats.invalidatedBytes, (unsigned long long)g_stats.requestedBytes,
+			(unsigned long long)faults, (int)CountProtectedPagesLocked());
+	}
+	g_stats = {};
+}
+
+}  // namespace JitWriteProtect
@@ -0,0 +1,87 @@
+// Copyright (c) 2024- PPSSPP Project.
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, version 2.0 or later versions.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License 2.0 for more details.
+
+// A copy of the GPL 2.0 should have been included with the program.
+// If not, see http://www.gnu.org/licenses/
+
+// Official git repository and contact information can be found at
+// https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "Common/CommonTypes.h"
+
+// Optional self-modifying code detection using write protection (the JitWriteProtect ini setting.)
+//
+// Once a block has been compiled, the host pages of RAM it covers are made read-only in
+// every mirror of the fastmem view. A write to such a page faults, and the fault handler
+// makes the page writable again and remembers that it was written. Explicit icache
+// invalidations (from HLE, module loading, DMA and so on) then only need to look at pages
+// that were actually written since their blocks were compiled, everything else is skipped.
+//
+// Only used where MemArena can protect views (currently the POSIX arena) and there's a fault
+// handler. HLE code that passes RAM to system calls that write to it (like file reads or recv)
+// must call NotifyWrite first, since the kernel returns EFAULT rather than fault into our
+// handler. NotifyMemInfo takes care of that. If the system call may run on another thread
+// (async IO), use BeginExternalWrite/EndExternalWrite instead, so that the pages aren't
+// protected again while it's still writing.
+namespace JitWriteProtect {
+
+struct Stats {
+	u64 faults;
+	// Explicit invalidations, in requests and bytes.
+	u64 requests;
+	u64 requestedBytes;
+	// What was actually passed on to the JIT.
+	u64 invalidatedBytes;
+	// Requests that turned out to need no invalidation at all.
+	u64 skippedRequests;
+	int protectedPages;
+};
+
+extern bool g_enabled;
+inline bool IsEnabled() {
+	return g_enabled;
+}
+
+// Called by Memory::Init and Memory::Shutdown.
+void Init();
+void Shutdown();
+// Called when the block cache is cleared, makes all of RAM writable again. Keeps the stats.
+void Reset();
+
+// Protects the pages of a newly compiled block, unless they've been written already.
+void OnBlockFinalized(u32 address, u32 size);
+// Marks pages as written, and makes them writable. For writes that can't fault.
+void NotifyWrite(u32 address, u32 size);
+// Same, for a pointer into RAM from Memory::GetPointer. Anything else is ignored.
+void NotifyHostWrite(const void *ptr, size_t size);
+// Like NotifyWrite, but the pages also stay unprotected until EndExternalWrite, even if they're
+// invalidated and get new blocks meanwhile. Can be nested, calls must match.
+void BeginExternalWrite(u32 address, u32 size);
+void EndExternalWrite(u32 address, u32 size);
+// Called from the fault handler, on any thread. Lock-free. Returns true if it was a write to a
+// protected page, in which case the access can simply be retried.
+bool HandleFault(uintptr_t hostAddress);
+// Writes an emuhack or the original opcode back, without marking the page as written.
+void WriteOpcode(u32 address, u32 value);
+
+// Calls invalidate(address, length) for the parts of the range that may contain stale code.
+void Invalidate(u32 address, u32 length, const std::function<void(u32, u32)> &invalidate);
+
+Stats GetStats();
+void LogAndResetStats();
+
+}  // namespace JitWriteProtect
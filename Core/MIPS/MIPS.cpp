@@ -35,6 +35,8 @@
 #include "Core/Core.h"
 #include "Core/System.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
+#include "Core/MIPS/JitCommon/JitPerfMap.h"
+#include "Core/MIPS/JitCommon/JitWriteProtect.h"
 #include "Core/CoreTiming.h"
 
 MIPSState mipsr4k;
@@ -167,6 +169,7 @@ void MIPSState::Shutdown() {
 		MIPSComp::jit = nullptr;
 		delete oldjit;
 	}
+	JitPerfMap::Shutdown();
 }
 
 void MIPSState::Reset() {
@@ -211,6 +214,7 @@ void MIPSState::Init() {
 
 	std::lock_guard<std::recursive_mutex> guard(MIPSComp::jitLock);
 	if (PSP_CoreParameter().cpuCore == CPUCore::JIT || PSP_CoreParameter().cpuCore == CPUCore::JIT_IR) {
+		JitPerfMap::Init();
 		MIPSComp::jit = MIPSComp::CreateNativeJit(this, PSP_CoreParameter().cpuCore == CPUCore::JIT_IR);
 	} else if (PSP_CoreParameter().cpuCore == CPUCore::IR_INTERPRETER) {
 		MIPSComp::jit = new MIPSComp::IRJit(this, false);
@@ -246,6 +250,7 @@ void MIPSState::UpdateCore(CPUCore desired) {
 	case CPUCore::JIT:
 	case CPUCore::JIT_IR:
 		INFO_LOG(Log::CPU, "Switching to JIT%s", PSP_CoreParameter().cpuCore == CPUCore::JIT_IR ? " IR" : "");
+		JitPerfMap::Init();
 		newjit = MIPSComp::CreateNativeJit(this, PSP_CoreParameter().cpuCore == CPUCore::JIT_IR);
 		break;
 
@@ -372,7 +377,14 @@ void MIPSState::InvalidateICache(u32 address, int length) {
 	// Note that the backend is responsible for ensuring native code can still be returned to.
 	std::lock_guard<std::recursive_mutex> guard(MIPSComp::jitLock);
 	if (MIPSComp::jit && length != 0) {
-		MIPSComp::jit->InvalidateCacheAt(address, length);
+		if (JitWriteProtect::IsEnabled()) {
+			// Skips the pages that haven't been written to since they were compiled.
+			JitWriteProtect::Invalidate(address, length, [](u32 start, u32 size) {
+				MIPSComp::jit->InvalidateCacheAt(start, size);
+			});
+		} else {
+			MIPSComp::jit->InvalidateCacheAt(address, length);
+		}
 	}
 }
 
@@ -25,10 +25,12 @@
 #include "Common/File/FileUtil.h"
 #include "Common/Log.h"
 #include "Common/StringUtils.h"
+#include "Common/Thread/ParallelLoop.h"
 #include "Common/TimeUtil.h"
 #include "Core/Config.h"
 #include "Core/MemMap.h"
 #include "Core/System.h"
+#include "Core/ELF/ParamSFO.h"
 #include "Core/MIPS/MIPS.h"
 #include "Core/MIPS/MIPSVFPUUtils.h"
 #include "Core/MIPS/MIPSTables.h"
@@ -590,6 +592,419 @@ namespace MIPSAnalyst {
 		return (op >> 26) == 0 && (op & 0x3f) == 12;
 	}
 
+	bool IsIdlePollingLoop(u32 startAddr, u32 branchAddr) {
+		// Polling loops are tiny, anything longer is likely doing real work.
+		const u32 MAX_IDLE_LOOP_INSTRUCTIONS = 8;
+		// Anything that has side effects, or reads state we don't track here.
+		const u64 UNSAFE_FLAGS = BAD_INSTRUCTION | LIKELY | IS_JUMP | IS_SYSCALL | IS_CONDMOVE | OUT_MEM | OUT_RA |
+			IN_OTHER | OUT_OTHER | IS_FPU | IS_VFPU | IN_LO | IN_HI | OUT_LO | OUT_HI | IN_FPUFLAG | IN_VFPU_CC |
+			OUT_FPUFLAG | OUT_VFPU_CC | OUT_EAT_PREFIX;
+
+		if (branchAddr < startAddr || (branchAddr - startAddr) / 4 + 2 > MAX_IDLE_LOOP_INSTRUCTIONS)
+			return false;
+
+		u32 readFirst = 0;
+		u32 written = 0;
+		for (u32 addr = startAddr; addr <= branchAddr + 4; addr += 4) {
+			MIPSOpcode op = Memory::Read_Opcode_JIT(addr);
+			if (MIPS_IS_EMUHACK(op))
+				return false;
+			MIPSInfo info = MIPSGetInfo(op);
+			if ((info & UNSAFE_FLAGS) != 0)
+				return false;
+			// The only branch must be the one looping back.
+			if (((info & IS_CONDBRANCH) != 0) != (addr == branchAddr))
+				return false;
+			// Like cache, which only reads memory for its side effects.
+			if ((info & IN_MEM) != 0 && (info & OUT_RT) == 0)
+				return false;
+
+			for (MIPSGPReg reg : GetInputRegs(op)) {
+				if ((written & (1U << reg)) == 0)
+					readFirst |= 1U << reg;
+			}
+			for (MIPSGPReg reg : GetOutputRegs(op)) {
+				if (reg != MIPS_REG_ZERO)
+					written |= 1U << reg;
+			}
+		}
+
+		// If an iteration feeds a later one (like a counter), each iteration isn't the same.
+		return (readFirst & written) == 0;
+	}
+
+	// A value in MatchByteLoop(), a symbol (or two) plus a constant.
+	struct LoopValue {
+		enum Kind : u8 {
+			UNKNOWN,
+			CONST,
+			// sym + off.
+			SYM,
+			// sym + sym2 + off, with sym <= sym2.
+			SUM,
+			// sym - sym2 + off.
+			DIFF,
+			// Whatever the loop loaded this iteration.
+			LOADED,
+		};
+
+		Kind kind = UNKNOWN;
+		u8 sym = 0;
+		u8 sym2 = 0;
+		s32 off = 0;
+
+		static LoopValue Make(Kind kind, s32 off, u8 sym = 0, u8 sym2 = 0) {
+			LoopValue v;
+			v.kind = kind;
+			v.sym = sym;
+			v.sym2 = sym2;
+			v.off = off;
+			return v;
+		}
+
+		bool operator ==(const LoopValue &other) const {
+			return kind == other.kind && sym == other.sym && sym2 == other.sym2 && off == other.off;
+		}
+		bool HasOffset() const {
+			return kind == CONST || kind == SYM || kind == SUM || kind == DIFF;
+		}
+	};
+
+	// Symbols are registers at function entry, registers at the start of the current iteration,
+	// and the address of the terminator strlen stops at.
+	static u8 EntrySym(MIPSGPReg reg) {
+		return (u8)reg;
+	}
+	static u8 IterSym(MIPSGPReg reg) {
+		return (u8)(32 + reg);
+	}
+	static const u8 TERMINATOR_SYM = 64;
+
+	static LoopValue LoopAddImm(const LoopValue &a, s32 imm) {
+		if (!a.HasOffset())
+			return LoopValue();
+		LoopValue result = a;
+		result.off += imm;
+		return result;
+	}
+
+	static LoopValue LoopAdd(const LoopValue &a, const LoopValue &b) {
+		if (a.kind == LoopValue::CONST)
+			return LoopAddImm(b, a.off);
+		if (b.kind == LoopValue::CONST)
+			return LoopAddImm(a, b.off);
+		if (a.kind == LoopValue::SYM && b.kind == LoopValue::SYM)
+			return LoopValue::Make(LoopValue::SUM, a.off + b.off, std::min(a.sym, b.sym), std::max(a.sym, b.sym));
+		return LoopValue();
+	}
+
+	static LoopValue LoopSub(const LoopValue &a, const LoopValue &b) {
+		if (b.kind == LoopValue::CONST)
+			return LoopAddImm(a, -b.off);
+		if (a.kind == LoopValue::SYM && b.kind == LoopValue::SYM) {
+			if (a.sym == b.sym)
+				return LoopValue::Make(LoopValue::CONST, a.off - b.off);
+			return LoopValue::Make(LoopValue::DIFF, a.off - b.off, a.sym, b.sym);
+		}
+		if (a.kind == LoopValue::SUM && b.kind == LoopValue::SYM) {
+			if (a.sym == b.sym)
+				return LoopValue::Make(LoopValue::SYM, a.off - b.off, a.sym2);
+			if (a.sym2 == b.sym)
+				return LoopValue::Make(LoopValue::SYM, a.off - b.off, a.sym);
+		}
+		return LoopValue();
+	}
+
+	struct ByteLoopState {
+		LoopValue regs[32];
+		int loads = 0;
+		int stores = 0;
+		LoopValue loadAddr;
+		LoopValue storeAddr;
+		LoopValue storeValue;
+	};
+
+	static bool IsScratchReg(MIPSGPReg reg) {
+		return (reg >= MIPS_REG_COMPILER_SCRATCH && reg <= MIPS_REG_T7) || reg == MIPS_REG_T8 || reg == MIPS_REG_T9;
+	}
+
+	// Runs a non-branch instruction of MatchByteLoop() on symbolic values.
+	// Returns false for anything it doesn't understand. Memory is only accessed inside the loop.
+	static bool ByteLoopStep(ByteLoopState &s, MIPSOpcode op, bool inLoop) {
+		if (op == MIPS_MAKE_NOP())
+			return true;
+
+		const MIPSGPReg rs = MIPS_GET_RS(op);
+		const MIPSGPReg rt = MIPS_GET_RT(op);
+		const MIPSGPReg rd = MIPS_GET_RD(op);
+		const s32 simm = (s16)(op & 0xFFFF);
+		MIPSGPReg dest;
+		LoopValue result;
+		switch (MIPS_GET_OP(op)) {
+		case 0:
+			dest = rd;
+			switch (MIPS_GET_FUNC(op)) {
+			case 0x21: result = LoopAdd(s.regs[rs], s.regs[rt]); break;  // addu
+			case 0x23: result = LoopSub(s.regs[rs], s.regs[rt]); break;  // subu
+			case 0x25:  // or, only as move.
+				if (rt == MIPS_REG_ZERO)
+					result = s.regs[rs];
+				else if (rs == MIPS_REG_ZERO)
+					result = s.regs[rt];
+				break;
+			default:
+				return false;
+			}
+			break;
+
+		case 0x09:  // addiu
+			dest = rt;
+			result = LoopAddImm(s.regs[rs], simm);
+			break;
+
+		case 0x20:  // lb
+		case 0x24:  // lbu
+			if (!inLoop || s.loads++ != 0)
+				return false;
+			s.loadAddr = LoopAddImm(s.regs[rs], simm);
+			dest = rt;
+			result.kind = LoopValue::LOADED;
+			break;
+
+		case 0x28:  // sb
+			if (!inLoop || s.stores++ != 0)
+				return false;
+			s.storeAddr = LoopAddImm(s.regs[rs], simm);
+			s.storeValue = s.regs[rt];
+			return true;
+
+		default:
+			return false;
+		}
+
+		// The replacement only sets v0, so callers mustn't be able to see anything else change.
+		if (dest != MIPS_REG_ZERO) {
+			if (!IsScratchReg(dest))
+				return false;
+			s.regs[dest] = result;
+		}
+		return true;
+	}
+
+	static bool RunByteLoopEpilogue(ByteLoopState s, const MIPSOpcode *ops, int from, int count, LoopValue *v0) {
+		for (int i = from; i < count; ++i) {
+			// The jr ra is at count - 2, its delay slot still runs.
+			if (i != count - 2 && !ByteLoopStep(s, ops[i], false))
+				return false;
+		}
+		*v0 = s.regs[MIPS_REG_V0];
+		return true;
+	}
+
+	const char *MatchByteLoop(u32 startAddr, u32 size) {
+		const int MAX_INSTRUCTIONS = 24;
+		const int count = (int)(size / 4);
+		if ((size & 3) != 0 || count < 4 || count > MAX_INSTRUCTIONS)
+			return nullptr;
+
+		MIPSOpcode ops[MAX_INSTRUCTIONS];
+		for (int i = 0; i < count; ++i) {
+			ops[i] = Memory::Read_Instruction(startAddr + i * 4, true);
+			if (MIPS_IS_EMUHACK(ops[i]))
+				return nullptr;
+		}
+		if (ops[count - 2] != MIPS_MAKE_JR_RA())
+			return nullptr;
+
+		// Layout: a prologue with an optional forward guard branch, then the loop ending in a
+		// backward bne, then the epilogue and jr ra.
+		int guard = -1;
+		int guardTarget = -1;
+		int loopStart = -1;
+		int loopBranch = -1;
+		for (int i = 0; i < count - 2; ++i) {
+			MIPSInfo info = MIPSGetInfo(ops[i]);
+			if ((info & IS_JUMP) != 0)
+				return nullptr;
+			if ((info & IS_CONDBRANCH) == 0)
+				continue;
+			if ((info & LIKELY) != 0 || loopBranch != -1)
+				return nullptr;
+
+			const u32 addr = startAddr + i * 4;
+			const u32 target = GetBranchTargetNoRA(addr, ops[i]);
+			if (target == INVALIDTARGET || target < startAddr || target >= startAddr + size)
+				return nullptr;
+			if (target <= addr) {
+				loopBranch = i;
+				loopStart = (int)((target - startAddr) / 4);
+			} else if (guard == -1) {
+				guard = i;
+				guardTarget = (int)((target - startAddr) / 4);
+			} else {
+				return nullptr;
+			}
+		}
+		if (loopBranch == -1 || loopBranch + 2 > count - 2 || MIPS_GET_OP(ops[loopBranch]) != 0x05)
+			return nullptr;
+		if (guard != -1) {
+			if (guard + 1 >= loopStart || guardTarget < loopBranch + 2 || guardTarget > count - 2)
+				return nullptr;
+			// beq or blez.
+			if (MIPS_GET_OP(ops[guard]) != 0x04 && MIPS_GET_OP(ops[guard]) != 0x06)
+				return nullptr;
+		}
+
+		ByteLoopState prologue;
+		for (int r = 0; r < 32; ++r)
+			prologue.regs[r] = LoopValue::Make(LoopValue::SYM, 0, EntrySym((MIPSGPReg)r));
+		prologue.regs[MIPS_REG_ZERO] = LoopValue::Make(LoopValue::CONST, 0);
+
+		ByteLoopState guardState;
+		LoopValue guardA, guardB;
+		for (int i = 0; i < loopStart; ++i) {
+			if (i == guard) {
+				guardA = prologue.regs[MIPS_GET_RS(ops[i])];
+				guardB = prologue.regs[MIPS_GET_RT(ops[i])];
+				continue;
+			}
+			if (!ByteLoopStep(prologue, ops[i], false))
+				return nullptr;
+			if (i == guard + 1)
+				guardState = prologue;
+		}
+
+		ByteLoopState loop;
+		for (int r = 0; r < 32; ++r)
+			loop.regs[r] = LoopValue::Make(LoopValue::SYM, 0, IterSym((MIPSGPReg)r));
+		loop.regs[MIPS_REG_ZERO] = LoopValue::Make(LoopValue::CONST, 0);
+
+		LoopValue branchA, branchB;
+		for (int i = loopStart; i <= loopBranch + 1; ++i) {
+			if (i == loopBranch) {
+				branchA = loop.regs[MIPS_GET_RS(ops[i])];
+				branchB = loop.regs[MIPS_GET_RT(ops[i])];
+			} else if (!ByteLoopStep(loop, ops[i], true)) {
+				return nullptr;
+			}
+		}
+
+		// Registers that change by a constant each iteration (or not at all.)
+		bool stepKnown[32]{};
+		s32 step[32]{};
+		for (int r = 0; r < 32; ++r) {
+			const LoopValue &v = loop.regs[r];
+			if (v.kind == LoopValue::SYM && v.sym == IterSym((MIPSGPReg)r)) {
+				stepKnown[r] = true;
+				step[r] = v.off;
+			}
+		}
+		auto usesOnlyStepped = [&](const LoopValue &v) {
+			auto ok = [&](u8 sym) {
+				return sym < 32 || sym >= 64 || stepKnown[sym - 32];
+			};
+			if (v.kind == LoopValue::SYM)
+				return ok(v.sym);
+			if (v.kind == LoopValue::SUM || v.kind == LoopValue::DIFF)
+				return ok(v.sym) && ok(v.sym2);
+			return true;
+		};
+		if (!usesOnlyStepped(loop.loadAddr) || !usesOnlyStepped(loop.storeAddr) || !usesOnlyStepped(loop.storeValue) || !usesOnlyStepped(branchA) || !usesOnlyStepped(branchB))
+			return nullptr;
+
+		// Which register (and offset from its value at the top of the iteration) a value is.
+		auto iterReg = [&](const LoopValue &v, MIPSGPReg *reg, s32 *off) {
+			if (v.kind != LoopValue::SYM || v.sym < 32 || v.sym >= 64)
+				return false;
+			*reg = (MIPSGPReg)(v.sym - 32);
+			*off = v.off;
+			return true;
+		};
+		auto entryIs = [&](MIPSGPReg reg, MIPSGPReg arg, s32 off) {
+			return prologue.regs[reg] == LoopValue::Make(LoopValue::SYM, off, EntrySym(arg));
+		};
+
+		// The registers after the loop: only ones that don't change are known, except strlen's pointer.
+		ByteLoopState after;
+		for (int r = 0; r < 32; ++r) {
+			if (stepKnown[r] && step[r] == 0)
+				after.regs[r] = prologue.regs[r];
+			else if (loop.regs[r].kind == LoopValue::CONST)
+				after.regs[r] = loop.regs[r];
+		}
+
+		MIPSGPReg ptrReg;
+		s32 ptrOff;
+		LoopValue v0;
+		const bool storeToArg0 = loop.stores == 1 && iterReg(loop.storeAddr, &ptrReg, &ptrOff) && stepKnown[ptrReg] && step[ptrReg] == 1 && entryIs(ptrReg, MIPS_REG_A0, -ptrOff);
+		if (loop.stores == 0 && loop.loads == 1) {
+			// strlen: loads each byte from a0 until one is zero.
+			if (guard != -1 || !iterReg(loop.loadAddr, &ptrReg, &ptrOff) || !stepKnown[ptrReg] || step[ptrReg] != 1 || !entryIs(ptrReg, MIPS_REG_A0, -ptrOff))
+				return nullptr;
+			const LoopValue zero = LoopValue::Make(LoopValue::CONST, 0);
+			if (!(branchA.kind == LoopValue::LOADED && branchB == zero) && !(branchB.kind == LoopValue::LOADED && branchA == zero))
+				return nullptr;
+
+			// The last iteration loaded the terminator, and then still stepped the pointer.
+			after.regs[ptrReg] = LoopValue::Make(LoopValue::SYM, 1 - ptrOff, TERMINATOR_SYM);
+			if (!RunByteLoopEpilogue(after, ops, loopBranch + 2, count, &v0))
+				return nullptr;
+			return v0 == LoopValue::Make(LoopValue::DIFF, 0, TERMINATOR_SYM, EntrySym(MIPS_REG_A0)) ? "strlen_byteloop" : nullptr;
+		}
+		if (!storeToArg0)
+			return nullptr;
+
+		const char *name = nullptr;
+		MIPSGPReg srcReg;
+		s32 srcOff;
+		if (loop.loads == 0 && iterReg(loop.storeValue, &srcReg, &srcOff) && srcOff == 0 && stepKnown[srcReg] && step[srcReg] == 0 && entryIs(srcReg, MIPS_REG_A1, 0)) {
+			name = "memset_byteloop";
+		} else if (loop.loads == 1 && loop.storeValue.kind == LoopValue::LOADED && iterReg(loop.loadAddr, &srcReg, &srcOff) && srcReg != ptrReg && stepKnown[srcReg] && step[srcReg] == 1 && entryIs(srcReg, MIPS_REG_A1, -srcOff)) {
+			name = "memcpy_byteloop";
+		} else {
+			return nullptr;
+		}
+
+		// The loop has to run exactly a2 times.
+		const LoopValue byteCount = LoopValue::Make(LoopValue::SYM, 0, EntrySym(MIPS_REG_A2));
+		auto runsCountTimes = [&](const LoopValue &a, const LoopValue &b) {
+			MIPSGPReg reg;
+			s32 off;
+			if (!iterReg(a, &reg, &off) || !stepKnown[reg])
+				return false;
+			// Counting down to zero: stops once entry - i + off == 0, after entry + off + 1 iterations.
+			if (step[reg] == -1 && b == LoopValue::Make(LoopValue::CONST, 0))
+				return entryIs(reg, MIPS_REG_A2, -(off + 1));
+			// Counting up to an end: stops once entry + i + off == end, after end - entry - off + 1.
+			MIPSGPReg endReg;
+			s32 endOff;
+			if (step[reg] == 1 && iterReg(b, &endReg, &endOff) && stepKnown[endReg] && step[endReg] == 0) {
+				const LoopValue distance = LoopSub(LoopAddImm(prologue.regs[endReg], endOff), prologue.regs[reg]);
+				return distance == LoopAddImm(byteCount, off - 1);
+			}
+			return false;
+		};
+		if (!runsCountTimes(branchA, branchB) && !runsCountTimes(branchB, branchA))
+			return nullptr;
+
+		// The return value is either dst, like the real thing, or not set at all.
+		auto returnsOk = [&](const LoopValue &v) {
+			return v == LoopValue::Make(LoopValue::SYM, 0, EntrySym(MIPS_REG_A0)) || v == LoopValue::Make(LoopValue::SYM, 0, EntrySym(MIPS_REG_V0));
+		};
+		if (!RunByteLoopEpilogue(after, ops, loopBranch + 2, count, &v0) || !returnsOk(v0))
+			return nullptr;
+
+		if (guard != -1) {
+			// Has to skip the loop only when there's nothing to do.
+			const bool blez = MIPS_GET_OP(ops[guard]) == 0x06;
+			if (blez ? !(guardA == byteCount) : !(LoopSub(guardA, guardB) == byteCount || LoopSub(guardB, guardA) == byteCount))
+				return nullptr;
+			if (!RunByteLoopEpilogue(guardState, ops, guardTarget, count, &v0) || !returnsOk(v0))
+				return nullptr;
+		}
+		return name;
+	}
+
 	static bool IsSWInstr(MIPSOpcode op) {
 		return (op & MIPSTABLE_IMM_MASK) == 0xAC000000;
 	}
@@ -746,10 +1161,61 @@ namespace MIPSAnalyst {
 		return results;
 	}
 	
+	// Function scan cache file, one per game. A header, then module headers, then all functions.
+	#define SCAN_CACHE_MAGIC 0x4E435346  // "FSCN"
+	#define SCAN_CACHE_VERSION 1
+
+	struct ScanCacheHeader {
+		u32 magic;
+		u32 version;
+		u64 fingerprint;
+		u32 numModules;
+		u32 numFunctions;
+	};
+
+	struct ScanCacheModuleHeader {
+		u64 key;
+		u32 numFunctions;
+		u32 insertSymbols;
+	};
+
+	enum {
+		SCAN_CACHE_STRAIGHT_LEAF = 1,
+		SCAN_CACHE_HAS_HASH = 2,
+		SCAN_CACHE_USES_VFPU = 4,
+		SCAN_CACHE_IN_SYMBOL_MAP = 8,
+		SCAN_CACHE_REPLACED = 16,
+	};
+
+	struct ScanCacheFunction {
+		u32 start;
+		u32 end;
+		u64 hash;
+		u32 flags;
+		// The name from the hash map, if any.
+		char name[64];
+		u32 reserved;
+	};
+
+	static_assert(sizeof(ScanCacheFunction) == 88, "ScanCacheFunction is written directly to the cache file");
+
+	struct CachedModuleScan {
+		bool insertSymbols;
+		std::vector<ScanCacheFunction> functions;
+	};
+
+	// All protected by functions_lock.
+	static std::unordered_map<u64, CachedModuleScan> scanCache;
+	static Path scanCachePath;
+	static u64 scanCacheFingerprint;
+	static bool scanCacheLoaded;
+
 	void Reset() {
 		std::lock_guard<std::recursive_mutex> guard(functions_lock);
 		functions.clear();
 		hashToFunction.clear();
+		scanCache.clear();
+		scanCacheLoaded = false;
 	}
 
 	void UpdateHashToFunctionMap() {
@@ -874,40 +1340,44 @@ namespace MIPSAnalyst {
 		return DetermineRegisterUsage(reg, addr, instrs) == USAGE_CLOBBERED;
 	}
 
-	void HashFunctions() {
-		std::lock_guard<std::recursive_mutex> guard(functions_lock);
-		std::vector<u32> buffer;
+	static void HashFunction(AnalyzedFunction &f, std::vector<u32> &buffer) {
+		if (!Memory::IsValidRange(f.start, f.end - f.start + 4)) {
+			return;
+		}
 
-		for (auto iter = functions.begin(), end = functions.end(); iter != end; iter++) {
-			AnalyzedFunction &f = *iter;
-			if (!Memory::IsValidRange(f.start, f.end - f.start + 4)) {
-				continue;
+		// This is unfortunate.  In case of emuhacks or relocs, we have to make a copy.
+		buffer.resize((f.end - f.start + 4) / 4);
+		size_t pos = 0;
+		for (u32 addr = f.start; addr <= f.end; addr += 4) {
+			u32 validbits = 0xFFFFFFFF;
+			MIPSOpcode instr = Memory::ReadUnchecked_Instruction(addr, true);
+			if (MIPS_IS_EMUHACK(instr)) {
+				f.hasHash = false;
+				return;
 			}
 
-			// This is unfortunate.  In case of emuhacks or relocs, we have to make a copy.
-			buffer.resize((f.end - f.start + 4) / 4);
-			size_t pos = 0;
-			for (u32 addr = f.start; addr <= f.end; addr += 4) {
-				u32 validbits = 0xFFFFFFFF;
-				MIPSOpcode instr = Memory::ReadUnchecked_Instruction(addr, true);
-				if (MIPS_IS_EMUHACK(instr)) {
-					f.hasHash = false;
-					goto skip;
-				}
+			MIPSInfo flags = MIPSGetInfo(instr);
+			if (flags & IN_IMM16)
+				validbits &= ~0xFFFF;
+			if (flags & IN_IMM26)
+				validbits &= ~0x03FFFFFF;
+			buffer[pos++] = instr & validbits;
+		}
 
-				MIPSInfo flags = MIPSGetInfo(instr);
-				if (flags & IN_IMM16)
-					validbits &= ~0xFFFF;
-				if (flags & IN_IMM26)
-					validbits &= ~0x03FFFFFF;
-				buffer[pos++] = instr & validbits;
-			}
+		f.hash = CityHash64((const char *) &buffer[0], buffer.size() * sizeof(u32));
+		f.hasHash = true;
+	}
 
-			f.hash = CityHash64((const char *) &buffer[0], buffer.size() * sizeof(u32));
-			f.hasHash = true;
-skip:
-			;
-		}
+	void HashFunctions() {
+		std::lock_guard<std::recursive_mutex> guard(functions_lock);
+
+		// Every function is hashed on its own, so this splits nicely.
+		ParallelRangeLoop(&g_threadManager, [&](int l, int h) {
+			std::vector<u32> buffer;
+			for (int i = l; i < h; ++i) {
+				HashFunction(functions[i], buffer);
+			}
+		}, 0, (int)functions.size(), 256);
 	}
 
 	static const char *DefaultFunctionName(char buffer[256], u32 startAddr) {
@@ -999,15 +1469,20 @@ namespace MIPSAnalyst {
 		return furthestJumpbackAddr;
 	}
 
-	// endAddr is exclusive.
-	bool ScanForFunctions(u32 startAddr, u32 endAddr, bool insertSymbols) {
-		_assert_((startAddr & 3) == 0);
-		_assert_((endAddr & 3) == 0);
-
-		std::lock_guard<std::recursive_mutex> guard(functions_lock);
-
-		FunctionsVector new_functions;
+	// Functions found by one piece of a parallel scan, see ScanForFunctions().
+	struct FunctionScanChunk {
+		FunctionsVector functions;
+		// Where the scan state was fresh for each function (its start, before skipping nop padding.)
+		std::vector<u32> resetPoints;
+		// The first start of a function at or after the end of the chunk.
+		u32 exitAddr;
+	};
 
+	// Scans for functions, assuming one starts at startAddr. Stops at the first function that starts
+	// at or after stopAddr, or at one of syncPoints (if not null), and returns where that is.
+	// The scan state is fresh at the start of each function, so scanning from any function start
+	// gives the same results from then on. endAddr is exclusive.
+	static u32 ScanFunctionsFrom(u32 startAddr, u32 stopAddr, u32 endAddr, const std::vector<u32> *syncPoints, FunctionsVector &found, std::vector<u32> &resetPoints) {
 		AnalyzedFunction currentFunction = {startAddr};
 
 		u32 furthestBranch = 0;
@@ -1015,9 +1490,18 @@ namespace MIPSAnalyst {
 		bool end = false;
 		bool isStraightLeaf = true;
 		bool decreasedSp = false;
+		bool freshState = true;
+		u32 resetPoint = startAddr;
 
 		u32 addr;
 		for (addr = startAddr; addr < endAddr; addr += 4) {
+			if (freshState) {
+				if (addr >= stopAddr || (syncPoints && std::binary_search(syncPoints->begin(), syncPoints->end(), addr)))
+					return addr;
+				resetPoint = addr;
+				freshState = false;
+			}
+
 			MIPSOpcode op = Memory::Read_Instruction(addr, true);
 			u32 target = GetBranchTargetNoRA(addr, op);
 			if (target != INVALIDTARGET) {
@@ -1112,23 +1596,8 @@ namespace MIPSAnalyst {
 			if (end) {
 				currentFunction.end = addr + 4;
 				currentFunction.isStraightLeaf = isStraightLeaf;
-
-				// Check if we already have symbol info starting here.  If so, skip insertion.
-				// We used to use the symbols to find the functions, but sometimes we'd find
-				// wrong ones due to two modules with the same name.
-				u32 existingSize = g_symbolMap->GetFunctionSize(currentFunction.start);
-				if (existingSize != SymbolMap::INVALID_ADDRESS) {
-					currentFunction.foundInSymbolMap = true;
-
-					// If we run into a func with a different size, skip updating the hash map.
-					// This will prevent us saving incorrectly named funcs with wrong hashes.
-					u32 detectedSize = currentFunction.end - currentFunction.start + 4;
-					if (existingSize != detectedSize) {
-						insertSymbols = false;
-					}
-				}
-
-				new_functions.push_back(currentFunction);
+				found.push_back(currentFunction);
+				resetPoints.push_back(resetPoint);
 
 				furthestBranch = 0;
 				addr += 4;
@@ -1137,17 +1606,88 @@ namespace MIPSAnalyst {
 				isStraightLeaf = true;
 				decreasedSp = false;
 				currentFunction.start = addr + 4;
-				currentFunction.foundInSymbolMap = false;
+				freshState = true;
 			}
 		}
 
 		if (addr < endAddr) {
 			currentFunction.end = addr + 4;
-			new_functions.push_back(currentFunction);
+			found.push_back(currentFunction);
+			resetPoints.push_back(resetPoint);
+		}
+		return addr;
+	}
+
+	// Large enough that the scan going past the end of a chunk (and not syncing up) doesn't matter much.
+	static const u32 FUNCTION_SCAN_CHUNK_SIZE = 0x8000;
+
+	// endAddr is exclusive.
+	bool ScanForFunctions(u32 startAddr, u32 endAddr, bool insertSymbols) {
+		_assert_((startAddr & 3) == 0);
+		_assert_((endAddr & 3) == 0);
+
+		std::lock_guard<std::recursive_mutex> guard(functions_lock);
+
+		FunctionsVector new_functions;
+		const int numChunks = endAddr > startAddr ? (int)((endAddr - startAddr + FUNCTION_SCAN_CHUNK_SIZE - 1) / FUNCTION_SCAN_CHUNK_SIZE) : 0;
+		if (numChunks <= 1) {
+			std::vector<u32> resetPoints;
+			ScanFunctionsFrom(startAddr, endAddr, endAddr, nullptr, new_functions, resetPoints);
+		} else {
+			// Each chunk is scanned as if a function starts right at its beginning.
+			std::vector<FunctionScanChunk> chunks(numChunks);
+			ParallelRangeLoop(&g_threadManager, [&](int l, int h) {
+				for (int i = l; i < h; ++i) {
+					const u32 chunkStart = startAddr + i * FUNCTION_SCAN_CHUNK_SIZE;
+					const u32 chunkEnd = std::min(chunkStart + FUNCTION_SCAN_CHUNK_SIZE, endAddr);
+					chunks[i].exitAddr = ScanFunctionsFrom(chunkStart, chunkEnd, endAddr, nullptr, chunks[i].functions, chunks[i].resetPoints);
+				}
+			}, 0, numChunks, 1);
+
+			// Stitch them together in order. Once the previous chunk ends at a function start that
+			// this chunk also found, the rest of this chunk matches what a serial scan would find.
+			// If not, scan serially from there until they do meet up (usually within a function.)
+			new_functions = std::move(chunks[0].functions);
+			u32 next = chunks[0].exitAddr;
+			for (int i = 1; i < numChunks && next < endAddr; ++i) {
+				const FunctionScanChunk &chunk = chunks[i];
+				if (next >= chunk.exitAddr) {
+					// A function spanned this whole chunk.
+					continue;
+				}
+				const u32 chunkEnd = std::min(startAddr + (i + 1) * FUNCTION_SCAN_CHUNK_SIZE, endAddr);
+				auto sync = std::lower_bound(chunk.resetPoints.begin(), chunk.resetPoints.end(), next);
+				if (sync == chunk.resetPoints.end() || *sync != next) {
+					std::vector<u32> resetPoints;
+					next = ScanFunctionsFrom(next, chunkEnd, endAddr, &chunk.resetPoints, new_functions, resetPoints);
+					sync = std::lower_bound(chunk.resetPoints.begin(), chunk.resetPoints.end(), next);
+				}
+				if (sync != chunk.resetPoints.end() && *sync == next) {
+					new_functions.insert(new_functions.end(), chunk.functions.begin() + (sync - chunk.resetPoints.begin()), chunk.functions.end());
+					next = chunk.exitAddr;
+				}
+			}
 		}
 
 		for (auto iter = new_functions.begin(); iter != new_functions.end(); iter++) {
 			iter->size = iter->end - iter->start + 4;
+
+			// Check if we already have symbol info starting here.  If so, skip insertion.
+			// We used to use the symbols to find the functions, but sometimes we'd find
+			// wrong ones due to two modules with the same name.
+			u32 existingSize = g_symbolMap->GetFunctionSize(iter->start);
+			if (existingSize != SymbolMap::INVALID_ADDRESS) {
+				iter->foundInSymbolMap = true;
+
+				// If we run into a func with a different size, skip updating the hash map.
+				// This will prevent us saving incorrectly named funcs with wrong hashes.
+				if (existingSize != iter->size) {
+					insertSymbols = false;
+				}
+			}
+		}
+
+		for (auto iter = new_functions.begin(); iter != new_functions.end(); iter++) {
 			if (insertSymbols && !iter->foundInSymbolMap) {
 				char temp[256];
 				g_symbolMap->AddFunction(DefaultFunctionName(temp, iter->start), iter->start, iter->end - iter->start + 4);
@@ -1275,8 +1815,23 @@ namespace MIPSAnalyst {
 	void ReplaceFunctions() {
 		std::lock_guard<std::recursive_mutex> guard(functions_lock);
 
+		// Looking up the hashes can be done in parallel, few match. Writing the replacements can't.
+		std::vector<u8> hasReplacement(functions.size());
+		std::vector<const char *> byteLoopReplacement(functions.size());
+		const bool matchByteLoops = g_Config.bFuncPatternReplacements;
+		ParallelRangeLoop(&g_threadManager, [&](int l, int h) {
+			for (int i = l; i < h; ++i) {
+				hasReplacement[i] = !GetReplacementFuncIndexes(functions[i].hash, functions[i].size).empty();
+				if (!hasReplacement[i] && matchByteLoops)
+					byteLoopReplacement[i] = MatchByteLoop(functions[i].start, functions[i].size);
+			}
+		}, 0, (int)functions.size(), 1024);
+
 		for (size_t i = 0; i < functions.size(); i++) {
-			WriteReplaceInstructions(functions[i].start, functions[i].hash, functions[i].size);
+			if (hasReplacement[i])
+				WriteReplaceInstructions(functions[i].start, functions[i].hash, functions[i].size);
+			else if (byteLoopReplacement[i])
+				WriteReplaceInstructionsByName(functions[i].start, byteLoopReplacement[i]);
 		}
 	}
 
@@ -1399,6 +1954,207 @@ namespace MIPSAnalyst {
 		fclose(file);
 	}
 
+	static u64 ComputeScanCacheFingerprint() {
+		// Anything that changes what the scan, the hashing or the hash map would decide must go in here.
+		std::string key = StringFromFormat("%s|%d|%d|%s|", PPSSPP_GIT_VERSION, g_Config.bFuncHashMap, g_Config.bFuncReplacements, g_Config.sSkipFuncHashMap.c_str());
+		for (const HardHashTableEntry &entry : hardcodedHashes) {
+			key += StringFromFormat("%016llx:%d=%s\n", (unsigned long long)entry.hash, entry.funcSize, entry.funcName);
+		}
+		if (g_Config.bFuncHashMap) {
+			std::string knownFuncs;
+			if (File::ReadBinaryFileToString(GetSysDirectory(DIRECTORY_SYSTEM) / "knownfuncs.ini", &knownFuncs))
+				key += knownFuncs;
+		}
+		return CityHash64(key.data(), key.size());
+	}
+
+	static void LoadScanCache() {
+		scanCacheLoaded = true;
+		scanCache.clear();
+		scanCachePath.clear();
+
+		std::string discID = g_paramSFO.GetDiscID();
+		if (discID.empty())
+			return;
+		File::CreateFullPath(GetSysDirectory(DIRECTORY_APP_CACHE));
+		scanCachePath = GetSysDirectory(DIRECTORY_APP_CACHE) / (discID + ".funccache");
+		scanCacheFingerprint = ComputeScanCacheFingerprint();
+
+		FILE *f = File::OpenCFile(scanCachePath, "rb");
+		if (!f)
+			return;
+
+		ScanCacheHeader header{};
+		bool success = fread(&header, sizeof(header), 1, f) == 1;
+		if (!success || header.magic != SCAN_CACHE_MAGIC || header.version != SCAN_CACHE_VERSION || header.fingerprint != scanCacheFingerprint) {
+			// Different build or hash map, start over.
+			INFO_LOG(Log::Loader, "Function scan cache outdated, ignoring %s", scanCachePath.c_str());
+			fclose(f);
+			return;
+		}
+
+		std::vector<ScanCacheModuleHeader> modules(header.numModules);
+		std::vector<ScanCacheFunction> cachedFunctions(header.numFunctions);
+		success = header.numModules == 0 || fread(&modules[0], sizeof(ScanCacheModuleHeader), header.numModules, f) == header.numModules;
+		success = success && (header.numFunctions == 0 || fread(&cachedFunctions[0], sizeof(ScanCacheFunction), header.numFunctions, f) == header.numFunctions);
+		fclose(f);
+		if (!success) {
+			ERROR_LOG(Log::Loader, "Function scan cache truncated: %s", scanCachePath.c_str());
+			return;
+		}
+
+		size_t pos = 0;
+		for (const ScanCacheModuleHeader &module : modules) {
+			if (pos + module.numFunctions > cachedFunctions.size()) {
+				ERROR_LOG(Log::Loader, "Function scan cache corrupt: %s", scanCachePath.c_str());
+				scanCache.clear();
+				return;
+			}
+			CachedModuleScan &cached = scanCache[module.key];
+			cached.insertSymbols = module.insertSymbols != 0;
+			cached.functions.assign(cachedFunctions.begin() + pos, cachedFunctions.begin() + pos + module.numFunctions);
+			pos += module.numFunctions;
+		}
+		for (auto &iter : scanCache) {
+			for (ScanCacheFunction &cf : iter.second.functions)
+				cf.name[sizeof(cf.name) - 1] = 0;
+		}
+	}
+
+	static void SaveScanCache() {
+		ScanCacheHeader header{};
+		header.magic = SCAN_CACHE_MAGIC;
+		header.version = SCAN_CACHE_VERSION;
+		header.fingerprint = scanCacheFingerprint;
+
+		std::vector<ScanCacheModuleHeader> modules;
+		std::vector<ScanCacheFunction> cachedFunctions;
+		for (const auto &iter : scanCache) {
+			modules.push_back(ScanCacheModuleHeader{ iter.first, (u32)iter.second.functions.size(), iter.second.insertSymbols ? 1U : 0U });
+			cachedFunctions.insert(cachedFunctions.end(), iter.second.functions.begin(), iter.second.functions.end());
+		}
+		header.numModules = (u32)modules.size();
+		header.numFunctions = (u32)cachedFunctions.size();
+
+		FILE *f = File::OpenCFile(scanCachePath, "wb");
+		if (!f)
+			return;
+		bool writeFailed = fwrite(&header, sizeof(header), 1, f) != 1;
+		writeFailed = writeFailed || (!modules.empty() && fwrite(&modules[0], sizeof(ScanCacheModuleHeader), modules.size(), f) != modules.size());
+		writeFailed = writeFailed || (!cachedFunctions.empty() && fwrite(&cachedFunctions[0], sizeof(ScanCacheFunction), cachedFunctions.size(), f) != cachedFunctions.size());
+		fclose(f);
+
+		if (writeFailed) {
+			ERROR_LOG(Log::Loader, "Failed to write function scan cache, disk full?");
+			File::Delete(scanCachePath);
+		}
+	}
+
+	u64 ScanCacheKey(const std::vector<std::pair<u32, u32>> &ranges, bool insertSymbols) {
+		// Relocations are already applied, so the load address is implicitly covered too.
+		u64 key = insertSymbols ? 1 : 0;
+		for (const auto &range : ranges) {
+			const u64 seed = key ^ range.first ^ ((u64)range.second << 32);
+			const u32 len = range.second >= range.first ? range.second + 4 - range.first : 0;
+			key = CityHash64WithSeed((const char *)Memory::GetPointerUnchecked(range.first), len, seed);
+		}
+		return key;
+	}
+
+	bool ApplyCachedScan(u64 key) {
+		std::lock_guard<std::recursive_mutex> guard(functions_lock);
+		if (!scanCacheLoaded)
+			LoadScanCache();
+		auto iter = scanCache.find(key);
+		if (iter == scanCache.end())
+			return false;
+
+		// Do what ScanForFunctions() and FinalizeScan() would have, just for these functions.
+		const CachedModuleScan &cached = iter->second;
+		bool anyReplaced = false;
+		for (const ScanCacheFunction &cf : cached.functions) {
+			AnalyzedFunction f{};
+			f.start = cf.start;
+			f.end = cf.end;
+			f.size = cf.end - cf.start + 4;
+			f.hash = cf.hash;
+			f.isStraightLeaf = (cf.flags & SCAN_CACHE_STRAIGHT_LEAF) != 0;
+			f.hasHash = (cf.flags & SCAN_CACHE_HAS_HASH) != 0;
+			f.usesVFPU = (cf.flags & SCAN_CACHE_USES_VFPU) != 0;
+			f.foundInSymbolMap = (cf.flags & SCAN_CACHE_IN_SYMBOL_MAP) != 0;
+			truncate_cpy(f.name, cf.name);
+			anyReplaced = anyReplaced || (cf.flags & SCAN_CACHE_REPLACED) != 0;
+
+			if (cached.insertSymbols) {
+				char defaultLabel[256];
+				if (!f.foundInSymbolMap)
+					g_symbolMap->AddFunction(DefaultFunctionName(defaultLabel, f.start), f.start, f.size);
+				if (f.name[0]) {
+					// Same as ApplyHashMap(), keep it if it was renamed.
+					std::string existingLabel = g_symbolMap->GetLabelString(f.start);
+					if (existingLabel.empty() || existingLabel == DefaultFunctionName(defaultLabel, f.start))
+						g_symbolMap->SetLabelName(f.name, f.start);
+				}
+			}
+			functions.push_back(f);
+		}
+		UpdateHashToFunctionMap();
+
+		if (anyReplaced && g_Config.bFuncReplacements) {
+			// Replacements are looked up by name through the hash map.
+			LoadBuiltinHashMap();
+			if (g_Config.bFuncHashMap)
+				LoadHashMap(GetSysDirectory(DIRECTORY_SYSTEM) / "knownfuncs.ini");
+			for (const ScanCacheFunction &cf : cached.functions) {
+				if (cf.flags & SCAN_CACHE_REPLACED)
+					WriteReplaceInstructions(cf.start, cf.hash, cf.end - cf.start + 4);
+			}
+		}
+		if (g_Config.bFuncReplacements && g_Config.bFuncPatternReplacements) {
+			// Cheap enough to just match again, it's only small functions.
+			for (const ScanCacheFunction &cf : cached.functions) {
+				const char *name = (cf.flags & SCAN_CACHE_REPLACED) ? nullptr : MatchByteLoop(cf.start, cf.end - cf.start + 4);
+				if (name)
+					WriteReplaceInstructionsByName(cf.start, name);
+			}
+		}
+		return true;
+	}
+
+	void StoreCachedScan(u64 key, const std::vector<std::pair<u32, u32>> &ranges, bool insertSymbols) {
+		std::lock_guard<std::recursive_mutex> guard(functions_lock);
+		if (!scanCacheLoaded)
+			LoadScanCache();
+		if (scanCachePath.empty())
+			return;
+
+		CachedModuleScan &cached = scanCache[key];
+		cached.insertSymbols = insertSymbols;
+		cached.functions.clear();
+		for (const AnalyzedFunction &f : functions) {
+			bool inRanges = false;
+			for (const auto &range : ranges)
+				inRanges = inRanges || (f.start >= range.first && f.start <= range.second);
+			if (!inRanges)
+				continue;
+
+			ScanCacheFunction cf{};
+			cf.start = f.start;
+			cf.end = f.end;
+			cf.hash = f.hash;
+			cf.flags |= f.isStraightLeaf ? SCAN_CACHE_STRAIGHT_LEAF : 0;
+			cf.flags |= f.hasHash ? SCAN_CACHE_HAS_HASH : 0;
+			cf.flags |= f.usesVFPU ? SCAN_CACHE_USES_VFPU : 0;
+			cf.flags |= f.foundInSymbolMap ? SCAN_CACHE_IN_SYMBOL_MAP : 0;
+			// The same decision ReplaceFunctions() made.
+			if (g_Config.bFuncReplacements && !GetReplacementFuncIndexes(f.hash, f.size).empty())
+				cf.flags |= SCAN_CACHE_REPLACED;
+			truncate_cpy(cf.name, f.name);
+			cached.functions.push_back(cf);
+		}
+		SaveScanCache();
+	}
+
 	std::vector<MIPSGPReg> GetInputRegs(MIPSOpcode op) {
 		std::vector<MIPSGPReg> vec;
 		MIPSInfo info = MIPSGetInfo(op);
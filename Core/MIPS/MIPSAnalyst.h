@@ -18,6 +18,7 @@
 #pragma once
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "Common/CommonTypes.h"
@@ -110,6 +111,16 @@ namespace MIPSAnalyst {
 
 	bool GetAnalyzedFunctionAt(u32 addr, AnalyzedFunction *out);
 
+	// Optional per-game cache of what ScanForFunctions() and FinalizeScan() found for a module
+	// (the FuncScanCache setting), so an identical module can skip both on later boots.
+	// ranges are the start and (inclusive) end passed to each ScanForFunctions() call, in order.
+	// The key covers their contents.
+	u64 ScanCacheKey(const std::vector<std::pair<u32, u32>> &ranges, bool insertSymbols);
+	// Adds the functions, symbols and replacements from the cache. Returns false on a miss.
+	bool ApplyCachedScan(u64 key);
+	// Call after FinalizeScan() to remember the functions found in ranges.
+	void StoreCachedScan(u64 key, const std::vector<std::pair<u32, u32>> &ranges, bool insertSymbols);
+
 	void LoadBuiltinHashMap();
 	void LoadHashMap(const Path &filename);
 	void StoreHashMap(Path filename = Path());
@@ -129,6 +140,13 @@ namespace MIPSAnalyst {
 	bool IsDelaySlotNiceVFPU(MIPSOpcode branchOp, MIPSOpcode op);
 	bool IsDelaySlotNiceFPU(MIPSOpcode branchOp, MIPSOpcode op);
 	bool IsSyscall(MIPSOpcode op);
+	// Checks if the loop from startAddr back from the branch at branchAddr (and its delay slot) only polls,
+	// e.g. reads a memory word and compares it. Such a loop can't exit until an interrupt or event changes memory.
+	bool IsIdlePollingLoop(u32 startAddr, u32 branchAddr);
+	// Recognizes small leaf functions that are just a byte loop doing what memcpy (copying forward),
+	// memset or strlen does, whatever registers and instruction order the compiler picked.
+	// Returns the name of the replacement for it, or nullptr.
+	const char *MatchByteLoop(u32 startAddr, u32 size);
 
 	bool OpWouldChangeMemory(u32 pc, u32 addr, u32 size);
 	int OpMemoryAccessSize(u32 pc);
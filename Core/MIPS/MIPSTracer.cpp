@@ -17,10 +17,97 @@
 
 #include "Core/MIPS/MIPSTracer.h"
 
+#include <algorithm>
+#include <condition_variable>
 #include <cstring> // for std::memcpy
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+#include <zstd.h>
+
 #include "Core/MIPS/MIPSTables.h" // for MIPSDisAsm
 #include "Core/MemMap.h" // for Memory::GetPointerUnchecked
 #include "Common/File/FileUtil.h" // for the File::OpenCFile
+#include "Common/Thread/ThreadUtil.h"
+
+// Compresses the binary trace on its own thread, so the emulator only has to fill chunks.
+struct TraceStreamWriter {
+	FILE *file = nullptr;
+	ZSTD_CCtx *ctx = nullptr;
+	std::vector<u8> out_buffer;
+
+	std::thread thread;
+	std::mutex lock;
+	std::condition_variable cond;
+	std::deque<std::vector<u32>> queue;
+	bool finishing = false;
+
+	bool failed = false;
+	u64 raw_bytes = 0;
+	u64 compressed_bytes = 0;
+
+	void run();
+	void compress(const void *data, size_t size, ZSTD_EndDirective mode);
+};
+
+void TraceStreamWriter::run() {
+	SetCurrentThreadName("MIPSTracer");
+	while (true) {
+		std::vector<u32> chunk;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			cond.wait(guard, [&] { return !queue.empty() || finishing; });
+			if (queue.empty())
+				break;
+			chunk = std::move(queue.front());
+			queue.pop_front();
+		}
+		compress(chunk.data(), chunk.size() * sizeof(u32), ZSTD_e_continue);
+	}
+	compress(nullptr, 0, ZSTD_e_end);
+}
+
+void TraceStreamWriter::compress(const void *data, size_t size, ZSTD_EndDirective mode) {
+	if (failed)
+		return;
+
+	ZSTD_inBuffer in{ data, size, 0 };
+	bool done;
+	do {
+		ZSTD_outBuffer out{ out_buffer.data(), out_buffer.size(), 0 };
+		size_t remaining = ZSTD_compressStream2(ctx, &out, &in, mode);
+		if (ZSTD_isError(remaining)) {
+			ERROR_LOG(Log::JIT, "MIPSTracer failed to compress the trace: %s", ZSTD_getErrorName(remaining));
+			failed = true;
+			return;
+		}
+		if (out.pos != 0 && fwrite(out_buffer.data(), 1, out.pos, file) != out.pos) {
+			ERROR_LOG(Log::JIT, "MIPSTracer failed to write the trace, out of disk space?");
+			failed = true;
+			return;
+		}
+		compressed_bytes += out.pos;
+		// Without ZSTD_e_end, zstd may keep some of the input buffered, that's fine.
+		done = mode == ZSTD_e_end ? remaining == 0 : in.pos == in.size;
+	} while (!done);
+	raw_bytes += size;
+}
+
+// The log format is '{prefix}{disassembled line}', where 'prefix' is '0x{8 hex digits of the address}: '
+static void write_block_text(FILE *output, u32 addr, const u32 *instructions, u32 size) {
+	char buffer[512];
+	const auto prefix_size = 2 + 8 + 2;
+
+	u32 end_addr = addr + size;
+	for (; addr < end_addr; addr += 4, ++instructions) {
+		snprintf(buffer, sizeof(buffer), "0x%08x: ", addr);
+		MIPSDisAsm(Memory::Opcode(*instructions), addr, buffer + prefix_size, sizeof(buffer) - prefix_size, true);
+
+		fprintf(output, "%s\n", buffer);
+	}
+}
 
 
 bool TraceBlockStorage::save_block(const u32* instructions, u32 size) {
@@ -83,6 +170,8 @@ void MIPSTracer::prepare_block(const MIPSComp::IRBlock* block, MIPSComp::IRBlock
 		// Successfully inserted the block at index 'storage_index'!
 
 		hash_to_storage_index.emplace(hash, storage_index);
+		if (streaming)
+			stream_block_data(storage_index);
 	}
 
 	// NB!
@@ -95,11 +184,20 @@ void MIPSTracer::prepare_block(const MIPSComp::IRBlock* block, MIPSComp::IRBlock
 
 
 	u32 index = (u32)(trace_info.size() - 1);
+	if (streaming)
+		stream_chunk.insert(stream_chunk.end(), { (u32)TraceRecord::BLOCK, index, virt_addr, storage_index });
 	auto ir_ptr = (IRInst*)blocks.GetBlockInstructionPtr(*block);
 	ir_ptr[1].constant = index;
 }
 
 bool MIPSTracer::flush_to_file() {
+	if (stream_writer) {
+		// Everything is already on its way to the file, just finish it.
+		close_stream();
+		clear();
+		return true;
+	}
+
 	if (logging_path.empty()) {
 		WARN_LOG(Log::JIT, "The path is empty, cannot flush the trace!");
 		return false;
@@ -126,31 +224,101 @@ bool MIPSTracer::flush_to_file() {
 }
 
 void MIPSTracer::flush_block_to_file(const TraceBlockInfo& block_info) {
-	char buffer[512];
+	u32 index = block_info.storage_index;
+	u32 size = storage[index];
+	write_block_text(output, block_info.virt_address, &storage.raw_instructions[index + 1], size);
+}
 
-	// The log format is '{prefix}{disassembled line}', where 'prefix' is '0x{8 hex digits of the address}: '
-	const auto prefix_size = 2 + 8 + 2;
+bool MIPSTracer::open_stream() {
+	if (logging_path.empty()) {
+		WARN_LOG(Log::JIT, "The path is empty, cannot stream the trace!");
+		return false;
+	}
 
-	u32 addr = block_info.virt_address;
-	u32 index = block_info.storage_index;
+	FILE *file = File::OpenCFile(logging_path, "wb");
+	if (!file) {
+		WARN_LOG(Log::JIT, "MIPSTracer failed to open the file '%s'", logging_path.c_str());
+		return false;
+	}
 
-	u32 size = storage[index];
-	++index;
+	stream_writer = new TraceStreamWriter();
+	stream_writer->file = file;
+	stream_writer->ctx = ZSTD_createCCtx();
+	ZSTD_CCtx_setParameter(stream_writer->ctx, ZSTD_c_compressionLevel, ZSTD_CLEVEL_DEFAULT);
+	stream_writer->out_buffer.resize(ZSTD_CStreamOutSize());
+	stream_writer->thread = std::thread([this] {
+		stream_writer->run();
+	});
+
+	stream_chunk.clear();
+	stream_chunk.reserve(STREAM_CHUNK_WORDS);
+	stream_chunk.insert(stream_chunk.end(), { (u32)TraceRecord::HEADER, TRACE_STREAM_MAGIC, TRACE_STREAM_VERSION });
+
+	// Blocks compiled before now still log their old indexes, so they need to be in the table.
+	std::unordered_set<u32> streamed;
+	for (u32 index = 0; index < (u32)trace_info.size(); ++index) {
+		const TraceBlockInfo &info = trace_info[index];
+		if (streamed.insert(info.storage_index).second)
+			stream_block_data(info.storage_index);
+		stream_chunk.insert(stream_chunk.end(), { (u32)TraceRecord::BLOCK, index, info.virt_address, info.storage_index });
+	}
 
-	u32 end_addr = addr + size;
-	
+	INFO_LOG(Log::JIT, "MIPSTracer streaming to '%s'", logging_path.c_str());
+	streaming = true;
+	return true;
+}
 
-	for (; addr < end_addr; addr += 4, ++index) {
-		snprintf(buffer, sizeof(buffer), "0x%08x: ", addr);
-		MIPSDisAsm(storage.read_asm(index), addr, buffer + prefix_size, sizeof(buffer) - prefix_size, true);
+void MIPSTracer::stream_block_data(u32 storage_index) {
+	u32 size = storage[storage_index];
+	stream_chunk.insert(stream_chunk.end(), { (u32)TraceRecord::BLOCK_DATA, storage_index, size });
+	const u32 *instructions = &storage.raw_instructions[storage_index + 1];
+	stream_chunk.insert(stream_chunk.end(), instructions, instructions + size / 4);
+}
 
-		fprintf(output, "%s\n", buffer);
+void MIPSTracer::submit_stream_chunk() {
+	if (!stream_writer || stream_chunk.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> guard(stream_writer->lock);
+		stream_writer->queue.push_back(std::move(stream_chunk));
+	}
+	stream_writer->cond.notify_one();
+
+	stream_chunk = std::vector<u32>();
+	stream_chunk.reserve(STREAM_CHUNK_WORDS);
+}
+
+void MIPSTracer::close_stream() {
+	if (!stream_writer)
+		return;
+
+	submit_stream_chunk();
+	{
+		std::lock_guard<std::mutex> guard(stream_writer->lock);
+		stream_writer->finishing = true;
 	}
+	stream_writer->cond.notify_one();
+	stream_writer->thread.join();
+
+	fclose(stream_writer->file);
+	ZSTD_freeCCtx(stream_writer->ctx);
+	if (!stream_writer->failed) {
+		INFO_LOG(Log::JIT, "MIPSTracer stream closed: %llu bytes compressed to %llu",
+			(unsigned long long)stream_writer->raw_bytes, (unsigned long long)stream_writer->compressed_bytes);
+	}
+
+	delete stream_writer;
+	stream_writer = nullptr;
+	streaming = false;
+	stream_chunk = std::vector<u32>();
 }
 
 void MIPSTracer::start_tracing() {
 	if (!tracing_enabled) {
 		INFO_LOG(Log::JIT, "MIPSTracer enabled");
+		if (in_stream_binary && !stream_writer)
+			open_stream();
 		tracing_enabled = true;
 	}
 }
@@ -159,6 +327,8 @@ void MIPSTracer::stop_tracing() {
 	if (tracing_enabled) {
 		INFO_LOG(Log::JIT, "MIPSTracer disabled");
 		tracing_enabled = false;
+		// The stream stays open until flushed, but let's not leave the tail in memory meanwhile.
+		submit_stream_chunk();
 
 #ifdef _DEBUG
 		print_stats();
@@ -200,6 +370,7 @@ void MIPSTracer::initialize(u32 storage_capacity, u32 max_trace_size) {
 }
 
 void MIPSTracer::clear() {
+	close_stream();
 	executed_blocks.clear();
 	hash_to_storage_index.clear();
 	storage.clear();
@@ -210,3 +381,177 @@ void MIPSTracer::clear() {
 MIPSTracer mipsTracer;
 
 
+struct TraceDecoder {
+	struct Block {
+		u32 virt_address = 0;
+		// The size in bytes followed by the instructions, or null if we haven't seen the block.
+		const std::vector<u32> *data = nullptr;
+		u64 executions = 0;
+	};
+
+	std::unordered_map<u32, std::vector<u32>> storage;
+	std::vector<Block> blocks;
+	FILE *text = nullptr;
+	bool seen_header = false;
+	bool failed = false;
+	u64 executed_blocks = 0;
+	u64 executed_instructions = 0;
+
+	size_t parse(const u32 *words, size_t count);
+};
+
+// Returns how many words were used, which stops short at an incomplete record.
+size_t TraceDecoder::parse(const u32 *words, size_t count) {
+	size_t pos = 0;
+	while (pos < count && !failed) {
+		const u32 word = words[pos];
+		if ((word & 0x80000000) == 0) {
+			if (word >= blocks.size() || !blocks[word].data) {
+				ERROR_LOG(Log::JIT, "Trace refers to unknown block %d", word);
+				failed = true;
+				break;
+			}
+			Block &block = blocks[word];
+			block.executions++;
+			executed_blocks++;
+			executed_instructions += (*block.data)[0] / 4;
+			if (text)
+				write_block_text(text, block.virt_address, block.data->data() + 1, (*block.data)[0]);
+			pos++;
+			continue;
+		}
+
+		size_t avail = count - pos;
+		switch ((TraceRecord)word) {
+		case TraceRecord::HEADER:
+			if (avail < 3)
+				return pos;
+			if (words[pos + 1] != TRACE_STREAM_MAGIC || words[pos + 2] != TRACE_STREAM_VERSION) {
+				ERROR_LOG(Log::JIT, "Not a MIPSTracer binary trace, or an unsupported version (%d)", words[pos + 2]);
+				failed = true;
+				break;
+			}
+			seen_header = true;
+			pos += 3;
+			break;
+
+		case TraceRecord::BLOCK_DATA:
+		{
+			if (avail < 3 || avail < 3 + words[pos + 2] / 4)
+				return pos;
+			u32 size = words[pos + 2];
+			storage[words[pos + 1]].assign(words + pos + 2, words + pos + 3 + size / 4);
+			pos += 3 + size / 4;
+			break;
+		}
+
+		case TraceRecord::BLOCK:
+		{
+			if (avail < 4)
+				return pos;
+			u32 index = words[pos + 1];
+			auto it = storage.find(words[pos + 3]);
+			if (it == storage.end()) {
+				ERROR_LOG(Log::JIT, "Trace block %d refers to unknown storage %08x", index, words[pos + 3]);
+				failed = true;
+				break;
+			}
+			if (index >= blocks.size())
+				blocks.resize(index + 1);
+			blocks[index].virt_address = words[pos + 2];
+			blocks[index].data = &it->second;
+			pos += 4;
+			break;
+		}
+
+		default:
+			ERROR_LOG(Log::JIT, "Unknown trace record %08x", word);
+			failed = true;
+			break;
+		}
+
+		if (!seen_header && !failed) {
+			ERROR_LOG(Log::JIT, "Not a MIPSTracer binary trace");
+			failed = true;
+		}
+	}
+	return pos;
+}
+
+bool MIPSTraceDecode(const Path &input, const Path &textOutput, FILE *histogram, int maxHotBlocks) {
+	FILE *in = File::OpenCFile(input, "rb");
+	if (!in) {
+		ERROR_LOG(Log::JIT, "Failed to open the trace '%s'", input.c_str());
+		return false;
+	}
+
+	TraceDecoder decoder;
+	if (!textOutput.empty()) {
+		decoder.text = File::OpenCFile(textOutput, "w");
+		if (!decoder.text) {
+			ERROR_LOG(Log::JIT, "Failed to open '%s' for the text trace", textOutput.c_str());
+			fclose(in);
+			return false;
+		}
+	}
+
+	ZSTD_DCtx *ctx = ZSTD_createDCtx();
+	std::vector<u8> in_buffer(ZSTD_DStreamInSize());
+	// Decompressed data not parsed yet, which may end with part of a record.
+	std::vector<u8> pending;
+	size_t pending_size = 0;
+	const size_t out_chunk = ZSTD_DStreamOutSize();
+
+	size_t last_result = 0;
+	size_t read_size;
+	while (!decoder.failed && (read_size = fread(in_buffer.data(), 1, in_buffer.size(), in)) != 0) {
+		ZSTD_inBuffer zin{ in_buffer.data(), read_size, 0 };
+		while (zin.pos < zin.size && !decoder.failed) {
+			if (pending.size() < pending_size + out_chunk)
+				pending.resize(pending_size + out_chunk);
+			ZSTD_outBuffer zout{ pending.data() + pending_size, out_chunk, 0 };
+			last_result = ZSTD_decompressStream(ctx, &zout, &zin);
+			if (ZSTD_isError(last_result)) {
+				ERROR_LOG(Log::JIT, "Failed to decompress the trace: %s", ZSTD_getErrorName(last_result));
+				decoder.failed = true;
+				break;
+			}
+			pending_size += zout.pos;
+
+			size_t used = decoder.parse((const u32 *)pending.data(), pending_size / 4) * 4;
+			memmove(pending.data(), pending.data() + used, pending_size - used);
+			pending_size -= used;
+		}
+	}
+	ZSTD_freeDCtx(ctx);
+	fclose(in);
+	if (decoder.text)
+		fclose(decoder.text);
+
+	if (!decoder.failed && (last_result != 0 || pending_size != 0)) {
+		// Still usable, the tracer probably wasn't flushed.
+		WARN_LOG(Log::JIT, "The trace '%s' is truncated", input.c_str());
+	}
+	if (decoder.failed)
+		return false;
+
+	if (histogram) {
+		std::vector<u32> order;
+		for (u32 i = 0; i < (u32)decoder.blocks.size(); ++i) {
+			if (decoder.blocks[i].executions != 0)
+				order.push_back(i);
+		}
+		std::sort(order.begin(), order.end(), [&](u32 a, u32 b) {
+			return decoder.blocks[a].executions > decoder.blocks[b].executions;
+		});
+
+		fprintf(histogram, "Executed %llu blocks (%llu instructions), %d unique\n",
+			(unsigned long long)decoder.executed_blocks, (unsigned long long)decoder.executed_instructions, (int)order.size());
+		for (int i = 0; i < std::min(maxHotBlocks, (int)order.size()); ++i) {
+			const TraceDecoder::Block &block = decoder.blocks[order[i]];
+			double percent = 100.0 * (double)block.executions / (double)decoder.executed_blocks;
+			fprintf(histogram, "0x%08x: %llu runs (%0.2f%%), %d instrs\n", block.virt_address, (unsigned long long)block.executions, percent, (*block.data)[0] / 4);
+		}
+	}
+	return true;
+}
@@ -17,6 +17,7 @@
 
 #pragma once
 
+#include <cstdio>
 #include <unordered_map>
 #include <vector>
 #include <string>
@@ -61,6 +62,21 @@ struct TraceBlockStorage {
 };
 
 
+// The binary trace is a zstd stream of u32 words. Words without the top bit are the indexes of
+// executed blocks (into the block table), other words start a record describing a block.
+enum class TraceRecord : u32 {
+	// magic, version
+	HEADER = 0x80000001,
+	// storage index, size in bytes, the MIPS instructions
+	BLOCK_DATA = 0x80000002,
+	// block index, address, storage index
+	BLOCK = 0x80000003,
+};
+
+static const u32 TRACE_STREAM_MAGIC = 0x4352544D;  // "MTRC"
+static const u32 TRACE_STREAM_VERSION = 1;
+
+struct TraceStreamWriter;
 
 // This system is meant for trace recording.
 // A trace here stands for a sequence of instructions and their respective addresses in RAM.
@@ -81,8 +97,16 @@ struct MIPSTracer {
 	FILE* output;
 	bool tracing_enabled = false;
 
+	// When streaming, executed blocks go to a compressed binary file instead of executed_blocks.
+	bool streaming = false;
+	// Handed to the writer thread once full, about 1 MB.
+	static const size_t STREAM_CHUNK_WORDS = 0x4'0000;
+	std::vector<u32> stream_chunk;
+	TraceStreamWriter *stream_writer = nullptr;
+
 	int in_storage_capacity = 0x10'0000;
 	int in_max_trace_size = 0x10'0000;
+	bool in_stream_binary = false;
 
 	void start_tracing();
 	void stop_tracing();
@@ -98,6 +122,21 @@ struct MIPSTracer {
 	bool flush_to_file();
 	void flush_block_to_file(const TraceBlockInfo& block);
 
+	// Called from the IR for every block executed while tracing.
+	void log_block(u32 trace_index) {
+		if (streaming) {
+			stream_chunk.push_back(trace_index);
+			if (stream_chunk.size() >= STREAM_CHUNK_WORDS)
+				submit_stream_chunk();
+		} else {
+			executed_blocks.push_back(trace_index);
+		}
+	}
+	bool open_stream();
+	void stream_block_data(u32 storage_index);
+	void submit_stream_chunk();
+	void close_stream();
+
 	void initialize(u32 storage_capacity, u32 max_trace_size);
 	void clear();
 
@@ -107,3 +146,7 @@ struct MIPSTracer {
 };
 
 extern MIPSTracer mipsTracer;
+
+// Rebuilds the text trace (in the format of flush_to_file()) from a binary trace, if textOutput isn't empty,
+// and prints the maxHotBlocks most executed blocks to histogram.
+bool MIPSTraceDecode(const Path &input, const Path &textOutput, FILE *histogram, int maxHotBlocks);
@@ -27,6 +27,7 @@
 #include "Core/MemMap.h"
 #include "Core/System.h"
 #include "Core/MIPS/MIPS.h"
+#include "Core/MIPS/JitCommon/JitPerfMap.h"
 #include "Core/CoreTiming.h"
 #include "Common/MemoryUtil.h"
 
@@ -67,7 +68,7 @@ void ImHere() {
 
 void Jit::GenerateFixedCode(JitOptions &jo) {
 	BeginWrite(GetMemoryProtectPageSize());
-	AlignCodePage();
+	const u8 *start = AlignCodePage();
 
 	restoreRoundingMode = AlignCode16(); {
 		STMXCSR(MIPSSTATE_VAR(temp));
@@ -226,6 +227,12 @@ void Jit::GenerateFixedCode(JitOptions &jo) {
 	// Let's spare the pre-generated code from unprotect-reprotect.
 	endOfPregeneratedCode = AlignCodePage();
 	EndWrite();
+
+	if (JitPerfMap::IsEnabled()) {
+		JitPerfMap::RegisterFixedCode(start, GetCodePtr(), [this](const u8 *ptr, std::string &name) {
+			return DescribeCodePtr(ptr, name);
+		});
+	}
 }
 
 }  // namespace
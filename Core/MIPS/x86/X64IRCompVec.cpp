@@ -140,6 +140,12 @@ void X64JitBackend::CompIR_VecArith(IRInst inst) {
 			DISABLE;
 
 		regs_.Map(inst);
+		if (cpu_info.bAVX2 && inst.dest != inst.src1) {
+			// Broadcast straight into dest, which also leaves src2 alone.
+			VBROADCASTSS(128, regs_.FX(inst.dest), regs_.F(inst.src2));
+			VMULPS(128, regs_.FX(inst.dest), regs_.FX(inst.dest), regs_.F(inst.src1));
+			break;
+		}
 		SHUFPS(regs_.FX(inst.src2), regs_.F(inst.src2), 0);
 		if (inst.dest == inst.src1) {
 			MULPS(regs_.FX(inst.dest), regs_.F(inst.src2));
@@ -275,17 +281,26 @@ void X64JitBackend::CompIR_VecHoriz(IRInst inst) {
 			MULPS(regs_.FX(inst.dest), regs_.F(inst.src1));
 		} else if (cpu_info.bAVX) {
 			VMULPS(128, regs_.FX(inst.dest), regs_.FX(inst.src1), regs_.F(inst.src2));
-		} else if (cpu_info.bSSE4_1) {
+		} else {
 			MOVAPS(regs_.FX(inst.dest), regs_.F(inst.src1));
 			MULPS(regs_.FX(inst.dest), regs_.F(inst.src2));
 		}
 
 		// This shuffle can be done in one op for SSE3/AVX, but it's not always faster.
-		MOVAPS(tempReg, regs_.F(inst.dest));
-		SHUFPS(tempReg, regs_.F(inst.dest), VFPU_SWIZZLE(1, 0, 3, 2));
-		ADDPS(regs_.FX(inst.dest), R(tempReg));
-		MOVHLPS(tempReg, regs_.FX(inst.dest));
-		ADDSS(regs_.FX(inst.dest), R(tempReg));
+		// Either way, the sum must stay (x + y) + (z + w) to match the other backends.
+		// Note: no FMA here on purpose, it would round differently than the VFPU.
+		if (cpu_info.bAVX) {
+			VPERMILPS(128, tempReg, regs_.F(inst.dest), VFPU_SWIZZLE(1, 0, 3, 2));
+			VADDPS(128, regs_.FX(inst.dest), regs_.FX(inst.dest), R(tempReg));
+			VMOVHLPS(tempReg, tempReg, regs_.FX(inst.dest));
+			VADDSS(regs_.FX(inst.dest), regs_.FX(inst.dest), R(tempReg));
+		} else {
+			MOVAPS(tempReg, regs_.F(inst.dest));
+			SHUFPS(tempReg, regs_.F(inst.dest), VFPU_SWIZZLE(1, 0, 3, 2));
+			ADDPS(regs_.FX(inst.dest), R(tempReg));
+			MOVHLPS(tempReg, regs_.FX(inst.dest));
+			ADDSS(regs_.FX(inst.dest), R(tempReg));
+		}
 		break;
 	}
 
@@ -174,6 +174,52 @@ bool X64JitBackend::CompileBlock(IRBlockCache *irBlockCache, int block_num) {
 	return true;
 }
 
+bool X64JitBackend::CompileInterpreterStub(IRBlockCache *irBlockCache, int block_num, IRNativeInterpretBlockFunc func) {
+	if (GetSpaceLeft() < 0x800)
+		return false;
+
+	IRBlock *block = irBlockCache->GetBlock(block_num);
+	u32 startPC = block->GetOriginalStart();
+	// Always put the checked entry first, even with useBackJump, since there's no loop to jump back to.
+	if (jo.enableBlocklink) {
+		SetBlockCheckedOffset(block_num, (int)GetOffset(GetCodePointer()));
+		WriteDebugPC(startPC);
+
+		if (jo.downcountInRegister) {
+			TEST(32, R(DOWNCOUNTREG), R(DOWNCOUNTREG));
+		} else {
+			CMP(32, MDisp(CTXREG, downcountOffset), Imm32(0));
+		}
+		FixupBranch normalEntry = J_CC(CC_NS);
+		MOV(32, R(SCRATCH1), Imm32(startPC));
+		JMP(outerLoopPCInSCRATCH1_, true);
+		SetJumpTarget(normalEntry);
+	}
+
+	const u8 *blockStart = GetCodePointer();
+	block->SetNativeOffset((int)GetOffset(blockStart));
+
+	// When the block gets hot, it's invalidated from inside func - keep the return address clear of that.
+	NOP(MIN_BLOCK_NORMAL_LEN);
+
+	SaveStaticRegisters();
+	WriteDebugProfilerStatus(IRProfilerStatus::IR_INTERPRET);
+	ABI_CallFunctionC((const void *)func, (u32)block_num);
+	WriteDebugProfilerStatus(IRProfilerStatus::IN_JIT);
+	LoadStaticRegisters();
+
+	// New PC in RAX aka SCRATCH1. The interpreter may have run a syscall, so check coreState.
+	_assert_(RAX == SCRATCH1);
+	MovToPC(SCRATCH1);
+	JMP(dispatcherCheckCoreState_, true);
+
+	if (!jo.enableBlocklink) {
+		// Always record this, even if block link disabled - it's used for size calc.
+		SetBlockCheckedOffset(block_num, (int)GetOffset(GetCodePointer()));
+	}
+	return true;
+}
+
 void X64JitBackend::WriteConstExit(uint32_t pc) {
 	int block_num = blocks_.GetBlockNumberFromStartAddress(pc);
 	const IRNativeBlock *nativeBlock = GetNativeBlock(block_num);
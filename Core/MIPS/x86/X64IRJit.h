@@ -53,6 +53,7 @@ class X64JitBackend : public Gen::XCodeBlock, public IRNativeBackend {
 
 	void GenerateFixedCode(MIPSState *mipsState) override;
 	bool CompileBlock(IRBlockCache *irBlockCache, int block_num) override;
+	bool CompileInterpreterStub(IRBlockCache *irBlockCache, int block_num, IRNativeInterpretBlockFunc func) override;
 	void ClearAllBlocks() override;
 	void InvalidateBlock(IRBlockCache *irBlockCache, int block_num) override;
 
@@ -42,6 +42,7 @@
 #include "Core/MemFault.h"
 #include "Core/MemMap.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
+#include "Core/MIPS/JitCommon/JitWriteProtect.h"
 #include "Core/Debugger/SymbolMap.h"
 
 // Stack walking stuff
@@ -111,6 +112,10 @@ static bool DisassembleNativeAt(const uint8_t *codePtr, int instructionSize, std
 }
 
 bool HandleFault(uintptr_t hostAddress, void *ctx) {
+	// Writes to code pages protected by JitWriteProtect. These can come from any thread.
+	if (JitWriteProtect::HandleFault(hostAddress))
+		return true;
+
 	if (inCrashHandler)
 		return false;
 	inCrashHandler = true;
@@ -337,6 +342,8 @@ bool HandleFault(uintptr_t hostAddress, void *ctx) {
 #else
 
 bool HandleFault(uintptr_t hostAddress, void *ctx) {
+	if (JitWriteProtect::HandleFault(hostAddress))
+		return true;
 	ERROR_LOG(Log::MemMap, "Exception handling not supported");
 	return false;
 }
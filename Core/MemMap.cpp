@@ -39,6 +39,7 @@
 #include "Core/MemFault.h"
 #include "Core/MIPS/MIPS.h"
 #include "Core/MIPS/JitCommon/JitCommon.h"
+#include "Core/MIPS/JitCommon/JitWriteProtect.h"
 #include "Common/Thread/ParallelLoop.h"
 
 namespace Memory {
@@ -324,6 +325,7 @@ bool Init(MemMapSetupFlags flags) {
 		base, m_pPhysicalRAM, m_pUncachedRAM);
 
 	MemFault_Init();
+	JitWriteProtect::Init();
 	return true;
 }
 
@@ -410,6 +412,7 @@ void DoState(PointerWrap &p) {
 void Shutdown() {
 	std::lock_guard<std::recursive_mutex> guard(g_shutdownLock);
 	u32 flags = 0;
+	JitWriteProtect::Shutdown();
 	MemoryMap_Shutdown();
 	base = nullptr;
 	DEBUG_LOG(Log::MemMap, "Memory system shut down.");
@@ -419,6 +422,32 @@ bool IsActive() {
 	return base != nullptr;
 }
 
+bool CanProtectRAM() {
+#ifdef MASKED_PSP_MEMORY
+	// Not worth it on 32-bit, and the views alias each other.
+	return false;
+#else
+	return g_arena.SupportsViewProtection();
+#endif
+}
+
+bool ProtectRAM(u32 address, u32 size, bool writable) {
+	bool success = true;
+	for (int i = 0; i < ARRAY_SIZE(views); i++) {
+		const MemoryView &view = views[i];
+		if (!(view.flags & (MV_IS_PRIMARY_RAM | MV_IS_EXTRA1_RAM | MV_IS_EXTRA2_RAM)) || view.size == 0 || !*view.out_ptr)
+			continue;
+		// Compare physical addresses, so that every mirror gets protected.
+		const u32 viewStart = view.virtual_address & 0x1FFFFFFF;
+		const u32 start = std::max(address, viewStart);
+		const u32 end = std::min(address + size, viewStart + view.size);
+		if (start >= end)
+			continue;
+		success = g_arena.ProtectView(*view.out_ptr + (start - viewStart), end - start, writable) && success;
+	}
+	return success;
+}
+
 // Wanting to avoid include pollution, MemMap.h is included a lot.
 MemoryInitedLock::MemoryInitedLock()
 {
@@ -504,6 +533,11 @@ Opcode Read_Opcode_JIT(u32 address)
 // WARNING! No checks!
 void Write_Opcode_JIT(const u32 address, const Opcode& _Value) {
 	_dbg_assert_((address & 3) == 0);
+	if (JitWriteProtect::IsEnabled()) {
+		// Code pages may be write protected, this writes without marking them as modified.
+		JitWriteProtect::WriteOpcode(address, _Value.encoding);
+		return;
+	}
 	Memory::WriteUnchecked_U32(_Value.encoding, address);
 }
 
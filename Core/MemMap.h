@@ -118,6 +118,11 @@ void DoState(PointerWrap &p);
 // False when shutdown has already been called.
 bool IsActive();
 
+// Changes the write protection of a range of RAM in all its mirrored views, for JitWriteProtect.
+// The range is a physical address and should be aligned to the host page size.
+bool CanProtectRAM();
+bool ProtectRAM(u32 address, u32 size, bool writable);
+
 class MemoryInitedLock {
 public:
 	MemoryInitedLock();
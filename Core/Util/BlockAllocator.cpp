@@ -17,6 +17,7 @@
 
 #include <cstring>
 
+#include "Common/BitScan.h"
 #include "Common/Log.h"
 #include "Common/Serialize/Serializer.h"
 #include "Common/Serialize/SerializeFuncs.h"
@@ -25,8 +26,6 @@
 #include "Core/Util/BlockAllocator.h"
 #include "Core/Reporting.h"
 
-// Slow freaking thing but works (eventually) :)
-
 BlockAllocator::~BlockAllocator()
 {
 	Shutdown();
@@ -40,6 +39,7 @@ void BlockAllocator::Init(u32 rangeStart, u32 rangeSize, bool suballoc) {
 	top_ = new Block(rangeStart_, rangeSize_, false, NULL, NULL);
 	bottom_ = top_;
 	suballoc_ = suballoc;
+	IndexBlock(top_);
 }
 
 void BlockAllocator::Shutdown()
@@ -51,6 +51,71 @@ void BlockAllocator::Shutdown()
 		bottom_ = next;
 	}
 	top_ = NULL;
+	blocksByStart_.clear();
+	for (FreeBin &bin : freeBins_)
+		bin.clear();
+}
+
+int BlockAllocator::FreeBinFor(u32 size) {
+	return size == 0 ? 0 : 31 - clz32_nonzero(size);
+}
+
+void BlockAllocator::IndexBlock(Block *b) {
+	blocksByStart_[b->start] = b;
+	if (!b->taken)
+		freeBins_[FreeBinFor(b->size)].insert(b);
+}
+
+void BlockAllocator::UnindexBlock(Block *b) {
+	auto it = blocksByStart_.find(b->start);
+	if (it != blocksByStart_.end() && it->second == b)
+		blocksByStart_.erase(it);
+	if (!b->taken)
+		freeBins_[FreeBinFor(b->size)].erase(b);
+}
+
+// Finds the same block as walking the list from the bottom (or top) for the first free one that fits.
+BlockAllocator::Block *BlockAllocator::FindFreeBlock(u32 size, u32 grain, bool fromTop) const {
+	auto fits = [&](const Block *b) {
+		u32 offset;
+		if (fromTop) {
+			if (b->size < size)
+				return false;
+			offset = (b->start + b->size - size) % grain;
+		} else {
+			offset = b->start % grain;
+			if (offset != 0)
+				offset = grain - offset;
+		}
+		return b->size >= offset + size;
+	};
+
+	// Larger bins first, where the first block almost always fits, to limit the scan of the smaller ones.
+	Block *best = nullptr;
+	for (int i = FREE_BIN_COUNT - 1; i >= FreeBinFor(size); --i) {
+		const FreeBin &bin = freeBins_[i];
+		if (!fromTop) {
+			for (Block *b : bin) {
+				if (best && b->start >= best->start)
+					break;
+				if (fits(b)) {
+					best = b;
+					break;
+				}
+			}
+		} else {
+			for (auto it = bin.rbegin(); it != bin.rend(); ++it) {
+				Block *b = *it;
+				if (best && b->start <= best->start)
+					break;
+				if (fits(b)) {
+					best = b;
+					break;
+				}
+			}
+		}
+	}
+	return best;
 }
 
 u32 BlockAllocator::AllocAligned(u32 &size, u32 sizeGrain, u32 grain, bool fromTop, const char *tag)
@@ -70,67 +135,37 @@ u32 BlockAllocator::AllocAligned(u32 &size, u32 sizeGrain, u32 grain, bool fromT
 	// upalign size to grain
 	size = (size + sizeGrain - 1) & ~(sizeGrain - 1);
 
-	if (!fromTop)
+	Block *bp = FindFreeBlock(size, grain, fromTop);
+	if (bp != NULL)
 	{
-		//Allocate from bottom of mem
-		for (Block *bp = bottom_; bp != NULL; bp = bp->next)
+		Block &b = *bp;
+		UnindexBlock(bp);
+		if (!fromTop)
 		{
-			Block &b = *bp;
+			//Allocate from bottom of mem
 			u32 offset = b.start % grain;
 			if (offset != 0)
 				offset = grain - offset;
 			u32 needed = offset + size;
-			if (b.taken == false && b.size >= needed)
-			{
-				if (b.size == needed)
-				{
-					if (offset >= grain_)
-						InsertFreeBefore(&b, offset);
-					b.taken = true;
-					b.SetAllocated(tag, suballoc_);
-					return b.start;
-				}
-				else
-				{
-					InsertFreeAfter(&b, b.size - needed);
-					if (offset >= grain_)
-						InsertFreeBefore(&b, offset);
-					b.taken = true;
-					b.SetAllocated(tag, suballoc_);
-					return b.start;
-				}
-			}
+			if (b.size != needed)
+				InsertFreeAfter(&b, b.size - needed);
+			if (offset >= grain_)
+				InsertFreeBefore(&b, offset);
 		}
-	}
-	else
-	{
-		// Allocate from top of mem.
-		for (Block *bp = top_; bp != NULL; bp = bp->prev)
+		else
 		{
-			Block &b = *bp;
+			// Allocate from top of mem.
 			u32 offset = (b.start + b.size - size) % grain;
 			u32 needed = offset + size;
-			if (b.taken == false && b.size >= needed)
-			{
-				if (b.size == needed)
-				{
-					if (offset >= grain_)
-						InsertFreeAfter(&b, offset);
-					b.taken = true;
-					b.SetAllocated(tag, suballoc_);
-					return b.start;
-				}
-				else
-				{
-					InsertFreeBefore(&b, b.size - needed);
-					if (offset >= grain_)
-						InsertFreeAfter(&b, offset);
-					b.taken = true;
-					b.SetAllocated(tag, suballoc_);
-					return b.start;
-				}
-			}
+			if (b.size != needed)
+				InsertFreeBefore(&b, b.size - needed);
+			if (offset >= grain_)
+				InsertFreeAfter(&b, offset);
 		}
+		b.taken = true;
+		b.SetAllocated(tag, suballoc_);
+		IndexBlock(bp);
+		return b.start;
 	}
 
 	//Out of memory :(
@@ -189,20 +224,24 @@ u32 BlockAllocator::AllocAt(u32 position, u32 size, const char *tag)
 			//good to go
 			else if (b.start == alignedPosition)
 			{
+				UnindexBlock(bp);
 				if (b.size != alignedSize)
 					InsertFreeAfter(&b, b.size - alignedSize);
 				b.taken = true;
 				b.SetAllocated(tag, suballoc_);
+				IndexBlock(bp);
 				CheckBlocks();
 				return position;
 			}
 			else
 			{
+				UnindexBlock(bp);
 				InsertFreeBefore(&b, alignedPosition - b.start);
 				if (b.size > alignedSize)
 					InsertFreeAfter(&b, b.size - alignedSize);
 				b.taken = true;
 				b.SetAllocated(tag, suballoc_);
+				IndexBlock(bp);
 
 				return position;
 			}
@@ -224,10 +263,12 @@ void BlockAllocator::MergeFreeBlocks(Block *fromBlock)
 {
 	VERBOSE_LOG(Log::sceKernel, "Merging Blocks");
 
+	// fromBlock is not indexed, and neither is anything merged into it.
 	Block *prev = fromBlock->prev;
 	while (prev != NULL && prev->taken == false)
 	{
 		VERBOSE_LOG(Log::sceKernel, "Block Alloc found adjacent free blocks - merging");
+		UnindexBlock(prev);
 		prev->size += fromBlock->size;
 		if (fromBlock->next == NULL)
 			top_ = prev;
@@ -248,6 +289,7 @@ void BlockAllocator::MergeFreeBlocks(Block *fromBlock)
 	while (next != NULL && next->taken == false)
 	{
 		VERBOSE_LOG(Log::sceKernel, "Block Alloc found adjacent free blocks - merging");
+		UnindexBlock(next);
 		fromBlock->size += next->size;
 		fromBlock->next = next->next;
 		delete next;
@@ -258,6 +300,7 @@ void BlockAllocator::MergeFreeBlocks(Block *fromBlock)
 		top_ = fromBlock;
 	else
 		next->prev = fromBlock;
+	IndexBlock(fromBlock);
 }
 
 bool BlockAllocator::Free(u32 position)
@@ -266,6 +309,7 @@ bool BlockAllocator::Free(u32 position)
 	if (b && b->taken)
 	{
 		NotifyMemInfo(suballoc_ ? MemBlockFlags::SUB_FREE : MemBlockFlags::FREE, b->start, b->size, "");
+		UnindexBlock(b);
 		b->taken = false;
 		MergeFreeBlocks(b);
 		return true;
@@ -283,6 +327,7 @@ bool BlockAllocator::FreeExact(u32 position)
 	if (b && b->taken && b->start == position)
 	{
 		NotifyMemInfo(suballoc_ ? MemBlockFlags::SUB_FREE : MemBlockFlags::FREE, b->start, b->size, "");
+		UnindexBlock(b);
 		b->taken = false;
 		MergeFreeBlocks(b);
 		return true;
@@ -305,6 +350,7 @@ BlockAllocator::Block *BlockAllocator::InsertFreeBefore(Block *b, u32 size)
 
 	b->start += size;
 	b->size -= size;
+	IndexBlock(inserted);
 	return inserted;
 }
 
@@ -318,6 +364,7 @@ BlockAllocator::Block *BlockAllocator::InsertFreeAfter(Block *b, u32 size)
 		inserted->next->prev = inserted;
 
 	b->size -= size;
+	IndexBlock(inserted);
 	return inserted;
 }
 
@@ -341,32 +388,21 @@ const char *BlockAllocator::GetBlockTag(u32 addr) const {
 	return b->tag;
 }
 
-inline BlockAllocator::Block *BlockAllocator::GetBlockFromAddress(u32 addr)
+BlockAllocator::Block *BlockAllocator::GetBlockFromAddress(u32 addr)
 {
-	for (Block *bp = bottom_; bp != NULL; bp = bp->next)
-	{
-		Block &b = *bp;
-		if (b.start <= addr && b.start + b.size > addr)
-		{
-			// Got one!
-			return bp;
-		}
-	}
+	auto it = blocksByStart_.upper_bound(addr);
+	if (it == blocksByStart_.begin())
+		return NULL;
+	--it;
+	Block *b = it->second;
+	if (b->start + b->size > addr)
+		return b;
 	return NULL;
 }
 
 const BlockAllocator::Block *BlockAllocator::GetBlockFromAddress(u32 addr) const
 {
-	for (const Block *bp = bottom_; bp != NULL; bp = bp->next)
-	{
-		const Block &b = *bp;
-		if (b.start <= addr && b.start + b.size > addr)
-		{
-			// Got one!
-			return bp;
-		}
-	}
-	return NULL;
+	return const_cast<BlockAllocator *>(this)->GetBlockFromAddress(addr);
 }
 
 u32 BlockAllocator::GetBlockStartFromAddress(u32 addr) const
@@ -401,13 +437,12 @@ void BlockAllocator::ListBlocks() const
 u32 BlockAllocator::GetLargestFreeBlockSize() const
 {
 	u32 maxFreeBlock = 0;
-	for (const Block *bp = bottom_; bp != NULL; bp = bp->next)
+	for (int i = FREE_BIN_COUNT - 1; i >= 0 && maxFreeBlock == 0; --i)
 	{
-		const Block &b = *bp;
-		if (!b.taken)
+		for (const Block *bp : freeBins_[i])
 		{
-			if (b.size > maxFreeBlock)
-				maxFreeBlock = b.size;
+			if (bp->size > maxFreeBlock)
+				maxFreeBlock = bp->size;
 		}
 	}
 	if (maxFreeBlock & (grain_ - 1))
@@ -418,13 +453,10 @@ u32 BlockAllocator::GetLargestFreeBlockSize() const
 u32 BlockAllocator::GetTotalFreeBytes() const
 {
 	u32 sum = 0;
-	for (const Block *bp = bottom_; bp != NULL; bp = bp->next)
+	for (const FreeBin &bin : freeBins_)
 	{
-		const Block &b = *bp;
-		if (!b.taken)
-		{
-			sum += b.size;
-		}
+		for (const Block *bp : bin)
+			sum += bp->size;
 	}
 	if (sum & (grain_ - 1))
 		WARN_LOG_REPORT(Log::HLE, "GetTotalFreeBytes: free size %08x does not align to grain %08x.", sum, grain_);
@@ -455,6 +487,9 @@ void BlockAllocator::DoState(PointerWrap &p)
 			top_->next->DoState(p);
 			top_ = top_->next;
 		}
+
+		for (Block *bp = bottom_; bp != NULL; bp = bp->next)
+			IndexBlock(bp);
 	}
 	else
 	{
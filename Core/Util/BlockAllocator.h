@@ -19,8 +19,14 @@
 
 class PointerWrap;
 
+#include <map>
+#include <set>
+
 #include "Common/CommonTypes.h"
 
+// Blocks form an address ordered list. To avoid walking it, all blocks are also indexed by start
+// address, and free blocks are kept in power of 2 size classes (sorted by address), so allocations
+// only look at blocks that might fit while still picking the same block a walk would.
 class BlockAllocator
 {
 public:
@@ -71,6 +77,16 @@ class BlockAllocator
 		Block *next;
 	};
 
+	struct BlockStartOrder {
+		bool operator()(const Block *a, const Block *b) const {
+			return a->start < b->start;
+		}
+	};
+	typedef std::set<Block *, BlockStartOrder> FreeBin;
+	enum {
+		FREE_BIN_COUNT = 32,
+	};
+
 	Block *bottom_ = nullptr;
 	Block *top_ = nullptr;
 	u32 rangeStart_ = 0;
@@ -79,6 +95,17 @@ class BlockAllocator
 	u32 grain_;
 	bool suballoc_ = false;
 
+	// Every block by start address.
+	std::map<u32, Block *> blocksByStart_;
+	// Free blocks, bin n has the sizes [1 << n, 2 << n).
+	FreeBin freeBins_[FREE_BIN_COUNT];
+
+	// A block must be removed from the indexes while its start, size, or taken changes.
+	void IndexBlock(Block *b);
+	void UnindexBlock(Block *b);
+	static int FreeBinFor(u32 size);
+	Block *FindFreeBlock(u32 size, u32 grain, bool fromTop) const;
+
 	void MergeFreeBlocks(Block *fromBlock);
 	Block *GetBlockFromAddress(u32 addr);
 	const Block *GetBlockFromAddress(u32 addr) const;
@@ -338,6 +338,11 @@ void DeveloperToolsScreen::CreateMIPSTracerTab(UI::LinearLayout *list) {
 		return true;
 	});
 
+	CheckBox *streamBinary = list->Add(new CheckBox(&mipsTracer.in_stream_binary, dev->T("Stream a compressed binary trace")));
+	streamBinary->SetEnabledFunc([]() {
+		return !mipsTracer.tracing_enabled;
+	});
+
 	MIPSTracerPath_ = mipsTracer.get_logging_path();
 	MIPSTracerPath = list->Add(new InfoItem(dev->T("Current log file"), MIPSTracerPath_));
 
@@ -749,7 +754,7 @@ void DeveloperToolsScreen::OnMIPSTracerPathChanged(UI::EventParams &e) {
 	System_BrowseForFileSave(
 		GetRequesterToken(),
 		dev->T("Select the log file"),
-		"trace.txt",
+		mipsTracer.in_stream_binary ? "trace.mtrace" : "trace.txt",
 		BrowseFileType::ANY,
 		[this](std::string_view value, int) {
 			mipsTracer.set_logging_path(std::string(value));
@@ -193,10 +193,8 @@ void DrawSchedulerView(ImConfig &cfg) {
 	}
 	s64 ticks = CoreTiming::GetTicks();
 	if (ImGui::BeginChild("event_list", ImVec2(300.0f, 0.0))) {
-		const CoreTiming::Event *event = CoreTiming::GetFirstEvent();
-		while (event) {
-			ImGui::Text("%s (%lld): %d", CoreTiming::GetEventTypes()[event->type].name, event->time - ticks, (int)event->userdata);
-			event = event->next;
+		for (const CoreTiming::BaseEvent &event : CoreTiming::GetPendingEvents()) {
+			ImGui::Text("%s (%lld): %d", CoreTiming::GetEventTypes()[event.type].name, event.time - ticks, (int)event.userdata);
 		}
 		ImGui::EndChild();
 	}
@@ -644,6 +642,23 @@ static void DrawFilesystemBrowser(ImConfig &cfg) {
 		return;
 	}
 
+	if (ImGui::CollapsingHeader("ISO read-ahead")) {
+		const ISOReadAheadStats stats = GetISOReadAheadStats();
+		const u64 misses = stats.reads - stats.hits;
+		const double hitUs = stats.hits ? stats.hitSeconds * 1000000.0 / stats.hits : 0.0;
+		const double missUs = misses ? stats.missSeconds * 1000000.0 / misses : 0.0;
+		ImGui::Text("Enabled: %s", g_Config.bISOReadAhead ? "yes" : "no (ISOReadAhead in the ini)");
+		ImGui::Text("Reads: %llu, hits: %llu (%.1f%%)", (unsigned long long)stats.reads, (unsigned long long)stats.hits, stats.reads ? stats.hits * 100.0 / stats.reads : 0.0);
+		ImGui::Text("Prefetches: %llu, %.1f MB (%.1f MB used)", (unsigned long long)stats.prefetches, stats.prefetchedBytes / 1048576.0, stats.hitBytes / 1048576.0);
+		ImGui::Text("Average read: %.1f us on a hit, %.1f us on a miss", hitUs, missUs);
+		if (stats.hits && misses) {
+			ImGui::Text("Estimated time saved: %.1f ms", (missUs - hitUs) * stats.hits / 1000.0);
+		}
+		if (ImGui::Button("Reset")) {
+			ResetISOReadAheadStats();
+		}
+	}
+
 	for (auto &fs : pspFileSystem.GetMounts()) {
 		std::string path;
 		char desc[256];
@@ -674,11 +689,11 @@ static void DrawKernelObjects(ImConfig &cfg) {
 		ImGui::TableHeadersRow();
 
 		for (int i = 0; i < (int)KernelObjectPool::maxCount; i++) {
-			int id = i + KernelObjectPool::handleOffset;
-			if (!kernelObjects.IsValid(id)) {
+			KernelObject *obj = kernelObjects.GetBySlot(i);
+			if (!obj) {
 				continue;
 			}
-			KernelObject *obj = kernelObjects.GetFast<KernelObject>(id);
+			int id = obj->GetUID();
 			ImGui::TableNextRow();
 			ImGui::TableNextColumn();
 			ImGui::PushID(i);
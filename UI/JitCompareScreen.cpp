@@ -316,11 +316,17 @@ void JitCompareScreen::UpdateDisasm() {
 			"Num blocks: %d\n"
 			"Average Bloat: %0.2f%%\n"
 			"Min Bloat: %0.2f%%  (%08x)\n"
-			"Max Bloat: %0.2f%%  (%08x)\n",
+			"Max Bloat: %0.2f%%  (%08x)\n"
+			"Disk cache: %d hits, %d misses, %d invalidated\n"
+			"Lookup tables: %d KB\n"
+			"Idle loops: %d blocks, %lld cycles skipped (most %lld at %08x)\n",
 			blockCacheDebug->GetNumBlocks(),
 			100.0 * bcStats.avgBloat,
 			100.0 * bcStats.minBloat, bcStats.minBloatBlock,
-			100.0 * bcStats.maxBloat, bcStats.maxBloatBlock);
+			100.0 * bcStats.maxBloat, bcStats.maxBloatBlock,
+			bcStats.diskCacheHits, bcStats.diskCacheMisses, bcStats.diskCacheInvalidated,
+			(int)(bcStats.lookupMemoryBytes / 1024),
+			bcStats.idleLoopBlocks, (long long)bcStats.idleSkippedCycles, (long long)bcStats.maxIdleSkippedCycles, bcStats.maxIdleSkippedBlock);
 
 		globalStats_->SetText(stats);
 	}
@@ -42,7 +42,14 @@
 #include "Core/CoreTiming.h"
 #include "Core/System.h"
 #include "Core/WebServer.h"
+#include "Core/HLE/HLE.h"
 #include "Core/HLE/sceUtility.h"
+#include "Core/MIPS/JitCommon/JitBlockCache.h"
+#include "Core/MIPS/JitCommon/JitCommon.h"
+#include "Core/MIPS/JitCommon/JitWriteProtect.h"
+#include "Core/MIPS/IR/IRJit.h"
+#include "Core/MIPS/MIPSTracer.h"
+#include "Core/HW/Display.h"
 #include "Core/SaveState.h"
 #include "GPU/GPUCommon.h"
 #include "GPU/Common/FramebufferManagerCommon.h"
@@ -150,8 +157,16 @@ int printUsage(const char *progname, const char *reason)
 	fprintf(stderr, "  -i                    use the interpreter\n");
 	fprintf(stderr, "  --ir                  use ir interpreter\n");
 	fprintf(stderr, "  -j                    use jit (default)\n");
+	fprintf(stderr, "  --ir-cache            persist IR blocks on disk, print cache stats\n");
+	fprintf(stderr, "  --superblocks         form IR blocks across forward branches\n");
+	fprintf(stderr, "  --function-regions    compile IR blocks to the end of their function\n");
+	fprintf(stderr, "  --dispatch-stats      print IR interpreter block dispatches per vblank\n");
+	fprintf(stderr, "  --ir-threaded         use threaded dispatch in the ir interpreter (compare with --bench)\n");
+	fprintf(stderr, "  --jit-write-protect   write protect compiled code to skip invalidations, prints stats\n");
+	fprintf(stderr, "  --direct-syscalls     continue IR interpreter blocks after hot syscalls (compare with --bench)\n");
 	fprintf(stderr, "  -c, --compare         compare with output in file.expected\n");
 	fprintf(stderr, "  --bench               run multiple times and output speed\n");
+	fprintf(stderr, "  --decode-trace=FILE   decode a binary MIPSTracer trace to FILE.txt, print hot blocks\n");
 	fprintf(stderr, "\nSee headless.txt for details.\n");
 
 	return 1;
@@ -177,6 +192,7 @@ struct AutoTestOptions {
 	bool compare : 1;
 	bool verbose : 1;
 	bool bench : 1;
+	bool dispatchStats : 1;
 };
 
 bool RunAutoTest(HeadlessHost *headlessHost, CoreParameter &coreParameter, const AutoTestOptions &opt) {
@@ -277,6 +293,43 @@ bool RunAutoTest(HeadlessHost *headlessHost, CoreParameter &coreParameter, const
 		draw->EndFrame();
 	}
 
+	if (g_Config.bIRBlockCache && MIPSComp::jit) {
+		BlockCacheStats bcStats{};
+		MIPSComp::jit->GetBlockCacheDebugInterface()->ComputeStats(bcStats);
+		fprintf(stderr, "IR block cache: %d blocks, %d hits, %d misses, %d invalidated, %d KB lookup tables\n", bcStats.numBlocks, bcStats.diskCacheHits, bcStats.diskCacheMisses, bcStats.diskCacheInvalidated, (int)(bcStats.lookupMemoryBytes / 1024));
+	}
+	if (g_Config.bIRIdleLoops && MIPSComp::jit) {
+		BlockCacheStats bcStats{};
+		MIPSComp::jit->GetBlockCacheDebugInterface()->ComputeStats(bcStats);
+		fprintf(stderr, "IR idle loops: %d blocks, %llu cycles skipped\n", bcStats.idleLoopBlocks, (unsigned long long)bcStats.idleSkippedCycles);
+	}
+	if (g_Config.bIRDirectSyscalls) {
+		u64 calls, slowCalls;
+		hleGetDirectSyscallStats(calls, slowCalls);
+		fprintf(stderr, "IR direct syscalls: %llu calls, %llu exited the block\n", (unsigned long long)calls, (unsigned long long)slowCalls);
+	}
+	if (opt.dispatchStats) {
+		// Only the IR interpreter counts dispatches, so compare with --ir with and without --superblocks or --function-regions.
+		MIPSComp::IRJit *irJit = dynamic_cast<MIPSComp::IRJit *>(MIPSComp::jit);
+		if (irJit) {
+			u64 dispatches = irJit->GetNumDispatches();
+			int vblanks = __DisplayGetNumVblanks();
+			fprintf(stderr, "IR dispatches: %llu (%.1f per vblank, %d vblanks)\n", (unsigned long long)dispatches, vblanks > 0 ? (double)dispatches / vblanks : 0.0, vblanks);
+			if (g_Config.bIRFunctionRegions) {
+				u64 functionEntries = irJit->GetNumFunctionEntryDispatches();
+				u64 blockEntries = dispatches - functionEntries;
+				fprintf(stderr, "IR function entries: %.1f per vblank, other block entries: %.1f per vblank\n",
+					vblanks > 0 ? (double)functionEntries / vblanks : 0.0, vblanks > 0 ? (double)blockEntries / vblanks : 0.0);
+			}
+		}
+	}
+	if (JitWriteProtect::IsEnabled()) {
+		JitWriteProtect::Stats wpStats = JitWriteProtect::GetStats();
+		fprintf(stderr, "Write protect: %llu invalidations, %llu skipped, %llu of %llu bytes invalidated, %llu write faults\n",
+			(unsigned long long)wpStats.requests, (unsigned long long)wpStats.skippedRequests,
+			(unsigned long long)wpStats.invalidatedBytes, (unsigned long long)wpStats.requestedBytes, (unsigned long long)wpStats.faults);
+	}
+
 	PSP_Shutdown(true);
 
 	if (!opt.bench)
@@ -369,6 +422,12 @@ int main(int argc, const char* argv[])
 	CPUCore cpuCore = CPUCore::JIT;
 	int debuggerPort = -1;
 	bool oldAtrac = false;
+	bool irBlockCache = false;
+	bool irSuperblocks = false;
+	bool irFunctionRegions = false;
+	bool irThreadedDispatch = false;
+	bool jitWriteProtect = false;
+	bool irDirectSyscalls = false;
 	bool outputDebugStringLog = false;
 
 	std::vector<std::string> testFilenames;
@@ -376,6 +435,7 @@ int main(int argc, const char* argv[])
 	const char *mountIso = nullptr;
 	const char *mountRoot = nullptr;
 	const char *screenshotFilename = nullptr;
+	const char *traceToDecode = nullptr;
 
 	for (int i = 1; i < argc; i++)
 	{
@@ -403,6 +463,20 @@ int main(int argc, const char* argv[])
 			cpuCore = CPUCore::JIT_IR;
 		else if (!strcmp(argv[i], "--ir"))
 			cpuCore = CPUCore::IR_INTERPRETER;
+		else if (!strcmp(argv[i], "--ir-cache"))
+			irBlockCache = true;
+		else if (!strcmp(argv[i], "--superblocks"))
+			irSuperblocks = true;
+		else if (!strcmp(argv[i], "--function-regions"))
+			irFunctionRegions = true;
+		else if (!strcmp(argv[i], "--ir-threaded"))
+			irThreadedDispatch = true;
+		else if (!strcmp(argv[i], "--jit-write-protect"))
+			jitWriteProtect = true;
+		else if (!strcmp(argv[i], "--direct-syscalls"))
+			irDirectSyscalls = true;
+		else if (!strcmp(argv[i], "--dispatch-stats"))
+			testOptions.dispatchStats = true;
 		else if (!strcmp(argv[i], "-c") || !strcmp(argv[i], "--compare"))
 			testOptions.compare = true;
 		else if (!strcmp(argv[i], "--bench"))
@@ -445,6 +519,8 @@ int main(int argc, const char* argv[])
 			teamCityMode = true;
 		else if (!strncmp(argv[i], "--state=", strlen("--state=")) && strlen(argv[i]) > strlen("--state="))
 			stateToLoad = argv[i] + strlen("--state=");
+		else if (!strncmp(argv[i], "--decode-trace=", strlen("--decode-trace=")) && strlen(argv[i]) > strlen("--decode-trace="))
+			traceToDecode = argv[i] + strlen("--decode-trace=");
 		else if (!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h"))
 			return printUsage(argv[0], NULL);
 		else if (!strcmp(argv[i], "--ignore")) {
@@ -456,6 +532,16 @@ int main(int argc, const char* argv[])
 		}
 	}
 
+	if (traceToDecode) {
+		// Doesn't need anything running, only the disassembler.
+		Path tracePath(traceToDecode);
+		if (!MIPSTraceDecode(tracePath, tracePath.WithExtraExtension(".txt"), stdout, 50)) {
+			fprintf(stderr, "Failed to decode the trace %s\n", traceToDecode);
+			return 1;
+		}
+		return 0;
+	}
+
 	if (testFilenames.size() == 1 && testFilenames[0][0] == '@')
 		testFilenames = ReadFromListFile(testFilenames[0].substr(1));
 
@@ -557,6 +643,12 @@ int main(int argc, const char* argv[])
 	g_Config.iReverbVolume = VOLUMEHI_FULL;
 	g_Config.internalDataDirectory.clear();
 	g_Config.bUseOldAtrac = oldAtrac;
+	g_Config.bIRBlockCache = irBlockCache;
+	g_Config.bIRSuperblocks = irSuperblocks;
+	g_Config.bIRFunctionRegions = irFunctionRegions;
+	g_Config.bIRThreadedDispatch = irThreadedDispatch;
+	g_Config.bJitWriteProtect = jitWriteProtect;
+	g_Config.bIRDirectSyscalls = irDirectSyscalls;
 	g_Config.iForceEnableHLE = 0xFFFFFFFF;  // Run all modules as HLE. We don't have anything to load in this context.
 
 	// g_Config.bUseOldAtrac = true;
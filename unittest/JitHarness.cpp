@@ -19,6 +19,7 @@
 
 #include "ppsspp_config.h"
 
+#include "Common/CPUDetect.h"
 #include "Common/System/NativeApp.h"
 #include "Common/System/System.h"
 #include "Common/TimeUtil.h"
@@ -37,6 +38,7 @@
 #include "Core/CoreTiming.h"
 #include "Core/Config.h"
 #include "Core/HLE/HLE.h"
+#include "Core/HLE/FunctionWrappers.h"
 
 // Temporary hacks around annoying linking errors.  Copied from Headless.
 void NativeFrame(GraphicsContext *graphicsContext) { }
@@ -53,8 +55,24 @@ void UnitTestTerminator() {
 	hleSkipDeadbeef();
 }
 
+// These do about what the real ones do. The names matter, IRDirectSyscalls picks functions by name.
+static u32 UnitTestGetSystemTimeLow() {
+	u64 t = CoreTiming::GetGlobalTimeUs();
+	hleEatCycles(165);
+	hleReSchedule("system time");
+	return hleNoLog((u32)t);
+}
+
+// Unlike the above, doesn't reschedule.
+static int UnitTestCtrlPeekBufferPositive(u32 ctrlDataPtr, u32 nBufs) {
+	hleEatCycles(330);
+	return hleNoLog((int)nBufs);
+}
+
 HLEFunction UnitTestFakeSyscalls[] = {
 	{0x1234BEEF, &UnitTestTerminator, "UnitTestTerminator"},
+	{0x369ED59D, &WrapU_V<UnitTestGetSystemTimeLow>, "sceKernelGetSystemTimeLow", 'x', ""},
+	{0x3A622550, &WrapI_UU<UnitTestCtrlPeekBufferPositive>, "sceCtrlPeekBufferPositive", 'i', "xx"},
 };
 
 double ExecCPUTest(bool clearCache = true) {
@@ -193,6 +211,7 @@ bool TestJit() {
 	printf("\n");
 
 	double jit_speed = 0.0, jit_ir_speed = 0.0, ir_speed = 0.0, interp_speed = 0.0;
+	double jit_ir_sse_speed = 0.0;
 	if (compileSuccess) {
 		interp_speed = ExecCPUTest();
 		mipsr4k.UpdateCore(CPUCore::IR_INTERPRETER);
@@ -201,6 +220,17 @@ bool TestJit() {
 		jit_speed = ExecCPUTest();
 #if !PPSSPP_PLATFORM(MAC)
 		mipsr4k.UpdateCore(CPUCore::JIT_IR);
+#if PPSSPP_ARCH(AMD64)
+		if (cpu_info.bAVX) {
+			// The x64 backend picks VEX encodings while compiling, so compare against plain SSE.
+			const CPUInfo saved = cpu_info;
+			cpu_info.bAVX = false;
+			cpu_info.bAVX2 = false;
+			cpu_info.bFMA3 = false;
+			jit_ir_sse_speed = ExecCPUTest();
+			cpu_info = saved;
+		}
+#endif
 		jit_ir_speed = ExecCPUTest(false);
 #endif
 
@@ -218,6 +248,8 @@ bool TestJit() {
 				printf("...\n");
 		}
 		printf("Jit was %fx faster than interp, IR was %fx faster, JIT IR %fx.\n\n", jit_speed / interp_speed, ir_speed / interp_speed, jit_ir_speed / interp_speed);
+		if (jit_ir_sse_speed > 0.0)
+			printf("JIT IR with AVX was %fx faster than with SSE only.\n\n", jit_ir_speed / jit_ir_sse_speed);
 	}
 
 	printf("\n");
@@ -226,3 +258,65 @@ bool TestJit() {
 
 	return jit_speed >= interp_speed;
 }
+
+// Syscall overhead in the IR interpreter, with and without IRDirectSyscalls.
+bool BenchIRSyscalls() {
+	SetupJitHarness();
+
+	g_Config.bFastMemory = true;
+
+	static const char *const funcs[] = {
+		"sceKernelGetSystemTimeLow",
+		"sceCtrlPeekBufferPositive",
+	};
+
+	const int NUM_SYSCALLS = 100;
+	for (const char *func : funcs) {
+		// Get rid of the jit before replacing the code it compiled.
+		mipsr4k.UpdateCore(CPUCore::INTERPRETER);
+
+		u32 *p = (u32 *)Memory::GetPointer(PSP_GetUserMemoryBase());
+		for (int i = 0; i < NUM_SYSCALLS; ++i) {
+			*p++ = MIPS_MAKE_SYSCALL("UnitTestFakeSyscalls", func);
+			*p++ = MIPS_MAKE_ADDIU(MIPS_REG_S0, MIPS_REG_S0, 1);
+		}
+		*p++ = MIPS_MAKE_SYSCALL("UnitTestFakeSyscalls", "UnitTestTerminator");
+		*p++ = MIPS_MAKE_BREAK(1);
+		*p++ = MIPS_MAKE_JR_RA();
+
+		double bestTime[2] = { 1.0, 1.0 };
+		u64 directCalls = 0, directExits = 0;
+		// Alternate, and keep the fastest of many short runs. The timings are noisy otherwise.
+		for (int i = 0; i < 8; ++i) {
+			for (int direct = 0; direct < 2; ++direct) {
+				// The option is read when the jit is created.
+				g_Config.bIRDirectSyscalls = direct != 0;
+				mipsr4k.UpdateCore(CPUCore::INTERPRETER);
+				mipsr4k.UpdateCore(CPUCore::IR_INTERPRETER);
+
+				u64 callsBefore, exitsBefore, callsAfter, exitsAfter;
+				hleGetDirectSyscallStats(callsBefore, exitsBefore);
+				for (int sample = 0; sample < 500; ++sample) {
+					double st = time_now_d();
+					for (int j = 0; j < 20; ++j) {
+						currentMIPS->pc = PSP_GetUserMemoryBase();
+						coreState = CORE_RUNNING_CPU;
+						while (coreState == CORE_RUNNING_CPU)
+							mipsr4k.RunLoopUntil(1000000);
+					}
+					bestTime[direct] = std::min(bestTime[direct], (time_now_d() - st) / (20 * NUM_SYSCALLS));
+				}
+				hleGetDirectSyscallStats(callsAfter, exitsAfter);
+				directCalls += callsAfter - callsBefore;
+				directExits += exitsAfter - exitsBefore;
+			}
+		}
+
+		printf("%s: %0.1f ns per syscall, %0.1f ns with IRDirectSyscalls (%0.2fx), %llu of %llu direct calls exited the block\n", func,
+			bestTime[0] * 1e9, bestTime[1] * 1e9, bestTime[0] / bestTime[1], (unsigned long long)directExits, (unsigned long long)directCalls);
+	}
+
+	g_Config.bIRDirectSyscalls = false;
+	DestroyJitHarness();
+	return true;
+}
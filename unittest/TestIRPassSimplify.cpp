@@ -15,9 +15,16 @@
 // Official git repository and contact information can be found at
 // https://github.com/hrydgard/ppsspp and http://www.ppsspp.org/.
 
+#include <algorithm>
 #include <cstdio>
 #include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include "Core/MemMap.h"
+#include "Core/MIPS/MIPS.h"
 #include "Core/MIPS/IR/IRInst.h"
+#include "Core/MIPS/IR/IRInterpreter.h"
 #include "Core/MIPS/IR/IRPassSimplify.h"
 
 struct IRVerification {
@@ -166,8 +173,285 @@ static const IRVerification tests[] = {
 		},
 		{ &PropagateConstants },
 	},
+	{
+		"VectorizeFloatAdd",
+		{
+			{ IROp::FAdd, { 32 }, 36, 40 },
+			{ IROp::FAdd, { 33 }, 37, 41 },
+			{ IROp::FAdd, { 35 }, 39, 43 },
+			{ IROp::FAdd, { 34 }, 38, 42 },
+			{ IROp::FNeg, { 4 }, 0 },
+			{ IROp::FNeg, { 5 }, 1 },
+			{ IROp::FNeg, { 6 }, 2 },
+			{ IROp::FNeg, { 7 }, 3 },
+		},
+		{
+			{ IROp::Vec4Add, { 32 }, 36, 40 },
+			{ IROp::Vec4Neg, { 4 }, 0 },
+		},
+		{ &VectorizeFloatOps },
+	},
+	{
+		"VectorizeFloatScale",
+		{
+			{ IROp::FMul, { 32 }, 32, 44 },
+			{ IROp::FMul, { 33 }, 33, 44 },
+			{ IROp::FMul, { 34 }, 34, 44 },
+			{ IROp::FMul, { 35 }, 35, 44 },
+			// The FPU FMul handles inf * 0 differently, so these stay scalar.
+			{ IROp::FMul, { 0 }, 4, 8 },
+			{ IROp::FMul, { 1 }, 5, 9 },
+			{ IROp::FMul, { 2 }, 6, 10 },
+			{ IROp::FMul, { 3 }, 7, 11 },
+		},
+		{
+			{ IROp::Vec4Scale, { 32 }, 32, 44 },
+			{ IROp::FMul, { 0 }, 4, 8 },
+			{ IROp::FMul, { 1 }, 5, 9 },
+			{ IROp::FMul, { 2 }, 6, 10 },
+			{ IROp::FMul, { 3 }, 7, 11 },
+		},
+		{ &VectorizeFloatOps },
+	},
+	{
+		// Not adjacent, and a scale factor that's overwritten part way through.
+		"VectorizeFloatBlocked",
+		{
+			{ IROp::FSub, { 32 }, 36, 40 },
+			{ IROp::FSub, { 33 }, 37, 41 },
+			{ IROp::FMov, { 36 }, 32 },
+			{ IROp::FSub, { 34 }, 38, 42 },
+			{ IROp::FMul, { 32 }, 36, 33 },
+			{ IROp::FMul, { 33 }, 37, 33 },
+			{ IROp::FMul, { 34 }, 38, 33 },
+			{ IROp::FMul, { 35 }, 39, 33 },
+		},
+		{
+			{ IROp::FSub, { 32 }, 36, 40 },
+			{ IROp::FSub, { 33 }, 37, 41 },
+			{ IROp::FMov, { 36 }, 32 },
+			{ IROp::FSub, { 34 }, 38, 42 },
+			{ IROp::FMul, { 32 }, 36, 33 },
+			{ IROp::FMul, { 33 }, 37, 33 },
+			{ IROp::FMul, { 34 }, 38, 33 },
+			{ IROp::FMul, { 35 }, 39, 33 },
+		},
+		{ &VectorizeFloatOps },
+	},
+};
+
+// Differential testing: random blocks must behave the same when interpreted with and without a pass.
+static const u32 DIFF_MEM_BASE = 0x08800000;
+static const u32 DIFF_MEM_SIZE = 0x1000;
+static const u32 DIFF_EXIT_PC = 0x08804000;
+
+static IRInst RandomIRInst(std::mt19937 &rng) {
+	static const u8 gprs[] = { MIPS_REG_V0, MIPS_REG_V1, MIPS_REG_A0, MIPS_REG_A1, MIPS_REG_A2, MIPS_REG_A3, MIPS_REG_T0, MIPS_REG_T1 };
+	// S0 stays fixed, S1 moves around to test ops that change the base.
+	static const u8 bases[] = { MIPS_REG_S0, MIPS_REG_S1 };
+	static const IROp arith[] = { IROp::Add, IROp::Sub, IROp::And, IROp::Or, IROp::Xor, IROp::Slt, IROp::SltU };
+	static const IROp loads[] = { IROp::Load8, IROp::Load8Ext, IROp::Load16, IROp::Load16Ext, IROp::Load32 };
+	static const IROp stores[] = { IROp::Store8, IROp::Store16, IROp::Store32 };
+
+	auto pick = [&](int n) { return (int)(rng() % n); };
+	auto gpr = [&]() { return gprs[pick(ARRAY_SIZE(gprs))]; };
+	auto fpr = [&]() { return (u8)pick(8); };
+	auto base = [&]() { return bases[pick(ARRAY_SIZE(bases))]; };
+	auto offset = [&](int size) { return (u32)((pick(24) - 8) * size); };
+
+	switch (pick(12)) {
+	case 0:
+		return { arith[pick(ARRAY_SIZE(arith))], { gpr() }, gpr(), gpr() };
+	case 1:
+		return { IROp::AddConst, { gpr() }, gpr(), 0, (u32)rng() };
+	case 2:
+		return { IROp::Mov, { gpr() }, gpr() };
+	case 3:
+		return { IROp::AddConst, { MIPS_REG_S1 }, MIPS_REG_S1, 0, (u32)((pick(5) - 2) * 8) };
+	case 4:
+	case 5: {
+		IROp op = loads[pick(ARRAY_SIZE(loads))];
+		int size = op == IROp::Load32 ? 4 : (op == IROp::Load8 || op == IROp::Load8Ext ? 1 : 2);
+		return { op, { gpr() }, base(), 0, offset(size) };
+	}
+	case 6:
+	case 7: {
+		IROp op = stores[pick(ARRAY_SIZE(stores))];
+		int size = op == IROp::Store32 ? 4 : (op == IROp::Store8 ? 1 : 2);
+		// Zero stores are what MergeLoadStore combines.
+		u8 value = pick(3) == 0 ? (u8)MIPS_REG_ZERO : gpr();
+		return { op, { value }, base(), 0, offset(size) };
+	}
+	case 8:
+		return { pick(2) ? IROp::LoadFloat : IROp::StoreFloat, { fpr() }, base(), 0, offset(4) };
+	case 9:
+		return { pick(2) ? IROp::FAdd : IROp::FMul, { fpr() }, fpr(), fpr() };
+	case 10:
+		if (pick(2))
+			return { IROp::Mult, { 0 }, gpr(), gpr() };
+		return { IROp::MfLo, { gpr() } };
+	default:
+		return { IROp::ExitToConstIfEq, { 255 }, gpr(), pick(2) ? gpr() : (u8)MIPS_REG_ZERO, DIFF_EXIT_PC + 4 };
+	}
+}
+
+static void RandomIRBlock(std::mt19937 &rng, IRWriter &ir) {
+	int count = 4 + (int)(rng() % 40);
+	for (int i = 0; i < count; ++i) {
+		IRInst inst = RandomIRInst(rng);
+		if ((inst.op == IROp::Store8 || inst.op == IROp::Store16) && (rng() % 4) == 0) {
+			// A run of adjacent zero stores.
+			int size = inst.op == IROp::Store8 ? 1 : 2;
+			for (int j = 0; j < 4; ++j)
+				ir.Write({ inst.op, { MIPS_REG_ZERO }, inst.src1, 0, inst.constant + j * size });
+			continue;
+		}
+		if (inst.op == IROp::FAdd && (rng() % 2) == 0) {
+			// Lane by lane vector math, the way VectorizeFloatOps wants it (unless there's a dependency.)
+			static const IROp vecOps[] = { IROp::FAdd, IROp::FSub, IROp::FMul, IROp::FMov, IROp::FNeg, IROp::FAbs };
+			static const u8 vecBases[] = { 0, 4, 32, 36, 40 };
+			IROp op = vecOps[rng() % ARRAY_SIZE(vecOps)];
+			u8 dest = vecBases[rng() % ARRAY_SIZE(vecBases)];
+			u8 src1 = vecBases[rng() % ARRAY_SIZE(vecBases)];
+			u8 src2 = vecBases[rng() % ARRAY_SIZE(vecBases)];
+			bool scalarSrc2 = op == IROp::FMul && (rng() % 2) == 0;
+			u8 order[4] = { 0, 1, 2, 3 };
+			std::shuffle(order, order + 4, rng);
+			for (int j = 0; j < 4; ++j)
+				ir.Write({ op, { (u8)(dest + order[j]) }, (u8)(src1 + order[j]), scalarSrc2 ? (u8)(src2 + 1) : (u8)(src2 + order[j]) });
+			continue;
+		}
+		ir.Write(inst);
+	}
+	ir.Write(IROp::ExitToConst, 0, ir.AddConstant(DIFF_EXIT_PC));
+}
+
+struct IRDiffState {
+	u32 pc;
+	u32 r[32];
+	u32 fi[32];
+	u32 vi[128];
+	u32 lo;
+	u32 hi;
+	u8 mem[DIFF_MEM_SIZE];
 };
 
+static void RunIRDiff(MIPSState *mips, const IRWriter &code, const void *const *handlers, u32 seed, IRDiffState &result) {
+	std::mt19937 rng(seed);
+	for (int i = 0; i < 32; ++i) {
+		mips->r[i] = rng();
+		// Keep the values in floats small to avoid NaN payload differences.
+		mips->f[i] = (float)(int)(rng() % 1000);
+	}
+	for (int i = 0; i < 128; ++i)
+		mips->v[i] = (float)(int)(rng() % 1000);
+	mips->r[MIPS_REG_ZERO] = 0;
+	mips->r[MIPS_REG_S0] = DIFF_MEM_BASE + 0x100;
+	mips->r[MIPS_REG_S1] = DIFF_MEM_BASE + 0x800;
+	mips->lo = rng();
+	mips->hi = rng();
+	u8 *mem = Memory::GetPointerWriteUnchecked(DIFF_MEM_BASE);
+	for (u32 i = 0; i < DIFF_MEM_SIZE; ++i)
+		mem[i] = (u8)rng();
+
+	if (handlers)
+		result.pc = IRInterpretThreaded(mips, code.GetInstructions().data(), handlers);
+	else
+		result.pc = IRInterpret(mips, code.GetInstructions().data());
+	memcpy(result.r, mips->r, sizeof(result.r));
+	memcpy(result.fi, mips->fi, sizeof(result.fi));
+	memcpy(result.vi, mips->vi, sizeof(result.vi));
+	result.lo = mips->lo;
+	result.hi = mips->hi;
+	memcpy(result.mem, mem, DIFF_MEM_SIZE);
+}
+
+static bool DiffPass(MIPSState *mips, const char *name, const IRPassFunc *passes, size_t c, const IROptions &opts, u32 seed) {
+	std::mt19937 rng(seed);
+	IRWriter in, out;
+	RandomIRBlock(rng, in);
+	IRApplyPasses(passes, c, in, out, opts);
+
+	std::string error;
+	if (c == 1 && !IRVerifyPassResult(in, out, &error)) {
+		printf("%s FAILED verification (seed %u): %s\n", name, seed, error.c_str());
+		LogInstructions(in.GetInstructions());
+		return false;
+	}
+
+	std::unique_ptr<IRDiffState> expected(new IRDiffState());
+	std::unique_ptr<IRDiffState> actual(new IRDiffState());
+	RunIRDiff(mips, in, nullptr, seed, *expected);
+	RunIRDiff(mips, out, nullptr, seed, *actual);
+	if (memcmp(expected.get(), actual.get(), sizeof(IRDiffState)) != 0) {
+		printf("%s FAILED differential test (seed %u)\nInput:\n", name, seed);
+		LogInstructions(in.GetInstructions());
+		printf("Output:\n");
+		LogInstructions(out.GetInstructions());
+		return false;
+	}
+	return true;
+}
+
+static bool DiffThreadedDispatch(MIPSState *mips, u32 seed) {
+	std::mt19937 rng(seed);
+	IRWriter code;
+	RandomIRBlock(rng, code);
+	const std::vector<IRInst> &insts = code.GetInstructions();
+	std::vector<const void *> handlers(insts.size());
+	IRTranslateToHandlers(insts.data(), insts.size(), handlers.data());
+
+	std::unique_ptr<IRDiffState> expected(new IRDiffState());
+	std::unique_ptr<IRDiffState> actual(new IRDiffState());
+	RunIRDiff(mips, code, nullptr, seed, *expected);
+	RunIRDiff(mips, code, handlers.data(), seed, *actual);
+	if (memcmp(expected.get(), actual.get(), sizeof(IRDiffState)) != 0) {
+		printf("ThreadedDispatch FAILED differential test (seed %u)\n", seed);
+		LogInstructions(insts);
+		return false;
+	}
+	return true;
+}
+
+static bool TestIRPassDifferential() {
+	struct DiffTest {
+		const char *name;
+		std::vector<IRPassFunc> passes;
+	};
+	static const DiffTest diffTests[] = {
+		{ "ReorderLoadStore", { &ReorderLoadStore } },
+		{ "MergeLoadStore", { &MergeLoadStore } },
+		{ "ThreeOpToTwoOp", { &ThreeOpToTwoOp } },
+		{ "VectorizeFloatOps", { &VectorizeFloatOps } },
+		{ "LoadStoreCombined", { &PropagateConstants, &PurgeTemps, &ReorderLoadStore, &MergeLoadStore, &ThreeOpToTwoOp } },
+	};
+
+	IROptions opts{};
+	opts.unalignedLoadStore = true;
+
+	Memory::g_MemorySize = Memory::RAM_NORMAL_SIZE;
+	Memory::Init(Memory::MemMapSetupFlags::Default);
+	std::unique_ptr<MIPSState> mips(new MIPSState());
+
+	bool success = true;
+	for (const auto &test : diffTests) {
+		for (u32 seed = 1; seed <= 2000 && success; ++seed) {
+			if (!DiffPass(mips.get(), test.name, test.passes.data(), test.passes.size(), opts, seed))
+				success = false;
+		}
+	}
+	if (IRThreadedDispatchAvailable()) {
+		for (u32 seed = 1; seed <= 2000 && success; ++seed) {
+			if (!DiffThreadedDispatch(mips.get(), seed))
+				success = false;
+		}
+	}
+
+	mips.reset();
+	Memory::Shutdown();
+	return success;
+}
+
 bool TestIRPassSimplify() {
 	InitIR();
 
@@ -176,5 +460,5 @@ bool TestIRPassSimplify() {
 			return false;
 	}
 
-	return true;
+	return TestIRPassDifferential();
 }
@@ -25,7 +25,7 @@
 // Or just integrate with an existing testing framework.
 //
 // To use, set command line parameter to one or more of the tests below, or "all".
-// Search for "availableTests".
+// Search for "availableTests". Benchmarks are in "availableBenchmarks", run them with "bench".
 //
 // Example of how to run with CMake:
 //
@@ -37,12 +37,22 @@
 #include <typeinfo>
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
 #include <cmath>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
 #include <vector>
 #include <string>
+#include <set>
+#include <thread>
 #include <sstream>
+#include <tuple>
+#include <unordered_map>
 
 #if PPSSPP_PLATFORM(ANDROID)
 #include <jni.h>
@@ -56,7 +66,9 @@
 #include "Common/Data/Text/WrapText.h"
 #include "Common/Data/Encoding/Utf8.h"
 #include "Common/Buffer.h"
+#include "Common/File/FileUtil.h"
 #include "Common/File/Path.h"
+#include "Common/Serialize/Serializer.h"
 #include "Common/Log/LogManager.h"
 #include "Common/Math/SIMDHeaders.h"
 #include "Common/Math/CrossSIMD.h"
@@ -70,8 +82,10 @@
 #include "Common/Render/DrawBuffer.h"
 #include "Common/System/NativeApp.h"
 #include "Common/System/System.h"
+#include "Common/Thread/ThreadManager.h"
 #include "Common/Thread/ThreadUtil.h"
 #include "Common/Data/Format/IniFile.h"
+#include "Common/Data/Random/Rng.h"
 #include "Common/TimeUtil.h"
 
 #include "Common/ArmEmitter.h"
@@ -80,15 +94,25 @@
 #include "Common/Log.h"
 #include "Common/StringUtils.h"
 #include "Core/Config.h"
+#include "Core/CoreTiming.h"
+#include "Core/Debugger/MemBlockInfo.h"
 #include "Common/Data/Convert/ColorConv.h"
 #include "Common/File/VFS/VFS.h"
 #include "Common/File/VFS/DirectoryReader.h"
 #include "Common/Math/fast/fast_matrix.h"
+#include "Core/FileSystems/DirectoryFileSystem.h"
 #include "Core/FileSystems/ISOFileSystem.h"
+#include "Core/FileSystems/MetaFileSystem.h"
+#include "Core/HLE/sceKernel.h"
+#include "Core/HW/AsyncIOManager.h"
 #include "Core/MemMap.h"
 #include "Core/KeyMap.h"
 #include "Core/Util/PathUtil.h"
+#include "Core/MIPS/MIPSAnalyst.h"
+#include "Core/MIPS/MIPSCodeUtils.h"
 #include "Core/MIPS/MIPSVFPUUtils.h"
+#include "Core/MIPS/JitCommon/JitBlockPageIndex.h"
+#include "Core/Util/BlockAllocator.h"
 #include "GPU/Common/TextureDecoder.h"
 #include "GPU/Common/GPUStateUtils.h"
 #include "GPU/Math3D.h"
@@ -1321,6 +1345,1151 @@ bool TestLang() {
 	return true;
 }
 
+struct IndexTestBlock {
+	u32 start;
+	u32 size;
+};
+
+static IndexTestBlock RandomIndexTestBlock(GMRng &rng) {
+	// Mostly small blocks in 24MB of user memory, with the occasional big one.
+	u32 start = (0x08800000 + (rng.R32() % 0x01800000)) & ~3;
+	u32 size = (rng.R32() & 15) == 0 ? 4 + (rng.R32() % 0x2000) : 4 + (rng.R32() % 0x100);
+	// Throw in some mirrors, the index should see through them.
+	if ((rng.R32() & 7) == 0)
+		start |= 0x40000000;
+	return IndexTestBlock{ start, size & ~3 };
+}
+
+// Runs a stream of random invalidations against a cache of 50k blocks, replacing each
+// destroyed block with a new one. Returns the total number of blocks destroyed.
+template <typename Find, typename Add, typename Remove>
+static int RunIndexInvalidations(int numInvalidations, std::vector<IndexTestBlock> &blocks, Find find, Add add, Remove remove) {
+	GMRng rng;
+	rng.Init(0x1234);
+	std::vector<int> found;
+	int destroyed = 0;
+	for (int i = 0; i < numInvalidations; i++) {
+		u32 start = 0x08800000 + (rng.R32() % 0x01800000);
+		// Mostly small writes, sometimes a big DMA or overlay load.
+		u32 size = (rng.R32() & 31) == 0 ? rng.R32() % 0x40000 : 4 + (rng.R32() % 0x400);
+		found.clear();
+		find(start, size, found);
+		// The order differs between implementations, keep the random stream in sync.
+		std::sort(found.begin(), found.end());
+		for (int b : found) {
+			remove(b);
+			blocks[b] = RandomIndexTestBlock(rng);
+			add(b);
+			destroyed++;
+		}
+	}
+	return destroyed;
+}
+
+bool TestJitBlockPageIndex() {
+	const int NUM_BLOCKS = 5000;
+	GMRng rng;
+	std::vector<IndexTestBlock> blocks;
+	for (int i = 0; i < NUM_BLOCKS; i++) {
+		blocks.push_back(RandomIndexTestBlock(rng));
+	}
+	auto overlaps = [&](int b, u32 start, u32 size) {
+		u32 bStart = blocks[b].start & 0x3FFFFFFF;
+		start &= 0x3FFFFFFF;
+		return bStart < start + size && bStart + blocks[b].size > start;
+	};
+
+	JitBlockPageIndex index(0x3FFFFFFF);
+	for (int i = 0; i < NUM_BLOCKS; i++) {
+		index.Add(i, blocks[i].start, blocks[i].size);
+	}
+
+	// Check against brute force, including that each block is only reported once.
+	for (int i = 0; i < 500; i++) {
+		u32 start = 0x08800000 + (rng.R32() % 0x01800000);
+		u32 size = (i & 15) == 0 ? rng.R32() % 0x100000 : 4 + (rng.R32() % 0x1000);
+		std::vector<int> found;
+		index.FindOverlapping(start | ((i & 1) ? 0x40000000 : 0), size, found);
+		std::sort(found.begin(), found.end());
+		EXPECT_TRUE(std::adjacent_find(found.begin(), found.end()) == found.end());
+
+		std::vector<int> expected;
+		for (int b = 0; b < NUM_BLOCKS; b++) {
+			if (overlaps(b, start, size))
+				expected.push_back(b);
+		}
+		EXPECT_EQ_INT(found.size(), expected.size());
+		EXPECT_TRUE(found == expected);
+	}
+
+	for (int i = 0; i < NUM_BLOCKS; i += 2) {
+		EXPECT_TRUE(index.Remove(i, blocks[i].start, blocks[i].size));
+		EXPECT_FALSE(index.Remove(i, blocks[i].start, blocks[i].size));
+	}
+	bool foundRemoved = false;
+	index.ForEachOverlapping(0x08800000, 0x01800000, [&](int b) {
+		if ((b & 1) == 0)
+			foundRemoved = true;
+	});
+	EXPECT_FALSE(foundRemoved);
+
+	// Start address lookups see every block touching the page.
+	bool foundStart = false;
+	index.ForEachInPage(blocks[1].start, [&](int b) {
+		if (b == 1)
+			foundStart = true;
+	});
+	EXPECT_TRUE(foundStart);
+
+	index.Clear();
+	EXPECT_EQ_INT(index.NumEntries(), 0);
+	index.ForEachOverlapping(0, 0x3FFFFFFF, [&](int b) {
+		foundRemoved = true;
+	});
+	EXPECT_FALSE(foundRemoved);
+	return true;
+}
+
+// A stress benchmark, against the (end, start) map JitBlockCache used to use.
+static bool BenchJitBlockPageIndex() {
+	const int NUM_BLOCKS = 50000;
+	const int NUM_INVALIDATIONS = 100000;
+	GMRng rng;
+	std::vector<IndexTestBlock> blocks;
+	for (int i = 0; i < NUM_BLOCKS; i++) {
+		blocks.push_back(RandomIndexTestBlock(rng));
+	}
+	auto overlaps = [&](int b, u32 start, u32 size) {
+		u32 bStart = blocks[b].start & 0x3FFFFFFF;
+		start &= 0x3FFFFFFF;
+		return bStart < start + size && bStart + blocks[b].size > start;
+	};
+
+	std::vector<IndexTestBlock> initial = blocks;
+	JitBlockPageIndex index(0x3FFFFFFF);
+	for (int i = 0; i < NUM_BLOCKS; i++) {
+		index.Add(i, blocks[i].start, blocks[i].size);
+	}
+	double st = time_now_d();
+	int indexDestroyed = RunIndexInvalidations(NUM_INVALIDATIONS, blocks, [&](u32 start, u32 size, std::vector<int> &found) {
+		index.FindOverlapping(start, size, found);
+	}, [&](int b) {
+		index.Add(b, blocks[b].start, blocks[b].size);
+	}, [&](int b) {
+		index.Remove(b, blocks[b].start, blocks[b].size);
+	});
+	double indexTime = time_now_d() - st;
+
+	blocks = initial;
+	// Keyed by (end, start, block), since blocks can share a range.
+	std::set<std::tuple<u32, u32, int>> blockMap;
+	auto mapKey = [&](int b) {
+		u32 start = blocks[b].start & 0x3FFFFFFF;
+		return std::make_tuple(start + blocks[b].size, start, b);
+	};
+	for (int i = 0; i < NUM_BLOCKS; i++) {
+		blockMap.insert(mapKey(i));
+	}
+	st = time_now_d();
+	int mapDestroyed = RunIndexInvalidations(NUM_INVALIDATIONS, blocks, [&](u32 start, u32 size, std::vector<int> &found) {
+		start &= 0x3FFFFFFF;
+		auto next = blockMap.lower_bound(std::make_tuple(start, 0, 0));
+		auto last = blockMap.upper_bound(std::make_tuple(start + size + 0x4000, 0, 0));
+		for (; next != last; ++next) {
+			if (std::get<1>(*next) < start + size && std::get<0>(*next) > start)
+				found.push_back(std::get<2>(*next));
+		}
+	}, [&](int b) {
+		blockMap.insert(mapKey(b));
+	}, [&](int b) {
+		blockMap.erase(mapKey(b));
+	});
+	double mapTime = time_now_d() - st;
+
+	// And against the per-page hash map of vectors IRBlockCache used to use.
+	blocks = initial;
+	std::unordered_map<u32, std::vector<int>> byPage;
+	auto forEachPage = [&](int b, const std::function<void(std::vector<int> &)> &func) {
+		u32 start = blocks[b].start & 0x3FFFFFFF;
+		for (u32 page = start >> 10; page <= (start + blocks[b].size) >> 10; ++page)
+			func(byPage[page]);
+	};
+	for (int i = 0; i < NUM_BLOCKS; i++) {
+		forEachPage(i, [&](std::vector<int> &list) { list.push_back(i); });
+	}
+	st = time_now_d();
+	int byPageDestroyed = RunIndexInvalidations(NUM_INVALIDATIONS, blocks, [&](u32 start, u32 size, std::vector<int> &found) {
+		for (u32 page = start >> 10; page <= (start + size) >> 10; ++page) {
+			auto iter = byPage.find(page);
+			if (iter == byPage.end())
+				continue;
+			for (int b : iter->second) {
+				if (overlaps(b, start, size) && std::find(found.begin(), found.end(), b) == found.end())
+					found.push_back(b);
+			}
+		}
+	}, [&](int b) {
+		forEachPage(b, [&](std::vector<int> &list) { list.push_back(b); });
+	}, [&](int b) {
+		forEachPage(b, [&](std::vector<int> &list) { list.erase(std::find(list.begin(), list.end(), b)); });
+	});
+	double byPageTime = time_now_d() - st;
+
+	printf("JitBlockPageIndex: %d invalidations, %d blocks destroyed: index %0.1f ms (%d KB), map %0.1f ms, byPage %0.1f ms\n", NUM_INVALIDATIONS, indexDestroyed, indexTime * 1000.0, (int)(index.MemoryUsage() / 1024), mapTime * 1000.0, byPageTime * 1000.0);
+	EXPECT_EQ_INT(indexDestroyed, mapDestroyed);
+	EXPECT_EQ_INT(indexDestroyed, byPageDestroyed);
+	return true;
+}
+
+static bool TestIdlePollingLoop() {
+	Memory::g_MemorySize = Memory::RAM_NORMAL_SIZE;
+	Memory::Init(Memory::MemMapSetupFlags::Default);
+
+	const u32 base = 0x08804000;
+	auto check = [&](std::initializer_list<u32> code, u32 branchAddr) {
+		u32 addr = base;
+		for (u32 op : code) {
+			Memory::Write_U32(op, addr);
+			addr += 4;
+		}
+		return MIPSAnalyst::IsIdlePollingLoop(base, branchAddr);
+	};
+	auto beq = [](int rs, int rt, int offs) { return 0x10000000 | (rs << 21) | (rt << 16) | (offs & 0xFFFF); };
+	auto beql = [](int rs, int rt, int offs) { return 0x50000000 | (rs << 21) | (rt << 16) | (offs & 0xFFFF); };
+	const int a0 = MIPS_REG_A0, a1 = MIPS_REG_A1, s0 = MIPS_REG_S0;
+
+	// lw a0, 0(s0); beq a0, zero, base; nop
+	EXPECT_TRUE(check({ MIPS_MAKE_LW(a0, s0, 0), (u32)beq(a0, 0, -2), MIPS_MAKE_NOP() }, base + 4));
+	// The address can be built inside the loop, and the delay slot can do work too.
+	EXPECT_TRUE(check({ MIPS_MAKE_LUI(s0, 0x0880), MIPS_MAKE_LW(a0, s0, 0x4000), (u32)beq(a0, 0, -3), 0x30840001 }, base + 8));
+	// A counter changes every iteration.
+	EXPECT_FALSE(check({ MIPS_MAKE_ADDIU(a0, a0, 0xFFFF), (u32)beq(a0, 0, -2), MIPS_MAKE_NOP() }, base + 4));
+	// So does a store.
+	EXPECT_FALSE(check({ 0xAC000000 | (s0 << 21) | (a1 << 16), MIPS_MAKE_LW(a0, s0, 0), (u32)beq(a0, 0, -3), MIPS_MAKE_NOP() }, base + 8));
+	// Likely branches skip the delay slot when exiting.
+	EXPECT_FALSE(check({ MIPS_MAKE_LW(a0, s0, 0), (u32)beql(a0, 0, -2), MIPS_MAKE_NOP() }, base + 4));
+	// Calls and other branches inside aren't simple polling.
+	EXPECT_FALSE(check({ MIPS_MAKE_JAL(0x08808000), MIPS_MAKE_NOP(), (u32)beq(a0, 0, -3), MIPS_MAKE_NOP() }, base + 8));
+
+	Memory::Shutdown();
+	return true;
+}
+
+static bool TestByteLoopMatch() {
+	Memory::g_MemorySize = Memory::RAM_NORMAL_SIZE;
+	Memory::Init(Memory::MemMapSetupFlags::Default);
+
+	const u32 base = 0x08804000;
+	auto match = [&](std::initializer_list<u32> code) {
+		u32 addr = base;
+		for (u32 op : code) {
+			Memory::Write_U32(op, addr);
+			addr += 4;
+		}
+		const char *name = MIPSAnalyst::MatchByteLoop(base, addr - base);
+		return std::string(name ? name : "");
+	};
+	auto addu = [](int rd, int rs, int rt) { return (u32)((rs << 21) | (rt << 16) | (rd << 11) | 0x21); };
+	auto subu = [](int rd, int rs, int rt) { return (u32)((rs << 21) | (rt << 16) | (rd << 11) | 0x23); };
+	auto addiu = [](int rt, int rs, int imm) { return (u32)MIPS_MAKE_ADDIU(rt, rs, imm & 0xFFFF); };
+	auto lb = [](int rt, int rs, int offs) { return (u32)(0x80000000 | (rs << 21) | (rt << 16) | (offs & 0xFFFF)); };
+	auto lbu = [](int rt, int rs, int offs) { return (u32)(0x90000000 | (rs << 21) | (rt << 16) | (offs & 0xFFFF)); };
+	auto sb = [](int rt, int rs, int offs) { return (u32)(0xA0000000 | (rs << 21) | (rt << 16) | (offs & 0xFFFF)); };
+	auto beq = [](int rs, int rt, int offs) { return (u32)(0x10000000 | (rs << 21) | (rt << 16) | (offs & 0xFFFF)); };
+	auto bne = [](int rs, int rt, int offs) { return (u32)(0x14000000 | (rs << 21) | (rt << 16) | (offs & 0xFFFF)); };
+	const int zero = MIPS_REG_ZERO, v0 = MIPS_REG_V0, v1 = MIPS_REG_V1, a0 = MIPS_REG_A0, a1 = MIPS_REG_A1, a2 = MIPS_REG_A2, a3 = MIPS_REG_A3, t0 = MIPS_REG_T0, s0 = MIPS_REG_S0;
+	const u32 jr_ra = MIPS_MAKE_JR_RA(), nop = MIPS_MAKE_NOP();
+
+	// Counting down, with a guard for zero bytes.
+	const std::string memsetLoop = match({ beq(a2, zero, 5), addu(v0, a0, zero), addiu(a2, a2, -1), sb(a1, a0, 0), bne(a2, zero, -3), addiu(a0, a0, 1), jr_ra, nop });
+	EXPECT_EQ_STR(memsetLoop, std::string("memset_byteloop"));
+	// Up to an end pointer, with the pointers stepped in different places.
+	const std::string memcpyLoop = match({ addu(a3, a0, a2), beq(a0, a3, 7), addu(v0, a0, zero), lbu(t0, a1, 0), addiu(a1, a1, 1), sb(t0, a0, 0), addiu(a0, a0, 1), bne(a0, a3, -5), nop, jr_ra, nop });
+	EXPECT_EQ_STR(memcpyLoop, std::string("memcpy_byteloop"));
+	const std::string strlenLoop = match({ addu(v0, a0, zero), lb(v1, v0, 0), bne(v1, zero, -2), addiu(v0, v0, 1), subu(v0, v0, a0), jr_ra, addiu(v0, v0, -1) });
+	EXPECT_EQ_STR(strlenLoop, std::string("strlen_byteloop"));
+
+	// Off by one in the return value.
+	EXPECT_EQ_STR(match({ addu(v0, a0, zero), lb(v1, v0, 0), bne(v1, zero, -2), addiu(v0, v0, 1), subu(v0, v0, a0), jr_ra, nop }), std::string());
+	// Decrementing in the delay slot runs once more than a2.
+	EXPECT_EQ_STR(match({ addu(v0, a0, zero), sb(a1, a0, 0), addiu(a0, a0, 1), bne(a2, zero, -3), addiu(a2, a2, -1), jr_ra, nop }), std::string());
+	// Returns the end, not dst.
+	EXPECT_EQ_STR(match({ addu(a3, a0, a2), lbu(t0, a1, 0), addiu(a1, a1, 1), sb(t0, a0, 0), addiu(a0, a0, 1), bne(a0, a3, -5), nop, jr_ra, addu(v0, a0, zero) }), std::string());
+	// Uses a saved register, which the caller would see unchanged after a replacement.
+	EXPECT_EQ_STR(match({ addu(s0, a0, a2), lbu(t0, a1, 0), addiu(a1, a1, 1), sb(t0, a0, 0), addiu(a0, a0, 1), bne(a0, s0, -5), nop, jr_ra, nop }), std::string());
+	// Stores a value carried over from the previous iteration.
+	EXPECT_EQ_STR(match({ addu(a3, a0, a2), sb(t0, a0, 0), lbu(t0, a1, 0), addiu(a1, a1, 1), addiu(a0, a0, 1), bne(a0, a3, -5), nop, jr_ra, nop }), std::string());
+
+	Memory::Shutdown();
+	return true;
+}
+
+// The sorted list CoreTiming used to use, as the reference for ordering.
+struct ListEventQueue {
+	std::list<CoreTiming::BaseEvent> events;
+
+	void Push(const CoreTiming::BaseEvent &ev) {
+		auto it = events.begin();
+		while (it != events.end() && it->time <= ev.time)
+			++it;
+		events.insert(it, ev);
+	}
+	bool Remove(int type, u64 userdata, s64 *lastTime) {
+		bool found = false;
+		for (auto it = events.begin(); it != events.end(); ) {
+			if (it->type == type && it->userdata == userdata) {
+				*lastTime = it->time;
+				found = true;
+				it = events.erase(it);
+			} else {
+				++it;
+			}
+		}
+		return found;
+	}
+};
+
+static bool TestCoreTimingQueue() {
+	GMRng rng;
+	CoreTiming::EventQueue queue;
+	ListEventQueue list;
+	auto same = [&](const CoreTiming::BaseEvent &a, const CoreTiming::BaseEvent &b) {
+		return a.time == b.time && a.userdata == b.userdata && a.type == b.type;
+	};
+
+	// Few distinct times, types and userdata, so there are plenty of ties and duplicates.
+	s64 now = 0;
+	for (int i = 0; i < 5000; i++) {
+		int type = rng.R32() % 8;
+		u64 userdata = rng.R32() % 16;
+		switch (rng.R32() % 8) {
+		case 0:
+		case 1:
+		case 2:
+		{
+			CoreTiming::BaseEvent ev{ now + (s64)(rng.R32() % 32), userdata, type };
+			queue.Push(ev);
+			list.Push(ev);
+			break;
+		}
+		case 3:
+			if (!list.events.empty()) {
+				CoreTiming::BaseEvent ev = queue.Pop();
+				EXPECT_TRUE(same(ev, list.events.front()));
+				list.events.pop_front();
+				now = ev.time;
+			}
+			break;
+		case 4:
+		{
+			s64 queueTime = 0, listTime = 0;
+			bool queueFound = queue.Remove(type, userdata, &queueTime);
+			bool listFound = list.Remove(type, userdata, &listTime);
+			EXPECT_EQ_INT(queueFound, listFound);
+			EXPECT_EQ_INT(queueTime, listTime);
+			break;
+		}
+		case 5:
+			if ((rng.R32() & 15) == 0) {
+				queue.RemoveType(type);
+				list.events.remove_if([&](const CoreTiming::BaseEvent &ev) { return ev.type == type; });
+			}
+			break;
+		default:
+		{
+			bool listHasType = std::any_of(list.events.begin(), list.events.end(), [&](const CoreTiming::BaseEvent &ev) { return ev.type == type; });
+			EXPECT_EQ_INT(queue.HasType(type), listHasType);
+			break;
+		}
+		}
+
+		EXPECT_EQ_INT(queue.Size(), list.events.size());
+		if (!list.events.empty())
+			EXPECT_TRUE(same(*queue.Top(), list.events.front()));
+	}
+
+	std::vector<CoreTiming::BaseEvent> sorted;
+	queue.GetSorted(sorted);
+	EXPECT_EQ_INT(sorted.size(), list.events.size());
+	EXPECT_TRUE(std::equal(sorted.begin(), sorted.end(), list.events.begin(), same));
+	return true;
+}
+
+// Lots of pending events (threads, alarms, vtimers...) getting rescheduled, unscheduled and run.
+static bool BenchCoreTimingQueue() {
+	const int NUM_PENDING = 4000;
+	const int NUM_OPS = 10000;
+	auto run = [&](auto &q, auto pop, auto top) {
+		GMRng benchRng;
+		s64 time = 0;
+		for (int i = 0; i < NUM_PENDING; i++)
+			q.Push(CoreTiming::BaseEvent{ (s64)(benchRng.R32() % 1000000), (u64)i, (int)(i % 16) });
+		double st = time_now_d();
+		s64 checksum = 0;
+		for (int i = 0; i < NUM_OPS; i++) {
+			u64 userdata = benchRng.R32() % NUM_PENDING;
+			if ((i & 1) == 0) {
+				s64 left;
+				if (q.Remove((int)(userdata % 16), userdata, &left))
+					checksum += left;
+				q.Push(CoreTiming::BaseEvent{ time + (s64)(benchRng.R32() % 1000000), userdata, (int)(userdata % 16) });
+			} else {
+				CoreTiming::BaseEvent ev = top(q);
+				pop(q);
+				time = ev.time;
+				checksum += ev.time;
+				q.Push(CoreTiming::BaseEvent{ time + (s64)(benchRng.R32() % 1000000), ev.userdata, ev.type });
+			}
+		}
+		return std::make_pair(time_now_d() - st, checksum);
+	};
+
+	CoreTiming::EventQueue benchQueue;
+	auto heapResult = run(benchQueue, [](CoreTiming::EventQueue &q) { q.Pop(); }, [](CoreTiming::EventQueue &q) { return *q.Top(); });
+	ListEventQueue benchList;
+	auto listResult = run(benchList, [](ListEventQueue &q) { q.events.pop_front(); }, [](ListEventQueue &q) { return q.events.front(); });
+	EXPECT_EQ_INT(heapResult.second, listResult.second);
+
+	printf("CoreTiming::EventQueue: %d pending, %d ops: heap %0.1f ms, sorted list %0.1f ms\n", NUM_PENDING, NUM_OPS, heapResult.first * 1000.0, listResult.first * 1000.0);
+	return true;
+}
+
+template <int TYPE>
+struct TestKernelObject : public KernelObject {
+	static u32 GetMissingErrorCode() { return 0x80020001; }
+	static int GetStaticIDType() { return TYPE; }
+	static const char *GetStaticTypeName() { return "Test"; }
+	int GetIDType() const override { return TYPE; }
+	void DoState(PointerWrap &p) override {}
+};
+typedef TestKernelObject<1> TestKernelObjectA;
+typedef TestKernelObject<2> TestKernelObjectB;
+
+static bool TestKernelObjectPool() {
+	std::unique_ptr<KernelObjectPool> pool(new KernelObjectPool());
+
+	// The first handle for each slot is still the old sequential ID.
+	SceUID a = pool->Create(new TestKernelObjectA());
+	SceUID b = pool->Create(new TestKernelObjectB());
+	SceUID c = pool->Create(new TestKernelObjectA());
+	EXPECT_EQ_INT(a, KernelObjectPool::initialNextID + KernelObjectPool::handleOffset);
+	EXPECT_EQ_INT(b, a + 1);
+	EXPECT_EQ_INT(c, a + 2);
+	EXPECT_EQ_INT(pool->GetCount(), 3);
+
+	u32 error;
+	EXPECT_TRUE(pool->Get<TestKernelObjectA>(a, error) != nullptr);
+	EXPECT_TRUE(pool->Get<TestKernelObjectA>(b, error) == nullptr);
+	EXPECT_EQ_INT(error, TestKernelObjectA::GetMissingErrorCode());
+	EXPECT_TRUE(pool->Is<TestKernelObjectB>(b));
+
+	// A destroyed handle stays invalid, even after its slot is used again.
+	u32 destroyError = pool->Destroy<TestKernelObjectA>(a);
+	EXPECT_EQ_INT(destroyError, 0);
+	EXPECT_FALSE(pool->IsValid(a));
+	destroyError = pool->Destroy<TestKernelObjectA>(a);
+	EXPECT_EQ_INT(destroyError, TestKernelObjectA::GetMissingErrorCode());
+
+	std::vector<SceUID> created;
+	SceUID reused = 0;
+	for (int i = 0; i < KernelObjectPool::maxCount - KernelObjectPool::initialNextID - 2; i++) {
+		SceUID id = pool->Create(new TestKernelObjectA());
+		if ((id & 0xFFFF) == (a & 0xFFFF))
+			reused = id;
+		created.push_back(id);
+	}
+	// Freed slots are only reused after all the others.
+	EXPECT_EQ_INT(created.back(), reused);
+	EXPECT_EQ_INT(pool->GetCount(), KernelObjectPool::maxCount - KernelObjectPool::initialNextID);
+	EXPECT_TRUE(reused > 0 && reused != a);
+	EXPECT_TRUE(pool->IsValid(reused));
+	EXPECT_FALSE(pool->IsValid(a));
+
+	// Typed iteration and listing only see their own type, in slot order.
+	int countB = 0;
+	pool->Iterate<TestKernelObjectB>([&](SceUID id, TestKernelObjectB *obj) {
+		countB++;
+		return id == b;
+	});
+	EXPECT_EQ_INT(countB, 1);
+
+	SceUID_le uids[4];
+	int total = pool->ListIDType(TestKernelObjectA::GetStaticIDType(), uids, 4);
+	EXPECT_EQ_INT(total, (int)created.size() + 1);
+	EXPECT_EQ_INT((SceUID)uids[0], reused);
+	EXPECT_EQ_INT((SceUID)uids[1], c);
+
+	// Destroying during iteration is allowed.
+	int visited = 0;
+	pool->Iterate<TestKernelObjectA>([&](SceUID id, TestKernelObjectA *obj) {
+		visited++;
+		pool->Destroy<TestKernelObjectA>(id);
+		return true;
+	});
+	EXPECT_EQ_INT(visited, total);
+	EXPECT_EQ_INT(pool->GetCount(), 1);
+
+	// The free ring has wrapped around by now. Saving must not change it.
+	std::vector<u8> saved, savedAgain;
+	EXPECT_TRUE(CChunkFileReader::MeasureAndSavePtr(*pool, &saved) == CChunkFileReader::ERROR_NONE);
+	EXPECT_TRUE(CChunkFileReader::MeasureAndSavePtr(*pool, &savedAgain) == CChunkFileReader::ERROR_NONE);
+	EXPECT_TRUE(saved == savedAgain);
+
+	// Every free slot is still handed out exactly once.
+	auto fillPool = [](KernelObjectPool &p, int expected) {
+		std::set<int> slots;
+		for (int i = 0; i < expected; i++) {
+			SceUID id = p.Create(new TestKernelObjectA());
+			if (id == 0 || !slots.insert(id & KernelObjectPool::indexMask).second)
+				return false;
+		}
+		return p.GetCount() == KernelObjectPool::maxCount - KernelObjectPool::initialNextID;
+	};
+	const int freeCount = KernelObjectPool::maxCount - KernelObjectPool::initialNextID - 1;
+	EXPECT_TRUE(fillPool(*pool, freeCount));
+
+	// Only kernel types can be loaded, so round trip an empty pool with a wrapped ring.
+	pool->Iterate<TestKernelObjectA>([&](SceUID id, TestKernelObjectA *obj) {
+		pool->Destroy<TestKernelObjectA>(id);
+		return true;
+	});
+	pool->Destroy<TestKernelObjectB>(b);
+	EXPECT_EQ_INT(pool->GetCount(), 0);
+	EXPECT_TRUE(CChunkFileReader::MeasureAndSavePtr(*pool, &saved) == CChunkFileReader::ERROR_NONE);
+
+	std::unique_ptr<KernelObjectPool> loaded(new KernelObjectPool());
+	std::string errorString;
+	EXPECT_TRUE(CChunkFileReader::LoadPtr(saved.data(), *loaded, &errorString) == CChunkFileReader::ERROR_NONE);
+	EXPECT_TRUE(CChunkFileReader::MeasureAndSavePtr(*loaded, &savedAgain) == CChunkFileReader::ERROR_NONE);
+	EXPECT_TRUE(saved == savedAgain);
+	// The loaded pool hands out the same slots in the same order.
+	for (int i = 0; i < 16; i++) {
+		SceUID original = pool->Create(new TestKernelObjectA());
+		EXPECT_EQ_INT(loaded->Create(new TestKernelObjectA()), original);
+	}
+	EXPECT_TRUE(fillPool(*loaded, freeCount + 1 - 16));
+	loaded->Clear();
+
+	pool->Clear();
+	EXPECT_EQ_INT(pool->GetCount(), 0);
+	return true;
+}
+
+// The list walking BlockAllocator as it used to be, to compare placement with.
+class ListBlockAllocator {
+public:
+	struct Block {
+		u32 start;
+		u32 size;
+		bool taken;
+	};
+	std::vector<Block> blocks;
+
+	ListBlockAllocator(u32 start, u32 size, u32 grain) : rangeSize_(size), grain_(grain) {
+		blocks.push_back(Block{ start, size, false });
+	}
+
+	u32 AllocAligned(u32 &size, u32 sizeGrain, u32 grain, bool fromTop) {
+		if (size == 0 || size > rangeSize_)
+			return -1;
+		grain = std::max(grain, grain_);
+		sizeGrain = std::max(sizeGrain, grain_);
+		size = (size + sizeGrain - 1) & ~(sizeGrain - 1);
+
+		for (size_t n = 0; n < blocks.size(); n++) {
+			size_t i = fromTop ? blocks.size() - 1 - n : n;
+			u32 offset;
+			if (fromTop) {
+				offset = (blocks[i].start + blocks[i].size - size) % grain;
+			} else {
+				offset = blocks[i].start % grain;
+				if (offset != 0)
+					offset = grain - offset;
+			}
+			u32 needed = offset + size;
+			if (blocks[i].taken || blocks[i].size < needed)
+				continue;
+			if (!fromTop) {
+				if (blocks[i].size != needed)
+					SplitAfter(i, blocks[i].size - needed);
+				if (offset >= grain_)
+					i = SplitBefore(i, offset);
+			} else {
+				if (blocks[i].size != needed)
+					i = SplitBefore(i, blocks[i].size - needed);
+				if (offset >= grain_)
+					SplitAfter(i, offset);
+			}
+			blocks[i].taken = true;
+			return blocks[i].start;
+		}
+		return -1;
+	}
+
+	u32 AllocAt(u32 position, u32 size) {
+		if (size > rangeSize_)
+			return -1;
+		u32 alignedPosition = position & ~(grain_ - 1);
+		u32 alignedSize = size + position - alignedPosition;
+		alignedSize = (alignedSize + grain_ - 1) & ~(grain_ - 1);
+
+		int i = Find(alignedPosition);
+		if (i < 0 || blocks[i].taken || blocks[i].start + blocks[i].size < alignedPosition + alignedSize)
+			return -1;
+		if (blocks[i].start != alignedPosition)
+			i = SplitBefore(i, alignedPosition - blocks[i].start);
+		if (blocks[i].size != alignedSize)
+			SplitAfter(i, blocks[i].size - alignedSize);
+		blocks[i].taken = true;
+		return position;
+	}
+
+	bool Free(u32 position, bool exact) {
+		int i = Find(position);
+		if (i < 0 || !blocks[i].taken || (exact && blocks[i].start != position))
+			return false;
+		blocks[i].taken = false;
+		while (i > 0 && !blocks[i - 1].taken) {
+			blocks[i - 1].size += blocks[i].size;
+			blocks.erase(blocks.begin() + i);
+			i--;
+		}
+		while (i + 1 < (int)blocks.size() && !blocks[i + 1].taken) {
+			blocks[i].size += blocks[i + 1].size;
+			blocks.erase(blocks.begin() + i + 1);
+		}
+		return true;
+	}
+
+	int Find(u32 addr) const {
+		for (size_t i = 0; i < blocks.size(); i++) {
+			if (blocks[i].start <= addr && blocks[i].start + blocks[i].size > addr)
+				return (int)i;
+		}
+		return -1;
+	}
+
+private:
+	// Splits size bytes off the front of block i as a free block, returns the new index of i.
+	size_t SplitBefore(size_t i, u32 size) {
+		Block inserted{ blocks[i].start, size, false };
+		blocks[i].start += size;
+		blocks[i].size -= size;
+		blocks.insert(blocks.begin() + i, inserted);
+		return i + 1;
+	}
+	void SplitAfter(size_t i, u32 size) {
+		blocks[i].size -= size;
+		blocks.insert(blocks.begin() + i + 1, Block{ blocks[i].start + blocks[i].size, size, false });
+	}
+
+	u32 rangeSize_;
+	u32 grain_;
+};
+
+static bool TestBlockAllocator() {
+	const u32 rangeStart = 0x08800000;
+	const u32 rangeSize = 0x00400000;
+	GMRng rng;
+	BlockAllocator alloc(256);
+	alloc.Init(rangeStart, rangeSize, false);
+	ListBlockAllocator list(rangeStart, rangeSize, 256);
+
+	std::vector<u32> allocated;
+	for (int i = 0; i < 20000; i++) {
+		// Mostly small sizes, so lots of blocks pile up and the tags and holes vary.
+		u32 size = rng.R32() % 8 == 0 ? rng.R32() % 0x40000 : rng.R32() % 0x2000 + 1;
+		bool fromTop = (rng.R32() & 1) != 0;
+		switch (rng.R32() % 6) {
+		case 0:
+		case 1:
+		{
+			u32 listSize = size;
+			u32 addr = alloc.Alloc(size, fromTop, "test");
+			u32 listAddr = list.AllocAligned(listSize, 256, 256, fromTop);
+			EXPECT_EQ_HEX(addr, listAddr);
+			EXPECT_EQ_HEX(size, listSize);
+			if (addr != (u32)-1)
+				allocated.push_back(addr);
+			break;
+		}
+		case 2:
+		{
+			u32 sizeGrain = 1 << (rng.R32() % 14);
+			u32 grain = 1 << (rng.R32() % 17);
+			u32 listSize = size;
+			u32 addr = alloc.AllocAligned(size, sizeGrain, grain, fromTop, "test");
+			u32 listAddr = list.AllocAligned(listSize, sizeGrain, grain, fromTop);
+			EXPECT_EQ_HEX(addr, listAddr);
+			EXPECT_EQ_HEX(size, listSize);
+			if (addr != (u32)-1)
+				allocated.push_back(addr);
+			break;
+		}
+		case 3:
+		{
+			u32 position = rangeStart + rng.R32() % rangeSize;
+			u32 addr = alloc.AllocAt(position, size, "test");
+			u32 listAddr = list.AllocAt(position, size);
+			EXPECT_EQ_HEX(addr, listAddr);
+			if (addr != (u32)-1)
+				allocated.push_back(addr);
+			break;
+		}
+		case 4:
+		case 5:
+			if (!allocated.empty()) {
+				size_t index = rng.R32() % allocated.size();
+				// Sometimes free by an address inside the block, or one that's already free.
+				u32 addr = allocated[index] + (rng.R32() % 4 == 0 ? rng.R32() % 0x100 : 0);
+				bool exact = (rng.R32() & 1) != 0;
+				bool freed = exact ? alloc.FreeExact(addr) : alloc.Free(addr);
+				bool listFreed = list.Free(addr, exact);
+				EXPECT_EQ_INT(freed, listFreed);
+				if (rng.R32() % 4 != 0) {
+					allocated[index] = allocated.back();
+					allocated.pop_back();
+				}
+			}
+			break;
+		}
+
+		if (i % 64 == 0) {
+			u32 largest = 0;
+			u32 total = 0;
+			for (const auto &b : list.blocks) {
+				if (!b.taken) {
+					largest = std::max(largest, b.size);
+					total += b.size;
+				}
+			}
+			EXPECT_EQ_HEX(alloc.GetLargestFreeBlockSize(), largest);
+			EXPECT_EQ_HEX(alloc.GetTotalFreeBytes(), total);
+			for (int j = 0; j < 16; j++) {
+				u32 addr = rangeStart + rng.R32() % rangeSize;
+				int b = list.Find(addr);
+				EXPECT_EQ_HEX(alloc.GetBlockStartFromAddress(addr), list.blocks[b].start);
+				EXPECT_EQ_HEX(alloc.GetBlockSizeFromAddress(addr), list.blocks[b].size);
+				EXPECT_EQ_INT(alloc.IsBlockFree(addr), !list.blocks[b].taken);
+			}
+		}
+	}
+
+	alloc.Shutdown();
+	return true;
+}
+
+// Files where each byte depends on the handle and offset. Reads are slow, so several are in flight at once.
+class SlowPatternFileSystem : public EmptyFileSystem {
+public:
+	explicit SlowPatternFileSystem(IHandleAllocator *hAlloc) : hAlloc_(hAlloc) {}
+
+	static u8 PatternByte(u32 handle, u32 offset) {
+		return (u8)(handle * 31 + offset * 7 + (offset >> 8));
+	}
+
+	int OpenFile(std::string filename, FileAccess access, const char *devicename = nullptr) override {
+		std::lock_guard<std::mutex> guard(lock_);
+		u32 handle = hAlloc_->GetNewHandle();
+		positions_[handle] = 0;
+		return (int)handle;
+	}
+	void CloseFile(u32 handle) override {
+		std::lock_guard<std::mutex> guard(lock_);
+		positions_.erase(handle);
+		hAlloc_->FreeHandle(handle);
+	}
+	bool OwnsHandle(u32 handle) override {
+		std::lock_guard<std::mutex> guard(lock_);
+		return positions_.find(handle) != positions_.end();
+	}
+	size_t ReadFile(u32 handle, u8 *pointer, s64 size) override {
+		int usec;
+		return ReadFile(handle, pointer, size, usec);
+	}
+	size_t ReadFile(u32 handle, u8 *pointer, s64 size, int &usec) override {
+		int active = ++active_;
+		int peak = peak_;
+		while (active > peak && !peak_.compare_exchange_weak(peak, active)) {
+		}
+
+		u32 pos;
+		{
+			std::lock_guard<std::mutex> guard(lock_);
+			pos = positions_[handle];
+			positions_[handle] += (u32)size;
+		}
+		std::this_thread::sleep_for(std::chrono::microseconds(500));
+		for (s64 i = 0; i < size; ++i)
+			pointer[i] = PatternByte(handle, pos + (u32)i);
+		usec = 100;
+
+		--active_;
+		return (size_t)size;
+	}
+	bool SupportsParallelIO() const override {
+		return true;
+	}
+
+	int PeakActive() const {
+		return peak_;
+	}
+
+private:
+	IHandleAllocator *hAlloc_;
+	std::mutex lock_;
+	std::map<u32, u32> positions_;
+	std::atomic<int> active_{};
+	std::atomic<int> peak_{};
+};
+
+static bool TestAsyncIOManager() {
+	auto fs = std::make_shared<SlowPatternFileSystem>(&pspFileSystem);
+	pspFileSystem.Mount("asynctest0:", fs);
+
+	const int FILES = 48;
+	const int ROUNDS = 8;
+	const int CHUNK = 0x800;
+	std::vector<u32> handles;
+	for (int i = 0; i < FILES; ++i)
+		handles.push_back((u32)fs->OpenFile("", FILEACCESS_READ));
+	std::vector<u8> buffers(FILES * CHUNK);
+
+	AsyncIOManager manager;
+	manager.StartWorkers(4);
+	bool success = true;
+	for (int round = 0; round < ROUNDS && success; ++round) {
+		// Like sceIoReadAsync on every file at once, one operation per file at a time.
+		for (int i = 0; i < FILES; ++i) {
+			AsyncIOEvent ev = IO_EVENT_READ;
+			ev.handle = handles[i];
+			ev.buf = &buffers[i * CHUNK];
+			ev.bytes = CHUNK;
+			ev.invalidateAddr = 0;
+			manager.ScheduleOperation(ev);
+			if (!manager.HasOperation(handles[i])) {
+				printf("Operation on %d missing in round %d\n", handles[i], round);
+				success = false;
+			}
+		}
+
+		// Pick them up in reverse, so most are finished and some are still waiting.
+		for (int i = FILES - 1; i >= 0; --i) {
+			if (manager.ResultFinishTicks(handles[i]) == 0) {
+				printf("No finish time for %d in round %d\n", handles[i], round);
+				success = false;
+			}
+			AsyncIOResult result;
+			if (!manager.WaitResult(handles[i], result) || result.result != CHUNK) {
+				printf("Bad result for %d in round %d\n", handles[i], round);
+				success = false;
+				continue;
+			}
+			if (manager.HasOperation(handles[i])) {
+				printf("Operation on %d still pending in round %d\n", handles[i], round);
+				success = false;
+			}
+			for (int j = 0; j < CHUNK; ++j) {
+				if (buffers[i * CHUNK + j] != SlowPatternFileSystem::PatternByte(handles[i], round * CHUNK + j)) {
+					printf("Wrong data for %d at %08x in round %d\n", handles[i], round * CHUNK + j, round);
+					success = false;
+					break;
+				}
+			}
+		}
+	}
+
+	// Reads without a result yet must be finished by SyncThread.
+	for (int i = 0; i < FILES; ++i) {
+		AsyncIOEvent ev = IO_EVENT_READ;
+		ev.handle = handles[i];
+		ev.buf = &buffers[i * CHUNK];
+		ev.bytes = CHUNK;
+		ev.invalidateAddr = 0;
+		manager.ScheduleOperation(ev);
+	}
+	manager.SyncThread();
+	for (int i = 0; i < FILES; ++i) {
+		if (!manager.HasResult(handles[i])) {
+			printf("No result for %d after SyncThread\n", handles[i]);
+			success = false;
+		}
+	}
+	manager.StopWorkers();
+	manager.Shutdown();
+
+	if (fs->PeakActive() < 2) {
+		printf("Reads never overlapped (peak %d)\n", fs->PeakActive());
+		success = false;
+	}
+
+	for (u32 handle : handles)
+		fs->CloseFile(handle);
+	pspFileSystem.Unmount("asynctest0:");
+	return success;
+}
+
+// A disc where each byte depends on its offset, except for the volume descriptor.
+class PatternBlockDevice : public BlockDevice {
+public:
+	PatternBlockDevice() : BlockDevice(nullptr) {}
+
+	static u8 PatternByte(u32 offset) {
+		return (u8)(offset * 13 + (offset >> 11));
+	}
+
+	bool ReadBlock(int blockNumber, u8 *outPtr, bool uncached = false) override {
+		for (int i = 0; i < 2048; ++i)
+			outPtr[i] = PatternByte(blockNumber * 2048 + i);
+		if (blockNumber == 16)
+			memcpy(outPtr + 1, "CD001", 5);
+		return true;
+	}
+	u32 GetNumBlocks() const override {
+		return 1024;
+	}
+	bool IsDisc() const override {
+		return true;
+	}
+};
+
+static bool TestISOReadAhead() {
+	const bool ownThreadManager = !g_threadManager.IsInitialized();
+	if (ownThreadManager)
+		g_threadManager.Init(2, 1);
+	g_Config.bISOReadAhead = true;
+	ResetISOReadAheadStats();
+
+	bool success = true;
+	{
+		ISOFileSystem fs(&pspFileSystem, std::make_shared<PatternBlockDevice>());
+		const u32 fileStart = 0x20 * 2048;
+		const u32 fileSize = 0x30000;
+		int handle = fs.OpenFile("/sce_lbn0x20_size0x30000", FILEACCESS_READ, "disc0:");
+		EXPECT_TRUE(handle > 0);
+
+		// Odd sized sequential reads, with a jump back in the middle.
+		std::vector<u8> chunk(0x1A00);
+		u32 pos = 0;
+		bool jumped = false;
+		while (pos < fileSize) {
+			size_t bytes = fs.ReadFile(handle, chunk.data(), chunk.size());
+			if (bytes != std::min((size_t)chunk.size(), (size_t)(fileSize - pos))) {
+				printf("Read %d bytes at %08x\n", (int)bytes, pos);
+				success = false;
+				break;
+			}
+			for (size_t i = 0; i < bytes; ++i) {
+				if (chunk[i] != PatternBlockDevice::PatternByte(fileStart + pos + (u32)i)) {
+					printf("Wrong data at %08x\n", pos + (u32)i);
+					success = false;
+					break;
+				}
+			}
+			pos += (u32)bytes;
+			if (!jumped && pos > fileSize / 2) {
+				jumped = true;
+				pos = 0x3000;
+				fs.SeekFile(handle, pos, FILEMOVE_BEGIN);
+			}
+		}
+		fs.CloseFile(handle);
+	}
+
+	// Even if every prefetch is still queued when it's needed and the reader does it itself,
+	// the next few reads hit, so this doesn't depend on how fast the pool is.
+	ISOReadAheadStats stats = GetISOReadAheadStats();
+	EXPECT_TRUE(stats.prefetches > 0);
+	EXPECT_TRUE(stats.hits > stats.reads / 2);
+
+	if (ownThreadManager)
+		g_threadManager.Teardown();
+	return success;
+}
+
+#if !PPSSPP_PLATFORM(WINDOWS)
+// A mixed case tree under a temporary directory, and the same paths in upper case like games use.
+static Path MakeMixedCaseTree(const char *name, int numDirs, int filesPerDir, std::vector<std::string> &realNames, std::vector<std::string> &guestNames) {
+	const char *tmpDir = getenv("TMPDIR");
+	const Path root = Path(tmpDir && *tmpDir ? tmpDir : "/tmp") / name;
+	File::DeleteDirRecursively(root);
+
+	for (int d = 0; d < numDirs; d++) {
+		std::string dir = StringFromFormat("SaveData/Ulus%05dData", d);
+		File::CreateFullPath(root / dir);
+		for (int f = 0; f < filesPerDir; f++) {
+			std::string name = dir + StringFromFormat("/File%03d.Bin", f);
+			File::CreateEmptyFile(root / name);
+			realNames.push_back(name);
+			for (char &c : name)
+				c = (char)toupper((unsigned char)c);
+			guestNames.push_back(name);
+		}
+	}
+	return root;
+}
+#endif
+
+static bool TestPathCaseCache() {
+#if PPSSPP_PLATFORM(WINDOWS)
+	return true;
+#else
+	const int NUM_DIRS = 5;
+	std::vector<std::string> realNames;
+	std::vector<std::string> guestNames;
+	const Path root = MakeMixedCaseTree("ppsspp_pathcase_test", NUM_DIRS, 4, realNames, guestNames);
+
+	PathCaseCache cache(root);
+	for (size_t i = 0; i < guestNames.size(); i++) {
+		std::string name = guestNames[i];
+		EXPECT_TRUE(cache.FixPathCase(name, FPC_FILE_MUST_EXIST));
+		EXPECT_EQ_STR(name, realNames[i]);
+	}
+	// Each directory is listed once, plus the root and SaveData.
+	EXPECT_EQ_INT(cache.ListedCount(), NUM_DIRS + 2);
+
+	// Partial paths behave the same.
+	std::string missing = "SAVEDATA/ULUS00001DATA/NEW/FILE.BIN";
+	EXPECT_FALSE(cache.FixPathCase(missing, FPC_PATH_MUST_EXIST));
+	EXPECT_TRUE(cache.FixPathCase(missing, FPC_PARTIAL_ALLOWED));
+	EXPECT_EQ_STR(missing, std::string("SaveData/Ulus00001Data/NEW/FILE.BIN"));
+	std::string created = "SAVEDATA/ULUS00001DATA/NEWFILE.BIN";
+	EXPECT_TRUE(cache.FixPathCase(created, FPC_PATH_MUST_EXIST));
+	EXPECT_FALSE(cache.FixPathCase(created, FPC_FILE_MUST_EXIST));
+
+	// Our own writes invalidate right away.
+	File::CreateEmptyFile(root / "SaveData/Ulus00001Data/NewFile.bin");
+	cache.Invalidate("SAVEDATA/ULUS00001DATA/NEWFILE.BIN");
+	created = "SAVEDATA/ULUS00001DATA/NEWFILE.BIN";
+	EXPECT_TRUE(cache.FixPathCase(created, FPC_FILE_MUST_EXIST));
+	EXPECT_EQ_STR(created, std::string("SaveData/Ulus00001Data/NewFile.bin"));
+
+	// Others' writes are caught by the modification time, once it ticks.
+	std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	File::CreateEmptyFile(root / "SaveData/Ulus00002Data/Other.bin");
+	std::string other = "SAVEDATA/ULUS00002DATA/OTHER.BIN";
+	EXPECT_TRUE(cache.FixPathCase(other, FPC_FILE_MUST_EXIST));
+	EXPECT_EQ_STR(other, std::string("SaveData/Ulus00002Data/Other.bin"));
+
+	// An exact name wins over others that only differ in case.
+	File::CreateEmptyFile(root / "SaveData/Ulus00003Data/FILE000.BIN");
+	cache.Invalidate("SaveData/Ulus00003Data/FILE000.BIN");
+	std::string exact = "SaveData/Ulus00003Data/File000.Bin";
+	EXPECT_TRUE(cache.FixPathCase(exact, FPC_FILE_MUST_EXIST));
+	EXPECT_EQ_STR(exact, std::string("SaveData/Ulus00003Data/File000.Bin"));
+	exact = "SaveData/Ulus00003Data/FILE000.BIN";
+	EXPECT_TRUE(cache.FixPathCase(exact, FPC_FILE_MUST_EXIST));
+	EXPECT_EQ_STR(exact, std::string("SaveData/Ulus00003Data/FILE000.BIN"));
+
+	// Removing a directory forgets what was below it.
+	File::DeleteDirRecursively(root / "SaveData/Ulus00004Data");
+	cache.Invalidate("SAVEDATA/ULUS00004DATA");
+	std::string removed = "SAVEDATA/ULUS00004DATA/FILE000.BIN";
+	EXPECT_FALSE(cache.FixPathCase(removed, FPC_PATH_MUST_EXIST));
+
+	File::DeleteDirRecursively(root);
+	return true;
+#endif
+}
+
+// Looking up 10k files in a mixed case tree, against plain FixPathCase().
+static bool BenchPathCaseCache() {
+#if PPSSPP_PLATFORM(WINDOWS)
+	return true;
+#else
+	std::vector<std::string> realNames;
+	std::vector<std::string> guestNames;
+	const Path root = MakeMixedCaseTree("ppsspp_pathcase_bench", 100, 100, realNames, guestNames);
+
+	PathCaseCache cache(root);
+	auto run = [&](auto fix) {
+		double st = time_now_d();
+		for (size_t i = 0; i < guestNames.size(); i++) {
+			std::string name = guestNames[i];
+			if (!fix(name, FPC_FILE_MUST_EXIST) || name != realNames[i]) {
+				printf("Wrong case for %s: %s\n", guestNames[i].c_str(), name.c_str());
+				return -1.0;
+			}
+		}
+		return time_now_d() - st;
+	};
+	double uncachedTime = run([&](std::string &name, FixPathCaseBehavior behavior) { return FixPathCase(root, name, behavior); });
+	double cachedTime = run([&](std::string &name, FixPathCaseBehavior behavior) { return cache.FixPathCase(name, behavior); });
+	File::DeleteDirRecursively(root);
+	EXPECT_TRUE(uncachedTime >= 0.0 && cachedTime >= 0.0);
+
+	printf("PathCaseCache: %d files, FixPathCase %0.1f ms, cached %0.1f ms (%d directories listed)\n", (int)guestNames.size(), uncachedTime * 1000.0, cachedTime * 1000.0, cache.ListedCount());
+	return true;
+#endif
+}
+
+// Each thread writes its own 1024 slots of 0x100 bytes over and over, alternating two tags.
+static void RunMemInfoNotifyThreads(int numThreads, int numNotifies) {
+	const MemBlockFlags writeFlags = MemBlockFlags::WRITE | MemBlockFlags::SKIP_MEMCHECK;
+	std::vector<std::thread> threads;
+	for (int t = 0; t < numThreads; t++) {
+		threads.emplace_back([t, numNotifies, writeFlags] {
+			const uint32_t base = 0x08a00000 + t * 0x00100000;
+			for (int i = 0; i < numNotifies; i++) {
+				const char *name = (i & 1) ? "NotifyOdd" : "NotifyEven";
+				NotifyMemInfoPC(writeFlags, base + (i % 1024) * 0x100, 0x100, 0x08804000 + i * 4, name, strlen(name));
+			}
+		});
+	}
+	for (auto &thread : threads)
+		thread.join();
+}
+
+static bool TestMemBlockInfo() {
+	MemBlockInfoInit();
+	const MemBlockFlags writeFlags = MemBlockFlags::WRITE | MemBlockFlags::SKIP_MEMCHECK;
+
+	// Writes keep their tag, frees keep the allocation's tag but aren't allocated.
+	NotifyMemInfoPC(MemBlockFlags::ALLOC, 0x08900000, 0x1000, 0x08804000, "TestAlloc", 9);
+	NotifyMemInfoPC(writeFlags, 0x08900100, 0x200, 0x08804010, "TestWrite", 9);
+	NotifyMemInfoPC(MemBlockFlags::FREE, 0x08900000, 0x1000, 0x08804020, "", 0);
+	std::vector<MemBlockInfo> info = FindMemInfoByFlag(MemBlockFlags::WRITE, 0x48900100, 1);
+	EXPECT_EQ_INT((int)info.size(), 1);
+	EXPECT_EQ_HEX(info[0].start, 0x08900100);
+	EXPECT_EQ_HEX(info[0].size, 0x200);
+	EXPECT_EQ_STR(info[0].tag, std::string("TestWrite"));
+	info = FindMemInfoByFlag(MemBlockFlags::ALLOC, 0x08900800, 1);
+	EXPECT_EQ_INT((int)info.size(), 1);
+	EXPECT_EQ_HEX(info[0].start, 0x08900000);
+	EXPECT_FALSE(info[0].allocated);
+	EXPECT_EQ_STR(info[0].tag, std::string("TestAlloc"));
+
+	char tag[128];
+	FormatMemWriteTagAt(tag, sizeof(tag), "Copy/", 0x08900180, 0x10);
+	EXPECT_EQ_STR(std::string(tag), std::string("Copy/TestWrite"));
+
+	// Notifies from several threads, more than a flush can keep up with, and different tags that don't merge.
+	const int NUM_THREADS = 4;
+	RunMemInfoNotifyThreads(NUM_THREADS, 8192);
+	for (int t = 0; t < NUM_THREADS; t++) {
+		// The last notify for this slot had an odd i.
+		info = FindMemInfoByFlag(MemBlockFlags::WRITE, 0x08a00000 + t * 0x00100000 + 1023 * 0x100, 0x100);
+		EXPECT_EQ_INT((int)info.size(), 1);
+		EXPECT_EQ_STR(info[0].tag, std::string("NotifyOdd"));
+	}
+
+	MemBlockInfoShutdown();
+	return true;
+}
+
+static bool BenchMemBlockInfo() {
+	MemBlockInfoInit();
+	const int NUM_THREADS = 4;
+	const int NUM_NOTIFIES = 250000;
+	double st = time_now_d();
+	RunMemInfoNotifyThreads(NUM_THREADS, NUM_NOTIFIES);
+	double elapsed = time_now_d() - st;
+
+	printf("MemBlockInfo: %d threads, %0.2f million notifies/sec\n", NUM_THREADS, NUM_THREADS * NUM_NOTIFIES / elapsed / 1000000.0);
+	MemBlockInfoShutdown();
+	return true;
+}
+
 typedef bool (*TestFunc)();
 struct TestItem {
 	const char *name;
@@ -1364,6 +2533,16 @@ TestItem availableTests[] = {
 	TEST_ITEM(Parsers),
 	TEST_ITEM(IRPassSimplify),
 	TEST_ITEM(Jit),
+	TEST_ITEM(JitBlockPageIndex),
+	TEST_ITEM(IdlePollingLoop),
+	TEST_ITEM(ByteLoopMatch),
+	TEST_ITEM(CoreTimingQueue),
+	TEST_ITEM(KernelObjectPool),
+	TEST_ITEM(BlockAllocator),
+	TEST_ITEM(MemBlockInfo),
+	TEST_ITEM(AsyncIOManager),
+	TEST_ITEM(ISOReadAhead),
+	TEST_ITEM(PathCaseCache),
 	TEST_ITEM(VFPUMatrixTranspose),
 	TEST_ITEM(ParseLBN),
 	TEST_ITEM(QuickTexHash),
@@ -1395,6 +2574,17 @@ TestItem availableTests[] = {
 	TEST_ITEM(Lang),
 };
 
+// Timings against the code something replaced. Not part of "all", run them with "bench" or by name.
+#define BENCH_ITEM(name) { "Bench" #name, &Bench ##name, }
+
+TestItem availableBenchmarks[] = {
+	BENCH_ITEM(JitBlockPageIndex),
+	BENCH_ITEM(CoreTimingQueue),
+	BENCH_ITEM(MemBlockInfo),
+	BENCH_ITEM(PathCaseCache),
+	BENCH_ITEM(IRSyscalls),
+};
+
 int main(int argc, const char *argv[]) {
 	SetCurrentThreadName("UnitTest");
 	TimeInit();
@@ -1411,10 +2601,13 @@ int main(int argc, const char *argv[]) {
 	g_logManager.DisableOutput(LogOutput::DebugString);  // not really needed
 
 	bool allTests = false;
+	bool allBenchmarks = false;
 	TestFunc testFunc = nullptr;
 	if (argc >= 2) {
 		if (!strcasecmp(argv[1], "all")) {
 			allTests = true;
+		} else if (!strcasecmp(argv[1], "bench")) {
+			allBenchmarks = true;
 		}
 		for (auto f : availableTests) {
 			if (!strcasecmp(argv[1], f.name)) {
@@ -1422,13 +2615,24 @@ int main(int argc, const char *argv[]) {
 				break;
 			}
 		}
+		for (auto f : availableBenchmarks) {
+			if (!strcasecmp(argv[1], f.name)) {
+				testFunc = f.func;
+				break;
+			}
+		}
 	}
 
-	if (allTests) {
+	if (allTests || allBenchmarks) {
 		int passes = 0;
 		int fails = 0;
 		std::vector<const char *> failedTests;
-		for (const auto &f : availableTests) {
+		std::vector<TestItem> items;
+		if (allTests)
+			items.assign(std::begin(availableTests), std::end(availableTests));
+		else
+			items.assign(std::begin(availableBenchmarks), std::end(availableBenchmarks));
+		for (const auto &f : items) {
 			printf("\n**** Running test %s ****\n", f.name);
 			if (f.func()) {
 				++passes;
@@ -1455,6 +2659,11 @@ int main(int argc, const char *argv[]) {
 		for (auto f : availableTests) {
 			fprintf(stderr, "  * %s\n", f.name);
 		}
+		fprintf(stderr, "\n");
+		fprintf(stderr, "Available benchmarks (or \"bench\" for all of them):\n");
+		for (auto f : availableBenchmarks) {
+			fprintf(stderr, "  * %s\n", f.name);
+		}
 		return 1;
 	} else {
 		if (!testFunc()) {